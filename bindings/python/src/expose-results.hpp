@@ -44,7 +44,17 @@ exposeResults(pybind11::module_ m)
     .def_readwrite("sparse_backend",
                    &Info<T>::sparse_backend,
                    "Sparse backend used to solve the qp, either SparseCholesky "
-                   "or MatrixFree.");
+                   "or MatrixFree.")
+    .def_readwrite("sparse_ordering",
+                   &Info<T>::sparse_ordering,
+                   "Fill reducing ordering of the sparse KKT factorization.")
+    .def_readwrite("factor_nnz",
+                   &Info<T>::factor_nnz,
+                   "Predicted number of non zeros of the sparse KKT factor.")
+    .def_readwrite("factor_flops",
+                   &Info<T>::factor_flops,
+                   "Predicted number of floating point operations of the "
+                   "sparse KKT factorization.");
 
   ::pybind11::class_<Results<T>>(m, "Results", pybind11::module_local())
     .def(::pybind11::init<i64, i64, i64>(),
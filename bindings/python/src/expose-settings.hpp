@@ -32,6 +32,15 @@ exposeSettings(pybind11::module_ m)
     .value("SparseCholesky", SparseBackend::SparseCholesky)
     .export_values();
 
+  ::pybind11::enum_<SparseOrdering>(
+    m, "SparseOrdering", pybind11::module_local())
+    .value("Automatic", SparseOrdering::Automatic)
+    .value("Natural", SparseOrdering::Natural)
+    .value("AMD", SparseOrdering::AMD)
+    .value("ConstrainedAMD", SparseOrdering::ConstrainedAMD)
+    .value("NestedDissection", SparseOrdering::NestedDissection)
+    .export_values();
+
   ::pybind11::class_<Settings<T>>(m, "Settings", pybind11::module_local())
     .def(::pybind11::init(), "Default constructor.") // constructor
     .def_readwrite("default_rho", &Settings<T>::default_rho)
@@ -67,7 +76,16 @@ exposeSettings(pybind11::module_ m)
                    &Settings<T>::compute_preconditioner)
     .def_readwrite("update_preconditioner", &Settings<T>::update_preconditioner)
     .def_readwrite("verbose", &Settings<T>::verbose)
-    .def_readwrite("bcl_update", &Settings<T>::bcl_update);
+    .def_readwrite("bcl_update", &Settings<T>::bcl_update)
+    .def_readwrite("nb_threads", &Settings<T>::nb_threads)
+    .def_readwrite("packed_factorization", &Settings<T>::packed_factorization)
+    .def_readwrite("mixed_precision_factorization",
+                   &Settings<T>::mixed_precision_factorization)
+    .def_readwrite("supernodal_factorization",
+                   &Settings<T>::supernodal_factorization)
+    .def_readwrite("sparse_ordering", &Settings<T>::sparse_ordering)
+    .def_readwrite("sparse_factorization_memory_budget",
+                   &Settings<T>::sparse_factorization_memory_budget);
 }
 } // namespace python
 } // namespace proxqp
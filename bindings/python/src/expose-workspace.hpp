@@ -66,6 +66,10 @@ exposeWorkspaceDense(pybind11::module_ m)
                   &Workspace<T>::primal_residual_in_scaled_up_plus_alphaCdx)
     .def_readonly("primal_residual_in_scaled_low_plus_alphaCdx",
                   &Workspace<T>::primal_residual_in_scaled_low_plus_alphaCdx)
+    .def_readonly("Hx", &Workspace<T>::Hx)
+    .def_readonly("Ax", &Workspace<T>::Ax)
+    .def_readonly("Cx", &Workspace<T>::Cx)
+    .def_readonly("ATy", &Workspace<T>::ATy)
     .def_readonly("CTz", &Workspace<T>::CTz);
 }
 } // namespace python
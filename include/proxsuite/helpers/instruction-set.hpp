@@ -11,6 +11,8 @@
 #include <vector>
 #include <bitset>
 #include <array>
+#include <cstring>
+#include <string>
 
 #ifndef _WIN32
 #include <cpuid.h>
@@ -42,6 +44,21 @@ cpuidex(std::array<int, 4>& cpui, int level, int count)
 #endif
 }
 
+// extended control register 0, describing the register states enabled by the
+// operating system. only valid when OSXSAVE is supported.
+inline unsigned long long
+xgetbv0()
+{
+#ifndef _WIN32
+  unsigned int eax = 0;
+  unsigned int edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#else
+  return static_cast<unsigned long long>(_xgetbv(0));
+#endif
+}
+
 template<typename T = void>
 struct InstructionSetBase
 {
@@ -147,9 +164,9 @@ protected:
   static const Data data;
 };
 
-template<>
-const typename InstructionSetBase<>::Data InstructionSetBase<>::data =
-  typename InstructionSetBase<>::Data();
+template<typename T>
+const typename InstructionSetBase<T>::Data InstructionSetBase<T>::data =
+  typename InstructionSetBase<T>::Data();
 } // namespace internal
 
 // Adapted from
@@ -269,6 +286,39 @@ struct InstructionSet : public internal::InstructionSetBase<>
   }
 };
 
+/// @brief \brief Widest vector extension that the dense kernels can use on the
+/// running host.
+enum struct SimdLevel
+{
+  Default, // instruction set the library was compiled for.
+  AVX2,    // AVX2 + FMA.
+  AVX512,  // AVX512F + AVX2 + FMA.
+};
+
+/// @brief \brief Detects the widest vector extension supported by the running
+/// host. The detection is performed once, the first time this function is
+/// called.
+inline SimdLevel
+runtime_simd_level()
+{
+  static const SimdLevel level = []() -> SimdLevel {
+    if (!InstructionSet::has_OSXSAVE()) {
+      return SimdLevel::Default;
+    }
+    // the ymm (resp. zmm) registers must also be saved by the OS
+    unsigned long long xcr0 = internal::xgetbv0();
+    if ((xcr0 & 0x6) != 0x6 || !InstructionSet::has_AVX2() ||
+        !InstructionSet::has_FMA()) {
+      return SimdLevel::Default;
+    }
+    if ((xcr0 & 0xe6) == 0xe6 && InstructionSet::has_AVX512F()) {
+      return SimdLevel::AVX512;
+    }
+    return SimdLevel::AVX2;
+  }();
+  return level;
+}
+
 } // helpers
 } // proxsuite
 
@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2022 INRIA
+//
+/**
+ * @file memory.hpp
+ */
+
+#ifndef PROXSUITE_HELPERS_MEMORY_HPP
+#define PROXSUITE_HELPERS_MEMORY_HPP
+
+#include <proxsuite/linalg/veg/internal/typedefs.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace proxsuite {
+namespace helpers {
+
+using proxsuite::linalg::veg::isize;
+
+/// @brief \brief Returns the size in bytes of the physical memory of the
+/// machine, or -1 if it cannot be queried on this platform.
+inline isize
+physical_memory() noexcept
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  long nb_pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (nb_pages > 0 && page_size > 0) {
+    return isize(nb_pages) * isize(page_size);
+  }
+#endif
+  return -1;
+}
+
+} // namespace helpers
+} // namespace proxsuite
+
+#endif /* end of include guard PROXSUITE_HELPERS_MEMORY_HPP */
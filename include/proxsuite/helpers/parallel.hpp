@@ -0,0 +1,232 @@
+//
+// Copyright (c) 2022 INRIA
+//
+/**
+ * @file parallel.hpp
+ */
+
+#ifndef PROXSUITE_HELPERS_PARALLEL_HPP
+#define PROXSUITE_HELPERS_PARALLEL_HPP
+
+#include <proxsuite/linalg/veg/internal/typedefs.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace proxsuite {
+namespace helpers {
+
+using proxsuite::linalg::veg::isize;
+
+/// @brief \brief Returns the number of threads to use for a requested thread
+/// count. A non positive request is interpreted as "use all the available
+/// hardware threads".
+inline isize
+resolve_nb_threads(isize nb_threads) noexcept
+{
+  if (nb_threads > 0) {
+    return nb_threads;
+  }
+  isize hw = isize(std::thread::hardware_concurrency());
+  return hw > 0 ? hw : 1;
+}
+
+/// @brief \brief Pool of worker threads that are kept alive between the
+/// parallel loops, so that the loops do not pay for the creation of their
+/// threads. The workers are created on demand, and wait on a condition
+/// variable while the pool is idle.
+class ThreadPool
+{
+public:
+  ThreadPool() = default;
+  ThreadPool(ThreadPool const&) = delete;
+  auto operator=(ThreadPool const&) -> ThreadPool& = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    start_cv.notify_all();
+    for (auto& t : workers) {
+      t.join();
+    }
+  }
+
+  /// @brief \brief Returns the pool of the calling thread, which is shared by
+  /// all the parallel loops it starts.
+  static auto local() -> ThreadPool&
+  {
+    static thread_local ThreadPool pool;
+    return pool;
+  }
+
+  /// @brief \brief Returns true on the worker threads of all the pools.
+  static auto is_worker() noexcept -> bool&
+  {
+    static thread_local bool worker = false;
+    return worker;
+  }
+
+  /// @brief \brief Runs fn(0), ..., fn(n_tasks - 1) on at most nb_threads
+  /// threads, the calling thread included, and returns once all the tasks are
+  /// done. When the pool is already running a loop started by the calling
+  /// thread, or when the calling thread is itself a worker of a pool, the
+  /// tasks are run sequentially. The first exception thrown by a task is
+  /// rethrown once all the threads are done.
+  template<typename Fn>
+  void run(isize nb_threads, isize n_tasks, Fn& fn)
+  {
+    if (nb_threads > n_tasks) {
+      nb_threads = n_tasks;
+    }
+    if (nb_threads <= 1 || busy || is_worker()) {
+      for (isize i = 0; i < n_tasks; ++i) {
+        fn(i);
+      }
+      return;
+    }
+
+    busy = true;
+    grow(nb_threads - 1);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task_fn = [](void* ctx, isize i) { (*static_cast<Fn*>(ctx))(i); };
+      task_ctx = const_cast<void*>(static_cast<void const*>(&fn));
+      task_count = n_tasks;
+      next_task.store(0, std::memory_order_relaxed);
+      nb_active = nb_threads - 1;
+      nb_pending = nb_threads - 1;
+      error = nullptr;
+      ++generation;
+    }
+    start_cv.notify_all();
+
+    // the tasks reference the caller's frame, so the workers are waited for
+    // even if a task of the calling thread throws
+    struct Wait
+    {
+      ThreadPool& pool;
+      ~Wait()
+      {
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.done_cv.wait(lock, [this] { return pool.nb_pending == 0; });
+        pool.busy = false;
+      }
+    };
+    {
+      Wait wait{ *this };
+      run_tasks();
+    }
+    if (error) {
+      std::exception_ptr e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  void grow(isize nb_workers)
+  {
+    isize k = isize(workers.size());
+    if (k >= nb_workers) {
+      return;
+    }
+    workers.reserve(std::size_t(nb_workers));
+    std::uint64_t current = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = generation;
+    }
+    for (; k < nb_workers; ++k) {
+      workers.emplace_back([this, k, current] { work(k, current); });
+    }
+  }
+
+  void run_tasks()
+  {
+    while (true) {
+      isize i = next_task.fetch_add(1, std::memory_order_relaxed);
+      if (i >= task_count) {
+        break;
+      }
+      task_fn(task_ctx, i);
+    }
+  }
+
+  void work(isize k, std::uint64_t seen)
+  {
+    is_worker() = true;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [&] { return stop || generation != seen; });
+        if (stop) {
+          return;
+        }
+        seen = generation;
+        if (k >= nb_active) {
+          continue;
+        }
+      }
+      std::exception_ptr e;
+      try {
+        run_tasks();
+      } catch (...) {
+        e = std::current_exception();
+        // the remaining tasks are skipped
+        next_task.store(task_count, std::memory_order_relaxed);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (e && !error) {
+          error = e;
+        }
+        --nb_pending;
+        if (nb_pending == 0) {
+          done_cv.notify_one();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  // the current loop, published under the mutex with a new generation
+  std::uint64_t generation = 0;
+  void (*task_fn)(void*, isize) = nullptr;
+  void* task_ctx = nullptr;
+  isize task_count = 0;
+  std::atomic<isize> next_task{ 0 };
+  isize nb_active = 0;
+  isize nb_pending = 0;
+  // first exception thrown by a task of a worker
+  std::exception_ptr error;
+  bool stop = false;
+  // only accessed by the thread owning the pool
+  bool busy = false;
+};
+
+/// @brief \brief Runs fn(0), ..., fn(n_tasks - 1) on at most nb_threads
+/// threads, the calling thread included. Tasks are handed out dynamically in
+/// increasing order, so fn must not depend on which thread executes it.
+/// Returns once all the tasks are done. The other threads are the workers of
+/// the pool of the calling thread, which are reused by the following calls.
+template<typename Fn>
+void
+parallel_for(isize nb_threads, isize n_tasks, Fn&& fn)
+{
+  ThreadPool::local().run(nb_threads, n_tasks, fn);
+}
+
+} // helpers
+} // proxsuite
+
+#endif // ifndef PROXSUITE_HELPERS_PARALLEL_HPP
@@ -18,6 +18,19 @@
 #include <cmath> // to avoid error of the type no member named 'isnan' in namespace 'std';
 #include <simde/x86/avx2.h>
 #include <simde/x86/fma.h>
+
+// on x86 hosts, the hot kernels are additionally compiled for AVX2 and AVX512
+// and selected at runtime, unless the library is already built for AVX512.
+#if !defined(PROXSUITE_DISABLE_RUNTIME_DISPATCH) &&                            \
+  (defined(__GNUC__) || defined(__clang__)) &&                                 \
+  (defined(__x86_64__) || defined(__i386__)) && !defined(__AVX512F__)
+#define PROXSUITE_LINALG_RUNTIME_DISPATCH
+#include <simde/x86/avx512.h>
+#include <proxsuite/helpers/instruction-set.hpp>
+#define PROXSUITE_LINALG_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define PROXSUITE_LINALG_TARGET_AVX512                                         \
+  __attribute__((target("avx512f,avx2,fma")))
+#endif
 #endif
 
 #include <Eigen/Core>
@@ -186,7 +199,19 @@ struct Pack<f32, 8>
   LDLT_LOAD_STORE(256, ps);
 };
 
-#ifdef __AVX512F__
+#if defined(PROXSUITE_LINALG_RUNTIME_DISPATCH)
+// only used from kernels compiled with PROXSUITE_LINALG_TARGET_AVX512, where
+// the simde fallback is lowered to native instructions
+template<>
+struct Pack<f32, 16>
+{
+  using ScalarType = f32;
+
+  simde__m512 inner;
+  LDLT_ARITHMETIC_IMPL(512, ps)
+  LDLT_LOAD_STORE(512, ps);
+};
+#elif defined(__AVX512F__)
 template<>
 struct Pack<f32, 16>
 {
@@ -236,7 +261,17 @@ struct Pack<f64, 4>
   LDLT_LOAD_STORE(256, pd);
 };
 
-#ifdef __AVX512F__
+#if defined(PROXSUITE_LINALG_RUNTIME_DISPATCH)
+template<>
+struct Pack<f64, 8>
+{
+  using ScalarType = f64;
+
+  simde__m512d inner;
+  LDLT_ARITHMETIC_IMPL(512, pd)
+  LDLT_LOAD_STORE(512, pd);
+};
+#elif defined(__AVX512F__)
 template<>
 struct Pack<f64, 8>
 {
@@ -298,6 +333,96 @@ using NativePack = typename NativePackInfo<T>::Type;
 
 namespace _detail {
 using proxsuite::linalg::veg::uncvref_t;
+
+template<usize... Is, typename Fn>
+VEG_INLINE void
+unroll_impl(proxsuite::linalg::veg::meta::index_sequence<Is...> /*unused*/,
+            Fn fn)
+{
+  VEG_EVAL_ALL(fn(Is));
+}
+
+template<usize N, typename Fn>
+VEG_INLINE void
+unroll(Fn fn)
+{
+  _detail::unroll_impl(proxsuite::linalg::veg::meta::make_index_sequence<N>{},
+                       VEG_FWD(fn));
+}
+
+// acc -= cols[c][i:i + N] × p_x[c], for the column c of a group of columns
+// that are swept together
+template<typename T, usize N>
+struct ColumnsFnmadd
+{
+  _simd::Pack<T, N>& acc;
+  T const* const* cols;
+  _simd::Pack<T, N> const* p_x;
+  isize i;
+
+  VEG_INLINE void operator()(usize c) const
+  {
+    acc = _simd::Pack<T, N>::fnmadd(
+      _simd::Pack<T, N>::load_unaligned(cols[c] + i), p_x[c], acc);
+  }
+};
+
+// width of the packs following the ones of N elements in a tail loop, the
+// narrowest vector packs holding 128 bits
+template<typename T, usize N>
+using narrower_pack_width = proxsuite::linalg::veg::meta::
+  constant<usize, (N / 2 * sizeof(T) < 16) ? 1 : N / 2>;
+
+// dst[i:n] -= cols[0:K][i:n] × x[0:K], with packs of N elements, followed by
+// packs of decreasing width for the remaining rows
+template<usize K, usize N>
+struct ColumnsFnmaddRows
+{
+  template<typename T>
+  VEG_INLINE static void fn(T* dst,
+                            T const* const* cols,
+                            T const* x,
+                            isize i,
+                            isize n) noexcept
+  {
+    using Pack = _simd::Pack<T, N>;
+    Pack p_x[K];
+    for (usize c = 0; c < K; ++c) {
+      p_x[c] = Pack::broadcast(x[c]);
+    }
+    for (; i + isize(N) <= n; i += isize(N)) {
+      Pack acc = Pack::load_unaligned(dst + i);
+      _detail::unroll<K>(ColumnsFnmadd<T, N>{ acc, cols, p_x, i });
+      acc.store_unaligned(dst + i);
+    }
+    ColumnsFnmaddRows<K, narrower_pack_width<T, N>::value>::fn(
+      dst, cols, x, i, n);
+  }
+};
+
+template<usize K>
+struct ColumnsFnmaddRows<K, 1>
+{
+  template<typename T>
+  VEG_INLINE static void fn(T* dst,
+                            T const* const* cols,
+                            T const* x,
+                            isize i,
+                            isize n) noexcept
+  {
+    using Scalar = _simd::Pack<T, 1>;
+    Scalar p_x[K];
+    for (usize c = 0; c < K; ++c) {
+      p_x[c] = { x[c] };
+    }
+    for (; i < n; ++i) {
+      Scalar acc{ dst[i] };
+      _detail::unroll<K>(ColumnsFnmadd<T, 1>{ acc, cols, p_x, i });
+      dst[i] = acc.inner;
+    }
+  }
+};
+
 template<bool COND, typename T>
 using const_if = proxsuite::linalg::veg::meta::if_t<COND, T const, T>;
 
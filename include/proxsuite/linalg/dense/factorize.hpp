@@ -6,12 +6,165 @@
 #define PROXSUITE_LINALG_DENSE_LDLT_FACTORIZE_HPP
 
 #include "proxsuite/linalg/dense/core.hpp"
+#include "proxsuite/helpers/parallel.hpp"
 #include <algorithm>
+#include <mutex>
 #include <proxsuite/linalg/veg/memory/dynamic_stack.hpp>
 
 namespace proxsuite {
 namespace linalg {
 namespace dense {
+
+/*!
+ * Tunable parameters of the dense LDLT factorization kernels.
+ */
+struct FactorizeParams
+{
+  /// width of the column panels of the blocked factorization.
+  isize block_size;
+  /// size below which the recursive factorization switches to the unblocked
+  /// kernel.
+  isize recursive_threshold;
+  /// size above which the blocked factorization is preferred to the
+  /// recursive one.
+  isize blocked_threshold;
+};
+
+namespace _detail {
+template<typename T>
+auto
+default_factorize_params() noexcept -> FactorizeParams
+{
+#ifdef PROXSUITE_WITH_BLAS
+  return { 128, 32, 2 * 128 - 1 };
+#else
+  return { 128, 32, 2048 };
+#endif
+}
+
+// parameters requested with set_factorize_params, which are frozen the first
+// time they are read by a factorization or a memory requirement
+template<typename T>
+struct FactorizeParamsState
+{
+  std::mutex mutex;
+  bool frozen = false;
+  FactorizeParams params = _detail::default_factorize_params<T>();
+};
+
+template<typename T>
+auto
+factorize_params_state() noexcept -> FactorizeParamsState<T>&
+{
+  static FactorizeParamsState<T> state;
+  return state;
+}
+
+template<typename T>
+auto
+freeze_factorize_params() noexcept -> FactorizeParams
+{
+  FactorizeParamsState<T>& state = _detail::factorize_params_state<T>();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.frozen = true;
+  return state.params;
+}
+
+// parameters that factorize_params returns, without freezing them
+template<typename T>
+auto
+current_factorize_params() noexcept -> FactorizeParams
+{
+  FactorizeParamsState<T>& state = _detail::factorize_params_state<T>();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.params;
+}
+
+inline auto
+same_factorize_params(FactorizeParams a, FactorizeParams b) noexcept -> bool
+{
+  return a.block_size == b.block_size &&
+         a.recursive_threshold == b.recursive_threshold &&
+         a.blocked_threshold == b.blocked_threshold;
+}
+} // namespace _detail
+
+/*!
+ * Returns the parameters used by `factorize` and `factorize_req` for the
+ * scalar type `T`. The first call freezes them for the rest of the program, so
+ * that all the memory requirements and the factorizations agree on them, and
+ * so that they can be read concurrently.
+ */
+template<typename T>
+auto
+factorize_params() noexcept -> FactorizeParams
+{
+  static FactorizeParams const params =
+    _detail::freeze_factorize_params<T>();
+  return params;
+}
+
+/*!
+ * Returns whether the parameters of the scalar type `T` are frozen, i.e.
+ * whether they were already used by a factorization or a memory requirement.
+ */
+template<typename T>
+auto
+factorize_params_frozen() noexcept -> bool
+{
+  _detail::FactorizeParamsState<T>& state =
+    _detail::factorize_params_state<T>();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.frozen;
+}
+
+/*!
+ * Sets the parameters used by `factorize` and `factorize_req` for the scalar
+ * type `T`, e.g. from the output of `tune_factorize_params`. Non positive
+ * values are replaced by the defaults.
+ * The parameters can only be changed until they are first used, see
+ * `factorize_params`, so this should be done at the start of the program.
+ *
+ * @param params new parameters
+ * @return whether `params` are the parameters in use after the call
+ */
+template<typename T>
+auto
+set_factorize_params(FactorizeParams params) noexcept -> bool
+{
+  FactorizeParams defaults = _detail::default_factorize_params<T>();
+  if (params.block_size <= 0) {
+    params.block_size = defaults.block_size;
+  }
+  if (params.recursive_threshold <= 0) {
+    params.recursive_threshold = defaults.recursive_threshold;
+  }
+  if (params.blocked_threshold <= 0) {
+    params.blocked_threshold = defaults.blocked_threshold;
+  }
+  _detail::FactorizeParamsState<T>& state =
+    _detail::factorize_params_state<T>();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.frozen) {
+    state.params = params;
+  }
+  return _detail::same_factorize_params(state.params, params);
+}
+
+/*!
+ * Restores the default parameters for the scalar type `T`, if they were not
+ * used yet, see `set_factorize_params`.
+ *
+ * @return whether the default parameters are in use after the call
+ */
+template<typename T>
+auto
+reset_factorize_params() noexcept -> bool
+{
+  return proxsuite::linalg::dense::set_factorize_params<T>(
+    _detail::default_factorize_params<T>());
+}
+
 namespace _detail {
 
 template<typename T>
@@ -86,33 +239,39 @@ apply_permutation_tri_lower(Mat&& mat, Work&& work, isize const* perm_indices)
     work.template triangularView<Eigen::Lower>();
 }
 
-template<typename Mat>
-void
-factorize_unblocked_impl(Mat mat,
-                         proxsuite::linalg::veg::dynstack::DynStackMut stack)
+// number of columns of l20 that are read together by the unblocked
+// factorization, so that l21 is loaded and stored once per group
+using factorize_unblocked_width =
+  proxsuite::linalg::veg::meta::constant<usize, 4>;
+
+// l21 -= l20[:, k:k + K] × work[k:k + K], where l21 is the subdiagonal part of
+// the column j of l
+template<usize K, usize N, typename T>
+VEG_INLINE void
+factorize_unblocked_group(T* l,
+                          isize stride,
+                          isize n,
+                          isize j,
+                          isize k,
+                          T const* work) noexcept
 {
-  // left looking cholesky
-  // https://en.wikipedia.org/wiki/Cholesky_decomposition#LDL_decomposition_2
-
-  using T = typename Mat::Scalar;
-  isize n = mat.rows();
-  if (n == 0) {
-    return;
+  T const* cols[K];
+  for (usize c = 0; c < K; ++c) {
+    cols[c] = l + (k + isize(c)) * stride;
   }
+  ColumnsFnmaddRows<K, N>::fn(l + j * stride, cols, work + k, j + 1, n);
+}
 
-  auto _work = stack.make_new_for_overwrite( //
-    proxsuite::linalg::veg::Tag<T>{},
-    n,
-    _detail::align<T>());
-  auto work_storage =
-    Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, 1>, Eigen::Unaligned>{
-      _work.ptr_mut(),
-      n,
-      1,
-    };
+// left looking cholesky of the n×n matrix l, stored column major with the
+// given stride, using packs of N elements
+// https://en.wikipedia.org/wiki/Cholesky_decomposition#LDL_decomposition_2
+template<usize N, typename T>
+VEG_INLINE void
+factorize_unblocked_loop(T* l, isize stride, isize n, T* work) noexcept
+{
+  constexpr usize K = factorize_unblocked_width::value;
 
-  isize j = 0;
-  while (true) {
+  for (isize j = 0; j < n; ++j) {
     /*
      *     L00
      * l = l10  1
@@ -125,26 +284,103 @@ factorize_unblocked_impl(Mat mat,
      * compute d1 and l21
      */
 
-    auto l10 = util::subcols(util::row(mat, j), 0, j);
-    auto d0 = util::subrows(mat.diagonal(), 0, j);
-    auto work = util::subrows(work_storage, 0, j);
-
-    work = util::trans(l10).cwiseProduct(d0);
-    mat(j, j) -= work.dot(l10);
+    // work = D0 × l10ᵀ
+    T* lj = l + j * stride;
+    T dj = lj[j];
+    for (isize k = 0; k < j; ++k) {
+      T ljk = l[k * stride + j];
+      work[k] = ljk * l[k * stride + k];
+      dj -= work[k] * ljk;
+    }
+    lj[j] = dj;
 
     if (j + 1 == n) {
       break;
     }
 
-    isize rem = n - j - 1;
+    isize n_grouped = j / isize(K) * isize(K);
+    for (isize k = 0; k < n_grouped; k += isize(K)) {
+      _detail::factorize_unblocked_group<K, N>(l, stride, n, j, k, work);
+    }
+    for (isize k = n_grouped; k < j; ++k) {
+      _detail::factorize_unblocked_group<1, N>(l, stride, n, j, k, work);
+    }
+
+    T inv = T(1) / dj;
+    for (isize i = j + 1; i < n; ++i) {
+      lj[i] *= inv;
+    }
+  }
+}
+
+template<typename T>
+using FactorizeUnblockedFn = void (*)(T*, isize, isize, T*);
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<typename T>
+PROXSUITE_LINALG_TARGET_AVX2 void
+factorize_unblocked_loop_avx2(T* l, isize stride, isize n, T* work) noexcept
+{
+  _detail::factorize_unblocked_loop<32 / sizeof(T)>(l, stride, n, work);
+}
+
+template<typename T>
+PROXSUITE_LINALG_TARGET_AVX512 void
+factorize_unblocked_loop_avx512(T* l, isize stride, isize n, T* work) noexcept
+{
+  _detail::factorize_unblocked_loop<64 / sizeof(T)>(l, stride, n, work);
+}
+#endif
+
+template<typename T, bool VECTORIZABLE = should_vectorize<T>::value>
+struct FactorizeUnblockedTable
+{
+  static auto get() noexcept -> FactorizeUnblockedFn<T>
+  {
+    return factorize_unblocked_loop<_simd::NativePackInfo<T>::N, T>;
+  }
+};
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<typename T>
+struct FactorizeUnblockedTable<T, true>
+{
+  // the kernel is selected once, depending on the instruction set of the
+  // running host
+  static auto get() noexcept -> FactorizeUnblockedFn<T>
+  {
+    switch (proxsuite::helpers::runtime_simd_level()) {
+      case proxsuite::helpers::SimdLevel::AVX512:
+        return factorize_unblocked_loop_avx512<T>;
+      case proxsuite::helpers::SimdLevel::AVX2:
+        return factorize_unblocked_loop_avx2<T>;
+      default:
+        return factorize_unblocked_loop<_simd::NativePackInfo<T>::N, T>;
+    }
+  }
+};
+#endif
 
-    auto l20 = util::submatrix(mat, j + 1, 0, rem, j);
-    auto l21 = util::subrows(util::col(mat, j), j + 1, rem);
+template<typename Mat>
+void
+factorize_unblocked_impl(Mat mat,
+                         proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  static_assert(Mat::InnerStrideAtCompileTime == 1, ".");
+  static_assert(!bool(Mat::IsRowMajor), ".");
 
-    util::noalias_mul_add(l21, l20, work, T(-1));
-    l21 *= 1 / mat(j, j);
-    ++j;
+  using T = typename Mat::Scalar;
+  isize n = mat.rows();
+  if (n == 0) {
+    return;
   }
+
+  auto _work = stack.make_new_for_overwrite( //
+    proxsuite::linalg::veg::Tag<T>{},
+    n,
+    _detail::align<T>());
+  _detail::FactorizeUnblockedTable<T>::get()(
+    mat.data(), mat.outerStride(), n, _work.ptr_mut());
 }
 
 template<typename Mat>
@@ -209,12 +445,102 @@ factorize_blocked_impl(Mat mat,
   }
 }
 
-using factorize_recursive_threshold =
-  proxsuite::linalg::veg::meta::constant<isize, 32>;
+template<typename Mat>
+void
+factorize_blocked_parallel_impl(
+  Mat mat,
+  isize block_size,
+  isize nb_threads,
+  proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  // right looking blocked cholesky, where the panel solve and the trailing
+  // update are split into tiles of block_size rows/columns that are
+  // distributed over nb_threads threads.
+  // each tile is computed by exactly one thread, so the result does not depend
+  // on the scheduling.
+
+  using T = typename Mat::Scalar;
+  VEG_ASSERT(mat.rows() == mat.cols());
+
+  isize n = mat.rows();
+
+  if (n == 0) {
+    return;
+  }
+
+  isize j = 0;
+  while (true) {
+    isize bs = min2(n - j, block_size);
+
+    auto ld11 = util::submatrix(mat, j, j, bs, bs);
+    auto d1 = util::diagonal(ld11);
+    _detail::factorize_unblocked_impl(ld11, stack);
+
+    if (j + bs == n) {
+      break;
+    }
+    isize rem = n - j - bs;
+
+    isize work_stride = _detail::adjusted_stride<T>(rem);
+
+    auto _work = stack.make_new_for_overwrite( //
+      proxsuite::linalg::veg::Tag<T>{},
+      bs * work_stride,
+      _detail::align<T>());
+
+    auto work = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>,
+                           Eigen::Unaligned,
+                           Eigen::OuterStride<Eigen::Dynamic>>{
+      _work.ptr_mut(),
+      rem,
+      bs,
+      Eigen::OuterStride<Eigen::Dynamic>{ work_stride },
+    };
+
+    auto l21 = util::submatrix(mat, j + bs, j, rem, bs);
+    auto l22 = util::submatrix(mat, j + bs, j + bs, rem, rem);
+
+    isize n_tiles = (rem + block_size - 1) / block_size;
+
+    proxsuite::helpers::parallel_for(nb_threads, n_tiles, [&](isize t) {
+      isize i0 = t * block_size;
+      isize ts = min2(rem - i0, block_size);
+
+      auto l21_t = util::subrows(l21, i0, ts);
+      auto work_t = util::subrows(work, i0, ts);
+
+      util::trans(ld11)
+        .template triangularView<Eigen::UnitUpper>()
+        .template solveInPlace<Eigen::OnTheRight>(l21_t);
+
+      work_t = l21_t;
+      l21_t = l21_t * d1.asDiagonal().inverse();
+    });
+
+    proxsuite::helpers::parallel_for(nb_threads, n_tiles, [&](isize t) {
+      isize c0 = t * block_size;
+      isize ts = min2(rem - c0, block_size);
+
+      auto l22_diag = util::submatrix(l22, c0, c0, ts, ts);
+      l22_diag.template triangularView<Eigen::Lower>() -=
+        util::subrows(l21, c0, ts) * util::trans(util::subrows(work, c0, ts));
+
+      isize below = rem - c0 - ts;
+      if (below > 0) {
+        auto l22_below = util::submatrix(l22, c0 + ts, c0, below, ts);
+        l22_below.noalias() -= util::subrows(l21, c0 + ts, below) *
+                               util::trans(util::subrows(work, c0, ts));
+      }
+    });
+
+    j += bs;
+  }
+}
 
 template<typename Mat>
 void
 factorize_recursive_impl(Mat mat,
+                         isize threshold,
                          proxsuite::linalg::veg::dynstack::DynStackMut stack)
 {
   // right looking recursive cholesky
@@ -224,7 +550,7 @@ factorize_recursive_impl(Mat mat,
 
   isize n = mat.rows();
 
-  if (n < factorize_recursive_threshold::value) {
+  if (n < threshold) {
     _detail::factorize_unblocked_impl(mat, stack);
   } else {
     /*
@@ -246,7 +572,7 @@ factorize_recursive_impl(Mat mat,
     auto l10 = util::submatrix(mat, bs, 0, rem, bs);
     auto l11 = util::submatrix(mat, bs, bs, rem, rem);
 
-    _detail::factorize_recursive_impl(l00, stack);
+    _detail::factorize_recursive_impl(l00, threshold, stack);
     auto d0 = util::diagonal(l00);
 
     isize work_stride = _detail::adjusted_stride<T>(rem);
@@ -275,7 +601,7 @@ factorize_recursive_impl(Mat mat,
       l11.template triangularView<Eigen::Lower>() -= l10 * util::trans(work);
     }
 
-    _detail::factorize_recursive_impl(l11, stack);
+    _detail::factorize_recursive_impl(l11, threshold, stack);
   }
 }
 } // namespace _detail
@@ -312,9 +638,11 @@ auto
 factorize_recursive_req(proxsuite::linalg::veg::Tag<T> tag, isize n) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
+  isize threshold = proxsuite::linalg::dense::factorize_params<T>()
+                      .recursive_threshold;
   auto req0 = proxsuite::linalg::dense::factorize_unblocked_req(
-    tag, _detail::min2(n, _detail::factorize_recursive_threshold::value));
-  if (n < _detail::factorize_recursive_threshold::value) {
+    tag, _detail::min2(n, threshold));
+  if (n < threshold) {
     return req0;
   }
   isize bs = (n + 1) / 2;
@@ -342,10 +670,24 @@ factorize_blocked(Mat&& mat,
 }
 template<typename Mat>
 void
+factorize_blocked_parallel(Mat&& mat,
+                           isize block_size,
+                           isize nb_threads,
+                           proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  _detail::factorize_blocked_parallel_impl(
+    util::to_view_dyn(mat), block_size, nb_threads, stack);
+}
+template<typename Mat>
+void
 factorize_recursive(Mat&& mat,
                     proxsuite::linalg::veg::dynstack::DynStackMut stack)
 {
-  _detail::factorize_recursive_impl(util::to_view_dyn(mat), stack);
+  using T = typename proxsuite::linalg::veg::uncvref_t<Mat>::Scalar;
+  _detail::factorize_recursive_impl(
+    util::to_view_dyn(mat),
+    proxsuite::linalg::dense::factorize_params<T>().recursive_threshold,
+    stack);
 }
 
 template<typename T>
@@ -353,21 +695,76 @@ auto
 factorize_req(proxsuite::linalg::veg::Tag<T> tag, isize n) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
-  return proxsuite::linalg::dense::factorize_blocked_req(tag, n, 128) |
+  return proxsuite::linalg::dense::factorize_blocked_req(
+           tag, n, proxsuite::linalg::dense::factorize_params<T>().block_size) |
          proxsuite::linalg::dense::factorize_recursive_req(tag, n);
 }
 
+/*!
+ * Computes the decomposition of the lower triangular part of `mat` in place.
+ * The blocked variant is used above `factorize_params<T>().blocked_threshold`,
+ * the recursive one otherwise. When proxsuite is built with
+ * `BUILD_WITH_BLAS_SUPPORT`, the default threshold is lowered so that the
+ * blocked variant is used for all but the smallest matrices, since its panel
+ * solves and trailing updates are the products that get forwarded to the BLAS
+ * library.
+ * The memory requirements are given by `factorize_req`.
+ *
+ * @param mat matrix to decompose
+ * @param stack workspace memory stack
+ */
 template<typename Mat>
 void
 factorize(Mat&& mat, proxsuite::linalg::veg::dynstack::DynStackMut stack)
 {
+  using T = typename proxsuite::linalg::veg::uncvref_t<Mat>::Scalar;
+  FactorizeParams params = proxsuite::linalg::dense::factorize_params<T>();
   isize n = mat.rows();
-  if (n > 2048) {
-    proxsuite::linalg::dense::factorize_blocked(mat, 128, stack);
+  if (n > params.blocked_threshold) {
+    proxsuite::linalg::dense::factorize_blocked(
+      mat, params.block_size, stack);
   } else {
     proxsuite::linalg::dense::factorize_recursive(mat, stack);
   }
 }
+
+/*!
+ * Computes the decomposition of the lower triangular part of `mat` in place,
+ * using up to `nb_threads` threads. The multithreaded path is only used when
+ * the matrix is large enough for the tiles to be worth distributing, otherwise
+ * this is equivalent to the single-threaded overload. A non positive
+ * `nb_threads` requests all the available hardware threads.
+ * When proxsuite is built with `BUILD_WITH_BLAS_SUPPORT`, the threading is
+ * left to the BLAS library and `nb_threads` is ignored.
+ * The memory requirements are given by `factorize_req`.
+ *
+ * @param mat matrix to decompose
+ * @param stack workspace memory stack
+ * @param nb_threads maximum number of threads
+ */
+template<typename Mat>
+void
+factorize(Mat&& mat,
+          proxsuite::linalg::veg::dynstack::DynStackMut stack,
+          isize nb_threads)
+{
+#ifdef PROXSUITE_WITH_BLAS
+  (void)nb_threads;
+  proxsuite::linalg::dense::factorize(mat, stack);
+#else
+  using T = typename proxsuite::linalg::veg::uncvref_t<Mat>::Scalar;
+  isize block_size =
+    proxsuite::linalg::dense::factorize_params<T>().block_size;
+  isize n = mat.rows();
+  nb_threads = proxsuite::helpers::resolve_nb_threads(nb_threads);
+  if (nb_threads > 1 && n >= 2 * block_size) {
+    proxsuite::linalg::dense::factorize_blocked_parallel(
+      mat, block_size, nb_threads, stack);
+  } else {
+    proxsuite::linalg::dense::factorize(mat, stack);
+  }
+#endif
+}
 } // namespace dense
 } // namespace linalg
 } // namespace proxsuite
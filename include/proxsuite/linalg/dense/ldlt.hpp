@@ -9,7 +9,9 @@
 #include "proxsuite/linalg/dense/update.hpp"
 #include "proxsuite/linalg/dense/modify.hpp"
 #include "proxsuite/linalg/dense/solve.hpp"
+#include "proxsuite/linalg/dense/packed.hpp"
 #include <proxsuite/linalg/veg/vec.hpp>
+#include <limits>
 
 namespace proxsuite {
 namespace linalg {
@@ -214,23 +216,172 @@ private:
   // sorted on a best effort basis
   proxsuite::linalg::veg::Vec<T> maybe_sorted_diag;
 
-  VEG_REFLECT(Ldlt, ld_storage, stride, perm, perm_inv, maybe_sorted_diag);
+  // whether ld_storage holds the block packed lower triangular part only
+  bool packed{};
+
+  // smallest and largest magnitudes of the pivots, updated after every
+  // modification of the factor, and the largest one right after the last full
+  // factorization. the magnitudes are NaN when a pivot is not finite
+  T pivot_min_abs{};
+  T pivot_max_abs{};
+  T pivot_max_abs_factorized{};
+
+  VEG_REFLECT(Ldlt,
+              ld_storage,
+              stride,
+              perm,
+              perm_inv,
+              maybe_sorted_diag,
+              packed,
+              pivot_min_abs,
+              pivot_max_abs,
+              pivot_max_abs_factorized);
 
   static auto adjusted_stride(isize n) noexcept -> isize
   {
     return _detail::adjusted_stride<T>(n);
   }
 
+  auto storage_len(isize cap, isize cap_stride) const noexcept -> isize
+  {
+    return packed ? _detail::packed_storage_len<T>(cap_stride)
+                  : cap * cap_stride;
+  }
+
+  auto ld_packed() const noexcept -> _detail::PackedLd<T const>
+  {
+    return { ld_storage.ptr(), stride, dim() };
+  }
+  auto ld_packed_mut() noexcept -> _detail::PackedLd<T>
+  {
+    return { ld_storage.ptr_mut(), stride, dim() };
+  }
+
+  auto pivot(isize i) const noexcept -> T
+  {
+    return packed ? ld_packed()(i, i) : ld_storage.ptr()[i * stride + i];
+  }
+
+  // factorizes the permuted matrix, already gathered in the storage of the
+  // factor
+  void factorize_gathered(proxsuite::linalg::veg::dynstack::DynStackMut stack,
+                          isize nb_threads)
+  {
+    isize n = dim();
+    if (packed) {
+      auto ld = ld_packed_mut();
+      for (isize i = 0; i < n; ++i) {
+        maybe_sorted_diag[i] = ld(i, i);
+      }
+      _detail::packed_factorize_impl(
+        ld, proxsuite::helpers::resolve_nb_threads(nb_threads), stack);
+    } else {
+      for (isize i = 0; i < n; ++i) {
+        maybe_sorted_diag[i] = ld_col()(i, i);
+      }
+      proxsuite::linalg::dense::factorize(ld_col_mut(), stack, nb_threads);
+    }
+    update_pivot_stats();
+    pivot_max_abs_factorized = pivot_max_abs;
+  }
+
+  void update_pivot_stats() noexcept
+  {
+    using std::fabs;
+    isize n = dim();
+    T d_min = std::numeric_limits<T>::infinity();
+    T d_max = T(0);
+    for (isize i = 0; i < n; ++i) {
+      T d_abs = fabs(pivot(i));
+      if (!(d_abs < std::numeric_limits<T>::infinity())) {
+        d_min = std::numeric_limits<T>::quiet_NaN();
+        d_max = std::numeric_limits<T>::quiet_NaN();
+        break;
+      }
+      d_min = d_abs < d_min ? d_abs : d_min;
+      d_max = d_abs > d_max ? d_abs : d_max;
+    }
+    pivot_min_abs = n == 0 ? T(0) : d_min;
+    pivot_max_abs = d_max;
+  }
+
+  // x ← L × D × L.T × x, in the permuted basis of the factor
+  void mul_factor_in_place(T* x, T* work) const noexcept
+  {
+    isize n = dim();
+    if (packed) {
+      auto ld = ld_packed();
+      for (isize j = 0; j < n; ++j) {
+        T acc = x[j];
+        for (isize i = j + 1; i < n; ++i) {
+          acc += ld(i, j) * x[i];
+        }
+        work[j] = acc * ld(j, j);
+      }
+      for (isize i = 0; i < n; ++i) {
+        x[i] = work[i];
+      }
+      for (isize j = 0; j < n; ++j) {
+        for (isize i = j + 1; i < n; ++i) {
+          x[i] += ld(i, j) * work[j];
+        }
+      }
+      return;
+    }
+    auto x_ = Eigen::Map<Vec>(x, n);
+    auto work_ = Eigen::Map<Vec>(work, n);
+    work_.noalias() = lt() * x_;
+    work_.array() *= d().array();
+    x_.noalias() = l() * work_;
+  }
+
   // soft invariants:
   // - perm.len() == perm_inv.len() == dim
   // - dim < stride
-  // - ld_storage.len() >= dim * stride
+  // - ld_storage.len() >= dim * stride, or the packed storage length
 public:
   /*!
    * Default constructor, initialized with a `0×0` empty matrix.
    */
   Ldlt() = default;
 
+  /*!
+   * Selects the storage of the factor. When `packed` is true, only the lower
+   * triangular part of the factor is stored, in column panels, which roughly
+   * halves the memory usage compared to the default square storage.
+   * Changing the storage mode invalidates the existing decomposition and
+   * releases the storage of the factor, which has to be reserved again.
+   *
+   * @param packed_storage whether the packed storage should be used
+   */
+  void set_packed_storage(bool packed_storage) noexcept
+  {
+    if (packed_storage == packed) {
+      return;
+    }
+    packed = packed_storage;
+    perm.clear();
+    perm_inv.clear();
+    maybe_sorted_diag.clear();
+    // a square buffer would otherwise be kept by the packed storage, since
+    // reserving never shrinks it
+    ld_storage = StorageSimdVec{};
+    stride = 0;
+  }
+
+  /*!
+   * Returns whether the factor uses the packed storage.
+   */
+  auto is_packed() const noexcept -> bool { return packed; }
+
+  /*!
+   * Returns the number of scalars allocated for the storage of the factor.
+   */
+  auto storage_capacity() const noexcept -> isize
+  {
+    return ld_storage.capacity();
+  }
+
   /*!
    * Reserves enough internal storage for a matrix `A` of size at least
    * `cap×cap`.
@@ -243,16 +394,17 @@ public:
     static_assert(VEG_CONCEPT(nothrow_constructible<T>), ".");
 
     auto new_stride = adjusted_stride(cap);
-    if (cap <= stride && cap * new_stride <= ld_storage.len()) {
+    auto new_len = storage_len(cap, new_stride);
+    if (cap <= stride && new_len <= ld_storage.len()) {
       return;
     }
 
-    ld_storage.reserve_exact(cap * new_stride);
+    ld_storage.reserve_exact(new_len);
     perm.reserve_exact(cap);
     perm_inv.reserve_exact(cap);
     maybe_sorted_diag.reserve_exact(cap);
 
-    ld_storage.resize_for_overwrite(cap * new_stride);
+    ld_storage.resize_for_overwrite(new_len);
     stride = new_stride;
   }
 
@@ -266,17 +418,32 @@ public:
   void reserve(isize cap) noexcept
   {
     auto new_stride = adjusted_stride(cap);
-    if (cap <= stride && cap * new_stride <= ld_storage.len()) {
+    auto new_len = storage_len(cap, new_stride);
+    if (cap <= stride && new_len <= ld_storage.len()) {
       return;
     }
     auto n = dim();
 
-    ld_storage.reserve_exact(cap * new_stride);
+    ld_storage.reserve_exact(new_len);
     perm.reserve_exact(cap);
     perm_inv.reserve_exact(cap);
     maybe_sorted_diag.reserve_exact(cap);
 
-    ld_storage.resize_for_overwrite(cap * new_stride);
+    ld_storage.resize_for_overwrite(new_len);
+
+    if (packed) {
+      // the elements only move forward when the stride grows
+      auto old_ld = ld_packed_mut();
+      auto new_ld = old_ld;
+      new_ld.stride = new_stride;
+      for (isize i = 0; i < n; ++i) {
+        auto col = n - i - 1;
+        T* ptr = old_ld.elem_addr(col, col);
+        std::move_backward(ptr, ptr + (n - col), new_ld.elem_addr(n, col));
+      }
+      stride = new_stride;
+      return;
+    }
 
     for (isize i = 0; i < n; ++i) {
       auto col = n - i - 1;
@@ -307,7 +474,9 @@ public:
       r * isize{ sizeof(T) },
       alignof(T),
     };
-    return w_req & alpha_req;
+    return w_req & alpha_req &
+           proxsuite::linalg::dense::rank_r_update_clobber_inputs_req(
+             proxsuite::linalg::veg::Tag<T>{}, n, r);
   }
 
   /*!
@@ -357,11 +526,17 @@ public:
       indices_actual[k] = perm_inv[indices[k]];
     }
 
-    proxsuite::linalg::dense::ldlt_delete_rows_and_cols_sort_indices( //
-      ld_col_mut(),
-      indices_actual,
-      r,
-      stack);
+    if (packed) {
+      std::sort(indices_actual, indices_actual + r);
+      _detail::packed_delete_rows_and_cols(
+        ld_packed_mut(), indices_actual, r, stack);
+    } else {
+      proxsuite::linalg::dense::ldlt_delete_rows_and_cols_sort_indices( //
+        ld_col_mut(),
+        indices_actual,
+        r,
+        stack);
+    }
 
     // PERF: do this in one pass
     for (isize k = 0; k < r; ++k) {
@@ -384,6 +559,7 @@ public:
         }
       }
     }
+    update_pivot_stats();
   }
 
   auto choose_insertion_position(isize i, Eigen::Ref<Vec const> a) -> isize
@@ -415,8 +591,10 @@ public:
       isize{ sizeof(T) } * (adjusted_stride(n + r) * r),
       _detail::align<T>(),
     } &
-           proxsuite::linalg::dense::ldlt_insert_rows_and_cols_req(
-             proxsuite::linalg::veg::Tag<T>{}, n, r);
+           (proxsuite::linalg::dense::ldlt_insert_rows_and_cols_req(
+              proxsuite::linalg::veg::Tag<T>{}, n, r) |
+            proxsuite::linalg::dense::packed_insert_rows_and_cols_req(
+              proxsuite::linalg::veg::Tag<T>{}, n, r));
   }
 
   /*!
@@ -470,8 +648,14 @@ public:
       }
     }
 
-    proxsuite::linalg::dense::ldlt_insert_rows_and_cols(
-      ld_col_mut(), i_actual, permuted_a, stack);
+    if (packed) {
+      _detail::packed_insert_rows_and_cols(
+        ld_packed_mut(), i_actual, permuted_a, stack);
+    } else {
+      proxsuite::linalg::dense::ldlt_insert_rows_and_cols(
+        ld_col_mut(), i_actual, permuted_a, stack);
+    }
+    update_pivot_stats();
   }
 
   /*!
@@ -556,17 +740,32 @@ public:
       _w(sorted_indices[k] - first, k) = 1;
     }
 
-    proxsuite::linalg::dense::_detail::rank_r_update_clobber_w_impl(
-      util::submatrix(ld_col_mut(), first, first, n, n),
-      _w.data(),
-      _w.outerStride(),
-      _alpha.data(),
-      _detail::IndicesR{
-        first,
-        0,
-        r,
-        sorted_indices,
-      });
+    if (packed) {
+      _detail::packed_rank_r_update_clobber_w(ld_packed_mut(),
+                                              first,
+                                              _w.data(),
+                                              _w.outerStride(),
+                                              _alpha.data(),
+                                              _detail::IndicesR{
+                                                first,
+                                                0,
+                                                r,
+                                                sorted_indices,
+                                              });
+    } else {
+      proxsuite::linalg::dense::_detail::rank_r_update_clobber_w_impl(
+        util::submatrix(ld_col_mut(), first, first, n, n),
+        _w.data(),
+        _w.outerStride(),
+        _alpha.data(),
+        _detail::IndicesR{
+          first,
+          0,
+          r,
+          sorted_indices,
+        });
+    }
+    update_pivot_stats();
   }
 
   /*!
@@ -604,8 +803,19 @@ public:
       }
     }
 
-    proxsuite::linalg::dense::rank_r_update_clobber_inputs(
-      ld_col_mut(), _w, _alpha);
+    if (packed) {
+      _detail::packed_rank_r_update_clobber_w_select(ld_packed_mut(),
+                                                     0,
+                                                     _w.data(),
+                                                     _w.outerStride(),
+                                                     _alpha.data(),
+                                                     r,
+                                                     stack);
+    } else {
+      proxsuite::linalg::dense::rank_r_update_clobber_inputs(
+        ld_col_mut(), _w, _alpha, stack);
+    }
+    update_pivot_stats();
   }
 
   /*!
@@ -618,6 +828,7 @@ public:
     Eigen::Unaligned,
     Eigen::OuterStride<DYN>>
   {
+    VEG_DEBUG_ASSERT(!packed);
     return { ld_storage.ptr(), dim(), dim(), stride };
   }
   auto ld_col_mut() noexcept -> Eigen::Map< //
@@ -625,6 +836,7 @@ public:
     Eigen::Unaligned,
     Eigen::OuterStride<DYN>>
   {
+    VEG_DEBUG_ASSERT(!packed);
     return { ld_storage.ptr_mut(), dim(), dim(), stride };
   }
   auto ld_row() const noexcept -> Eigen::Map< //
@@ -632,6 +844,7 @@ public:
     Eigen::Unaligned,
     Eigen::OuterStride<DYN>>
   {
+    VEG_DEBUG_ASSERT(!packed);
     return {
       ld_storage.ptr(),
       dim(),
@@ -644,6 +857,7 @@ public:
     Eigen::Unaligned,
     Eigen::OuterStride<DYN>>
   {
+    VEG_DEBUG_ASSERT(!packed);
     return {
       ld_storage.ptr_mut(),
       dim(),
@@ -671,6 +885,7 @@ public:
 
   auto d() const noexcept -> DView
   {
+    VEG_DEBUG_ASSERT(!packed);
     return {
       ld_storage.ptr(),
       dim(),
@@ -680,6 +895,7 @@ public:
   }
   auto d_mut() noexcept -> DView
   {
+    VEG_DEBUG_ASSERT(!packed);
     return {
       ld_storage.ptr_mut(),
       dim(),
@@ -695,10 +911,15 @@ public:
    * of size at most `n×n`
    *
    * @param n maximum dimension of the matrix
+   * @param packed_storage whether the factor uses the packed storage
    */
-  static auto factorize_req(isize n)
+  static auto factorize_req(isize n, bool packed_storage = false)
     -> proxsuite::linalg::veg::dynstack::StackReq
   {
+    if (packed_storage) {
+      return proxsuite::linalg::dense::packed_factorize_req(
+        proxsuite::linalg::veg::Tag<T>{}, n);
+    }
     return proxsuite::linalg::veg::dynstack::StackReq{
       n * adjusted_stride(n) * isize{ sizeof(T) },
       _detail::align<T>(),
@@ -714,9 +935,11 @@ public:
    *
    * @param mat matrix whose decomposition should be computed
    * @param stack workspace memory stack
+   * @param nb_threads maximum number of threads used by the factorization
    */
   void factorize(Eigen::Ref<ColMat const> mat /* NOLINT */,
-                 proxsuite::linalg::veg::dynstack::DynStackMut stack)
+                 proxsuite::linalg::veg::dynstack::DynStackMut stack,
+                 isize nb_threads = 1)
   {
     VEG_ASSERT(mat.rows() == mat.cols());
     isize n = mat.rows();
@@ -731,18 +954,80 @@ public:
       perm_inv.ptr_mut(),
       util::diagonal(mat));
 
-    {
+    if (packed) {
+      _detail::packed_gather_permuted(ld_packed_mut(), mat, perm.ptr());
+    } else {
       LDLT_TEMP_MAT_UNINIT(T, work, n, n, stack);
       ld_col_mut() = mat;
       proxsuite::linalg::dense::_detail::apply_permutation_tri_lower(
         ld_col_mut(), work, perm.ptr());
     }
+    factorize_gathered(stack, nb_threads);
+  }
 
-    for (isize i = 0; i < n; ++i) {
-      maybe_sorted_diag[i] = ld_col()(i, i);
+  /*!
+   * Returns the memory storage requirements for a factorization with
+   * `factorize_cast` of a matrix of size at most `n×n`
+   *
+   * @param n maximum dimension of the matrix
+   * @param packed_storage whether the factor uses the packed storage
+   */
+  static auto factorize_cast_req(isize n, bool packed_storage = false)
+    -> proxsuite::linalg::veg::dynstack::StackReq
+  {
+    if (packed_storage) {
+      return proxsuite::linalg::dense::packed_factorize_req(
+        proxsuite::linalg::veg::Tag<T>{}, n);
     }
+    return proxsuite::linalg::dense::factorize_req(
+      proxsuite::linalg::veg::Tag<T>{}, n);
+  }
+
+  /*!
+   * Computes the decomposition of a given matrix `A` whose scalar type
+   * differs from the one of the decomposition, such as a double precision
+   * matrix with a single precision decomposition.
+   * The entries of the lower triangular part of `A` are rounded as they are
+   * gathered in the storage of the factor, one column at a time, so that no
+   * rounded copy of `A` is needed.
+   *
+   * @param mat matrix whose decomposition should be computed
+   * @param stack workspace memory stack
+   * @param nb_threads maximum number of threads used by the factorization
+   */
+  template<typename U>
+  void factorize_cast(
+    Eigen::Ref<Eigen::Matrix<U, Eigen::Dynamic, Eigen::Dynamic> const> mat,
+    proxsuite::linalg::veg::dynstack::DynStackMut stack,
+    isize nb_threads = 1)
+  {
+    VEG_ASSERT(mat.rows() == mat.cols());
+    isize n = mat.rows();
+    reserve_uninit(n);
+
+    perm.resize_for_overwrite(n);
+    perm_inv.resize_for_overwrite(n);
+    maybe_sorted_diag.resize_for_overwrite(n);
+
+    proxsuite::linalg::dense::_detail::compute_permutation( //
+      perm.ptr_mut(),
+      perm_inv.ptr_mut(),
+      util::diagonal(mat));
 
-    proxsuite::linalg::dense::factorize(ld_col_mut(), stack);
+    if (packed) {
+      _detail::packed_gather_permuted(ld_packed_mut(), mat, perm.ptr());
+    } else {
+      T* ld = ld_storage.ptr_mut();
+      for (isize j = 0; j < n; ++j) {
+        T* col_ptr = ld + j * stride;
+        isize pj = perm[j];
+        for (isize i = j; i < n; ++i) {
+          isize pi = perm[i];
+          col_ptr[i] = T(pi >= pj ? mat(pi, pj) : mat(pj, pi));
+        }
+      }
+    }
+    factorize_gathered(stack, nb_threads);
   }
 
   /*!
@@ -762,6 +1047,9 @@ public:
 
   /*!
    * Solves the system `A×x = rhs`, and stores the result in `rhs`.
+   * Unless the storage is packed, the permutations, the triangular solves and
+   * the diagonal scaling are fused into one forward and one backward sweep
+   * over the factor.
    *
    * @param rhs right hand side of the linear system
    * @param stack workspace memory stack
@@ -772,21 +1060,192 @@ public:
     isize n = rhs.rows();
     LDLT_TEMP_VEC_UNINIT(T, work, n, stack);
 
+    if (!packed) {
+      _detail::permuted_solve_impl(
+        ld_storage.ptr(), stride, n, perm.ptr(), rhs.data(), work.data());
+      return;
+    }
+
     for (isize i = 0; i < n; ++i) {
       work[i] = rhs[perm[i]];
     }
-
-    proxsuite::linalg::dense::solve(ld_col(), work);
-
+    _detail::packed_solve_in_place(ld_packed(), work);
     for (isize i = 0; i < n; ++i) {
       rhs[i] = work[perm_inv[i]];
     }
   }
 
+  /*!
+   * Returns the memory storage requirements for solving a linear system
+   * with `k` right hand sides, with a decomposition of dimension at most `n`
+   *
+   * @param n maximum dimension of the matrix
+   * @param k maximum number of right hand sides
+   */
+  static auto solve_in_place_req(isize n, isize k)
+    -> proxsuite::linalg::veg::dynstack::StackReq
+  {
+    return proxsuite::linalg::dense::temp_mat_req(
+      proxsuite::linalg::veg::Tag<T>{},
+      n,
+      _detail::min2(k, _detail::solve_rhs_block_size::value));
+  }
+
+  /*!
+   * Solves the system `A×X = rhs` for all the columns of `rhs` at once, and
+   * stores the result in `rhs`.
+   * The right hand sides are processed in blocks of columns, and the factor is
+   * read once per block, rather than once per column.
+   *
+   * @param rhs right hand sides of the linear system
+   * @param stack workspace memory stack
+   */
+  void solve_in_place_multiple(
+    Eigen::Ref<ColMat> rhs,
+    proxsuite::linalg::veg::dynstack::DynStackMut stack) const
+  {
+    isize n = rhs.rows();
+    isize k = rhs.cols();
+    isize bs = _detail::min2(k, _detail::solve_rhs_block_size::value);
+    LDLT_TEMP_MAT_UNINIT(T, work_storage, n, bs, stack);
+
+    isize c = 0;
+    while (c < k) {
+      isize c_chunk = _detail::min2(bs, k - c);
+      auto work = util::subcols(work_storage, 0, c_chunk);
+
+      for (isize j = 0; j < c_chunk; ++j) {
+        for (isize i = 0; i < n; ++i) {
+          work(i, j) = rhs(perm[i], c + j);
+        }
+      }
+
+      if (packed) {
+        _detail::packed_solve_in_place(ld_packed(), work);
+      } else {
+        proxsuite::linalg::dense::solve(ld_col(), work);
+      }
+
+      for (isize j = 0; j < c_chunk; ++j) {
+        for (isize i = 0; i < n; ++i) {
+          rhs(i, c + j) = work(perm_inv[i], j);
+        }
+      }
+      c += c_chunk;
+    }
+  }
+
+  /*!
+   * Returns the smallest magnitude of the entries of `D`.
+   * It is kept up to date by the factorization and by every modification of
+   * the decomposition, and is NaN if one of the entries is not finite.
+   */
+  auto min_abs_pivot() const noexcept -> T { return pivot_min_abs; }
+
+  /*!
+   * Returns the largest magnitude of the entries of `D`.
+   * It is kept up to date by the factorization and by every modification of
+   * the decomposition, and is NaN if one of the entries is not finite.
+   */
+  auto max_abs_pivot() const noexcept -> T { return pivot_max_abs; }
+
+  /*!
+   * Returns the ratio of the largest magnitude of the entries of `D` to the
+   * same quantity right after the last call to `factorize`. A large growth
+   * indicates that the updates since the factorization amplified the rounding
+   * errors of the decomposition.
+   */
+  auto pivot_growth() const noexcept -> T
+  {
+    return pivot_max_abs_factorized > T(0)
+             ? pivot_max_abs / pivot_max_abs_factorized
+             : T(1);
+  }
+
+  /*!
+   * Returns whether the decomposition is numerically singular, that is when
+   * one of the entries of `D` is not finite, or is not larger in magnitude
+   * than `tol` times the largest one.
+   *
+   * @param tol relative tolerance on the magnitude of the entries of `D`
+   */
+  auto is_degraded(T tol) const noexcept -> bool
+  {
+    return dim() > 0 && !(pivot_min_abs > tol * pivot_max_abs);
+  }
+
+  /*!
+   * Returns the memory storage requirements for estimating the condition
+   * number of a decomposition of dimension at most `n`.
+   *
+   * @param n maximum dimension of the matrix
+   */
+  static auto condition_estimate_req(isize n) noexcept
+    -> proxsuite::linalg::veg::dynstack::StackReq
+  {
+    auto vec_req = proxsuite::linalg::dense::temp_vec_req(
+      proxsuite::linalg::veg::Tag<T>{}, n);
+    return vec_req & vec_req & vec_req;
+  }
+
+  /*!
+   * Returns an estimate of the condition number `‖A‖₁×‖A⁻¹‖₁` of the
+   * decomposed matrix, computed with Hager's method from a few products with
+   * the factors and a few solves, which costs `O(n²)` operations.
+   * The estimate is a lower bound of the condition number, and is usually
+   * within a small factor of it.
+   *
+   * @param stack workspace memory stack
+   */
+  auto condition_estimate(
+    proxsuite::linalg::veg::dynstack::DynStackMut stack) const -> T
+  {
+    // the 1-norm is invariant under symmetric permutations, so the estimates
+    // are computed in the permuted basis of the factor
+    isize n = dim();
+    LDLT_TEMP_VEC_UNINIT(T, x, n, stack);
+    LDLT_TEMP_VEC_UNINIT(T, y, n, stack);
+    LDLT_TEMP_VEC_UNINIT(T, work, n, stack);
+
+    T norm_a = _detail::norm1_estimate_symmetric(
+      n,
+      [&](T* v) { mul_factor_in_place(v, work.data()); },
+      x.data(),
+      y.data());
+    T norm_a_inv = _detail::norm1_estimate_symmetric(
+      n,
+      [&](T* v) {
+        auto v_ = Eigen::Map<Vec>(v, n);
+        if (packed) {
+          _detail::packed_solve_in_place(ld_packed(), v_);
+        } else {
+          proxsuite::linalg::dense::solve(ld_col(), v_);
+        }
+      },
+      x.data(),
+      y.data());
+    return norm_a * norm_a_inv;
+  }
+
   auto dbg_reconstructed_matrix_internal() const -> ColMat
   {
     isize n = dim();
     auto tmp = ColMat(n, n);
+    if (packed) {
+      auto ld = ld_packed();
+      auto l_tmp = ColMat(n, n);
+      l_tmp.setIdentity();
+      for (isize j = 0; j < n; ++j) {
+        for (isize i = j + 1; i < n; ++i) {
+          l_tmp(i, j) = ld(i, j);
+        }
+      }
+      tmp = l_tmp;
+      for (isize j = 0; j < n; ++j) {
+        tmp.col(j) *= ld(j, j);
+      }
+      return ColMat(tmp * l_tmp.transpose());
+    }
     tmp = l();
     tmp = tmp * d().asDiagonal();
     auto A = ColMat(tmp * lt());
@@ -797,9 +1256,7 @@ public:
   {
     isize n = dim();
     auto tmp = ColMat(n, n);
-    tmp = l();
-    tmp = tmp * d().asDiagonal();
-    auto A = ColMat(tmp * lt());
+    auto A = dbg_reconstructed_matrix_internal();
 
     for (isize i = 0; i < n; i++) {
       tmp.row(i) = A.row(perm_inv[i]);
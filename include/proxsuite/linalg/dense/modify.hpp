@@ -255,12 +255,13 @@ ldlt_insert_rows_and_cols_impl(
     std::copy(src_ptr, src_ptr + rem, pw + k * w_stride);
   }
 
-  _detail::rank_r_update_clobber_w_impl( //
+  _detail::rank_r_update_clobber_w_select_impl( //
     ld22,
     pw,
     w_stride,
     palpha,
-    _detail::ConstantR{ r });
+    r,
+    stack);
 }
 } // namespace _detail
 
@@ -313,7 +314,10 @@ ldlt_insert_rows_and_cols_req(proxsuite::linalg::veg::Tag<T> tag,
     alignof(T),
   };
 
-  return (w_req & alpha_req) | factorize_req;
+  return (w_req & alpha_req &
+          proxsuite::linalg::dense::rank_r_update_clobber_inputs_req(
+            tag, n, r)) |
+         factorize_req;
 }
 
 template<typename Mat, typename A_1>
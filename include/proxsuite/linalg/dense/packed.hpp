@@ -0,0 +1,553 @@
+/** \file */
+//
+// Copyright (c) 2022 INRIA
+//
+#ifndef PROXSUITE_LINALG_DENSE_LDLT_PACKED_HPP
+#define PROXSUITE_LINALG_DENSE_LDLT_PACKED_HPP
+
+#include "proxsuite/linalg/dense/core.hpp"
+#include "proxsuite/linalg/dense/factorize.hpp"
+#include "proxsuite/linalg/dense/update.hpp"
+#include "proxsuite/linalg/dense/modify.hpp"
+#include "proxsuite/helpers/parallel.hpp"
+#include <algorithm>
+#include <proxsuite/linalg/veg/memory/dynamic_stack.hpp>
+
+namespace proxsuite {
+namespace linalg {
+namespace dense {
+namespace _detail {
+
+using packed_panel_width = proxsuite::linalg::veg::meta::constant<isize, 64>;
+
+/*
+ * block packed lower triangular storage.
+ *
+ * the columns are grouped in panels of packed_panel_width columns.
+ * the panel k holds the rows [k*P, cap) of the columns [k*P, (k+1)*P), stored
+ * in column major order with an outer stride of (stride - k*P), where stride is
+ * the (simd adjusted) capacity.
+ * each panel is then a regular column major matrix that can be handed to the
+ * dense kernels, while the strictly upper triangular part is only stored
+ * inside the diagonal blocks, which roughly halves the memory footprint.
+ *
+ * the address of an element only depends on the capacity, not on the current
+ * dimension, so that rows and columns can be inserted or deleted in place.
+ */
+template<typename T>
+struct PackedLd
+{
+  using Scalar = proxsuite::linalg::veg::uncvref_t<T>;
+  using PanelMap =
+    Eigen::Map<_detail::const_if<std::is_const<T>::value,
+                                 Eigen::Matrix<Scalar,
+                                               Eigen::Dynamic,
+                                               Eigen::Dynamic,
+                                               Eigen::ColMajor>>,
+               Eigen::Unaligned,
+               Eigen::OuterStride<Eigen::Dynamic>>;
+
+  T* data;
+  isize stride;
+  isize n;
+
+  VEG_INLINE auto panel_stride(isize k) const noexcept -> isize
+  {
+    return stride - k * packed_panel_width::value;
+  }
+  VEG_INLINE auto panel_offset(isize k) const noexcept -> isize
+  {
+    constexpr isize P = packed_panel_width::value;
+    return P * (k * stride - P * ((k * (k - 1)) / 2));
+  }
+  VEG_INLINE auto elem_addr(isize i, isize j) const noexcept -> T*
+  {
+    constexpr isize P = packed_panel_width::value;
+    isize k = j / P;
+    return data + panel_offset(k) + (j - k * P) * panel_stride(k) +
+           (i - k * P);
+  }
+  VEG_INLINE auto operator()(isize i, isize j) const noexcept -> T&
+  {
+    return *elem_addr(i, j);
+  }
+
+  // end of the panel containing the column j, clamped to the dimension
+  VEG_INLINE auto panel_end(isize j) const noexcept -> isize
+  {
+    constexpr isize P = packed_panel_width::value;
+    return min2((j / P + 1) * P, n);
+  }
+
+  // rows [j0, n) of the columns [j0, j1)
+  // the columns must belong to the same panel
+  auto block(isize j0, isize j1) const noexcept -> PanelMap
+  {
+    return {
+      elem_addr(j0, j0),
+      n - j0,
+      j1 - j0,
+      Eigen::OuterStride<Eigen::Dynamic>{
+        panel_stride(j0 / packed_panel_width::value) },
+    };
+  }
+
+  auto as_const() const noexcept -> PackedLd<Scalar const>
+  {
+    return { data, stride, n };
+  }
+  auto with_dim(isize new_n) const noexcept -> PackedLd
+  {
+    return { data, stride, new_n };
+  }
+};
+
+template<typename T>
+auto
+packed_storage_len(isize stride) noexcept -> isize
+{
+  constexpr isize P = packed_panel_width::value;
+  return PackedLd<T>{ nullptr, stride, 0 }.panel_offset((stride + P - 1) / P);
+}
+
+// copies the lower triangular part of the symmetric matrix mat, permuted by
+// perm, to ld. the entries are converted if mat has another scalar type
+template<typename T, typename Mat>
+void
+packed_gather_permuted(PackedLd<T> ld, Mat const& mat, isize const* perm)
+{
+  isize n = ld.n;
+  for (isize j = 0; j < n; ++j) {
+    T* col_ptr = ld.elem_addr(0, j);
+    isize pj = perm[j];
+    for (isize i = j; i < n; ++i) {
+      isize pi = perm[i];
+      col_ptr[i] = T(pi >= pj ? mat(pi, pj) : mat(pj, pi));
+    }
+  }
+}
+
+template<typename T>
+void
+packed_factorize_impl(PackedLd<T> ld,
+                      isize nb_threads,
+                      proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  // right looking blocked cholesky, one panel at a time.
+  // the trailing update is distributed over the following panels.
+
+  constexpr isize P = packed_panel_width::value;
+  isize n = ld.n;
+
+  isize j = 0;
+  while (j < n) {
+    isize j1 = ld.panel_end(j);
+    isize bs = j1 - j;
+
+    auto panel = ld.block(j, j1);
+    auto ld11 = util::subrows(panel, 0, bs);
+    auto d1 = util::diagonal(ld11);
+    _detail::factorize_unblocked_impl(ld11, stack);
+
+    if (j1 == n) {
+      break;
+    }
+    isize rem = n - j1;
+
+    isize work_stride = _detail::adjusted_stride<T>(rem);
+    auto _work = stack.make_new_for_overwrite( //
+      proxsuite::linalg::veg::Tag<T>{},
+      bs * work_stride,
+      _detail::align<T>());
+    auto work = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>,
+                           Eigen::Unaligned,
+                           Eigen::OuterStride<Eigen::Dynamic>>{
+      _work.ptr_mut(),
+      rem,
+      bs,
+      Eigen::OuterStride<Eigen::Dynamic>{ work_stride },
+    };
+
+    auto l21 = util::subrows(panel, bs, rem);
+    isize n_tiles = (rem + P - 1) / P;
+
+    proxsuite::helpers::parallel_for(nb_threads, n_tiles, [&](isize t) {
+      isize i0 = t * P;
+      isize ts = min2(rem - i0, P);
+
+      auto l21_t = util::subrows(l21, i0, ts);
+      auto work_t = util::subrows(work, i0, ts);
+
+      util::trans(ld11)
+        .template triangularView<Eigen::UnitUpper>()
+        .template solveInPlace<Eigen::OnTheRight>(l21_t);
+
+      work_t = l21_t;
+      l21_t = l21_t * d1.asDiagonal().inverse();
+    });
+
+    // the tiles of the trailing update are exactly the following panels
+    proxsuite::helpers::parallel_for(nb_threads, n_tiles, [&](isize t) {
+      isize c0 = j1 + t * P;
+      isize c1 = ld.panel_end(c0);
+      isize ts = c1 - c0;
+
+      auto target = ld.block(c0, c1);
+      auto work_t = util::subrows(work, c0 - j1, ts);
+
+      util::subrows(target, 0, ts).template triangularView<Eigen::Lower>() -=
+        util::subrows(l21, c0 - j1, ts) * util::trans(work_t);
+
+      isize below = n - c1;
+      if (below > 0) {
+        util::subrows(target, ts, below).noalias() -=
+          util::subrows(l21, c1 - j1, below) * util::trans(work_t);
+      }
+    });
+
+    j = j1;
+  }
+}
+
+// solves L×x = rhs in place, where rhs may have several columns
+template<typename T, typename Rhs>
+void
+packed_l_solve_in_place(PackedLd<T const> ld, Rhs rhs)
+{
+  isize n = ld.n;
+  isize j = 0;
+  while (j < n) {
+    isize j1 = ld.panel_end(j);
+    isize bs = j1 - j;
+    auto panel = ld.block(j, j1);
+    auto x1 = util::subrows(rhs, j, bs);
+
+    util::subrows(panel, 0, bs)
+      .template triangularView<Eigen::UnitLower>()
+      .solveInPlace(x1);
+    if (j1 < n) {
+      util::subrows(rhs, j1, n - j1).noalias() -=
+        util::subrows(panel, bs, n - j1) * x1;
+    }
+    j = j1;
+  }
+}
+
+// solves L.T×x = rhs in place, where rhs may have several columns
+template<typename T, typename Rhs>
+void
+packed_lt_solve_in_place(PackedLd<T const> ld, Rhs rhs)
+{
+  constexpr isize P = packed_panel_width::value;
+  isize n = ld.n;
+  if (n == 0) {
+    return;
+  }
+  isize k = (n - 1) / P;
+  while (true) {
+    isize j = k * P;
+    isize j1 = ld.panel_end(j);
+    isize bs = j1 - j;
+    auto panel = ld.block(j, j1);
+    auto x1 = util::subrows(rhs, j, bs);
+
+    if (j1 < n) {
+      x1.noalias() -= util::trans(util::subrows(panel, bs, n - j1)) *
+                      util::subrows(rhs, j1, n - j1);
+    }
+    util::trans(util::subrows(panel, 0, bs))
+      .template triangularView<Eigen::UnitUpper>()
+      .solveInPlace(x1);
+
+    if (k == 0) {
+      break;
+    }
+    --k;
+  }
+}
+
+template<typename T, typename Rhs>
+void
+packed_solve_in_place(PackedLd<T const> ld, Rhs rhs)
+{
+  _detail::packed_l_solve_in_place(ld, rhs);
+  for (isize i = 0; i < ld.n; ++i) {
+    rhs.row(i) *= T(1) / ld(i, i);
+  }
+  _detail::packed_lt_solve_in_place(ld, rhs);
+}
+
+// rank update of the trailing factor starting at the column first
+// pw points to the rows [first, n) of the update matrix
+template<typename T, typename Fn>
+void
+packed_rank_r_update_clobber_w(PackedLd<T> ld,
+                               isize first,
+                               T* pw,
+                               isize w_stride,
+                               T* palpha,
+                               Fn r_fn)
+{
+  isize n = ld.n;
+  isize j = first;
+  while (j < n) {
+    isize j1 = ld.panel_end(j);
+    _detail::rank_r_update_clobber_w_impl( //
+      ld.block(j, j1),
+      pw + (j - first),
+      w_stride,
+      palpha,
+      _detail::RefR<Fn>{ &r_fn });
+    j = j1;
+  }
+}
+
+// same as packed_rank_r_update_clobber_w with a constant r, using the blocked
+// update when it is expected to be faster
+template<typename T>
+void
+packed_rank_r_update_clobber_w_select(
+  PackedLd<T> ld,
+  isize first,
+  T* pw,
+  isize w_stride,
+  T* palpha,
+  isize r,
+  proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  isize n = ld.n;
+  isize j = first;
+  while (j < n) {
+    isize j1 = ld.panel_end(j);
+    _detail::rank_r_update_clobber_w_select_impl( //
+      ld.block(j, j1),
+      pw + (j - first),
+      w_stride,
+      palpha,
+      r,
+      stack);
+    j = j1;
+  }
+}
+
+// ld has the dimension of the matrix before the deletion
+// indices must be sorted in increasing order
+template<typename T>
+void
+packed_delete_rows_and_cols(PackedLd<T> ld,
+                            isize const* indices,
+                            isize r,
+                            proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  isize n = ld.n;
+  isize first = indices[0];
+
+  auto w_stride = _detail::adjusted_stride<T>(n - first - r);
+
+  proxsuite::linalg::veg::Tag<T> tag;
+
+  auto _w = stack.make_new(tag, r * w_stride, _detail::align<T>());
+  auto _alpha = stack.make_new_for_overwrite(tag, r);
+
+  auto pw = _w.ptr_mut();
+  auto palpha = _alpha.ptr_mut();
+
+  for (isize k = 0; k < r; ++k) {
+    isize j = indices[k];
+    palpha[k] = ld(j, j);
+    auto pwk = pw + k * w_stride;
+
+    for (isize chunk_i = k + 1; chunk_i < r + 1; ++chunk_i) {
+      isize i_start = indices[chunk_i - 1] + 1;
+      isize i_finish = chunk_i == r ? n : indices[chunk_i];
+
+      T* col_ptr = ld.elem_addr(0, j);
+      std::move(col_ptr + i_start,
+                col_ptr + i_finish,
+                pwk + i_start - chunk_i - first);
+    }
+  }
+
+  // the element addresses are increasing in the (column, row) lexicographic
+  // order, and each element moves to a lower row and column, so the elements
+  // can be moved forward in that order
+  for (isize chunk_j = 0; chunk_j < r + 1; ++chunk_j) {
+    isize j_start = chunk_j == 0 ? 0 : indices[chunk_j - 1] + 1;
+    isize j_finish = chunk_j == r ? n : indices[chunk_j];
+
+    for (isize j = j_start; j < j_finish; ++j) {
+      T* src_col_ptr = ld.elem_addr(0, j);
+      T* dest_col_ptr = ld.elem_addr(0, j - chunk_j);
+
+      for (isize chunk_i = chunk_j; chunk_i < r + 1; ++chunk_i) {
+        isize i_start = chunk_i == chunk_j ? j : indices[chunk_i - 1] + 1;
+        isize i_finish = chunk_i == r ? n : indices[chunk_i];
+
+        if (chunk_i != 0 || chunk_j != 0) {
+          std::move( //
+            src_col_ptr + i_start,
+            src_col_ptr + i_finish,
+            dest_col_ptr + (i_start - chunk_i));
+        }
+      }
+    }
+  }
+
+  _detail::packed_rank_r_update_clobber_w(ld.with_dim(n - r),
+                                          first,
+                                          pw,
+                                          w_stride,
+                                          palpha,
+                                          IndicesR{ first, 0, r, indices });
+}
+
+// ld has the dimension of the matrix after the insertion
+// a_1 holds the permuted inserted columns
+template<typename T, typename A_1>
+void
+packed_insert_rows_and_cols(PackedLd<T> ld,
+                            isize pos,
+                            A_1 const& a_1,
+                            proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  constexpr isize P = packed_panel_width::value;
+
+  isize const new_n = ld.n;
+  isize const r = a_1.cols();
+  isize const old_n = new_n - r;
+
+  // make room for the new rows and columns, moving the elements backward in
+  // the (column, row) lexicographic order
+  {
+    isize current_col = old_n;
+    while (current_col != pos) {
+      --current_col;
+
+      T* src_col_ptr = ld.elem_addr(0, current_col);
+      T* dest_col_ptr = ld.elem_addr(r, current_col + r);
+
+      std::move_backward( //
+        src_col_ptr + current_col,
+        src_col_ptr + old_n,
+        dest_col_ptr + old_n);
+    }
+    while (current_col != 0) {
+      --current_col;
+
+      T* col_ptr = ld.elem_addr(0, current_col);
+      std::move_backward( //
+        col_ptr + pos,
+        col_ptr + old_n,
+        col_ptr + new_n);
+    }
+  }
+
+  isize rem = new_n - pos - r;
+  auto ld00 = ld.with_dim(pos);
+
+  LDLT_TEMP_MAT_UNINIT(T, x, pos, r, stack);
+  LDLT_TEMP_MAT_UNINIT(T, w, r + rem, r, stack);
+
+  // x = L00^-1 × a01, which is also D0 × l10.T
+  x = util::subrows(a_1, 0, pos);
+  _detail::packed_l_solve_in_place(ld00.as_const(), x);
+
+  for (isize j = 0; j < pos; ++j) {
+    T inv_dj = T(1) / ld(j, j);
+    for (isize k = 0; k < r; ++k) {
+      ld(pos + k, j) = x(j, k) * inv_dj;
+    }
+  }
+
+  // [ld11; l21] = [a11; a21] - [l10; l20] × D0 × l10.T
+  w = util::subrows(a_1, pos, r + rem);
+  {
+    isize j = 0;
+    while (j < pos) {
+      isize j1 = min2((j / P + 1) * P, pos);
+      auto panel = ld.block(j, j1);
+      w.noalias() -=
+        util::subrows(panel, pos - j, r + rem) * util::subrows(x, j, j1 - j);
+      j = j1;
+    }
+  }
+
+  auto ld11 = util::subrows(w, 0, r);
+  auto l21 = util::subrows(w, r, rem);
+
+  proxsuite::linalg::dense::factorize(ld11, stack);
+  util::trans(ld11) //
+    .template triangularView<Eigen::UnitUpper>()
+    .template solveInPlace<Eigen::OnTheRight>(l21);
+
+  LDLT_TEMP_VEC_UNINIT(T, alpha, r, stack);
+  for (isize k = 0; k < r; ++k) {
+    T d1k = ld11(k, k);
+    alpha[k] = -d1k;
+
+    T* dest_ptr = ld.elem_addr(pos + k, pos + k);
+    for (isize i = k; i < r; ++i) {
+      dest_ptr[i - k] = ld11(i, k);
+    }
+
+    // l21 is also used as the update matrix
+    T* w_ptr = util::matrix_elem_addr(l21, 0, k);
+    T inv_d1k = T(1) / d1k;
+    for (isize i = 0; i < rem; ++i) {
+      T l = w_ptr[i] * inv_d1k;
+      w_ptr[i] = l;
+      dest_ptr[r - k + i] = l;
+    }
+  }
+
+  _detail::packed_rank_r_update_clobber_w_select(
+    ld,
+    pos + r,
+    util::matrix_elem_addr(l21, 0, 0),
+    w.outerStride(),
+    alpha.data(),
+    r,
+    stack);
+}
+} // namespace _detail
+
+template<typename T>
+auto
+packed_factorize_req(proxsuite::linalg::veg::Tag<T> tag, isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return proxsuite::linalg::dense::factorize_blocked_req(
+    tag, n, _detail::packed_panel_width::value);
+}
+
+template<typename T>
+auto
+packed_insert_rows_and_cols_req(proxsuite::linalg::veg::Tag<T> tag,
+                                isize n,
+                                isize r) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  auto x_req = StackReq{
+    _detail::adjusted_stride<T>(n) * r * isize{ sizeof(T) },
+    _detail::align<T>(),
+  };
+  auto w_req = StackReq{
+    _detail::adjusted_stride<T>(n + r) * r * isize{ sizeof(T) },
+    _detail::align<T>(),
+  };
+  auto alpha_req = StackReq{
+    r * isize{ sizeof(T) },
+    _detail::align<T>(),
+  };
+  return x_req & w_req &
+         (proxsuite::linalg::dense::factorize_req(tag, r) |
+          (alpha_req &
+           proxsuite::linalg::dense::rank_r_update_clobber_inputs_req(
+             tag, n, r)));
+}
+} // namespace dense
+} // namespace linalg
+} // namespace proxsuite
+
+#endif /* end of include guard PROXSUITE_LINALG_DENSE_LDLT_PACKED_HPP */
@@ -12,6 +12,12 @@ namespace proxsuite {
 namespace linalg {
 namespace dense {
 namespace _detail {
+// number of right hand sides that are solved together, so that the factor is
+// only read once per block of columns
+using solve_rhs_block_size = proxsuite::linalg::veg::meta::constant<isize, 64>;
+
+// rhs may be a vector or a matrix. in the latter case, the triangular solves
+// are performed by the blocked (level 3) kernels
 template<typename Mat, typename Rhs>
 void
 solve_impl(Mat ld, Rhs rhs)
@@ -21,9 +27,277 @@ solve_impl(Mat ld, Rhs rhs)
   auto d = util::diagonal(ld);
 
   l.solveInPlace(rhs);
-  rhs = rhs.cwiseQuotient(d);
+  rhs = d.asDiagonal().inverse() * rhs;
   lt.solveInPlace(rhs);
 }
+
+// number of columns of the factor that are swept together by the fused solve,
+// so that the entries of the solution are loaded and stored once per group
+using fused_solve_width = proxsuite::linalg::veg::meta::constant<usize, 4>;
+
+template<typename T, usize N>
+struct FusedSolveDot
+{
+  _simd::Pack<T, N>* acc;
+  T const* const* cols;
+  _simd::Pack<T, N> p_x;
+  isize i;
+
+  VEG_INLINE void operator()(usize c) const
+  {
+    acc[c] = _simd::Pack<T, N>::fmadd(
+      _simd::Pack<T, N>::load_unaligned(cols[c] + i), p_x, acc[c]);
+  }
+};
+
+// forward sweep over the columns [j, j + K) of l, followed by the scaling by
+// the inverse of their diagonal entries:
+// x[j + K:] -= l[j + K:, j:j + K] × x[j:j + K], x[j:j + K] /= d[j:j + K]
+template<usize K, usize N, typename T>
+VEG_INLINE void
+fused_forward_group(T const* l, isize stride, isize n, isize j, T* x) noexcept
+{
+  T const* cols[K];
+  T xj[K];
+  for (usize c = 0; c < K; ++c) {
+    cols[c] = l + (j + isize(c)) * stride;
+  }
+  for (usize c = 0; c < K; ++c) {
+    xj[c] = x[j + isize(c)];
+    for (usize r = c + 1; r < K; ++r) {
+      x[j + isize(r)] -= cols[c][j + isize(r)] * xj[c];
+    }
+  }
+
+  ColumnsFnmaddRows<K, N>::fn(x, cols, xj, j + isize(K), n);
+
+  for (usize c = 0; c < K; ++c) {
+    x[j + isize(c)] = xj[c] / cols[c][j + isize(c)];
+  }
+}
+
+// backward sweep over the columns [j, j + K) of l, once x[j + K:] is final:
+// x[j:j + K] -= l[j:, j:j + K]ᵀ × x[j:]
+template<usize K, usize N, typename T>
+VEG_INLINE void
+fused_backward_group(T const* l, isize stride, isize n, isize j, T* x) noexcept
+{
+  using Pack = _simd::Pack<T, N>;
+  using Scalar = _simd::Pack<T, 1>;
+
+  T const* cols[K];
+  Pack acc[K];
+  Scalar acc_tail[K];
+  for (usize c = 0; c < K; ++c) {
+    cols[c] = l + (j + isize(c)) * stride;
+    acc[c] = Pack::broadcast(T(0));
+    acc_tail[c] = { T(0) };
+  }
+  isize i = j + isize(K);
+  for (; i + isize(N) <= n; i += isize(N)) {
+    _detail::unroll<K>(
+      FusedSolveDot<T, N>{ acc, cols, Pack::load_unaligned(x + i), i });
+  }
+  for (; i < n; ++i) {
+    _detail::unroll<K>(FusedSolveDot<T, 1>{ acc_tail, cols, { x[i] }, i });
+  }
+
+  for (usize c = 0; c < K; ++c) {
+    T lanes[N];
+    acc[c].store_unaligned(lanes);
+    for (usize w = N / 2; w > 0; w /= 2) {
+      for (usize k = 0; k < w; ++k) {
+        lanes[k] += lanes[k + w];
+      }
+    }
+    x[j + isize(c)] -= lanes[0] + acc_tail[c].inner;
+  }
+
+  for (usize c = K; c-- > 0;) {
+    for (usize r = c + 1; r < K; ++r) {
+      x[j + isize(c)] -= cols[c][j + isize(r)] * x[j + isize(r)];
+    }
+  }
+}
+
+// solves l × d × lᵀ × y = p(rhs) and stores p⁻¹(y) in rhs, with a single
+// forward and a single backward sweep over the factor, using packs of N
+// elements:
+// - the gather of the permuted right hand side into work,
+// - the forward sweep with the inverse of the diagonal applied on the fly,
+// - the backward sweep, where each entry of the solution is scattered back
+//   to rhs as soon as it is final.
+template<usize N, typename T>
+VEG_INLINE void
+permuted_solve_loop(T const* l,
+                    isize stride,
+                    isize n,
+                    isize const* perm,
+                    T* rhs,
+                    T* work) noexcept
+{
+  constexpr usize K = fused_solve_width::value;
+
+  for (isize i = 0; i < n; ++i) {
+    work[i] = rhs[perm[i]];
+  }
+
+  isize n_grouped = n / isize(K) * isize(K);
+  for (isize j = 0; j < n_grouped; j += isize(K)) {
+    _detail::fused_forward_group<K, N>(l, stride, n, j, work);
+  }
+  for (isize j = n_grouped; j < n; ++j) {
+    _detail::fused_forward_group<1, N>(l, stride, n, j, work);
+  }
+
+  for (isize j = n - 1; j >= n_grouped; --j) {
+    _detail::fused_backward_group<1, N>(l, stride, n, j, work);
+    rhs[perm[j]] = work[j];
+  }
+  for (isize j = n_grouped - isize(K); j >= 0; j -= isize(K)) {
+    _detail::fused_backward_group<K, N>(l, stride, n, j, work);
+    for (isize c = 0; c < isize(K); ++c) {
+      rhs[perm[j + c]] = work[j + c];
+    }
+  }
+}
+
+template<typename T>
+using PermutedSolveFn =
+  void (*)(T const*, isize, isize, isize const*, T*, T*);
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<typename T>
+PROXSUITE_LINALG_TARGET_AVX2 void
+permuted_solve_loop_avx2(T const* l,
+                         isize stride,
+                         isize n,
+                         isize const* perm,
+                         T* rhs,
+                         T* work) noexcept
+{
+  _detail::permuted_solve_loop<32 / sizeof(T)>(l, stride, n, perm, rhs, work);
+}
+
+template<typename T>
+PROXSUITE_LINALG_TARGET_AVX512 void
+permuted_solve_loop_avx512(T const* l,
+                           isize stride,
+                           isize n,
+                           isize const* perm,
+                           T* rhs,
+                           T* work) noexcept
+{
+  _detail::permuted_solve_loop<64 / sizeof(T)>(l, stride, n, perm, rhs, work);
+}
+#endif
+
+template<typename T, bool VECTORIZABLE = should_vectorize<T>::value>
+struct PermutedSolveTable
+{
+  static auto get() noexcept -> PermutedSolveFn<T>
+  {
+    return permuted_solve_loop<_simd::NativePackInfo<T>::N, T>;
+  }
+};
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<typename T>
+struct PermutedSolveTable<T, true>
+{
+  // the kernel is selected once, depending on the instruction set of the
+  // running host
+  static auto get() noexcept -> PermutedSolveFn<T>
+  {
+    switch (proxsuite::helpers::runtime_simd_level()) {
+      case proxsuite::helpers::SimdLevel::AVX512:
+        return permuted_solve_loop_avx512<T>;
+      case proxsuite::helpers::SimdLevel::AVX2:
+        return permuted_solve_loop_avx2<T>;
+      default:
+        return permuted_solve_loop<_simd::NativePackInfo<T>::N, T>;
+    }
+  }
+};
+#endif
+
+// solves l × d × lᵀ × y = p(rhs) and stores p⁻¹(y) in rhs, with the kernel
+// matching the instruction set of the running host
+template<typename T>
+void
+permuted_solve_impl(T const* l,
+                    isize stride,
+                    isize n,
+                    isize const* perm,
+                    T* rhs,
+                    T* work) noexcept
+{
+  _detail::PermutedSolveTable<T>::get()(l, stride, n, perm, rhs, work);
+}
+
+// estimates the 1-norm of a symmetric n×n operator B with Hager's method, from
+// a few products apply(v) : v ← B × v.
+// x and y are work vectors of size n.
+template<typename T, typename Fn>
+auto
+norm1_estimate_symmetric(isize n, Fn apply, T* x, T* y) -> T
+{
+  using std::fabs;
+
+  if (n == 0) {
+    return T(0);
+  }
+
+  for (isize i = 0; i < n; ++i) {
+    x[i] = T(1) / T(n);
+  }
+
+  T estimate = T(0);
+  isize prev_j = -1;
+  for (isize it = 0; it < 5; ++it) {
+    // y = B × x
+    for (isize i = 0; i < n; ++i) {
+      y[i] = x[i];
+    }
+    apply(y);
+    T norm = T(0);
+    for (isize i = 0; i < n; ++i) {
+      norm += fabs(y[i]);
+    }
+    if (it > 0 && norm <= estimate) {
+      break;
+    }
+    estimate = norm;
+
+    // z = B × sign(y), stored in y
+    for (isize i = 0; i < n; ++i) {
+      y[i] = y[i] >= T(0) ? T(1) : T(-1);
+    }
+    apply(y);
+
+    isize j = 0;
+    T z_max = fabs(y[0]);
+    T z_dot_x = T(0);
+    for (isize i = 0; i < n; ++i) {
+      if (fabs(y[i]) > z_max) {
+        z_max = fabs(y[i]);
+        j = i;
+      }
+      z_dot_x += y[i] * x[i];
+    }
+    if (z_max <= z_dot_x || j == prev_j) {
+      break;
+    }
+    prev_j = j;
+
+    // restart from the unit vector of the largest gradient component
+    for (isize i = 0; i < n; ++i) {
+      x[i] = T(0);
+    }
+    x[j] = T(1);
+  }
+  return estimate;
+}
 } // namespace _detail
 template<typename Mat, typename Rhs>
 void
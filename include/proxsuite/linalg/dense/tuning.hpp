@@ -0,0 +1,318 @@
+/** \file */
+//
+// Copyright (c) 2022 INRIA
+//
+#ifndef PROXSUITE_LINALG_DENSE_LDLT_TUNING_HPP
+#define PROXSUITE_LINALG_DENSE_LDLT_TUNING_HPP
+
+#include "proxsuite/linalg/dense/factorize.hpp"
+#include <proxsuite/linalg/veg/vec.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace proxsuite {
+namespace linalg {
+namespace dense {
+namespace _detail {
+
+template<typename T>
+struct TuningMatrix
+{
+  using ColMat = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+  ColMat a;
+  ColMat work;
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+
+  explicit TuningMatrix(isize n)
+  {
+    // symmetric and diagonally dominant, so that no pivot gets small
+    a = ColMat::Random(n, n);
+    a = (a + a.transpose()).eval();
+    a.diagonal().array() += T(2 * n);
+    work.resize(n, n);
+  }
+
+  // best wall clock time out of nb_samples factorizations of the leading
+  // n x n block
+  template<typename Fn>
+  auto time(isize n, isize nb_samples, Fn fn) -> double
+  {
+    double best = 0;
+    for (isize k = 0; k < nb_samples; ++k) {
+      auto w = work.topLeftCorner(n, n);
+      w = a.topLeftCorner(n, n);
+      proxsuite::linalg::veg::dynstack::DynStackMut stack{
+        proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+      };
+      auto start = std::chrono::steady_clock::now();
+      fn(w, stack);
+      auto stop = std::chrono::steady_clock::now();
+      double t = std::chrono::duration<double>(stop - start).count();
+      if (k == 0 || t < best) {
+        best = t;
+      }
+    }
+    return best;
+  }
+
+  void reserve(proxsuite::linalg::veg::dynstack::StackReq req)
+  {
+    if (storage.len() < req.alloc_req()) {
+      storage.resize_for_overwrite(req.alloc_req());
+    }
+  }
+};
+
+template<typename T>
+struct ScalarName;
+template<>
+struct ScalarName<float>
+{
+  static constexpr char const* value() noexcept { return "f32"; }
+};
+template<>
+struct ScalarName<double>
+{
+  static constexpr char const* value() noexcept { return "f64"; }
+};
+} // namespace _detail
+
+/*!
+ * Times the candidate block sizes and recursion cutoffs of the dense LDLT
+ * factorization for the scalar type `T` on the running machine, and returns
+ * the fastest combination. The parameters currently in use are left
+ * unchanged, see `set_factorize_params`.
+ * The cost of the tuning grows as the cube of `max_dim`.
+ *
+ * @param max_dim size of the largest matrix used for the measurements
+ * @param nb_samples number of timings per candidate, the best one is kept
+ */
+template<typename T>
+auto
+tune_factorize_params(isize max_dim = 2048, isize nb_samples = 3)
+  -> FactorizeParams
+{
+  static constexpr isize recursive_candidates[] = { 8, 16, 32, 64, 128 };
+  static constexpr isize block_candidates[] = { 32, 64, 96, 128, 192, 256 };
+  proxsuite::linalg::veg::Tag<T> tag{};
+
+  max_dim = _detail::max2(max_dim, isize(256));
+  nb_samples = _detail::max2(nb_samples, isize(1));
+  _detail::TuningMatrix<T> bench(max_dim);
+
+  FactorizeParams params = _detail::default_factorize_params<T>();
+
+  // recursion cutoff, measured on a matrix small enough for the recursive
+  // variant to be the one in use
+  {
+    isize n = _detail::min2(max_dim, isize(512));
+    bench.reserve(proxsuite::linalg::veg::dynstack::StackReq{
+      n * _detail::adjusted_stride<T>(n) * isize{ sizeof(T) },
+      _detail::align<T>(),
+    });
+    double best = -1;
+    for (isize threshold : recursive_candidates) {
+      double t = bench.time(
+        n,
+        nb_samples,
+        [&](Eigen::Ref<typename _detail::TuningMatrix<T>::ColMat> w,
+            proxsuite::linalg::veg::dynstack::DynStackMut stack) {
+          _detail::factorize_recursive_impl(
+            util::to_view_dyn(w), threshold, stack);
+        });
+      if (best < 0 || t < best) {
+        best = t;
+        params.recursive_threshold = threshold;
+      }
+    }
+  }
+
+  // panel width of the blocked variant, measured on the largest matrix
+  {
+    double best = -1;
+    for (isize block_size : block_candidates) {
+      bench.reserve(proxsuite::linalg::dense::factorize_blocked_req(
+        tag, max_dim, block_size));
+      double t = bench.time(
+        max_dim,
+        nb_samples,
+        [&](Eigen::Ref<typename _detail::TuningMatrix<T>::ColMat> w,
+            proxsuite::linalg::veg::dynstack::DynStackMut stack) {
+          _detail::factorize_blocked_impl(
+            util::to_view_dyn(w), block_size, stack);
+        });
+      if (best < 0 || t < best) {
+        best = t;
+        params.block_size = block_size;
+      }
+    }
+  }
+
+  // crossover between the two variants: the blocked one is used from the
+  // smallest size after which it always wins
+  {
+    bench.reserve(proxsuite::linalg::dense::factorize_blocked_req(
+                    tag, max_dim, params.block_size) |
+                  proxsuite::linalg::veg::dynstack::StackReq{
+                    max_dim * _detail::adjusted_stride<T>(max_dim) *
+                      isize{ sizeof(T) },
+                    _detail::align<T>(),
+                  });
+    isize threshold = -1;
+    for (isize n = 256; n <= max_dim; n *= 2) {
+      double t_blocked = bench.time(
+        n,
+        nb_samples,
+        [&](Eigen::Ref<typename _detail::TuningMatrix<T>::ColMat> w,
+            proxsuite::linalg::veg::dynstack::DynStackMut stack) {
+          _detail::factorize_blocked_impl(
+            util::to_view_dyn(w), params.block_size, stack);
+        });
+      double t_recursive = bench.time(
+        n,
+        nb_samples,
+        [&](Eigen::Ref<typename _detail::TuningMatrix<T>::ColMat> w,
+            proxsuite::linalg::veg::dynstack::DynStackMut stack) {
+          _detail::factorize_recursive_impl(
+            util::to_view_dyn(w), params.recursive_threshold, stack);
+        });
+      if (t_blocked < t_recursive) {
+        if (threshold < 0) {
+          threshold = n / 2;
+        }
+      } else {
+        threshold = -1;
+      }
+    }
+    params.blocked_threshold =
+      threshold < 0 ? _detail::max2(params.blocked_threshold, max_dim)
+                    : threshold;
+  }
+
+  return params;
+}
+
+/*!
+ * Writes the parameters currently in use for `f32` and `f64` to the file at
+ * `path`, one line per scalar type. This does not freeze them, see
+ * `factorize_params`.
+ *
+ * @param path path of the cache file
+ * @return whether the file could be written
+ */
+inline auto
+save_factorize_params(char const* path) -> bool
+{
+  std::FILE* file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = std::fputs("# scalar block_size recursive_threshold "
+                       "blocked_threshold\n",
+                       file) >= 0;
+  auto write = [&](char const* name, FactorizeParams params) {
+    ok = ok && std::fprintf(file,
+                            "%s %lld %lld %lld\n",
+                            name,
+                            static_cast<long long>(params.block_size),
+                            static_cast<long long>(params.recursive_threshold),
+                            static_cast<long long>(params.blocked_threshold)) >
+                 0;
+  };
+  write(_detail::ScalarName<f32>::value(),
+        _detail::current_factorize_params<f32>());
+  write(_detail::ScalarName<f64>::value(),
+        _detail::current_factorize_params<f64>());
+  ok = (std::fclose(file) == 0) && ok;
+  return ok;
+}
+
+/*!
+ * Reads a cache file written by `save_factorize_params`, and sets the
+ * parameters of the scalar types it contains. Lines that cannot be parsed
+ * are ignored. The parameters of a scalar type that were already used are
+ * left unchanged, see `set_factorize_params`.
+ *
+ * @param path path of the cache file
+ * @return whether the parameters of both `f32` and `f64` were found, and are
+ * the ones in use
+ */
+inline auto
+load_factorize_params(char const* path) -> bool
+{
+  std::FILE* file = std::fopen(path, "r");
+  if (file == nullptr) {
+    return false;
+  }
+  bool found_f32 = false;
+  bool found_f64 = false;
+  char line[256];
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+    char name[16];
+    long long block_size = 0;
+    long long recursive_threshold = 0;
+    long long blocked_threshold = 0;
+    if (std::sscanf(line,
+                    "%15s %lld %lld %lld",
+                    name,
+                    &block_size,
+                    &recursive_threshold,
+                    &blocked_threshold) != 4 ||
+        block_size <= 0 || recursive_threshold <= 0 ||
+        blocked_threshold <= 0) {
+      continue;
+    }
+    FactorizeParams params{
+      isize(block_size),
+      isize(recursive_threshold),
+      isize(blocked_threshold),
+    };
+    if (std::strcmp(name, _detail::ScalarName<f32>::value()) == 0) {
+      found_f32 =
+        proxsuite::linalg::dense::set_factorize_params<f32>(params);
+    } else if (std::strcmp(name, _detail::ScalarName<f64>::value()) == 0) {
+      found_f64 =
+        proxsuite::linalg::dense::set_factorize_params<f64>(params);
+    }
+  }
+  std::fclose(file);
+  return found_f32 && found_f64;
+}
+
+/*!
+ * Loads the tuned parameters of the dense factorization from the cache file
+ * at `path`. If the file is missing or incomplete, the parameters of `f32`
+ * and `f64` are tuned on the running machine with `tune_factorize_params`,
+ * then set and written to `path`.
+ * This must be called before the first dense factorization or workspace
+ * allocation, since the parameters are frozen by their first use. Once both
+ * are frozen, nothing is tuned nor written.
+ *
+ * @param path path of the cache file
+ * @param max_dim size of the largest matrix used for the measurements
+ * @return whether the parameters in use are the ones of the cache file
+ */
+inline auto
+autotune_factorize_params(char const* path, isize max_dim = 2048) -> bool
+{
+  if (proxsuite::linalg::dense::load_factorize_params(path)) {
+    return true;
+  }
+  if (proxsuite::linalg::dense::factorize_params_frozen<f32>() &&
+      proxsuite::linalg::dense::factorize_params_frozen<f64>()) {
+    return false;
+  }
+  proxsuite::linalg::dense::set_factorize_params<f32>(
+    proxsuite::linalg::dense::tune_factorize_params<f32>(max_dim));
+  proxsuite::linalg::dense::set_factorize_params<f64>(
+    proxsuite::linalg::dense::tune_factorize_params<f64>(max_dim));
+  proxsuite::linalg::dense::save_factorize_params(path);
+  return false;
+}
+} // namespace dense
+} // namespace linalg
+} // namespace proxsuite
+
+#endif /* end of include guard PROXSUITE_LINALG_DENSE_LDLT_TUNING_HPP */
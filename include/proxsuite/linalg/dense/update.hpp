@@ -32,22 +32,6 @@ bytes_to_next_aligned(void* ptr, usize align) noexcept -> isize
   return isize(aligned_ptr - iptr);
 }
 
-template<usize... Is, typename Fn>
-VEG_INLINE void
-unroll_impl(proxsuite::linalg::veg::meta::index_sequence<Is...> /*unused*/,
-            Fn fn)
-{
-  VEG_EVAL_ALL(fn(Is));
-}
-
-template<usize N, typename Fn>
-VEG_INLINE void
-unroll(Fn fn)
-{
-  _detail::unroll_impl(proxsuite::linalg::veg::meta::make_index_sequence<N>{},
-                       VEG_FWD(fn));
-}
-
 template<typename T, usize N>
 struct RankUpdateLoadW
 {
@@ -152,8 +136,8 @@ struct RankRUpdateLoopImpl<false>
   }
 };
 
-template<>
-struct RankRUpdateLoopImpl<true>
+template<usize N>
+struct RankRUpdateVecLoopImpl
 {
   template<usize R, typename T>
   VEG_INLINE static void fn(isize n,
@@ -167,13 +151,11 @@ struct RankRUpdateLoopImpl<true>
     // best perf if beginning of each pw is aligned
     // should be enforced by the Ldlt class
 
-    using Info = _simd::NativePackInfo<T>;
-    constexpr usize N = Info::N;
     auto inout_l_vectorized_end = inout_l + usize(n) / N * N;
     auto inout_l_end = inout_l + usize(n);
 
     {
-      using Pack = _simd::NativePack<T>;
+      using Pack = _simd::Pack<T, N>;
       Pack p_p[R];
       Pack p_mu[R];
 
@@ -203,6 +185,22 @@ struct RankRUpdateLoopImpl<true>
   }
 };
 
+template<>
+struct RankRUpdateLoopImpl<true>
+{
+  template<usize R, typename T>
+  VEG_INLINE static void fn(isize n,
+                            T* inout_l,
+                            T* pw,
+                            isize w_stride,
+                            T const* p,
+                            T const* mu) noexcept
+  {
+    RankRUpdateVecLoopImpl<_simd::NativePackInfo<T>::N>::template fn<R>(
+      n, inout_l, pw, w_stride, p, mu);
+  }
+};
+
 template<usize R, typename T>
 VEG_INLINE void
 rank_r_update_inner_loop(isize n,
@@ -216,6 +214,96 @@ rank_r_update_inner_loop(isize n,
     n, inout_l, pw, w_stride, p, mu);
 }
 
+template<typename T>
+using RankRUpdateInnerLoopFn = void (*)(isize,
+                                        T*,
+                                        T*,
+                                        isize,
+                                        T const*,
+                                        T const*);
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<usize R, typename T>
+PROXSUITE_LINALG_TARGET_AVX2 void
+rank_r_update_inner_loop_avx2(isize n,
+                              T* inout_l,
+                              T* pw,
+                              isize w_stride,
+                              T const* p,
+                              T const* mu)
+{
+  RankRUpdateVecLoopImpl<32 / sizeof(T)>::template fn<R>(
+    n, inout_l, pw, w_stride, p, mu);
+}
+
+template<usize R, typename T>
+PROXSUITE_LINALG_TARGET_AVX512 void
+rank_r_update_inner_loop_avx512(isize n,
+                                T* inout_l,
+                                T* pw,
+                                isize w_stride,
+                                T const* p,
+                                T const* mu)
+{
+  RankRUpdateVecLoopImpl<64 / sizeof(T)>::template fn<R>(
+    n, inout_l, pw, w_stride, p, mu);
+}
+#endif
+
+template<typename T, bool VECTORIZABLE = should_vectorize<T>::value>
+struct RankRUpdateInnerLoopTable
+{
+  // returns the kernels processing 1, 2, 3 and 4 columns at once
+  static auto get() noexcept -> RankRUpdateInnerLoopFn<T> const*
+  {
+    static RankRUpdateInnerLoopFn<T> const table[] = {
+      rank_r_update_inner_loop<1, T>,
+      rank_r_update_inner_loop<2, T>,
+      rank_r_update_inner_loop<3, T>,
+      rank_r_update_inner_loop<4, T>,
+    };
+    return table;
+  }
+};
+
+#ifdef PROXSUITE_LINALG_RUNTIME_DISPATCH
+template<typename T>
+struct RankRUpdateInnerLoopTable<T, true>
+{
+  // the kernels are selected once, depending on the instruction set of the
+  // running host
+  static auto get() noexcept -> RankRUpdateInnerLoopFn<T> const*
+  {
+    static RankRUpdateInnerLoopFn<T> const table_default[] = {
+      rank_r_update_inner_loop<1, T>,
+      rank_r_update_inner_loop<2, T>,
+      rank_r_update_inner_loop<3, T>,
+      rank_r_update_inner_loop<4, T>,
+    };
+    static RankRUpdateInnerLoopFn<T> const table_avx2[] = {
+      rank_r_update_inner_loop_avx2<1, T>,
+      rank_r_update_inner_loop_avx2<2, T>,
+      rank_r_update_inner_loop_avx2<3, T>,
+      rank_r_update_inner_loop_avx2<4, T>,
+    };
+    static RankRUpdateInnerLoopFn<T> const table_avx512[] = {
+      rank_r_update_inner_loop_avx512<1, T>,
+      rank_r_update_inner_loop_avx512<2, T>,
+      rank_r_update_inner_loop_avx512<3, T>,
+      rank_r_update_inner_loop_avx512<4, T>,
+    };
+    switch (proxsuite::helpers::runtime_simd_level()) {
+      case proxsuite::helpers::SimdLevel::AVX512:
+        return table_avx512;
+      case proxsuite::helpers::SimdLevel::AVX2:
+        return table_avx2;
+      default:
+        return table_default;
+    }
+  }
+};
+#endif
+
 template<typename LD, typename T, typename Fn>
 void
 rank_r_update_clobber_w_impl( //
@@ -228,9 +316,14 @@ rank_r_update_clobber_w_impl( //
   static_assert(LD::InnerStrideAtCompileTime == 1, ".");
   static_assert(!bool(LD::IsRowMajor), ".");
 
+  // ld may have more rows than columns, in which case only its leading
+  // columns are updated, and w is updated for the remaining rows
   isize n = ld.rows();
+  isize n_cols = ld.cols();
+  RankRUpdateInnerLoopFn<T> const* fn_table =
+    RankRUpdateInnerLoopTable<T>::get();
 
-  for (isize j = 0; j < n; ++j) {
+  for (isize j = 0; j < n_cols; ++j) {
     isize r = r_fn();
 
     isize r_done = 0;
@@ -261,14 +354,6 @@ rank_r_update_clobber_w_impl( //
 
       isize rem = n - j - 1;
 
-      using FnType = void (*)(isize, T*, T*, isize, T const*, T const*);
-      FnType fn_table[] = {
-        rank_r_update_inner_loop<1, T>,
-        rank_r_update_inner_loop<2, T>,
-        rank_r_update_inner_loop<3, T>,
-        rank_r_update_inner_loop<4, T>,
-      };
-
       (*fn_table[r_chunk - 1])( //
         rem,
         util::matrix_elem_addr(ld, j + 1, j),
@@ -290,8 +375,165 @@ struct ConstantR
   isize r;
   VEG_INLINE auto operator()() const noexcept -> isize { return r; }
 };
+template<typename Fn>
+struct RefR
+{
+  Fn* fn;
+  VEG_INLINE auto operator()() const noexcept -> isize { return (*fn)(); }
+};
+
+using rank_r_update_block_size =
+  proxsuite::linalg::veg::meta::constant<isize, 32>;
+
+// cost model choosing between the column by column update and the blocked one.
+// the blocked update performs about twice as many flops, but almost all of
+// them in matrix products. this only pays off once enough columns of w are
+// updated at each pass over the factor, and once the factor no longer fits in
+// the cache
+inline auto
+rank_r_update_prefer_blocked(isize n, isize r) noexcept -> bool
+{
+  return r >= 16 && n >= 8 * rank_r_update_block_size::value;
+}
+
+template<typename LD, typename T>
+void
+rank_r_update_clobber_w_blocked_impl(
+  LD ld,
+  T* pw,
+  isize w_stride,
+  T* palpha,
+  isize r,
+  proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  /*
+   * the column by column algorithm applies the same sequence of linear
+   * transformations to the row vector [l_i, w_i] of every row i that lies
+   * below the current block of columns [j, j + bs).
+   * the transformations only depend on the diagonal block, so they are
+   * computed once by running the column by column algorithm on the diagonal
+   * block, extended with identity rows. the resulting matrix m is then applied
+   * to all the rows below with matrix products:
+   * [L21 W2] <- [L21 W2] × m
+   */
+  using Map = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>,
+                         Eigen::Unaligned,
+                         Eigen::OuterStride<Eigen::Dynamic>>;
+  constexpr isize B = rank_r_update_block_size::value;
+
+  isize n = ld.rows();
+  isize n_cols = ld.cols();
+
+  for (isize k = 0; k < r; k += B) {
+    isize rb = min2(B, r - k);
+    T* pw_k = pw + k * w_stride;
+
+    isize j = 0;
+    while (j < n_cols) {
+      isize bs = min2(B, n_cols - j);
+      isize rem = n - j - bs;
+
+      LDLT_TEMP_MAT_UNINIT(T, tl, 2 * bs + rb, bs, stack);
+      LDLT_TEMP_MAT_UNINIT(T, tw, 2 * bs + rb, rb, stack);
+
+      auto ld11 = util::submatrix(ld, j, j, bs, bs);
+      auto w1 = Map{
+        pw_k + j, bs, rb, Eigen::OuterStride<Eigen::Dynamic>{ w_stride }
+      };
+
+      util::subrows(tl, 0, bs).template triangularView<Eigen::Lower>() =
+        ld11.template triangularView<Eigen::Lower>();
+      util::subrows(tl, bs, bs + rb).setZero();
+      util::subrows(tl, bs, bs).setIdentity();
+
+      util::subrows(tw, 0, bs) = w1;
+      util::subrows(tw, bs, bs + rb).setZero();
+      util::subrows(tw, 2 * bs, rb).setIdentity();
+
+      _detail::rank_r_update_clobber_w_impl( //
+        tl,
+        tw.data(),
+        tw.outerStride(),
+        palpha + k,
+        ConstantR{ rb });
+
+      ld11.template triangularView<Eigen::Lower>() =
+        util::subrows(tl, 0, bs).template triangularView<Eigen::Lower>();
+
+      if (rem == 0) {
+        break;
+      }
+
+      auto m_l = util::subrows(tl, bs, bs + rb);
+      auto m_w = util::subrows(tw, bs, bs + rb);
+
+      auto l21 = util::submatrix(ld, j + bs, j, rem, bs);
+      auto w2 = Map{
+        pw_k + j + bs, rem, rb, Eigen::OuterStride<Eigen::Dynamic>{ w_stride }
+      };
+
+      LDLT_TEMP_MAT_UNINIT(T, l21_new, rem, bs, stack);
+      LDLT_TEMP_MAT_UNINIT(T, w2_new, rem, rb, stack);
+
+      l21_new.noalias() = l21 * util::subrows(m_l, 0, bs);
+      l21_new.noalias() += w2 * util::subrows(m_l, bs, rb);
+      w2_new.noalias() = l21 * util::subrows(m_w, 0, bs);
+      w2_new.noalias() += w2 * util::subrows(m_w, bs, rb);
+
+      l21 = l21_new;
+      w2 = w2_new;
+      j += bs;
+    }
+  }
+}
+
+// rank r update with a constant r, using the cost model to pick the algorithm
+template<typename LD, typename T>
+void
+rank_r_update_clobber_w_select_impl(
+  LD ld,
+  T* pw,
+  isize w_stride,
+  T* palpha,
+  isize r,
+  proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  if (_detail::rank_r_update_prefer_blocked(ld.rows(), r)) {
+    _detail::rank_r_update_clobber_w_blocked_impl(
+      ld, pw, w_stride, palpha, r, stack);
+  } else {
+    _detail::rank_r_update_clobber_w_impl(
+      ld, pw, w_stride, palpha, ConstantR{ r });
+  }
+}
 } // namespace _detail
 
+/*!
+ * Returns the memory storage requirements for a rank `r` update of a matrix
+ * with size at most `n×n`, with the algorithm chosen by
+ * `rank_r_update_clobber_inputs`.
+ *
+ * @param n maximum dimension of the matrix
+ * @param r maximum rank of the update
+ */
+template<typename T>
+auto
+rank_r_update_clobber_inputs_req(proxsuite::linalg::veg::Tag<T> tag,
+                                 isize n,
+                                 isize r) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  if (!_detail::rank_r_update_prefer_blocked(n, r)) {
+    return proxsuite::linalg::veg::dynstack::StackReq{ 0, 1 };
+  }
+  isize b = _detail::rank_r_update_block_size::value;
+  isize rb = _detail::min2(b, r);
+  return proxsuite::linalg::dense::temp_mat_req(tag, 2 * b + rb, b) &
+         proxsuite::linalg::dense::temp_mat_req(tag, 2 * b + rb, rb) &
+         proxsuite::linalg::dense::temp_mat_req(tag, n, b) &
+         proxsuite::linalg::dense::temp_mat_req(tag, n, rb);
+}
+
 template<typename LD,
          typename W,
          typename T = typename proxsuite::linalg::veg::uncvref_t<LD>::Scalar>
@@ -323,6 +565,36 @@ rank_r_update_clobber_inputs(LD&& ld, W&& w, A&& alpha)
     alpha.data(),
     _detail::ConstantR{ r });
 }
+
+/*!
+ * Computes the decomposition of `L×diag(D)×L.T + w×diag(alpha)×w.T` in place,
+ * where `ld` holds `L` and `D`. `w` and `alpha` are clobbered.
+ * Large updates are performed with a blocked algorithm, whose memory
+ * requirements are given by `rank_r_update_clobber_inputs_req`.
+ *
+ * @param ld factor to update
+ * @param w rank update matrix
+ * @param alpha rank update diagonal vector
+ * @param stack workspace memory stack
+ */
+template<typename LD,
+         typename W,
+         typename A,
+         typename T = typename proxsuite::linalg::veg::uncvref_t<LD>::Scalar>
+void
+rank_r_update_clobber_inputs(LD&& ld,
+                             W&& w,
+                             A&& alpha,
+                             proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  _detail::rank_r_update_clobber_w_select_impl( //
+    util::to_view_dyn(ld),
+    w.data(),
+    w.outerStride(),
+    alpha.data(),
+    w.cols(),
+    stack);
+}
 } // namespace dense
 } // namespace linalg
 } // namespace proxsuite
@@ -6,27 +6,176 @@
 #define PROXSUITE_LINALG_SPARSE_LDLT_FACTORIZE_HPP
 
 #include "proxsuite/linalg/sparse/core.hpp"
-#include <Eigen/OrderingMethods>
+#include "proxsuite/linalg/sparse/ordering.hpp"
+#include "proxsuite/helpers/parallel.hpp"
+#include <algorithm>
 
 namespace proxsuite {
 namespace linalg {
 namespace sparse {
 
+namespace _detail {
 template<typename I>
 auto
-transpose_req(proxsuite::linalg::veg::Tag<I> /*tag*/, isize nrows) noexcept
+parallel_scatter_req(proxsuite::linalg::veg::Tag<I> /*tag*/,
+                     isize n_dst,
+                     isize nb_threads) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  constexpr isize sz{ sizeof(I) };
+  constexpr isize al{ alignof(I) };
+  return StackReq{ nb_threads * n_dst * sz, al } &
+         StackReq{ (nb_threads + 1) * isize{ sizeof(isize) },
+                   alignof(isize) } &
+         StackReq{ (nb_threads + 1) * sz, al };
+}
+
+// counting sort of the entries of the columns of src into the n_dst columns
+// of a compressed matrix, using nb_threads threads.
+// dest(j, p) is the destination column of the entry p of the column j of src,
+// or n_dst if the entry is dropped, and write(q, j, p) stores it at the
+// position q of the destination.
+// dst_col_ptrs[0] must be set by the caller.
+//
+// each thread counts the entries of a contiguous range of columns of src in
+// its own histogram, and these are turned into per thread insertion cursors by
+// a prefix sum over the destination columns. the entries of a destination
+// column are then ordered exactly as with the serial counting sort.
+template<typename I, typename Dest, typename Write>
+void
+parallel_scatter(I* dst_col_ptrs,
+                 isize n_dst,
+                 SymbolicMatRef<I> src,
+                 Dest dest,
+                 Write write,
+                 isize nb_threads,
+                 DynStackMut stack)
+{
+  proxsuite::linalg::veg::Tag<I> tag{};
+  usize n = usize(n_dst);
+  usize n_src = usize(src.ncols());
+  isize nt = nb_threads;
+
+  auto _counts = stack.make_new(tag, nt * n_dst);
+  auto _col_bounds = stack.make_new_for_overwrite(
+    proxsuite::linalg::veg::Tag<isize>{}, nt + 1);
+  auto _block_starts = stack.make_new_for_overwrite(tag, nt + 1);
+  I* pcounts = _counts.ptr_mut();
+  isize* pcol_bounds = _col_bounds.ptr_mut();
+  I* pblock_starts = _block_starts.ptr_mut();
+
+  // the columns of src are split so that each thread gets about the same
+  // number of entries
+  I const* psrc_col_ptrs = src.col_ptrs();
+  usize first = util::zero_extend(psrc_col_ptrs[0]);
+  usize total = util::zero_extend(psrc_col_ptrs[n_src]) - first;
+  pcol_bounds[0] = 0;
+  pcol_bounds[nt] = isize(n_src);
+  for (isize t = 1; t < nt; ++t) {
+    I target = I(first + usize(t) * total / usize(nt));
+    pcol_bounds[t] = isize(
+      std::lower_bound(psrc_col_ptrs, psrc_col_ptrs + n_src, target) -
+      psrc_col_ptrs);
+  }
+
+  auto for_each_entry = [&](isize t, I* pcursors, bool count) {
+    for (usize j = usize(pcol_bounds[t]); j < usize(pcol_bounds[t + 1]); ++j) {
+      usize col_start = src.col_start(j);
+      usize col_end = src.col_end(j);
+      for (usize p = col_start; p < col_end; ++p) {
+        usize i = dest(j, p);
+        if (i == n) {
+          continue;
+        }
+        if (count) {
+          util::wrapping_inc(mut(pcursors[i]));
+        } else {
+          write(util::zero_extend(pcursors[i]), j, p);
+          pcursors[i] = util::wrapping_plus(pcursors[i], I(1));
+        }
+      }
+    }
+  };
+
+  proxsuite::helpers::parallel_for(
+    nt, nt, [&](isize t) { for_each_entry(t, pcounts + t * n_dst, true); });
+
+  // the destination columns are split into nt blocks. the counts of each
+  // column become offsets relative to its start, and the column sizes are
+  // kept in dst_col_ptrs until the block starts are known
+  auto block_bounds = [&](isize b, usize& begin, usize& end) {
+    begin = usize(b) * n / usize(nt);
+    end = usize(b + 1) * n / usize(nt);
+  };
+  proxsuite::helpers::parallel_for(nt, nt, [&](isize b) {
+    usize begin = 0;
+    usize end = 0;
+    block_bounds(b, begin, end);
+    I block_size = I(0);
+    for (usize i = begin; i < end; ++i) {
+      I col_size = I(0);
+      for (isize t = 0; t < nt; ++t) {
+        I& c = pcounts[usize(t) * n + i];
+        I tmp = c;
+        c = col_size;
+        col_size = util::wrapping_plus(col_size, tmp);
+      }
+      dst_col_ptrs[i + 1] = col_size;
+      block_size = util::checked_non_negative_plus(block_size, col_size);
+    }
+    pblock_starts[b + 1] = block_size;
+  });
+
+  pblock_starts[0] = dst_col_ptrs[0];
+  for (isize b = 0; b < nt; ++b) {
+    pblock_starts[b + 1] =
+      util::checked_non_negative_plus(pblock_starts[b], pblock_starts[b + 1]);
+  }
+
+  proxsuite::helpers::parallel_for(nt, nt, [&](isize b) {
+    usize begin = 0;
+    usize end = 0;
+    block_bounds(b, begin, end);
+    I start = pblock_starts[b];
+    for (usize i = begin; i < end; ++i) {
+      for (isize t = 0; t < nt; ++t) {
+        I& c = pcounts[usize(t) * n + i];
+        c = util::wrapping_plus(c, start);
+      }
+      start = util::wrapping_plus(start, dst_col_ptrs[i + 1]);
+      dst_col_ptrs[i + 1] = start;
+    }
+  });
+
+  proxsuite::helpers::parallel_for(
+    nt, nt, [&](isize t) { for_each_entry(t, pcounts + t * n_dst, false); });
+}
+} // namespace _detail
+
+template<typename I>
+auto
+transpose_req(proxsuite::linalg::veg::Tag<I> tag,
+              isize nrows,
+              isize nb_threads = 1) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  if (nb_threads > 1) {
+    return _detail::parallel_scatter_req(tag, nrows, nb_threads);
+  }
   return { nrows * isize(sizeof(I)), isize(alignof(I)) };
 }
 
 // at = a.T
+// with nb_threads > 1, the counting sort is split between threads, and the
+// result is identical to the serial one
 template<typename T, typename I>
 void
 transpose( //
   MatMut<T, I> at,
   MatRef<T, I> a,
-  DynStackMut stack) noexcept(VEG_CONCEPT(nothrow_copyable<T>))
+  DynStackMut stack,
+  isize nb_threads = 1) noexcept(VEG_CONCEPT(nothrow_copyable<T>))
 {
   using namespace _detail;
 
@@ -43,6 +192,21 @@ transpose( //
   auto pati = at.row_indices_mut();
   auto patx = at.values_mut();
 
+  if (nb_threads > 1) {
+    _detail::parallel_scatter(
+      patp,
+      at.ncols(),
+      a.symbolic(),
+      [&](usize /*j*/, usize p) { return util::zero_extend(pai[p]); },
+      [&](usize q, usize j, usize p) {
+        pati[q] = I(j);
+        patx[q] = pax[p];
+      },
+      nb_threads,
+      stack);
+    return;
+  }
+
   auto _work = stack.make_new(proxsuite::linalg::veg::Tag<I>{}, at.ncols());
   auto work = _work.ptr_mut();
 
@@ -83,10 +247,14 @@ transpose( //
 
 template<typename I>
 auto
-transpose_symbolic_req(proxsuite::linalg::veg::Tag<I> /*tag*/,
-                       isize nrows) noexcept
+transpose_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
+                       isize nrows,
+                       isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
+  if (nb_threads > 1) {
+    return _detail::parallel_scatter_req(tag, nrows, nb_threads);
+  }
   return { nrows * isize(sizeof(I)), isize(alignof(I)) };
 }
 
@@ -95,7 +263,8 @@ void
 transpose_symbolic( //
   SymbolicMatMut<I> at,
   SymbolicMatRef<I> a,
-  DynStackMut stack) noexcept
+  DynStackMut stack,
+  isize nb_threads = 1) noexcept
 {
   using namespace _detail;
 
@@ -110,6 +279,18 @@ transpose_symbolic( //
   auto patp = at.col_ptrs_mut();
   auto pati = at.row_indices_mut();
 
+  if (nb_threads > 1) {
+    _detail::parallel_scatter(
+      patp,
+      at.ncols(),
+      a,
+      [&](usize /*j*/, usize p) { return util::zero_extend(pai[p]); },
+      [&](usize q, usize j, usize /*p*/) { pati[q] = I(j); },
+      nb_threads,
+      stack);
+    return;
+  }
+
   auto _work = stack.make_new(proxsuite::linalg::veg::Tag<I>{}, at.ncols());
   auto work = _work.ptr_mut();
 
@@ -581,14 +762,15 @@ template<typename I>
 auto
 column_counts_req(proxsuite::linalg::veg::Tag<I> tag,
                   isize n,
-                  isize nnz) noexcept
+                  isize nnz,
+                  isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
   using proxsuite::linalg::veg::dynstack::StackReq;
   return StackReq{
     isize{ sizeof(I) } * (1 + 5 * n + nnz),
     alignof(I),
-  } & sparse::transpose_symbolic_req(tag, n);
+  } & sparse::transpose_symbolic_req(tag, n, nb_threads);
 }
 
 template<typename I>
@@ -597,7 +779,8 @@ column_counts(I* counts,
               SymbolicMatRef<I> a,
               I const* parent,
               I const* post,
-              DynStackMut stack) noexcept
+              DynStackMut stack,
+              isize nb_threads = 1) noexcept
 {
   // https://youtu.be/uZKJPTo4dZs
   using namespace _detail;
@@ -612,7 +795,7 @@ column_counts(I* counts,
     from_raw_parts, isize(n), isize(n),         a.nnz(),
     pat_work,       nullptr,  pat_work + n + 1,
   };
-  sparse::transpose_symbolic(at, a, stack);
+  sparse::transpose_symbolic(at, a, stack, nb_threads);
 
   auto patp = at.col_ptrs();
   auto pati = at.row_indices();
@@ -714,46 +897,6 @@ column_counts(I* counts,
   }
 }
 
-template<typename I>
-auto
-amd_req(proxsuite::linalg::veg::Tag<I> /*tag*/, isize /*n*/, isize nnz) noexcept
-  -> proxsuite::linalg::veg::dynstack::StackReq
-{
-  return { nnz * isize{ sizeof(char) }, alignof(char) };
-}
-
-template<typename I>
-void
-amd(I* perm, SymbolicMatRef<I> mat, DynStackMut stack) noexcept
-{
-  // TODO: reimplement amd under BSD-3
-  // https://github.com/DrTimothyAldenDavis/SuiteSparse/tree/master/AMD
-
-  isize n = mat.nrows();
-  isize nnz = mat.nnz();
-
-  Eigen::PermutationMatrix<-1, -1, I> perm_eigen;
-  auto _ = stack.make_new(proxsuite::linalg::veg::Tag<char>{}, nnz);
-
-  Eigen::AMDOrdering<I>{}(
-    Eigen::Map<Eigen::SparseMatrix<char, Eigen::ColMajor, I> const>{
-      n,
-      n,
-      nnz,
-      mat.col_ptrs(),
-      mat.row_indices(),
-      _.ptr(),
-      mat.nnz_per_col(),
-    }
-      .template selfadjointView<Eigen::Upper>(),
-
-    perm_eigen);
-  std::memmove( //
-    perm,
-    perm_eigen.indices().data(),
-    usize(n) * sizeof(I));
-}
-
 namespace _detail {
 template<typename I>
 void
@@ -766,17 +909,26 @@ inv_perm(I* perm_inv, I const* perm, isize n) noexcept
 
 template<typename I>
 auto
-symmetric_permute_symbolic_req(proxsuite::linalg::veg::Tag<I> /*tag*/,
-                               isize n) noexcept
+symmetric_permute_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
+                               isize n,
+                               isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
+  if (nb_threads > 1) {
+    return _detail::parallel_scatter_req(tag, n, nb_threads);
+  }
   return { n * isize{ sizeof(I) }, alignof(I) };
 }
 template<typename I>
 auto
-symmetric_permute_req(proxsuite::linalg::veg::Tag<I> /*tag*/, isize n) noexcept
+symmetric_permute_req(proxsuite::linalg::veg::Tag<I> tag,
+                      isize n,
+                      isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
+  if (nb_threads > 1) {
+    return _detail::parallel_scatter_req(tag, n, nb_threads);
+  }
   return { n * isize{ sizeof(I) }, alignof(I) };
 }
 
@@ -812,16 +964,74 @@ symmetric_permute_common(usize n,
   }
 }
 
+// parallel version of the symmetric permutation, see parallel_scatter.
+// write(q, new_min, p) stores the entry p of old_a at the position q of the
+// permuted matrix, with the row index new_min
+template<typename I, typename Write>
+void
+symmetric_permute_parallel(I* pnew_ap,
+                           usize n,
+                           I const* pperm_inv,
+                           SymbolicMatRef<I> old_a,
+                           Write write,
+                           isize nb_threads,
+                           DynStackMut stack)
+{
+  I const* pold_ai = old_a.row_indices();
+  auto new_max_min = [&](usize old_j, usize p, usize& new_min) -> usize {
+    usize old_i = util::zero_extend(pold_ai[p]);
+    if (old_i > old_j) {
+      return n;
+    }
+    usize new_i = util::zero_extend(pperm_inv[old_i]);
+    usize new_j = util::zero_extend(pperm_inv[old_j]);
+    new_min = new_i < new_j ? new_i : new_j;
+    return new_i > new_j ? new_i : new_j;
+  };
+
+  pnew_ap[0] = I(0);
+  _detail::parallel_scatter(
+    pnew_ap,
+    isize(n),
+    old_a,
+    [&](usize old_j, usize p) {
+      usize new_min = 0;
+      return new_max_min(old_j, p, new_min);
+    },
+    [&](usize q, usize old_j, usize p) {
+      usize new_min = 0;
+      new_max_min(old_j, p, new_min);
+      write(q, new_min, p);
+    },
+    nb_threads,
+    stack);
+}
+
 template<typename I>
 void
 symmetric_permute_symbolic(SymbolicMatMut<I> new_a,
                            SymbolicMatRef<I> old_a,
                            I const* perm_inv,
-                           DynStackMut stack) noexcept
+                           DynStackMut stack,
+                           isize nb_threads = 1) noexcept
 {
 
   usize n = usize(new_a.nrows());
 
+  if (nb_threads > 1) {
+    VEG_ASSERT(new_a.is_compressed());
+    I* pnew_ai = new_a.row_indices_mut();
+    _detail::symmetric_permute_parallel(
+      new_a.col_ptrs_mut(),
+      n,
+      perm_inv,
+      old_a,
+      [&](usize q, usize new_min, usize /*p*/) { pnew_ai[q] = I(new_min); },
+      nb_threads,
+      stack);
+    return;
+  }
+
   auto _work = stack.make_new(proxsuite::linalg::veg::Tag<I>{}, isize(n));
   I* pcol_counts = _work.ptr_mut();
 
@@ -865,9 +1075,30 @@ void
 symmetric_permute(MatMut<T, I> new_a,
                   MatRef<T, I> old_a,
                   I const* perm_inv,
-                  DynStackMut stack) noexcept(VEG_CONCEPT(nothrow_copyable<T>))
+                  DynStackMut stack,
+                  isize nb_threads = 1)
+  noexcept(VEG_CONCEPT(nothrow_copyable<T>))
 {
   usize n = usize(new_a.nrows());
+
+  if (nb_threads > 1) {
+    VEG_ASSERT(new_a.is_compressed());
+    I* pnew_ai = new_a.row_indices_mut();
+    T* pnew_ax = new_a.values_mut();
+    T const* pold_ax = old_a.values();
+    _detail::symmetric_permute_parallel(
+      new_a.col_ptrs_mut(),
+      n,
+      perm_inv,
+      old_a.symbolic(),
+      [&](usize q, usize new_min, usize p) {
+        pnew_ai[q] = I(new_min);
+        pnew_ax[q] = pold_ax[p];
+      },
+      nb_threads,
+      stack);
+    return;
+  }
   auto _work = stack.make_new(proxsuite::linalg::veg::Tag<I>{}, isize(n));
   I* pcol_counts = _work.ptr_mut();
 
@@ -926,13 +1157,16 @@ enum struct Ordering : unsigned char
  * @param nnz number of non zeros of the matrix to be factorized.
  * @param o the kind of permutation that is applied to the matrix before
  * factorization.
+ * @param nb_threads number of threads used for the permutation and
+ * transposition passes.
  */
 template<typename I>
 auto
 factorize_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
                        isize n,
                        isize nnz,
-                       Ordering o) noexcept
+                       Ordering o,
+                       isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
   using proxsuite::linalg::veg::dynstack::StackReq;
@@ -950,7 +1184,8 @@ factorize_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
       HEDLEY_FALL_THROUGH;
     case Ordering::user_provided:
       perm_req = perm_req & StackReq{ (n + 1 + nnz) * sz, al };
-      perm_req = perm_req & _detail::symmetric_permute_symbolic_req(tag, n);
+      perm_req = perm_req & _detail::symmetric_permute_symbolic_req(
+                              tag, n, nb_threads);
     default:
       break;
   }
@@ -960,7 +1195,8 @@ factorize_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
 
   StackReq etree_req = sparse::etree_req(tag, n);
   StackReq postorder_req = sparse::postorder_req(tag, n);
-  StackReq colcount_req = sparse::column_counts_req(tag, n, nnz);
+  StackReq colcount_req =
+    sparse::column_counts_req(tag, n, nnz, nb_threads);
 
   return amd_req              //
          | (perm_req          //
@@ -980,6 +1216,8 @@ factorize_symbolic_req(proxsuite::linalg::veg::Tag<I> tag,
  * @param perm optionally user-provided permutation, either null or of size `n`
  * @param a matrix to be symbolically factorized
  * @param stack temporary allocation stack
+ * @param nb_threads number of threads used for the permutation and
+ * transposition passes.
  */
 template<typename I>
 void
@@ -988,7 +1226,8 @@ factorize_symbolic_non_zeros(I* nnz_per_col,
                              I* perm_inv,
                              I const* perm,
                              SymbolicMatRef<I> a,
-                             DynStackMut stack) noexcept
+                             DynStackMut stack,
+                             isize nb_threads = 1) noexcept
 {
 
   bool id_perm = perm_inv == nullptr;
@@ -1038,7 +1277,8 @@ factorize_symbolic_non_zeros(I* nnz_per_col,
       nullptr,
       _permuted_a_row_indices.ptr_mut(),
     };
-    _detail::symmetric_permute_symbolic(permuted_a, a, perm_inv, stack);
+    _detail::symmetric_permute_symbolic(
+      permuted_a, a, perm_inv, stack, nb_threads);
   }
 
   SymbolicMatRef<I> permuted_a = id_perm ? a
@@ -1056,7 +1296,8 @@ factorize_symbolic_non_zeros(I* nnz_per_col,
 
   auto _post = stack.make_new_for_overwrite(tag, isize(n));
   sparse::postorder(_post.ptr_mut(), etree, isize(n), stack);
-  sparse::column_counts(nnz_per_col, permuted_a, etree, _post.ptr(), stack);
+  sparse::column_counts(
+    nnz_per_col, permuted_a, etree, _post.ptr(), stack, nb_threads);
 }
 
 /*!
@@ -1104,14 +1345,16 @@ factorize_symbolic_col_counts(I* col_ptrs,
  * @param a_nnz number of non zeros of the matrix to be factorized.
  * @param o the kind of permutation that is applied to the matrix before
  * factorization.
+ * @param nb_threads number of threads used for the permutation pass.
  */
 template<typename T, typename I>
 auto
 factorize_numeric_req(proxsuite::linalg::veg::Tag<T> /*ttag*/,
-                      proxsuite::linalg::veg::Tag<I> /*itag*/,
+                      proxsuite::linalg::veg::Tag<I> itag,
                       isize n,
                       isize a_nnz,
-                      Ordering o) noexcept
+                      Ordering o,
+                      isize nb_threads = 1) noexcept
   -> proxsuite::linalg::veg::dynstack::StackReq
 {
   using proxsuite::linalg::veg::dynstack::StackReq;
@@ -1126,12 +1369,17 @@ factorize_numeric_req(proxsuite::linalg::veg::Tag<T> /*ttag*/,
 
   auto symb_perm_req = StackReq{ sz * (id_perm ? 0 : (n + 1 + a_nnz)), al };
   auto num_perm_req = StackReq{ tsz * (id_perm ? 0 : a_nnz), tal };
-  return num_perm_req                         //
-         & (StackReq{ tsz * n, tal }          //
-            & (symb_perm_req                  //
-               & (StackReq{ 2 * n * sz, al }  //
-                  & (StackReq{ n * tsz, tal } //
-                     & StackReq{ n * isize{ sizeof(bool) }, alignof(bool) }))));
+  auto permute_req = id_perm ? StackReq{ 0, al }
+                             : _detail::symmetric_permute_req(
+                                 itag, n, nb_threads);
+  auto factor_req =
+    StackReq{ 2 * n * sz, al }  //
+    & (StackReq{ n * tsz, tal } //
+       & StackReq{ n * isize{ sizeof(bool) }, alignof(bool) });
+  return num_perm_req                //
+         & (StackReq{ tsz * n, tal } //
+            & (symb_perm_req         //
+               & (permute_req | factor_req)));
 }
 
 /*!
@@ -1152,6 +1400,7 @@ factorize_numeric_req(proxsuite::linalg::veg::Tag<T> /*ttag*/,
  * the inverse of `perm`
  * @param a matrix to be factorized
  * @param stack temporary allocation stack
+ * @param nb_threads number of threads used for the permutation pass
  */
 template<typename T, typename I>
 void
@@ -1164,7 +1413,8 @@ factorize_numeric( //
   I const* etree,
   I const* perm_inv,
   MatRef<T, I> a,
-  DynStackMut stack) noexcept(false)
+  DynStackMut stack,
+  isize nb_threads = 1) noexcept(false)
 {
   using namespace _detail;
   isize n = a.nrows();
@@ -1196,7 +1446,7 @@ factorize_numeric( //
       _permuted_a_row_indices.ptr_mut(),
       _permuted_a_values.ptr_mut(),
     };
-    _detail::symmetric_permute(permuted_a, a, perm_inv, stack);
+    _detail::symmetric_permute(permuted_a, a, perm_inv, stack, nb_threads);
   }
 
   MatRef<T, I> permuted_a = id_perm ? a
@@ -1297,6 +1547,264 @@ factorize_numeric( //
     }
   }
 }
+
+/*!
+ * Computes the stack memory requirements of `factorize_numeric_pattern`.
+ *
+ * @param n dimension of the matrix to be factorized.
+ */
+template<typename I>
+auto
+factorize_numeric_pattern_req(proxsuite::linalg::veg::Tag<I> /*tag*/,
+                              isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  constexpr isize sz{ sizeof(I) };
+  constexpr isize al{ alignof(I) };
+  return StackReq{ n * sz, al } &
+         StackReq{ n * isize{ sizeof(bool) }, alignof(bool) };
+}
+
+/*!
+ * Precomputes the data used by `factorize_numeric_refactor` to factorize a
+ * matrix with the same sparsity pattern as `a`, whose values may differ.
+ * This stores the upper triangular part of the permuted matrix along with the
+ * position in `a` of each of its elements, as well as the non zero pattern of
+ * each row of the strictly lower part of `L`, in topological order.
+ *
+ * @param permuted_col_ptrs storage for the column pointers of the permuted
+ * matrix, of size `n + 1`
+ * @param permuted_row_indices storage for the row indices of the permuted
+ * matrix, of size `a.nnz()`
+ * @param permuted_sources storage for the positions in `a` of the elements of
+ * the permuted matrix, of size `a.nnz()`
+ * @param l_row_ptrs storage for the row pointers of the pattern of `L`, of
+ * size `n + 1`
+ * @param l_col_indices storage for the column indices of the pattern of `L`,
+ * of size equal to the number of non zeros of `L` minus `n`
+ * @param etree pointer to the already computed elimination tree
+ * @param perm_inv pointer to the already computed inverse permutation, or
+ * null for the identity permutation
+ * @param a matrix to be factorized
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+factorize_numeric_pattern(I* permuted_col_ptrs,
+                          I* permuted_row_indices,
+                          I* permuted_sources,
+                          I* l_row_ptrs,
+                          I* l_col_indices,
+                          I const* etree,
+                          I const* perm_inv,
+                          SymbolicMatRef<I> a,
+                          DynStackMut stack) noexcept
+{
+  usize n = usize(a.ncols());
+  proxsuite::linalg::veg::Tag<I> tag{};
+
+  {
+    auto _work = stack.make_new(tag, isize(n));
+    I* pcol_counts = _work.ptr_mut();
+
+    // column counts of the upper triangular part of the permuted matrix
+    for (usize old_j = 0; old_j < n; ++old_j) {
+      usize new_j = perm_inv == nullptr ? old_j
+                                        : util::zero_extend(perm_inv[old_j]);
+      for (usize p = a.col_start(old_j); p < a.col_end(old_j); ++p) {
+        usize old_i = util::zero_extend(a.row_indices()[p]);
+        if (old_i <= old_j) {
+          usize new_i = perm_inv == nullptr
+                          ? old_i
+                          : util::zero_extend(perm_inv[old_i]);
+          util::wrapping_inc(mut(pcol_counts[new_i > new_j ? new_i : new_j]));
+        }
+      }
+    }
+
+    permuted_col_ptrs[0] = I(0);
+    for (usize i = 0; i < n; ++i) {
+      permuted_col_ptrs[i + 1] =
+        util::checked_non_negative_plus(permuted_col_ptrs[i], pcol_counts[i]);
+      pcol_counts[i] = permuted_col_ptrs[i];
+    }
+
+    auto pcurrent_row_index = pcol_counts;
+    for (usize old_j = 0; old_j < n; ++old_j) {
+      usize new_j = perm_inv == nullptr ? old_j
+                                        : util::zero_extend(perm_inv[old_j]);
+      for (usize p = a.col_start(old_j); p < a.col_end(old_j); ++p) {
+        usize old_i = util::zero_extend(a.row_indices()[p]);
+        if (old_i <= old_j) {
+          usize new_i = perm_inv == nullptr
+                          ? old_i
+                          : util::zero_extend(perm_inv[old_i]);
+          usize new_max = new_i > new_j ? new_i : new_j;
+          usize new_min = new_i < new_j ? new_i : new_j;
+
+          auto row_idx = pcurrent_row_index[new_max];
+          permuted_row_indices[row_idx] = I(new_min);
+          permuted_sources[row_idx] = I(p);
+          pcurrent_row_index[new_max] = util::wrapping_plus(row_idx, I(1));
+        }
+      }
+    }
+  }
+
+  SymbolicMatRef<I> permuted_a{
+    from_raw_parts,
+    isize(n),
+    isize(n),
+    isize(util::zero_extend(permuted_col_ptrs[n])),
+    permuted_col_ptrs,
+    nullptr,
+    permuted_row_indices,
+  };
+
+  // the pattern of the k-th row of L is the set of nodes reachable from the
+  // pattern of the k-th column of the permuted matrix in the elimination tree
+  auto _ereach_stack_storage = stack.make_new_for_overwrite(tag, isize(n));
+  auto _marked = stack.make_new(proxsuite::linalg::veg::Tag<bool>{}, isize(n));
+  l_row_ptrs[0] = I(0);
+  for (usize k = 0; k < n; ++k) {
+    usize ereach_count = 0;
+    auto ereach_stack = _detail::ereach(ereach_count,
+                                        _ereach_stack_storage.ptr_mut(),
+                                        permuted_a,
+                                        etree,
+                                        isize(k),
+                                        _marked.ptr_mut());
+    usize row_start = util::zero_extend(l_row_ptrs[k]);
+    if (ereach_count > 0) {
+      std::memcpy(l_col_indices + row_start,
+                  ereach_stack,
+                  ereach_count * sizeof(I));
+    }
+    l_row_ptrs[k + 1] = I(row_start + ereach_count);
+  }
+}
+
+/*!
+ * Computes the stack memory requirements of `factorize_numeric_refactor`.
+ *
+ * @param n dimension of the matrix to be factorized.
+ */
+template<typename T, typename I>
+auto
+factorize_numeric_refactor_req(proxsuite::linalg::veg::Tag<T> /*ttag*/,
+                               proxsuite::linalg::veg::Tag<I> /*itag*/,
+                               isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  return StackReq{ n * isize{ sizeof(T) }, alignof(T) } &
+         StackReq{ n * isize{ sizeof(I) }, alignof(I) };
+}
+
+/*!
+ * Performs numerical `LDLT` factorization of a matrix whose sparsity pattern
+ * is the one `factorize_numeric_pattern` was called with. The permutation of
+ * the matrix and the elimination tree traversals are replaced by the
+ * precomputed data, so that only the values are computed. The result is the
+ * same as the one of `factorize_numeric`.
+ *
+ * @param values pointer to the values of the factorization
+ * @param row_indices pointer to the row indices of the factorization
+ * @param diag_to_add pointer to a vector that is added to the diagonal of the
+ * matrix during factorization, if `diag_to_add` and `perm` are both non null
+ * @param perm pointer to the pre-computed permutation that is applied to
+ * `diag`.
+ * @param col_ptrs pointer to the already computed column pointers
+ * @param permuted_col_ptrs column pointers computed by
+ * `factorize_numeric_pattern`
+ * @param permuted_row_indices row indices computed by
+ * `factorize_numeric_pattern`
+ * @param permuted_sources positions computed by `factorize_numeric_pattern`
+ * @param l_row_ptrs row pointers computed by `factorize_numeric_pattern`
+ * @param l_col_indices column indices computed by `factorize_numeric_pattern`
+ * @param a_values pointer to the values of the matrix to be factorized
+ * @param n dimension of the matrix to be factorized
+ * @param stack temporary allocation stack
+ */
+template<typename T, typename I>
+void
+factorize_numeric_refactor( //
+  T* values,
+  I* row_indices,
+  proxsuite::linalg::veg::DoNotDeduce<T const*> diag_to_add,
+  proxsuite::linalg::veg::DoNotDeduce<I const*> perm,
+  I const* col_ptrs,
+  I const* permuted_col_ptrs,
+  I const* permuted_row_indices,
+  I const* permuted_sources,
+  I const* l_row_ptrs,
+  I const* l_col_indices,
+  T const* a_values,
+  isize n,
+  DynStackMut stack) noexcept(false)
+{
+  auto _x = stack.make_new(proxsuite::linalg::veg::Tag<T>{}, n);
+  auto _current_row_index =
+    stack.make_new_for_overwrite(proxsuite::linalg::veg::Tag<I>{}, n);
+
+  I* pcurrent_row_index = _current_row_index.ptr_mut();
+  T* px = _x.ptr_mut();
+  std::memcpy(pcurrent_row_index, col_ptrs, usize(n) * sizeof(I));
+
+  I const* plp = col_ptrs;
+  I* pli = row_indices;
+  T* plx = values;
+
+  for (usize iter = 0; iter < usize(n); ++iter) {
+    // gather the values of the iter-th column of the permuted matrix into x
+    // untouched columns are already zeroed
+    for (usize p = util::zero_extend(permuted_col_ptrs[iter]);
+         p < util::zero_extend(permuted_col_ptrs[iter + 1]);
+         ++p) {
+      px[util::zero_extend(permuted_row_indices[p])] =
+        a_values[util::zero_extend(permuted_sources[p])];
+    }
+    T d = px[iter] + ((diag_to_add == nullptr || perm == nullptr)
+                        ? T(0)
+                        : diag_to_add[util::zero_extend(perm[iter])]);
+
+    // zero for next iteration
+    px[iter] = 0;
+
+    for (usize q = util::zero_extend(l_row_ptrs[iter]);
+         q < util::zero_extend(l_row_ptrs[iter + 1]);
+         ++q) {
+      usize j = util::zero_extend(l_col_indices[q]);
+      auto col_start = util::zero_extend(plp[j]);
+      auto row_idx = util::zero_extend(pcurrent_row_index[j]) + 1;
+
+      T const xj = px[j];
+      T const dj = plx[col_start];
+      T const lkj = xj / dj;
+
+      // zero for the next iteration
+      px[j] = 0;
+
+      // skip first element, to put diagonal there later
+      for (usize p = col_start + 1; p < row_idx; ++p) {
+        auto i = util::zero_extend(pli[p]);
+        px[i] -= plx[p] * xj;
+      }
+
+      d -= lkj * xj;
+
+      pli[row_idx] = I(iter);
+      plx[row_idx] = lkj;
+      pcurrent_row_index[j] = I(row_idx);
+    }
+    {
+      auto col_start = util::zero_extend(plp[iter]);
+      pli[col_start] = I(iter);
+      plx[col_start] = d;
+    }
+  }
+}
 } // namespace sparse
 } // namespace linalg
 } // namespace proxsuite
@@ -0,0 +1,925 @@
+/** \file */
+//
+// Copyright (c) 2022 INRIA
+//
+#ifndef PROXSUITE_LINALG_SPARSE_LDLT_ORDERING_HPP
+#define PROXSUITE_LINALG_SPARSE_LDLT_ORDERING_HPP
+
+#include "proxsuite/linalg/sparse/core.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace proxsuite {
+namespace linalg {
+namespace sparse {
+namespace _detail {
+
+// subgraphs of the nested dissection with at most that many vertices are not
+// split further, and are left to the constrained minimum degree ordering
+constexpr isize nested_dissection_leaf_size = 128;
+
+// number of entries of the adjacency lists of the graph of a + a.T, with the
+// elbow room used by the quotient graph of the minimum degree ordering
+inline auto
+ordering_graph_capacity(isize n, isize nnz) noexcept -> isize
+{
+  return 2 * nnz + (2 * nnz) / 5 + 2 * n + 1;
+}
+
+inline auto
+ordering_graph_req(isize n, isize nnz) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  return StackReq::with_len(tag, n + 1) &
+         StackReq::with_len(tag, ordering_graph_capacity(n, nnz)) &
+         StackReq::with_len(tag, n);
+}
+
+// stores the adjacency lists of the graph of a + a.T without its diagonal,
+// read from the upper triangular part of a, and returns their total length.
+// the lists are free of duplicates
+template<typename I>
+auto
+ordering_graph(isize* cp, isize* ci, SymbolicMatRef<I> a, DynStackMut stack)
+  -> isize
+{
+  isize n = a.ncols();
+  auto _w = stack.make_new(proxsuite::linalg::veg::Tag<isize>{}, n);
+  isize* w = _w.ptr_mut();
+  I const* ai = a.row_indices();
+
+  for (isize j = 0; j < n; ++j) {
+    for (usize p = a.col_start(usize(j)); p < a.col_end(usize(j)); ++p) {
+      isize i = isize(util::zero_extend(ai[p]));
+      if (i < j) {
+        ++w[i];
+        ++w[j];
+      }
+    }
+  }
+  cp[0] = 0;
+  for (isize j = 0; j < n; ++j) {
+    cp[j + 1] = cp[j] + w[j];
+    w[j] = cp[j];
+  }
+  for (isize j = 0; j < n; ++j) {
+    for (usize p = a.col_start(usize(j)); p < a.col_end(usize(j)); ++p) {
+      isize i = isize(util::zero_extend(ai[p]));
+      if (i < j) {
+        ci[w[i]++] = j;
+        ci[w[j]++] = i;
+      }
+    }
+  }
+
+  // remove the duplicates, coming from entries stored in both triangles or
+  // repeated within a column
+  for (isize j = 0; j < n; ++j) {
+    w[j] = -1;
+  }
+  isize q = 0;
+  for (isize j = 0; j < n; ++j) {
+    isize start = cp[j];
+    isize end = cp[j + 1];
+    cp[j] = q;
+    for (isize p = start; p < end; ++p) {
+      isize i = ci[p];
+      if (w[i] != j) {
+        w[i] = j;
+        ci[q++] = i;
+      }
+    }
+  }
+  cp[n] = q;
+  return q;
+}
+
+inline auto
+amd_impl_req(isize n) noexcept -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return proxsuite::linalg::veg::dynstack::StackReq::with_len(
+    proxsuite::linalg::veg::Tag<isize>{}, 18 * (n + 1));
+}
+
+// minimum degree ordering on the quotient graph of the elimination, which
+// stores the eliminated vertices as elements, i.e. cliques given by their
+// list of variables. the degrees are the approximate external degrees of
+// Amestoy, Davis and Duff, "An approximate minimum degree ordering
+// algorithm", SIAM J. Matrix Anal. Appl. 17(4), 1996. variables with the same
+// adjacency are merged in supervariables, which are eliminated together, and
+// the elements whose variables are all adjacent to the pivot are absorbed
+// by the new element.
+//
+// the adjacency lists in cp and ci are used as the initial lists of the
+// quotient graph. the new elements are appended after them, and the lists
+// are compacted when the nzmax entries of ci run out.
+//
+// if cons is not null, the vertices of the constraint set cons[i] = c are all
+// ordered after the ones of the sets c' < c: only the variables of the
+// current set are candidate pivots, and variables of distinct sets are never
+// merged.
+// otherwise, the variables with many more neighbours than the average are
+// left out of the graph and ordered last.
+inline void
+amd_impl(isize* perm,
+         isize n,
+         isize* cp,
+         isize* ci,
+         isize nzmax,
+         isize const* cons,
+         DynStackMut stack) noexcept
+{
+  if (n == 0) {
+    return;
+  }
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  auto _work = stack.make_new_for_overwrite(tag, 18 * (n + 1));
+  // position and length of the list of each vertex in ci. the list of a
+  // variable starts with its n_elems[i] adjacent elements, followed by its
+  // adjacent variables. the list of an element holds its variables
+  isize* start = _work.ptr_mut();
+  isize* len = start + (n + 1);
+  isize* n_elems = start + 2 * (n + 1);
+  // number of variables of a supervariable, zero for the merged ones
+  isize* weight = start + 3 * (n + 1);
+  isize* state = start + 4 * (n + 1);
+  // approximate external degree of a variable, weight of the variables of
+  // an element
+  isize* degree = start + 5 * (n + 1);
+  // doubly linked lists of the candidate pivots of each degree
+  isize* bucket_head = start + 6 * (n + 1);
+  isize* bucket_next = start + 7 * (n + 1);
+  isize* bucket_prev = start + 8 * (n + 1);
+  // weight of the variables of an element that are not in the new element
+  isize* ext = start + 9 * (n + 1);
+  isize* mark = start + 10 * (n + 1);
+  // hash tables of the variables of the new element, used to find the ones
+  // with the same adjacency
+  isize* key = start + 11 * (n + 1);
+  isize* hash_head = start + 12 * (n + 1);
+  isize* hash_next = start + 13 * (n + 1);
+  // singly linked list of the variables merged in a supervariable
+  isize* chain_next = start + 14 * (n + 1);
+  isize* chain_tail = start + 15 * (n + 1);
+  // variables sorted by constraint set
+  isize* set_ptr = start + 16 * (n + 1);
+  isize* set_nodes = start + 17 * (n + 1);
+
+  constexpr isize live_variable = 0;
+  constexpr isize live_element = 1;
+  constexpr isize removed = 2;
+  constexpr isize dense_variable = 3;
+
+  for (isize i = 0; i < n; ++i) {
+    start[i] = cp[i];
+    len[i] = cp[i + 1] - cp[i];
+    n_elems[i] = 0;
+    weight[i] = 1;
+    state[i] = live_variable;
+    mark[i] = 0;
+    hash_head[i] = -1;
+    chain_next[i] = -1;
+    chain_tail[i] = i;
+  }
+  for (isize d = 0; d <= n; ++d) {
+    bucket_head[d] = -1;
+  }
+  isize tail = cp[n];
+
+  isize n_sets = 1;
+  if (cons == nullptr) {
+    set_ptr[0] = 0;
+    set_ptr[1] = n;
+    for (isize i = 0; i < n; ++i) {
+      set_nodes[i] = i;
+    }
+    isize dense = isize(10 * std::sqrt(double(n)));
+    dense = dense > 16 ? dense : 16;
+    for (isize i = 0; i < n; ++i) {
+      if (len[i] > dense) {
+        state[i] = dense_variable;
+      }
+    }
+  } else {
+    // counting sort of the variables by constraint set
+    n_sets = n;
+    for (isize c = 0; c <= n; ++c) {
+      set_ptr[c] = 0;
+    }
+    for (isize i = 0; i < n; ++i) {
+      VEG_ASSERT(cons[i] >= 0 && cons[i] < n);
+      ++set_ptr[cons[i] + 1];
+    }
+    for (isize c = 0; c < n; ++c) {
+      set_ptr[c + 1] += set_ptr[c];
+      bucket_next[c] = set_ptr[c];
+    }
+    for (isize i = 0; i < n; ++i) {
+      set_nodes[bucket_next[cons[i]]++] = i;
+    }
+  }
+  auto set_of = [&](isize i) -> isize {
+    return cons == nullptr ? 0 : cons[i];
+  };
+
+  // the dense variables are ignored in the degrees
+  isize n_left = 0;
+  for (isize i = 0; i < n; ++i) {
+    if (state[i] != live_variable) {
+      continue;
+    }
+    ++n_left;
+    isize d = 0;
+    for (isize q = start[i]; q < start[i] + len[i]; ++q) {
+      d += isize(state[ci[q]] == live_variable);
+    }
+    degree[i] = d;
+  }
+
+  isize min_degree = n + 1;
+  auto bucket_insert = [&](isize i) {
+    isize d = degree[i];
+    bucket_prev[i] = -1;
+    bucket_next[i] = bucket_head[d];
+    if (bucket_head[d] != -1) {
+      bucket_prev[bucket_head[d]] = i;
+    }
+    bucket_head[d] = i;
+    min_degree = d < min_degree ? d : min_degree;
+  };
+  auto bucket_remove = [&](isize i) {
+    if (bucket_prev[i] != -1) {
+      bucket_next[bucket_prev[i]] = bucket_next[i];
+    } else {
+      bucket_head[degree[i]] = bucket_next[i];
+    }
+    if (bucket_next[i] != -1) {
+      bucket_prev[bucket_next[i]] = bucket_prev[i];
+    }
+  };
+
+  // the variables of the next non empty constraint set become candidate
+  // pivots, the previous sets being fully eliminated
+  isize cur_set = -1;
+  auto next_set = [&]() -> bool {
+    while (++cur_set < n_sets) {
+      bool any = false;
+      for (isize q = set_ptr[cur_set]; q < set_ptr[cur_set + 1]; ++q) {
+        isize i = set_nodes[q];
+        if (state[i] == live_variable) {
+          bucket_insert(i);
+          any = true;
+        }
+      }
+      if (any) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // moves the live lists to the front of ci, in their current order, and
+  // returns the end of the used part
+  auto compact = [&]() -> isize {
+    isize* nodes = hash_next;
+    isize count = 0;
+    for (isize i = 0; i < n; ++i) {
+      if (state[i] == live_variable || state[i] == live_element) {
+        nodes[count++] = i;
+      }
+    }
+    std::sort(nodes, nodes + count, [&](isize a, isize b) {
+      return start[a] < start[b];
+    });
+    isize q = 0;
+    for (isize k = 0; k < count; ++k) {
+      isize i = nodes[k];
+      isize old_start = start[i];
+      start[i] = q;
+      for (isize r = 0; r < len[i]; ++r) {
+        ci[q++] = ci[old_start + r];
+      }
+    }
+    return q;
+  };
+
+  isize stamp = 0;
+  isize k = 0;
+  next_set();
+  while (true) {
+    while (min_degree <= n && bucket_head[min_degree] == -1) {
+      ++min_degree;
+    }
+    if (min_degree > n) {
+      if (next_set()) {
+        continue;
+      }
+      break;
+    }
+    isize p = bucket_head[min_degree];
+    bucket_remove(p);
+    n_left -= weight[p];
+    for (isize i = p; i != -1; i = chain_next[i]) {
+      perm[k++] = i;
+    }
+
+    // the new element is the union of the variables adjacent to p and of
+    // the ones of its adjacent elements, which it absorbs
+    isize bound = len[p] - n_elems[p];
+    for (isize q = start[p]; q < start[p] + n_elems[p]; ++q) {
+      if (state[ci[q]] == live_element) {
+        bound += len[ci[q]];
+      }
+    }
+    bound = bound < n ? bound : n;
+    if (tail + bound > nzmax) {
+      tail = compact();
+    }
+    VEG_ASSERT(tail + bound <= nzmax);
+
+    isize lp_stamp = ++stamp;
+    isize lp_start = tail;
+    isize lp_weight = 0;
+    mark[p] = lp_stamp;
+    auto add = [&](isize i) {
+      if (state[i] == live_variable && mark[i] != lp_stamp) {
+        mark[i] = lp_stamp;
+        ci[tail++] = i;
+        lp_weight += weight[i];
+      }
+    };
+    for (isize q = start[p]; q < start[p] + n_elems[p]; ++q) {
+      isize e = ci[q];
+      if (state[e] != live_element) {
+        continue;
+      }
+      for (isize r = start[e]; r < start[e] + len[e]; ++r) {
+        add(ci[r]);
+      }
+      state[e] = removed;
+    }
+    for (isize q = start[p] + n_elems[p]; q < start[p] + len[p]; ++q) {
+      add(ci[q]);
+    }
+    state[p] = live_element;
+    start[p] = lp_start;
+    len[p] = tail - lp_start;
+    n_elems[p] = 0;
+    isize lp_end = tail;
+
+    // weight of the variables of each adjacent element outside of the new
+    // one
+    isize e_stamp = ++stamp;
+    for (isize q = lp_start; q < lp_end; ++q) {
+      isize i = ci[q];
+      for (isize r = start[i]; r < start[i] + n_elems[i]; ++r) {
+        isize e = ci[r];
+        if (state[e] != live_element) {
+          continue;
+        }
+        if (mark[e] != e_stamp) {
+          mark[e] = e_stamp;
+          ext[e] = degree[e];
+        }
+        ext[e] -= weight[i];
+      }
+    }
+
+    // the lists of the variables of the new element lose the absorbed
+    // elements and the variables of the new element, which are replaced by
+    // the new element. at least one entry is removed, so the lists do not
+    // grow
+    for (isize q = lp_start; q < lp_end; ++q) {
+      isize i = ci[q];
+      if (set_of(i) == cur_set) {
+        bucket_remove(i);
+      }
+      isize begin = start[i];
+      isize end = begin + len[i];
+      isize dst = begin;
+      isize d = 0;
+      usize h = usize(p);
+      for (isize r = begin; r < begin + n_elems[i]; ++r) {
+        isize e = ci[r];
+        if (state[e] != live_element) {
+          continue;
+        }
+        if (ext[e] == 0) {
+          state[e] = removed;
+          continue;
+        }
+        d += ext[e];
+        h += usize(e);
+        ci[dst++] = e;
+      }
+      isize ne = dst - begin;
+      for (isize r = begin + n_elems[i]; r < end; ++r) {
+        isize j = ci[r];
+        if (state[j] != live_variable || mark[j] == lp_stamp) {
+          continue;
+        }
+        d += weight[j];
+        h += usize(j);
+        ci[dst++] = j;
+      }
+      if (dst > begin + ne) {
+        ci[dst] = ci[begin + ne];
+      }
+      ci[begin + ne] = p;
+      n_elems[i] = ne + 1;
+      len[i] = dst + 1 - begin;
+
+      isize lp_ext = lp_weight - weight[i];
+      d += lp_ext;
+      degree[i] = d < degree[i] + lp_ext ? d : degree[i] + lp_ext;
+      key[i] = isize(h % usize(n));
+    }
+
+    // variables of the same constraint set with the same adjacency are
+    // merged
+    for (isize q = lp_start; q < lp_end; ++q) {
+      isize i = ci[q];
+      hash_next[i] = hash_head[key[i]];
+      hash_head[key[i]] = i;
+    }
+    for (isize q = lp_start; q < lp_end; ++q) {
+      isize i = ci[q];
+      if (state[i] != live_variable || hash_head[key[i]] == -1) {
+        continue;
+      }
+      for (isize a = hash_head[key[i]]; a != -1; a = hash_next[a]) {
+        if (state[a] != live_variable) {
+          continue;
+        }
+        isize a_stamp = ++stamp;
+        for (isize r = start[a]; r < start[a] + len[a]; ++r) {
+          mark[ci[r]] = a_stamp;
+        }
+        for (isize b = hash_next[a]; b != -1; b = hash_next[b]) {
+          if (state[b] != live_variable || len[b] != len[a] ||
+              n_elems[b] != n_elems[a] || set_of(b) != set_of(a)) {
+            continue;
+          }
+          bool same = true;
+          for (isize r = start[b]; r < start[b] + len[b] && same; ++r) {
+            same = mark[ci[r]] == a_stamp;
+          }
+          if (!same) {
+            continue;
+          }
+          weight[a] += weight[b];
+          degree[a] -= weight[b];
+          weight[b] = 0;
+          state[b] = removed;
+          chain_next[chain_tail[a]] = b;
+          chain_tail[a] = chain_tail[b];
+        }
+      }
+      hash_head[key[i]] = -1;
+    }
+
+    // the merged variables leave the new element, whose remaining variables
+    // become candidate pivots again
+    isize dst = lp_start;
+    for (isize q = lp_start; q < lp_end; ++q) {
+      isize i = ci[q];
+      if (state[i] != live_variable) {
+        continue;
+      }
+      ci[dst++] = i;
+      isize max_degree = n_left - weight[i];
+      degree[i] = degree[i] < max_degree ? degree[i] : max_degree;
+      degree[i] = degree[i] > 0 ? degree[i] : 0;
+      if (set_of(i) == cur_set) {
+        bucket_insert(i);
+      }
+    }
+    len[p] = dst - lp_start;
+    degree[p] = lp_weight;
+    tail = dst;
+    if (len[p] == 0) {
+      state[p] = removed;
+    }
+  }
+
+  for (isize i = 0; i < n; ++i) {
+    if (state[i] == dense_variable) {
+      perm[k++] = i;
+    }
+  }
+  VEG_ASSERT(k == n);
+}
+
+inline auto
+nested_dissection_impl_req(isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return proxsuite::linalg::veg::dynstack::StackReq::with_len(
+    proxsuite::linalg::veg::Tag<isize>{}, 8 * (n + 1));
+}
+
+// recursively splits the graph with vertex separators taken from the level
+// structures of a breadth first search started at a pseudo peripheral
+// vertex. on output, cons[i] is the index of the part of vertex i in a
+// postorder of the dissection tree, so that each separator comes after the
+// two halves it splits
+inline void
+nested_dissection_impl(isize* cons,
+                       isize n,
+                       isize const* cp,
+                       isize const* ci,
+                       DynStackMut stack) noexcept
+{
+  if (n == 0) {
+    return;
+  }
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  auto _work = stack.make_new_for_overwrite(tag, 8 * (n + 1));
+  isize* nodes = _work.ptr_mut();
+  isize* part = nodes + (n + 1);
+  isize* level = nodes + 2 * (n + 1);
+  isize* queue = nodes + 3 * (n + 1);
+  isize* seen = nodes + 4 * (n + 1);
+  isize* task_lo = nodes + 5 * (n + 1);
+  isize* task_hi = nodes + 6 * (n + 1);
+  isize* level_count = nodes + 7 * (n + 1);
+
+  for (isize i = 0; i < n; ++i) {
+    nodes[i] = i;
+    part[i] = 0;
+    seen[i] = 0;
+  }
+  isize stamp = 0;
+  isize n_tasks = 0;
+
+  // breadth first search of the part of `root`, filling the queue from
+  // queue[start]. the vertices marked with the current stamp are skipped.
+  // returns the number of reached vertices, and stores the index of the
+  // last level in ecc
+  auto bfs_from = [&](isize root, isize start, isize& ecc) -> isize {
+    isize tag_root = part[root];
+    isize qhead = start;
+    isize qtail = start;
+    queue[qtail++] = root;
+    seen[root] = stamp;
+    level[root] = 0;
+    ecc = 0;
+    while (qhead < qtail) {
+      isize i = queue[qhead++];
+      ecc = level[i];
+      for (isize p = cp[i]; p < cp[i + 1]; ++p) {
+        isize j = ci[p];
+        if (part[j] == tag_root && seen[j] != stamp) {
+          seen[j] = stamp;
+          level[j] = level[i] + 1;
+          queue[qtail++] = j;
+        }
+      }
+    }
+    return qtail - start;
+  };
+  auto bfs = [&](isize root, isize& ecc) -> isize {
+    ++stamp;
+    return bfs_from(root, 0, ecc);
+  };
+  auto push_task = [&](isize task_start, isize task_end) {
+    for (isize q = task_start; q < task_end; ++q) {
+      part[nodes[q]] = task_start;
+    }
+    task_lo[n_tasks] = task_start;
+    task_hi[n_tasks] = task_end;
+    ++n_tasks;
+  };
+
+  isize id = 0;
+  push_task(0, n);
+
+  while (n_tasks > 0) {
+    --n_tasks;
+    isize lo = task_lo[n_tasks];
+    isize hi = task_hi[n_tasks];
+    isize size = hi - lo;
+
+    auto make_leaf = [&] {
+      for (isize p = lo; p < hi; ++p) {
+        cons[nodes[p]] = id;
+        part[nodes[p]] = -1;
+      }
+      ++id;
+    };
+
+    if (size <= _detail::nested_dissection_leaf_size) {
+      make_leaf();
+      continue;
+    }
+
+    isize ecc = 0;
+    isize reached = bfs(nodes[lo], ecc);
+
+    if (reached < size) {
+      // disconnected subgraph: the connected components are gathered in
+      // chunks, each of which is either a single component or at most a leaf
+      isize* comp_end = level_count;
+      isize n_comps = 0;
+      comp_end[n_comps++] = reached;
+      for (isize p = lo; p < hi; ++p) {
+        isize i = nodes[p];
+        if (seen[i] != stamp) {
+          isize ecc_i = 0;
+          isize start = comp_end[n_comps - 1];
+          comp_end[n_comps++] = start + bfs_from(i, start, ecc_i);
+        }
+      }
+      for (isize q = 0; q < size; ++q) {
+        nodes[lo + q] = queue[q];
+      }
+      isize chunk_start = 0;
+      isize prev_end = 0;
+      for (isize c = 0; c < n_comps; ++c) {
+        if (comp_end[c] - chunk_start > _detail::nested_dissection_leaf_size &&
+            prev_end > chunk_start) {
+          push_task(lo + chunk_start, lo + prev_end);
+          chunk_start = prev_end;
+        }
+        prev_end = comp_end[c];
+      }
+      push_task(lo + chunk_start, hi);
+      continue;
+    }
+
+    // pseudo peripheral root: restart from a vertex of minimum degree in
+    // the last level, as long as the eccentricity increases
+    isize root = nodes[lo];
+    for (isize it = 0; it < 4; ++it) {
+      isize cand = -1;
+      for (isize q = reached - 1; q >= 0 && level[queue[q]] == ecc; --q) {
+        isize i = queue[q];
+        if (cand == -1 || cp[i + 1] - cp[i] < cp[cand + 1] - cp[cand]) {
+          cand = i;
+        }
+      }
+      isize ecc_cand = 0;
+      bfs(cand, ecc_cand);
+      if (ecc_cand > ecc) {
+        root = cand;
+        ecc = ecc_cand;
+      } else {
+        break;
+      }
+    }
+    bfs(root, ecc);
+
+    if (ecc < 2) {
+      make_leaf();
+      continue;
+    }
+
+    // separating level: the smallest one among those around the median
+    for (isize l = 0; l <= ecc; ++l) {
+      level_count[l] = 0;
+    }
+    for (isize q = 0; q < size; ++q) {
+      ++level_count[level[queue[q]]];
+    }
+    isize sep = -1;
+    {
+      isize acc = level_count[0];
+      for (isize l = 1; l < ecc; ++l) {
+        isize before = acc;
+        acc += level_count[l];
+        if (10 * acc < 3 * size || 10 * before > 7 * size) {
+          continue;
+        }
+        if (sep == -1 || level_count[l] < level_count[sep]) {
+          sep = l;
+        }
+      }
+      if (sep == -1) {
+        acc = level_count[0];
+        sep = 1;
+        while (sep < ecc - 1 && 2 * (acc + level_count[sep]) < size) {
+          acc += level_count[sep];
+          ++sep;
+        }
+      }
+    }
+
+    // vertices of the separating level without neighbours in the next one
+    // are moved to the first half
+    isize sep_size = 0;
+    for (isize q = 0; q < size; ++q) {
+      isize i = queue[q];
+      if (level[i] != sep) {
+        continue;
+      }
+      bool needed = false;
+      for (isize p = cp[i]; p < cp[i + 1] && !needed; ++p) {
+        isize j = ci[p];
+        needed = seen[j] == stamp && level[j] == sep + 1;
+      }
+      if (needed) {
+        ++sep_size;
+      } else {
+        level[i] = sep - 1;
+      }
+    }
+    if (2 * sep_size > size) {
+      make_leaf();
+      continue;
+    }
+
+    isize pa = lo;
+    for (isize q = 0; q < size; ++q) {
+      if (level[queue[q]] < sep) {
+        nodes[pa++] = queue[q];
+      }
+    }
+    isize pb = pa;
+    for (isize q = 0; q < size; ++q) {
+      if (level[queue[q]] > sep) {
+        nodes[pb++] = queue[q];
+      }
+    }
+    isize ps = pb;
+    for (isize q = 0; q < size; ++q) {
+      if (level[queue[q]] == sep) {
+        nodes[ps++] = queue[q];
+      }
+    }
+
+    for (isize q = pb; q < hi; ++q) {
+      cons[nodes[q]] = id;
+      part[nodes[q]] = -1;
+    }
+    ++id;
+    push_task(lo, pa);
+    push_task(pa, pb);
+  }
+
+  // the parts were numbered in reverse postorder
+  for (isize i = 0; i < n; ++i) {
+    cons[i] = id - 1 - cons[i];
+  }
+}
+} // namespace _detail
+
+/*!
+ * Computes the stack memory requirements of the constrained approximate
+ * minimum degree ordering.
+ *
+ * @param n dimension of the matrix.
+ * @param nnz number of non zeros of the matrix.
+ */
+template<typename I>
+auto
+camd_req(proxsuite::linalg::veg::Tag<I> /*tag*/, isize n, isize nnz) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  return _detail::ordering_graph_req(n, nnz) &
+         StackReq::with_len(tag, 2 * n) & _detail::amd_impl_req(n);
+}
+
+/*!
+ * Computes a fill reducing permutation of the symmetric matrix whose upper
+ * triangular part is `mat` with the approximate minimum degree algorithm,
+ * under the constraint that the indices `i` with `constraints[i] == c` are all
+ * ordered after the ones of the sets `c' < c`.
+ *
+ * @param perm storage for the permutation, of size `n`
+ * @param mat symbolic structure of the matrix
+ * @param constraints either null, in which case the ordering is
+ * unconstrained, or the constraint set of each index, in the range `[0, n)`
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+camd(I* perm,
+     SymbolicMatRef<I> mat,
+     I const* constraints,
+     DynStackMut stack) noexcept
+{
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  isize n = mat.nrows();
+  isize nzmax = _detail::ordering_graph_capacity(n, mat.nnz());
+
+  auto _cp = stack.make_new_for_overwrite(tag, n + 1);
+  auto _ci = stack.make_new_for_overwrite(tag, nzmax);
+  _detail::ordering_graph(_cp.ptr_mut(), _ci.ptr_mut(), mat, stack);
+
+  auto _cons = stack.make_new_for_overwrite(tag, n);
+  auto _perm = stack.make_new_for_overwrite(tag, n);
+  if (constraints != nullptr) {
+    for (isize i = 0; i < n; ++i) {
+      _cons.ptr_mut()[i] = isize(util::zero_extend(constraints[i]));
+    }
+  }
+  _detail::amd_impl(_perm.ptr_mut(),
+                    n,
+                    _cp.ptr_mut(),
+                    _ci.ptr_mut(),
+                    nzmax,
+                    constraints == nullptr ? nullptr : _cons.ptr(),
+                    stack);
+  for (isize i = 0; i < n; ++i) {
+    perm[i] = I(_perm.ptr()[i]);
+  }
+}
+
+/*!
+ * Computes the stack memory requirements of the approximate minimum degree
+ * ordering.
+ *
+ * @param n dimension of the matrix.
+ * @param nnz number of non zeros of the matrix.
+ */
+template<typename I>
+auto
+amd_req(proxsuite::linalg::veg::Tag<I> tag, isize n, isize nnz) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return sparse::camd_req(tag, n, nnz);
+}
+
+/*!
+ * Computes a fill reducing permutation of the symmetric matrix whose upper
+ * triangular part is `mat` with the approximate minimum degree algorithm.
+ *
+ * @param perm storage for the permutation, of size `n`
+ * @param mat symbolic structure of the matrix
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+amd(I* perm, SymbolicMatRef<I> mat, DynStackMut stack) noexcept
+{
+  sparse::camd(perm, mat, static_cast<I const*>(nullptr), stack);
+}
+
+/*!
+ * Computes the stack memory requirements of the nested dissection ordering.
+ *
+ * @param n dimension of the matrix.
+ * @param nnz number of non zeros of the matrix.
+ */
+template<typename I>
+auto
+nested_dissection_req(proxsuite::linalg::veg::Tag<I> /*tag*/,
+                      isize n,
+                      isize nnz) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  return _detail::ordering_graph_req(n, nnz) &
+         StackReq::with_len(tag, 2 * n) &
+         (_detail::nested_dissection_impl_req(n) | _detail::amd_impl_req(n));
+}
+
+/*!
+ * Computes a fill reducing permutation of the symmetric matrix whose upper
+ * triangular part is `mat` by nested dissection, which suits matrices coming
+ * from grid-like problems. The graph of the matrix is recursively split by
+ * small vertex separators, which are ordered after the parts they separate,
+ * and the resulting partial order is completed by the constrained minimum
+ * degree ordering.
+ *
+ * @param perm storage for the permutation, of size `n`
+ * @param mat symbolic structure of the matrix
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+nested_dissection(I* perm, SymbolicMatRef<I> mat, DynStackMut stack) noexcept
+{
+  proxsuite::linalg::veg::Tag<isize> tag{};
+  isize n = mat.nrows();
+  isize nzmax = _detail::ordering_graph_capacity(n, mat.nnz());
+
+  auto _cp = stack.make_new_for_overwrite(tag, n + 1);
+  auto _ci = stack.make_new_for_overwrite(tag, nzmax);
+  _detail::ordering_graph(_cp.ptr_mut(), _ci.ptr_mut(), mat, stack);
+
+  auto _cons = stack.make_new_for_overwrite(tag, n);
+  auto _perm = stack.make_new_for_overwrite(tag, n);
+  _detail::nested_dissection_impl(
+    _cons.ptr_mut(), n, _cp.ptr(), _ci.ptr(), stack);
+  _detail::amd_impl(_perm.ptr_mut(),
+                    n,
+                    _cp.ptr_mut(),
+                    _ci.ptr_mut(),
+                    nzmax,
+                    _cons.ptr(),
+                    stack);
+  for (isize i = 0; i < n; ++i) {
+    perm[i] = I(_perm.ptr()[i]);
+  }
+}
+} // namespace sparse
+} // namespace linalg
+} // namespace proxsuite
+
+#endif /* end of include guard PROXSUITE_LINALG_SPARSE_LDLT_ORDERING_HPP */
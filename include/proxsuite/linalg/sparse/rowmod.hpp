@@ -128,6 +128,165 @@ delete_row(MatMut<T, I> ld,
   petree[permuted_pos] = I(-1);
   return ld;
 }
+
+/*!
+ * Computes the memory requirements for deleting several rows and columns of
+ * the ldlt factors at once
+ *
+ * @param n : dimension of the matrix
+ * @param count : number of rows to be deleted
+ */
+template<typename T, typename I>
+auto
+delete_rows_req( //
+  proxsuite::linalg::veg::Tag<T> /*tag*/,
+  proxsuite::linalg::veg::Tag<I> /*tag*/,
+  isize n,
+  isize count) noexcept -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  auto permuted_positions =
+    StackReq{ count * isize{ sizeof(I) }, isize{ alignof(I) } };
+  auto marked = StackReq{ n * isize{ sizeof(bool) }, isize{ alignof(bool) } };
+  auto w = StackReq{ (2 * count + 1) * isize{ sizeof(I) },
+                     isize{ alignof(I) } } &
+           StackReq{ count * isize{ sizeof(T) }, isize{ alignof(T) } };
+  auto update = sparse::rank_r_update_req(proxsuite::linalg::veg::Tag<T>{},
+                                          proxsuite::linalg::veg::Tag<I>{},
+                                          n,
+                                          true,
+                                          count,
+                                          0);
+  return permuted_positions & marked & w & update;
+}
+
+/*!
+ * Given the ldlt factors of matrix a, computes the ldlt factors of the matrix a
+ * with the rows and columns at the given positions replaced by those of the
+ * identity matrix. The result is the same as that of calling `delete_row` for
+ * each position, but the rows are removed from the columns of the factors in a
+ * single pass, followed by a single multiple rank update.
+ * It returns a view of the updated factors.
+ *
+ * @param ld : the ldlt factors
+ * @param etree pointer to the elimination tree
+ * @param perm_inv pointer to inverse permutation (for ex AMD). If this is null,
+ * the permutation is assumed to be the identity.
+ * @param positions distinct positions of the rows and columns to be deleted
+ * @param stack is the memory stack
+ */
+template<typename T, typename I>
+auto
+delete_rows(MatMut<T, I> ld,
+            I* etree,
+            I const* perm_inv,
+            Slice<I> positions,
+            DynStackMut stack) noexcept(false) -> MatMut<T, I>
+{
+  VEG_ASSERT(!ld.is_compressed());
+  auto zx = util::zero_extend;
+  usize count = usize(positions.len());
+  if (count == 0) {
+    return ld;
+  }
+
+  proxsuite::linalg::veg::Tag<I> tag{};
+  auto _permuted_positions = stack.make_new_for_overwrite(tag, isize(count));
+  I* ppermuted_positions = _permuted_positions.ptr_mut();
+  for (usize k = 0; k < count; ++k) {
+    ppermuted_positions[k] =
+      perm_inv == nullptr ? positions.ptr()[k] : perm_inv[positions.ptr()[k]];
+  }
+  std::sort(ppermuted_positions, ppermuted_positions + count);
+
+  auto _marked =
+    stack.make_new(proxsuite::linalg::veg::Tag<bool>{}, ld.nrows());
+  bool* marked = _marked.ptr_mut();
+  for (usize k = 0; k < count; ++k) {
+    marked[zx(ppermuted_positions[k])] = true;
+  }
+
+  I* pldi = ld.row_indices_mut();
+  T* pldx = ld.values_mut();
+  I* pldnz = ld.nnz_per_col_mut();
+
+  // step 1: delete the rows from each column
+  usize first_pos = zx(ppermuted_positions[0]);
+  usize last_pos = zx(ppermuted_positions[count - 1]);
+  for (usize j = 0; j < last_pos; ++j) {
+    auto col_start = ld.col_start(j) + 1;
+    auto col_end = ld.col_end(j);
+    // the rows before the first deleted one are left in place
+    usize p =
+      usize(std::lower_bound(pldi + col_start, pldi + col_end, I(first_pos)) -
+            pldi);
+    usize out = p;
+    for (; p < col_end; ++p) {
+      if (!marked[zx(pldi[p])]) {
+        pldi[out] = pldi[p];
+        pldx[out] = pldx[p];
+        ++out;
+      }
+    }
+
+    usize removed = col_end - out;
+    if (removed != 0) {
+      pldnz[j] -= I(removed);
+      ld._set_nnz(ld.nnz() - isize(removed));
+
+      // the parent of j in the elimination tree is its first remaining row
+      etree[j] = pldnz[j] > 1 ? pldi[col_start] : I(-1);
+    }
+  }
+
+  // step 2: set d_kk = 1, and gather the remaining part of each deleted column
+  auto _w_col_ptrs = stack.make_new_for_overwrite(tag, isize(count + 1));
+  auto _w_nnz = stack.make_new_for_overwrite(tag, isize(count));
+  auto _alpha = stack.make_new_for_overwrite(
+    proxsuite::linalg::veg::Tag<T>{}, isize(count));
+  I* pw_col_ptrs = _w_col_ptrs.ptr_mut();
+  I* pw_nnz = _w_nnz.ptr_mut();
+  T* palpha = _alpha.ptr_mut();
+  isize w_nnz = 0;
+  for (usize k = 0; k < count; ++k) {
+    usize permuted_pos = zx(ppermuted_positions[k]);
+    auto col_start = ld.col_start(permuted_pos);
+    palpha[k] = pldx[col_start];
+    pldx[col_start] = 1;
+    pw_col_ptrs[k] = I(col_start + 1);
+    pw_nnz[k] = pldnz[permuted_pos] - 1;
+    w_nnz += isize(zx(pw_nnz[k]));
+  }
+  pw_col_ptrs[count] = I(ld.col_end(zx(ppermuted_positions[count - 1])));
+
+  // step 3: perform the rank update with the deleted columns, which are left
+  // unchanged by the update since the deleted rows were removed from every
+  // other column
+  ld = sparse::rank_r_update<T, I>( //
+    ld,
+    etree,
+    static_cast<I const*>(nullptr),
+    MatRef<T, I>{
+      from_raw_parts,
+      ld.nrows(),
+      isize(count),
+      w_nnz,
+      pw_col_ptrs,
+      pw_nnz,
+      pldi,
+      pldx,
+    },
+    palpha,
+    stack);
+
+  // step 4: delete the columns
+  for (usize k = 0; k < count; ++k) {
+    usize permuted_pos = zx(ppermuted_positions[k]);
+    pldnz[permuted_pos] = 1;
+    etree[permuted_pos] = I(-1);
+  }
+  return ld;
+}
 /*!
  * Computes the memory requirements for adding a row and column for the ldlt
  * factors
@@ -161,39 +320,34 @@ add_row_req( //
                                          true,
                                          max_nnz);
 
+  auto visited =
+    StackReq{ n * isize{ sizeof(bool) }, isize{ alignof(bool) } };
+
   auto req = numerical_work;
   req = req & permuted_indices;
   req = req & pattern_diff;
   req = req & merge;
+  req = visited & req;
   req = req | update;
 
   return req;
 }
-/*!
- * Given the ldlt factors of matrix a, computes the ldlt factors of the matrix a
- * with added row and column at position pos. It is assumed that the row and
- * column are empty except the diagonal element. It returns a view of the
- * updated factors.
- *
- * @param ld : the ldlt factors
- * @param etree pointer to the elimination tree
- * @param perm_inv pointer to inverse permutation (for ex AMD). If this is null,
- * the permutation is assumed to be the identity.
- * @param pos position of the row and column to be added
- * @param new_col : new column to be added without the diagonal element (of size
- * nnz-1)
- * @param diag_element : diagonal element of the added row and column
- * @param stack is the memory stack
- */
+namespace _detail {
+// inserts the row and column at position pos in the ldlt factors, and returns
+// the new diagonal element. the factors of the trailing part of the matrix
+// must then be updated with minus that element times the new column.
+// visited must hold at least perm_inv[pos] false values, and is left in that
+// state
 template<typename T, typename I>
 auto
-add_row(MatMut<T, I> ld,
-        I* etree,
-        I const* perm_inv,
-        isize pos,
-        VecRef<T, I> new_col,
-        proxsuite::linalg::veg::DoNotDeduce<T> diag_element,
-        DynStackMut stack) noexcept(false) -> MatMut<T, I>
+add_row_insert(MatMut<T, I>& ld,
+               I* etree,
+               I const* perm_inv,
+               isize pos,
+               VecRef<T, I> new_col,
+               T diag_element,
+               bool* visited,
+               DynStackMut stack) noexcept(false) -> T
 {
   VEG_ASSERT(!ld.is_compressed());
   bool id_perm = perm_inv == nullptr;
@@ -252,9 +406,6 @@ add_row(MatMut<T, I> ld,
 
     // for each row in the added column
     {
-      auto _visited = stack.make_new(proxsuite::linalg::veg::Tag<bool>{},
-                                     isize(permuted_pos));
-      bool* visited = _visited.ptr_mut();
       for (usize p = 0; p < usize(new_col.nnz()); ++p) {
         auto j = zx(new_col_permuted_indices[p]);
         if (j >= permuted_pos) {
@@ -280,6 +431,9 @@ add_row(MatMut<T, I> ld,
       }
     }
     std::sort(pl12_nnz_pattern, pl12_nnz_pattern + l12_nnz_pattern_count);
+    for (usize p = 0; p < l12_nnz_pattern_count; ++p) {
+      visited[zx(pl12_nnz_pattern[p])] = false;
+    }
 
     // zero the elements in the non-zero pattern of the solution (new k-th row)
     for (usize p = 0; p < l12_nnz_pattern_count; ++p) {
@@ -419,6 +573,54 @@ add_row(MatMut<T, I> ld,
     etree[permuted_pos] = pldi[ld.col_start(permuted_pos) + 1];
   }
 
+  return diag_element;
+}
+} // namespace _detail
+
+/*!
+ * Given the ldlt factors of matrix a, computes the ldlt factors of the matrix a
+ * with added row and column at position pos. It is assumed that the row and
+ * column are empty except the diagonal element. It returns a view of the
+ * updated factors.
+ *
+ * @param ld : the ldlt factors
+ * @param etree pointer to the elimination tree
+ * @param perm_inv pointer to inverse permutation (for ex AMD). If this is null,
+ * the permutation is assumed to be the identity.
+ * @param pos position of the row and column to be added
+ * @param new_col : new column to be added without the diagonal element (of size
+ * nnz-1)
+ * @param diag_element : diagonal element of the added row and column
+ * @param stack is the memory stack
+ */
+template<typename T, typename I>
+auto
+add_row(MatMut<T, I> ld,
+        I* etree,
+        I const* perm_inv,
+        isize pos,
+        VecRef<T, I> new_col,
+        proxsuite::linalg::veg::DoNotDeduce<T> diag_element,
+        DynStackMut stack) noexcept(false) -> MatMut<T, I>
+{
+  VEG_ASSERT(!ld.is_compressed());
+  bool id_perm = perm_inv == nullptr;
+  usize permuted_pos =
+    id_perm ? usize(pos) : util::zero_extend(perm_inv[pos]);
+
+  {
+    auto _visited = stack.make_new(proxsuite::linalg::veg::Tag<bool>{},
+                                   isize(permuted_pos));
+    diag_element = _detail::add_row_insert(ld,
+                                           etree,
+                                           perm_inv,
+                                           pos,
+                                           new_col,
+                                           T(diag_element),
+                                           _visited.ptr_mut(),
+                                           stack);
+  }
+
   isize len = isize(util::zero_extend(ld.nnz_per_col()[permuted_pos])) - 1;
   // perform the rank update with the newly added column
   ld = sparse::rank1_update<T, I>(ld,
@@ -428,14 +630,195 @@ add_row(MatMut<T, I> ld,
                                     from_raw_parts,
                                     ld.nrows(),
                                     len,
-                                    pldi + ld.col_start(permuted_pos) + 1,
-                                    pldx + ld.col_start(permuted_pos) + 1,
+                                    ld.row_indices() +
+                                      (ld.col_start(permuted_pos) + 1),
+                                    ld.values() +
+                                      (ld.col_start(permuted_pos) + 1),
                                   },
                                   -diag_element,
                                   stack);
 
   return ld;
 }
+
+/*!
+ * Computes the memory requirements for adding several rows and columns to the
+ * ldlt factors at once
+ *
+ * @param n : dimension of the matrix
+ * @param id_perm : whether the permutation corresponds to the identity
+ * @param count : number of rows to be added
+ * @param max_nnz : upper bound of the non zero counts of the added columns
+ */
+template<typename T, typename I>
+auto
+add_rows_req( //
+  proxsuite::linalg::veg::Tag<T> /*tag*/,
+  proxsuite::linalg::veg::Tag<I> /*tag*/,
+  isize n,
+  bool id_perm,
+  isize count,
+  isize max_nnz) noexcept -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  constexpr isize sz{ sizeof(I) };
+  constexpr isize al{ alignof(I) };
+  constexpr isize tsz{ sizeof(T) };
+  constexpr isize tal{ alignof(T) };
+
+  auto order = StackReq{ count * sz, al };
+  auto visited = StackReq{ n * isize{ sizeof(bool) }, isize{ alignof(bool) } };
+  auto pending = StackReq{ (count + 1 + n) * sz, al } &
+                 StackReq{ (count + n) * tsz, tal };
+
+  auto insert = StackReq{ n * tsz, tal } &
+                StackReq{ (id_perm ? 0 : max_nnz) * sz, al } &
+                StackReq{ n * sz, al } &
+                merge_second_col_into_first_req(
+                  proxsuite::linalg::veg::Tag<I>{}, n);
+  auto update = sparse::rank_r_update_req(proxsuite::linalg::veg::Tag<T>{},
+                                          proxsuite::linalg::veg::Tag<I>{},
+                                          n,
+                                          true,
+                                          count,
+                                          n);
+  return order & visited & pending & (insert | update);
+}
+
+/*!
+ * Given the ldlt factors of matrix a, computes the ldlt factors of the matrix a
+ * with added rows and columns at the given positions. It is assumed that these
+ * rows and columns are empty except their diagonal element, and that the added
+ * columns have no element in the rows of the other added columns.
+ * The rows are inserted from the last position to the first one, which leaves
+ * the columns read by each insertion unaffected by the rank updates of the
+ * previous ones. These updates are thus deferred and applied together as
+ * multiple rank updates, and the workspace of the insertions is shared.
+ * It returns a view of the updated factors.
+ *
+ * @param ld : the ldlt factors
+ * @param etree pointer to the elimination tree
+ * @param perm_inv pointer to inverse permutation (for ex AMD). If this is null,
+ * the permutation is assumed to be the identity.
+ * @param positions distinct positions of the rows and columns to be added
+ * @param new_cols : new columns to be added without their diagonal element, the
+ * k-th one being added at `positions[k]`
+ * @param diag_elements : diagonal elements of the added rows and columns
+ * @param stack is the memory stack
+ */
+template<typename T, typename I>
+auto
+add_rows(MatMut<T, I> ld,
+         I* etree,
+         I const* perm_inv,
+         Slice<I> positions,
+         MatRef<T, I> new_cols,
+         T const* diag_elements,
+         DynStackMut stack) noexcept(false) -> MatMut<T, I>
+{
+  VEG_ASSERT(!ld.is_compressed());
+  VEG_ASSERT(new_cols.ncols() == positions.len());
+  auto zx = util::zero_extend;
+  usize count = usize(positions.len());
+  usize n = usize(ld.nrows());
+  if (count == 0) {
+    return ld;
+  }
+
+  auto permuted = [&](usize k) -> usize {
+    return perm_inv == nullptr ? zx(positions.ptr()[k])
+                               : zx(perm_inv[positions.ptr()[k]]);
+  };
+
+  proxsuite::linalg::veg::Tag<I> tag{};
+  proxsuite::linalg::veg::Tag<T> ttag{};
+  auto _order = stack.make_new_for_overwrite(tag, isize(count));
+  I* porder = _order.ptr_mut();
+  for (usize k = 0; k < count; ++k) {
+    porder[k] = I(k);
+  }
+  std::sort(porder, porder + count, [&](I a, I b) {
+    return permuted(zx(a)) > permuted(zx(b));
+  });
+
+  auto _visited = stack.make_new(proxsuite::linalg::veg::Tag<bool>{}, isize(n));
+
+  // columns of the pending rank updates
+  auto _w_col_ptrs = stack.make_new_for_overwrite(tag, isize(count + 1));
+  auto _w_row_indices = stack.make_new_for_overwrite(tag, isize(n));
+  auto _w_values = stack.make_new_for_overwrite(ttag, isize(n));
+  auto _alpha = stack.make_new_for_overwrite(ttag, isize(count));
+  I* pw_col_ptrs = _w_col_ptrs.ptr_mut();
+  I* pw_row_indices = _w_row_indices.ptr_mut();
+  T* pw_values = _w_values.ptr_mut();
+  T* palpha = _alpha.ptr_mut();
+  usize pending_count = 0;
+  pw_col_ptrs[0] = I(0);
+
+  auto flush = [&]() {
+    if (pending_count == 0) {
+      return;
+    }
+    ld = sparse::rank_r_update<T, I>( //
+      ld,
+      etree,
+      static_cast<I const*>(nullptr),
+      MatRef<T, I>{
+        from_raw_parts,
+        isize(n),
+        isize(pending_count),
+        isize(zx(pw_col_ptrs[pending_count])),
+        pw_col_ptrs,
+        nullptr,
+        pw_row_indices,
+        pw_values,
+      },
+      palpha,
+      stack);
+    pending_count = 0;
+  };
+
+  for (usize q = 0; q < count; ++q) {
+    usize k = zx(porder[q]);
+    usize permuted_pos = permuted(k);
+
+    T diag_element = _detail::add_row_insert(
+      ld,
+      etree,
+      perm_inv,
+      isize(zx(positions.ptr()[k])),
+      VecRef<T, I>{
+        from_raw_parts,
+        isize(n),
+        isize(new_cols.col_end(k) - new_cols.col_start(k)),
+        new_cols.row_indices() + new_cols.col_start(k),
+        new_cols.values() + new_cols.col_start(k),
+      },
+      diag_elements[k],
+      _visited.ptr_mut(),
+      stack);
+
+    // the added column is copied, since the pending updates may modify it
+    auto col_start = ld.col_start(permuted_pos) + 1;
+    auto col_end = ld.col_end(permuted_pos);
+    if (zx(pw_col_ptrs[pending_count]) + (col_end - col_start) > n) {
+      flush();
+    }
+    usize w_start = zx(pw_col_ptrs[pending_count]);
+    std::copy(ld.row_indices() + col_start,
+              ld.row_indices() + col_end,
+              pw_row_indices + w_start);
+    std::copy(ld.values() + col_start,
+              ld.values() + col_end,
+              pw_values + w_start);
+    palpha[pending_count] = -diag_element;
+    pw_col_ptrs[pending_count + 1] = I(w_start + (col_end - col_start));
+    ++pending_count;
+  }
+  flush();
+
+  return ld;
+}
 } // namespace sparse
 } // namespace linalg
 } // namespace proxsuite
@@ -0,0 +1,412 @@
+/** \file */
+//
+// Copyright (c) 2022 INRIA
+//
+#ifndef PROXSUITE_LINALG_SPARSE_LDLT_SOLVE_HPP
+#define PROXSUITE_LINALG_SPARSE_LDLT_SOLVE_HPP
+
+#include "proxsuite/linalg/sparse/supernodal.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace proxsuite {
+namespace linalg {
+namespace sparse {
+
+/*!
+ * Schedule of the triangular solves with the factors of a sparse `LDLT`,
+ * computed from their structure by `ldlt_solve_schedule`. It stays valid as
+ * long as the structure of the factors is unchanged.
+ */
+template<typename I>
+struct LdltSolveSchedule
+{
+  // first column of each supernode, followed by n
+  I const* sn_start;
+  // supernodes of each independent subtree in increasing order, followed by
+  // the ones of the top part in increasing order
+  I const* order;
+  // start of each subtree in `order`, followed by the start of the top part
+  I const* subtree_ptr;
+  usize ns;
+  usize nsub;
+  isize nb_threads;
+};
+
+namespace _detail {
+// forward substitution with the columns of the supernode starting at column f
+// and of width w. the updates of the rows after `limit` are accumulated in
+// `outside` instead of `x`. `tmp` is a workspace of the size of the supernode.
+template<typename T, typename I>
+void
+supernode_lsolve(T* x,
+                 MatRef<T, I> ld,
+                 usize f,
+                 usize w,
+                 usize limit,
+                 T* outside,
+                 T* tmp) noexcept
+{
+  using Vec = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+  I const* ps = ld.row_indices() + ld.col_start(f);
+  T const* plx = ld.values();
+  usize m = ld.col_end(f) - ld.col_start(f);
+  usize split = usize(std::upper_bound(ps + w, ps + m, I(limit)) - ps);
+
+  if (w == 1) {
+    T const* col = plx + ld.col_start(f);
+    T const xj = x[f];
+    for (usize r = 1; r < split; ++r) {
+      x[util::zero_extend(ps[r])] -= col[r] * xj;
+    }
+    for (usize r = split; r < m; ++r) {
+      outside[util::zero_extend(ps[r])] += col[r] * xj;
+    }
+    return;
+  }
+
+  // the rows below the diagonal block are accumulated densely, then
+  // scattered once
+  usize mb = m - w;
+  Eigen::Map<Vec> acc{ tmp, isize(mb) };
+  acc.setZero();
+  for (usize k = 0; k < w; ++k) {
+    // col[r] is the element of the row ps[r], for r >= k
+    T const* col = plx + ld.col_start(f + k) - k;
+    T const xk = x[f + k];
+    for (usize r = k + 1; r < w; ++r) {
+      x[f + r] -= col[r] * xk;
+    }
+    acc += xk * Eigen::Map<Vec const>{ col + w, isize(mb) };
+  }
+  for (usize r = w; r < split; ++r) {
+    x[util::zero_extend(ps[r])] -= tmp[r - w];
+  }
+  for (usize r = split; r < m; ++r) {
+    outside[util::zero_extend(ps[r])] += tmp[r - w];
+  }
+}
+
+// diagonal solve followed by the backward substitution with the columns of
+// the supernode starting at column f and of width w. `tmp` is a workspace of
+// the size of the supernode.
+template<typename T, typename I>
+void
+supernode_dltsolve(T* x, MatRef<T, I> ld, usize f, usize w, T* tmp) noexcept
+{
+  using Vec = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+  I const* ps = ld.row_indices() + ld.col_start(f);
+  T const* plx = ld.values();
+  usize m = ld.col_end(f) - ld.col_start(f);
+
+  if (w == 1) {
+    T const* col = plx + ld.col_start(f);
+    T acc0 = 0;
+    T acc1 = 0;
+    usize r = 1;
+    for (; r + 1 < m; r += 2) {
+      acc0 += col[r] * x[util::zero_extend(ps[r])];
+      acc1 += col[r + 1] * x[util::zero_extend(ps[r + 1])];
+    }
+    if (r < m) {
+      acc0 += col[r] * x[util::zero_extend(ps[r])];
+    }
+    x[f] = x[f] / col[0] - (acc0 + acc1);
+    return;
+  }
+
+  // the rows below the diagonal block are gathered once
+  usize mb = m - w;
+  for (usize r = w; r < m; ++r) {
+    tmp[r - w] = x[util::zero_extend(ps[r])];
+  }
+  Eigen::Map<Vec const> below{ tmp, isize(mb) };
+  usize k = w;
+  while (k > 0) {
+    --k;
+    T const* col = plx + ld.col_start(f + k) - k;
+    T acc = below.dot(Eigen::Map<Vec const>{ col + w, isize(mb) });
+    for (usize r = k + 1; r < w; ++r) {
+      acc += col[r] * x[f + r];
+    }
+    x[f + k] = x[f + k] / col[k] - acc;
+  }
+}
+} // namespace _detail
+
+/*!
+ * Computes the memory requirements of `ldlt_solve_schedule`.
+ *
+ * @param n dimension of the factors.
+ */
+template<typename I>
+auto
+ldlt_solve_schedule_req(proxsuite::linalg::veg::Tag<I> itag, isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  return StackReq::with_len(itag, 6 * n) &
+         StackReq::with_len(proxsuite::linalg::veg::Tag<double>{}, n);
+}
+
+/*!
+ * Computes the schedule of the triangular solves with the factors `ld`, which
+ * may be stored in compressed or uncompressed format.
+ * Consecutive columns of the factor sharing the same structure are grouped in
+ * supernodes, whose columns are applied with dense kernels. With several
+ * threads, the supernodal elimination tree is also split into independent
+ * subtrees that are solved concurrently, and a top part made of their common
+ * ancestors.
+ *
+ * @param sn_start storage of size n + 1 for the supernodes.
+ * @param order storage of size n for the order of the supernodes.
+ * @param subtree_ptr storage of size n + 1 for the subtrees.
+ * @param ld the ldlt factors.
+ * @param nb_threads number of threads the solves may use.
+ * @param stack temporary allocation stack.
+ */
+template<typename T, typename I>
+auto
+ldlt_solve_schedule(I* sn_start,
+                    I* order,
+                    I* subtree_ptr,
+                    MatRef<T, I> ld,
+                    isize nb_threads,
+                    DynStackMut stack) noexcept(false) -> LdltSolveSchedule<I>
+{
+  usize n = usize(ld.nrows());
+  proxsuite::linalg::veg::Tag<I> tag{};
+
+  // the parent of each column is the first row below its diagonal
+  auto _etree = stack.make_new_for_overwrite(tag, isize(n));
+  auto _counts = stack.make_new_for_overwrite(tag, isize(n));
+  auto _sn_of = stack.make_new_for_overwrite(tag, isize(n));
+  auto _head = stack.make_new_for_overwrite(tag, isize(n));
+  auto _next = stack.make_new_for_overwrite(tag, isize(n));
+  auto _subtree_of = stack.make_new_for_overwrite(tag, isize(n));
+  I* etree = _etree.ptr_mut();
+  I* counts = _counts.ptr_mut();
+  for (usize j = 0; j < n; ++j) {
+    counts[j] = I(ld.col_end(j) - ld.col_start(j));
+    etree[j] =
+      counts[j] > 1 ? ld.row_indices()[ld.col_start(j) + 1] : I(-1);
+  }
+
+  usize ns = _detail::supernode_partition(
+    sn_start, _sn_of.ptr_mut(), _head.ptr_mut(), counts, etree, n);
+
+  usize nsub = 0;
+  if (nb_threads > 1 && ns > 1) {
+    // only the structure of the supernodes is used
+    _detail::SupernodalFactor<T, I> fact{
+      nullptr,          nullptr,      nullptr,         nullptr,
+      ld.col_ptrs(),    counts,       ld,              sn_start,
+      _sn_of.ptr(),     _head.ptr_mut(),  _next.ptr_mut(), nullptr,
+      nullptr,
+    };
+    for (usize s = 0; s < ns; ++s) {
+      fact.head[s] = I(-1);
+    }
+    for (usize s = ns; s > 0; --s) {
+      usize p = fact.parent(s - 1, etree);
+      if (p != usize(-1)) {
+        _detail::link_supernode(fact.head, fact.next, s - 1, p);
+      }
+    }
+
+    // the work of a supernode is the number of elements of its columns
+    auto _work = stack.make_new_for_overwrite(
+      proxsuite::linalg::veg::Tag<double>{}, isize(n));
+    double* work = _work.ptr_mut();
+    for (usize s = 0; s < ns; ++s) {
+      double m = double(fact.height(s));
+      double w = double(fact.width(s));
+      work[s] = w * (m - (w - 1) / 2);
+    }
+
+    // the roots are stored in `order` until the subtrees are sorted
+    nsub = _detail::supernode_subtrees(
+      _subtree_of.ptr_mut(), order, work, fact, etree, ns, nb_threads);
+    if (nsub <= 1) {
+      nsub = 0;
+    }
+  }
+
+  if (nsub == 0) {
+    for (usize s = 0; s < ns; ++s) {
+      _subtree_of.ptr_mut()[s] = I(-1);
+    }
+  }
+  _detail::supernode_subtree_order(
+    order, subtree_ptr, _subtree_of.ptr(), ns, nsub);
+  usize top = util::zero_extend(subtree_ptr[nsub]);
+  for (usize s = 0; s < ns; ++s) {
+    if (_subtree_of.ptr()[s] == I(-1)) {
+      order[top++] = I(s);
+    }
+  }
+
+  return {
+    sn_start, order, subtree_ptr, ns, nsub, nsub == 0 ? 1 : nb_threads,
+  };
+}
+
+/*!
+ * Computes the memory requirements of `ldlt_solve_in_place`.
+ *
+ * @param n dimension of the factors.
+ * @param nb_threads number of threads of the schedule.
+ */
+template<typename T, typename I>
+auto
+ldlt_solve_in_place_req(proxsuite::linalg::veg::Tag<T> ttag,
+                        proxsuite::linalg::veg::Tag<I> itag,
+                        isize n,
+                        isize nb_threads) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  if (nb_threads <= 1) {
+    return StackReq::with_len(ttag, n);
+  }
+  return StackReq::with_len(ttag, 2 * n * nb_threads) &
+         StackReq::with_len(itag, n);
+}
+
+/*!
+ * Solves `ld×x = b` in place, where `ld` holds the ldlt factors of a sparse
+ * matrix, following the schedule computed by `ldlt_solve_schedule`.
+ * The diagonal solve is fused with the backward substitution.
+ *
+ * @param x right hand side on entry, solution on return.
+ * @param ld the ldlt factors.
+ * @param schedule schedule of the solve, computed from the structure of `ld`.
+ * @param stack temporary allocation stack.
+ */
+template<typename T, typename I>
+void
+ldlt_solve_in_place(DenseVecMut<T> x,
+                    MatRef<T, I> ld,
+                    LdltSolveSchedule<I> const& schedule,
+                    DynStackMut stack) noexcept
+{
+  usize n = usize(ld.nrows());
+  usize nsub = schedule.nsub;
+  isize nb_threads = schedule.nb_threads;
+  T* px = x.as_slice_mut().ptr_mut();
+  auto zx = util::zero_extend;
+
+  auto first = [&](usize s) { return zx(schedule.sn_start[s]); };
+  auto width = [&](usize s) {
+    return zx(schedule.sn_start[s + 1]) - zx(schedule.sn_start[s]);
+  };
+  usize top_start = zx(schedule.subtree_ptr[nsub]);
+  usize ns = schedule.ns;
+
+  if (nsub == 0) {
+    auto _tmp = stack.make_new_for_overwrite(
+      proxsuite::linalg::veg::Tag<T>{}, isize(n));
+    T* tmp = _tmp.ptr_mut();
+    for (usize p = top_start; p < ns; ++p) {
+      usize s = zx(schedule.order[p]);
+      _detail::supernode_lsolve(
+        px, ld, first(s), width(s), n, static_cast<T*>(nullptr), tmp);
+    }
+    for (usize p = ns; p > top_start; --p) {
+      usize s = zx(schedule.order[p - 1]);
+      _detail::supernode_dltsolve(px, ld, first(s), width(s), tmp);
+    }
+    return;
+  }
+
+  // each thread owns an accumulator for the updates of the top part, and a
+  // workspace for the supernodes
+  auto _storage = stack.make_new_for_overwrite(
+    proxsuite::linalg::veg::Tag<T>{}, isize(2 * n) * nb_threads);
+  auto _owner =
+    stack.make_new_for_overwrite(proxsuite::linalg::veg::Tag<I>{}, isize(n));
+  T* storage = _storage.ptr_mut();
+  I* owner = _owner.ptr_mut();
+
+  auto subtree_root = [&](usize t) {
+    return zx(schedule.order[zx(schedule.subtree_ptr[t + 1]) - 1]);
+  };
+
+  // forward substitution: the subtrees are solved concurrently, while their
+  // updates of the top part are accumulated separately by each thread
+  {
+    std::atomic<usize> next_subtree{ 0 };
+    proxsuite::helpers::parallel_for(nb_threads, nb_threads, [&](isize k) {
+      T* outside = storage + usize(k) * 2 * n;
+      T* tmp = outside + n;
+      std::fill(outside, outside + n, T(0));
+      while (true) {
+        usize t = next_subtree.fetch_add(1, std::memory_order_relaxed);
+        if (t >= nsub) {
+          break;
+        }
+        owner[t] = I(k);
+        usize root = subtree_root(t);
+        usize limit = first(root) + width(root) - 1;
+        for (usize p = zx(schedule.subtree_ptr[t]);
+             p < zx(schedule.subtree_ptr[t + 1]);
+             ++p) {
+          usize s = zx(schedule.order[p]);
+          _detail::supernode_lsolve(
+            px, ld, first(s), width(s), limit, outside, tmp);
+        }
+      }
+    });
+  }
+
+  // the rows of the top part updated by a subtree are the ones of its root
+  // below the diagonal block
+  for (usize t = 0; t < nsub; ++t) {
+    T* outside = storage + zx(owner[t]) * 2 * n;
+    usize root = subtree_root(t);
+    usize f = first(root);
+    I const* ps = ld.row_indices() + ld.col_start(f);
+    usize m = ld.col_end(f) - ld.col_start(f);
+    for (usize r = width(root); r < m; ++r) {
+      usize i = zx(ps[r]);
+      px[i] -= outside[i];
+      outside[i] = 0;
+    }
+  }
+
+  T* tmp = storage + n;
+  for (usize p = top_start; p < ns; ++p) {
+    usize s = zx(schedule.order[p]);
+    _detail::supernode_lsolve(
+      px, ld, first(s), width(s), n, static_cast<T*>(nullptr), tmp);
+  }
+
+  // backward substitution: the top part is solved first, then the subtrees
+  // only read the solution of their ancestors
+  for (usize p = ns; p > top_start; --p) {
+    usize s = zx(schedule.order[p - 1]);
+    _detail::supernode_dltsolve(px, ld, first(s), width(s), tmp);
+  }
+  {
+    std::atomic<usize> next_subtree{ 0 };
+    proxsuite::helpers::parallel_for(nb_threads, nb_threads, [&](isize k) {
+      T* tmp_k = storage + usize(k) * 2 * n + n;
+      while (true) {
+        usize t = next_subtree.fetch_add(1, std::memory_order_relaxed);
+        if (t >= nsub) {
+          break;
+        }
+        for (usize p = zx(schedule.subtree_ptr[t + 1]);
+             p > zx(schedule.subtree_ptr[t]);
+             --p) {
+          usize s = zx(schedule.order[p - 1]);
+          _detail::supernode_dltsolve(px, ld, first(s), width(s), tmp_k);
+        }
+      }
+    });
+  }
+}
+} // namespace sparse
+} // namespace linalg
+} // namespace proxsuite
+#endif /* end of include guard PROXSUITE_LINALG_SPARSE_LDLT_SOLVE_HPP */
@@ -0,0 +1,1002 @@
+/** \file */
+//
+// Copyright (c) 2022 INRIA
+//
+#ifndef PROXSUITE_LINALG_SPARSE_LDLT_SUPERNODAL_HPP
+#define PROXSUITE_LINALG_SPARSE_LDLT_SUPERNODAL_HPP
+
+#include "proxsuite/linalg/sparse/factorize.hpp"
+#include "proxsuite/linalg/dense/factorize.hpp"
+#include "proxsuite/helpers/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace proxsuite {
+namespace linalg {
+namespace sparse {
+namespace _detail {
+// supernodes wider than this are split, so that the dense blocks stay
+// proportional to the longest column of the factor
+constexpr isize supernode_max_width = 64;
+// descendants narrower than this update a supernode without going through a
+// dense product
+constexpr isize supernode_gemm_width = 4;
+
+template<typename T>
+using SupernodeBlock =
+  Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>,
+             Eigen::Unaligned,
+             Eigen::OuterStride<Eigen::Dynamic>>;
+
+template<typename I>
+void
+link_supernode(I* head, I* next, usize s, usize target) noexcept
+{
+  next[s] = head[target];
+  head[target] = I(s);
+}
+
+// splits the columns of the factor into supernodes: consecutive columns
+// forming a chain of the elimination tree whose structures are nested, so that
+// each supernode is stored as a dense trapezoidal block.
+// returns the number of supernodes
+template<typename I>
+auto
+supernode_partition(I* sn_start,
+                    I* sn_of,
+                    I* nchildren,
+                    I const* nnz_per_col,
+                    I const* etree,
+                    usize n) noexcept -> usize
+{
+  for (usize j = 0; j < n; ++j) {
+    nchildren[j] = I(0);
+  }
+  for (usize j = 0; j < n; ++j) {
+    usize parent = util::sign_extend(etree[j]);
+    if (parent != usize(-1)) {
+      util::wrapping_inc(mut(nchildren[parent]));
+    }
+  }
+
+  usize ns = 0;
+  for (usize j = 0; j < n; ++j) {
+    bool merge =
+      j > 0 && util::sign_extend(etree[j - 1]) == j &&
+      util::zero_extend(nchildren[j]) == 1 &&
+      util::zero_extend(nnz_per_col[j - 1]) ==
+        util::zero_extend(nnz_per_col[j]) + 1 &&
+      j - util::zero_extend(sn_start[ns - 1]) < usize(supernode_max_width);
+    if (!merge) {
+      sn_start[ns] = I(j);
+      ++ns;
+    }
+    sn_of[j] = I(ns - 1);
+  }
+  sn_start[ns] = I(n);
+  return ns;
+}
+
+// memory needed by a thread to factorize one supernode at a time
+template<typename T, typename I>
+auto
+supernode_thread_req(proxsuite::linalg::veg::Tag<T> ttag,
+                     proxsuite::linalg::veg::Tag<I> itag,
+                     isize n,
+                     isize max_col_count) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  isize width = n < supernode_max_width ? n : supernode_max_width;
+  auto block_req = StackReq::with_len(ttag, max_col_count * width);
+  // dense block of the supernode, then the rows of a descendant, the same rows
+  // scaled by D and its update
+  return StackReq::with_len(itag, n) //
+         & (block_req                //
+            & ((block_req & block_req & block_req) |
+               proxsuite::linalg::dense::factorize_req(ttag, width)));
+}
+
+// state of a supernodal factorization, shared by the threads. a supernode is
+// only written to by the thread factorizing it, and the list of the
+// supernodes updating it is only modified by the thread that owns it
+template<typename T, typename I>
+struct SupernodalFactor
+{
+  T* values;
+  I* row_indices;
+  T const* diag_to_add;
+  I const* perm;
+  I const* col_ptrs;
+  I const* nnz_per_col;
+  MatRef<T, I> lower;
+  I const* sn_start;
+  I const* sn_of;
+  I* head;
+  I* next;
+  I* pos;
+  // subtree containing each supernode, or null when a single thread
+  // factorizes all of them
+  I const* subtree_of;
+
+  auto first_col(usize s) const noexcept -> usize
+  {
+    return util::zero_extend(sn_start[s]);
+  }
+  auto width(usize s) const noexcept -> usize
+  {
+    return util::zero_extend(sn_start[s + 1]) - util::zero_extend(sn_start[s]);
+  }
+  auto height(usize s) const noexcept -> usize
+  {
+    return util::zero_extend(nnz_per_col[sn_start[s]]);
+  }
+  // the structure of a supernode is stored as the row indices of its first
+  // column
+  auto pattern(usize s) const noexcept -> I*
+  {
+    return row_indices + util::zero_extend(col_ptrs[sn_start[s]]);
+  }
+  auto parent(usize s, I const* etree) const noexcept -> usize
+  {
+    usize p = util::sign_extend(etree[util::zero_extend(sn_start[s + 1]) - 1]);
+    return p == usize(-1) ? p : util::zero_extend(sn_of[p]);
+  }
+
+  // adds s to the list of the supernode containing its next row. when the
+  // latter belongs to another subtree, this is deferred until all the subtrees
+  // are factorized
+  void link_next(usize s) const noexcept
+  {
+    usize p = util::zero_extend(pos[s]);
+    if (p == height(s)) {
+      return;
+    }
+    usize target = util::zero_extend(sn_of[pattern(s)[p]]);
+    if (subtree_of == nullptr || subtree_of[target] == subtree_of[s]) {
+      _detail::link_supernode(head, next, s, target);
+    }
+  }
+
+  // computes the structure of each supernode, which is the union of the
+  // structure of its columns in the matrix and of the ones of its children.
+  // on return, `head` and `next` hold the children of each supernode
+  void symbolic(usize ns, I const* etree, I* mark) const noexcept
+  {
+    for (usize s = 0; s < ns; ++s) {
+      head[s] = I(-1);
+    }
+    for (usize s = ns; s > 0; --s) {
+      usize p = parent(s - 1, etree);
+      if (p != usize(-1)) {
+        _detail::link_supernode(head, next, s - 1, p);
+      }
+    }
+    for (usize i = 0; i < usize(lower.ncols()); ++i) {
+      mark[i] = I(-1);
+    }
+
+    I const* pai = lower.row_indices();
+    for (usize s = 0; s < ns; ++s) {
+      usize f = first_col(s);
+      usize w = width(s);
+      I* ps = pattern(s);
+      usize len = 0;
+
+      for (usize j = f; j < f + w; ++j) {
+        mark[j] = I(s);
+        ps[len++] = I(j);
+      }
+      for (usize j = f; j < f + w; ++j) {
+        auto col_start = lower.col_start(j);
+        auto col_end = lower.col_end(j);
+        for (usize p = col_start; p < col_end; ++p) {
+          usize i = util::zero_extend(pai[p]);
+          if (util::zero_extend(mark[i]) != s) {
+            mark[i] = I(s);
+            ps[len++] = I(i);
+          }
+        }
+      }
+      for (usize c = util::sign_extend(head[s]); c != usize(-1);
+           c = util::sign_extend(next[c])) {
+        I const* pc = pattern(c);
+        for (usize p = width(c); p < height(c); ++p) {
+          usize i = util::zero_extend(pc[p]);
+          if (util::zero_extend(mark[i]) != s) {
+            mark[i] = I(s);
+            ps[len++] = I(i);
+          }
+        }
+      }
+      VEG_ASSERT(len == height(s));
+      std::sort(ps + w, ps + len);
+    }
+  }
+
+  // left-looking step: assembles the supernode s, applies the updates of the
+  // already factorized supernodes in its list, then factorizes it.
+  // `map` is a workspace of size n
+  void factorize_supernode(usize s, I* map, DynStackMut stack) const
+  {
+    using Block = SupernodeBlock<T>;
+    using Stride = Eigen::OuterStride<Eigen::Dynamic>;
+    proxsuite::linalg::veg::Tag<T> ttag{};
+
+    usize f = first_col(s);
+    usize w = width(s);
+    usize m = height(s);
+    I const* ps = pattern(s);
+
+    for (usize p = 0; p < m; ++p) {
+      map[util::zero_extend(ps[p])] = I(p);
+    }
+
+    auto _b = stack.make_new(ttag, isize(m * w));
+    T* pb = _b.ptr_mut();
+
+    I const* pai = lower.row_indices();
+    T const* pax = lower.values();
+    for (usize j = f; j < f + w; ++j) {
+      T* pbj = pb + (j - f) * m;
+      auto col_start = lower.col_start(j);
+      auto col_end = lower.col_end(j);
+      for (usize p = col_start; p < col_end; ++p) {
+        usize i = util::zero_extend(pai[p]);
+        pbj[util::zero_extend(map[i])] += pax[p];
+      }
+      if (diag_to_add != nullptr && perm != nullptr) {
+        pbj[j - f] += diag_to_add[util::zero_extend(perm[j])];
+      }
+    }
+
+    usize d = util::sign_extend(head[s]);
+    head[s] = I(-1);
+    while (d != usize(-1)) {
+      usize d_next = util::sign_extend(next[d]);
+
+      usize fd = first_col(d);
+      usize wd = width(d);
+      usize md = height(d);
+      I const* pd = pattern(d);
+
+      usize p0 = util::zero_extend(pos[d]);
+      usize p1 = p0;
+      while (p1 < md && util::zero_extend(pd[p1]) < f + w) {
+        ++p1;
+      }
+      usize k1 = p1 - p0;
+      usize k2 = md - p0;
+
+      if (wd < usize(supernode_gemm_width)) {
+        // narrow descendants are applied directly from the column storage
+        for (usize k = 0; k < wd; ++k) {
+          T const* plx = values + util::zero_extend(col_ptrs[fd + k]) - k;
+          T dk = plx[k];
+          for (usize q = 0; q < k1; ++q) {
+            T* pbq = pb + (util::zero_extend(pd[p0 + q]) - f) * m;
+            T lq = plx[p0 + q] * dk;
+            for (usize r = q; r < k2; ++r) {
+              pbq[util::zero_extend(map[pd[p0 + r]])] -= plx[p0 + r] * lq;
+            }
+          }
+        }
+      } else {
+        auto _ld = stack.make_new_for_overwrite(ttag, isize(k2 * wd));
+        auto _ldd = stack.make_new_for_overwrite(ttag, isize(k2 * wd));
+        T* pld = _ld.ptr_mut();
+        T* pldd = _ldd.ptr_mut();
+
+        // rows p0.. of the columns of d, and the same rows scaled by D
+        for (usize k = 0; k < wd; ++k) {
+          T const* plx = values + util::zero_extend(col_ptrs[fd + k]);
+          T dk = plx[0];
+          for (usize r = 0; r < k2; ++r) {
+            T l = plx[p0 + r - k];
+            pld[k * k2 + r] = l;
+            pldd[k * k2 + r] = l * dk;
+          }
+        }
+
+        Block ld{ pld, isize(k2), isize(wd), Stride{ isize(k2) } };
+        Block ldd{ pldd, isize(k2), isize(wd), Stride{ isize(k2) } };
+        auto _c = stack.make_new_for_overwrite(ttag, isize(k2 * k1));
+        Block c{ _c.ptr_mut(), isize(k2), isize(k1), Stride{ isize(k2) } };
+        c.noalias() = ldd * ld.topRows(isize(k1)).transpose();
+
+        for (usize q = 0; q < k1; ++q) {
+          T* pbq = pb + (util::zero_extend(pd[p0 + q]) - f) * m;
+          T const* pcq = c.data() + q * k2;
+          for (usize r = q; r < k2; ++r) {
+            pbq[util::zero_extend(map[pd[p0 + r]])] -= pcq[r];
+          }
+        }
+      }
+
+      pos[d] = I(p1);
+      link_next(d);
+      d = d_next;
+    }
+
+    Block b11{ pb, isize(w), isize(w), Stride{ isize(m) } };
+    if (w == 1) {
+      T const d0 = pb[0];
+      for (usize r = 1; r < m; ++r) {
+        pb[r] /= d0;
+      }
+    } else {
+      proxsuite::linalg::dense::factorize(b11, stack);
+    }
+    if (w > 1 && m > w) {
+      Block b21{ pb + w, isize(m - w), isize(w), Stride{ isize(m) } };
+      b11.transpose()
+        .template triangularView<Eigen::UnitUpper>()
+        .template solveInPlace<Eigen::OnTheRight>(b21);
+      for (usize k = 0; k < w; ++k) {
+        b21.col(isize(k)) /= b11(isize(k), isize(k));
+      }
+    }
+
+    // copy back to the column storage, the diagonal element of each column
+    // holds the diagonal of D instead of 1
+    for (usize k = 0; k < w; ++k) {
+      usize col_start = util::zero_extend(col_ptrs[f + k]);
+      T const* pbk = pb + k * m;
+      for (usize r = k; r < m; ++r) {
+        values[col_start + r - k] = pbk[r];
+      }
+      if (k > 0) {
+        for (usize r = k; r < m; ++r) {
+          row_indices[col_start + r - k] = ps[r];
+        }
+      }
+    }
+
+    pos[s] = I(w);
+    link_next(s);
+  }
+};
+
+// splits the supernodal elimination tree into independent subtrees, and a top
+// part made of their ancestors. starting from the roots, the subtree with the
+// most work is replaced by its children until the work is spread evenly
+// enough to be balanced over `nb_threads` threads.
+// `head` and `next` of `fact` must hold the children of each supernode, and
+// `work` the work of each supernode, which is accumulated over the subtrees.
+// fills `roots` with the roots of the subtrees by decreasing work, and
+// `subtree_of` with the subtree containing each supernode, or -1 for the top
+// part. returns the number of subtrees
+template<typename T, typename I>
+auto
+supernode_subtrees(I* subtree_of,
+                   I* roots,
+                   double* work,
+                   SupernodalFactor<T, I> const& fact,
+                   I const* etree,
+                   usize ns,
+                   isize nb_threads) noexcept -> usize
+{
+  usize nroots = 0;
+  for (usize s = 0; s < ns; ++s) {
+    usize p = fact.parent(s, etree);
+    if (p == usize(-1)) {
+      roots[nroots++] = I(s);
+    } else {
+      work[p] += work[s];
+    }
+  }
+
+  double total = 0;
+  for (usize k = 0; k < nroots; ++k) {
+    total += work[util::zero_extend(roots[k])];
+  }
+  while (nroots > 0 && nroots < usize(64 * nb_threads)) {
+    usize heaviest = 0;
+    for (usize k = 1; k < nroots; ++k) {
+      if (work[util::zero_extend(roots[k])] >
+          work[util::zero_extend(roots[heaviest])]) {
+        heaviest = k;
+      }
+    }
+    usize s = util::zero_extend(roots[heaviest]);
+    if (work[s] <= total / double(nb_threads) ||
+        util::sign_extend(fact.head[s]) == usize(-1)) {
+      break;
+    }
+    // s moves to the top part
+    roots[heaviest] = roots[nroots - 1];
+    --nroots;
+    total -= work[s];
+    for (usize c = util::sign_extend(fact.head[s]); c != usize(-1);
+         c = util::sign_extend(fact.next[c])) {
+      roots[nroots++] = I(c);
+      total += work[c];
+    }
+  }
+
+  std::sort(roots, roots + nroots, [&](I a, I b) {
+    return work[util::zero_extend(a)] > work[util::zero_extend(b)];
+  });
+  for (usize s = 0; s < ns; ++s) {
+    subtree_of[s] = I(-1);
+  }
+  for (usize k = 0; k < nroots; ++k) {
+    subtree_of[util::zero_extend(roots[k])] = I(k);
+  }
+  // parents come after their children
+  for (usize s = ns; s > 0; --s) {
+    usize p = fact.parent(s - 1, etree);
+    if (subtree_of[s - 1] == I(-1) && p != usize(-1)) {
+      subtree_of[s - 1] = subtree_of[p];
+    }
+  }
+  return nroots;
+}
+
+// lists the supernodes of each subtree in increasing order. those of the
+// subtree t are stored in order[subtree_ptr[t]..subtree_ptr[t + 1]]
+template<typename I>
+void
+supernode_subtree_order(I* order,
+                        I* subtree_ptr,
+                        I const* subtree_of,
+                        usize ns,
+                        usize nsub) noexcept
+{
+  for (usize k = 0; k < nsub + 1; ++k) {
+    subtree_ptr[k] = I(0);
+  }
+  for (usize s = 0; s < ns; ++s) {
+    usize t = util::sign_extend(subtree_of[s]);
+    if (t != usize(-1)) {
+      util::wrapping_inc(mut(subtree_ptr[t + 1]));
+    }
+  }
+  for (usize k = 0; k < nsub; ++k) {
+    subtree_ptr[k + 1] += subtree_ptr[k];
+  }
+  for (usize s = 0; s < ns; ++s) {
+    usize t = util::sign_extend(subtree_of[s]);
+    if (t != usize(-1)) {
+      order[util::zero_extend(subtree_ptr[t])] = I(s);
+      util::wrapping_inc(mut(subtree_ptr[t]));
+    }
+  }
+  for (usize k = nsub; k > 0; --k) {
+    subtree_ptr[k] = subtree_ptr[k - 1];
+  }
+  subtree_ptr[0] = I(0);
+}
+
+// memory requirements of factorize_supernodal_lower
+template<typename T, typename I>
+auto
+supernodal_lower_req(proxsuite::linalg::veg::Tag<T> ttag,
+                     proxsuite::linalg::veg::Tag<I> itag,
+                     isize n,
+                     isize max_col_count,
+                     isize nb_threads) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+
+  constexpr isize sz{ sizeof(I) };
+  constexpr isize al{ alignof(I) };
+
+  auto thread_req = _detail::supernode_thread_req(ttag, itag, n, max_col_count);
+  auto factor_req =
+    nb_threads > 1
+      ? (StackReq{ (3 * n + 1) * sz, al } &
+         StackReq::with_len(proxsuite::linalg::veg::Tag<double>{}, n) &
+         StackReq{ nb_threads * thread_req.alloc_req(), 1 })
+      : thread_req;
+  return StackReq{ (5 * n + 1) * sz, al } &
+         (StackReq{ n * sz, al } | factor_req);
+}
+} // namespace _detail
+
+/*!
+ * Computes the stack memory requirements of supernodal numerical
+ * factorization.
+ *
+ * @param n dimension of the matrix to be factorized.
+ * @param a_nnz number of non zeros of the matrix to be factorized.
+ * @param max_col_count upper bound on the number of non zeros of each column
+ * of the factor, including the diagonal.
+ * @param o the kind of permutation that is applied to the matrix before
+ * factorization.
+ * @param nb_threads number of threads used by the factorization.
+ */
+template<typename T, typename I>
+auto
+factorize_numeric_supernodal_req(proxsuite::linalg::veg::Tag<T> ttag,
+                                 proxsuite::linalg::veg::Tag<I> itag,
+                                 isize n,
+                                 isize a_nnz,
+                                 isize max_col_count,
+                                 Ordering o,
+                                 isize nb_threads = 1) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+
+  constexpr isize sz{ sizeof(I) };
+  constexpr isize al{ alignof(I) };
+
+  constexpr isize tsz{ sizeof(T) };
+  constexpr isize tal{ alignof(T) };
+
+  bool id_perm = o == Ordering::natural;
+
+  auto symb_perm_req = StackReq{ sz * (id_perm ? 0 : (n + 1 + a_nnz)), al };
+  auto num_perm_req = StackReq{ tsz * (id_perm ? 0 : a_nnz), tal };
+  auto lower_req =
+    StackReq{ tsz * a_nnz, tal } & StackReq{ sz * (n + 1 + a_nnz), al };
+
+  auto permute_req = _detail::symmetric_permute_req(itag, n, nb_threads);
+  auto transpose_req = sparse::transpose_req(itag, n, nb_threads);
+
+  return num_perm_req                 //
+         & (symb_perm_req             //
+            & (permute_req            //
+               | (lower_req           //
+                  & (transpose_req    //
+                     | _detail::supernodal_lower_req(
+                         ttag, itag, n, max_col_count, nb_threads)))));
+}
+
+namespace _detail {
+// factorizes the matrix whose lower triangular part, permuted and with
+// the rows of each column in any order, is `lower`
+template<typename T, typename I>
+void
+factorize_supernodal_lower(T* values,
+                           I* row_indices,
+                           T const* diag_to_add,
+                           I const* perm,
+                           I const* col_ptrs,
+                           I const* nnz_per_col,
+                           I const* etree,
+                           MatRef<T, I> lower,
+                           DynStackMut stack,
+                           isize nb_threads) noexcept(false)
+{
+  isize n = lower.nrows();
+  proxsuite::linalg::veg::Tag<I> tag{};
+  proxsuite::linalg::veg::Tag<T> ttag{};
+
+  auto _sn_start = stack.make_new_for_overwrite(tag, n + 1);
+  auto _sn_of = stack.make_new_for_overwrite(tag, n);
+  auto _head = stack.make_new_for_overwrite(tag, n);
+  auto _next = stack.make_new_for_overwrite(tag, n);
+  auto _pos = stack.make_new_for_overwrite(tag, n);
+
+  usize ns = _detail::supernode_partition(_sn_start.ptr_mut(),
+                                          _sn_of.ptr_mut(),
+                                          _head.ptr_mut(),
+                                          nnz_per_col,
+                                          etree,
+                                          usize(n));
+
+  _detail::SupernodalFactor<T, I> fact{
+    values,
+    row_indices,
+    diag_to_add,
+    perm,
+    col_ptrs,
+    nnz_per_col,
+    lower,
+    _sn_start.ptr(),
+    _sn_of.ptr(),
+    _head.ptr_mut(),
+    _next.ptr_mut(),
+    _pos.ptr_mut(),
+    nullptr,
+  };
+
+  {
+    auto _mark = stack.make_new_for_overwrite(tag, n);
+    fact.symbolic(ns, etree, _mark.ptr_mut());
+  }
+
+  // during the numeric phase, the list of a supernode holds the already
+  // factorized supernodes with rows in its columns that have not updated it
+  // yet
+  if (nb_threads <= 1) {
+    for (usize s = 0; s < ns; ++s) {
+      fact.head[s] = I(-1);
+    }
+    auto _map = stack.make_new_for_overwrite(tag, n);
+    for (usize s = 0; s < ns; ++s) {
+      fact.factorize_supernode(s, _map.ptr_mut(), stack);
+    }
+    return;
+  }
+
+  auto _subtree_of = stack.make_new_for_overwrite(tag, n);
+  auto _order = stack.make_new_for_overwrite(tag, n);
+  auto _subtree_ptr = stack.make_new_for_overwrite(tag, n + 1);
+  auto _work =
+    stack.make_new_for_overwrite(proxsuite::linalg::veg::Tag<double>{}, n);
+
+  I const* subtree_of = _subtree_of.ptr();
+  I* order = _order.ptr_mut();
+  I* subtree_ptr = _subtree_ptr.ptr_mut();
+
+  // dense flop count of each supernode
+  double* work = _work.ptr_mut();
+  for (usize s = 0; s < ns; ++s) {
+    double m = double(fact.height(s));
+    work[s] = m * m * double(fact.width(s));
+  }
+
+  // the roots are stored in `order` until the subtrees are sorted
+  usize nsub = _detail::supernode_subtrees(
+    _subtree_of.ptr_mut(), order, work, fact, etree, ns, nb_threads);
+  _detail::supernode_subtree_order(order, subtree_ptr, subtree_of, ns, nsub);
+
+  for (usize s = 0; s < ns; ++s) {
+    fact.head[s] = I(-1);
+  }
+
+  usize max_height = 0;
+  for (usize s = 0; s < ns; ++s) {
+    max_height = std::max(max_height, fact.height(s));
+  }
+  isize thread_bytes =
+    _detail::supernode_thread_req(ttag, tag, n, isize(max_height)).alloc_req();
+  auto _thread_storage = stack.make_new_for_overwrite(
+    proxsuite::linalg::veg::Tag<unsigned char>{}, nb_threads * thread_bytes);
+  auto thread_stack = [&](isize k) -> DynStackMut {
+    return {
+      proxsuite::linalg::veg::from_slice_mut,
+      proxsuite::linalg::veg::SliceMut<unsigned char>{
+        proxsuite::linalg::veg::unsafe,
+        proxsuite::linalg::veg::from_raw_parts,
+        _thread_storage.ptr_mut() + k * thread_bytes,
+        thread_bytes,
+      },
+    };
+  };
+
+  // the subtrees are handed out dynamically, the heaviest ones first
+  fact.subtree_of = subtree_of;
+  std::atomic<usize> next_subtree{ 0 };
+  proxsuite::helpers::parallel_for(nb_threads, nb_threads, [&](isize k) {
+    DynStackMut local_stack = thread_stack(k);
+    auto _map = local_stack.make_new_for_overwrite(tag, n);
+    while (true) {
+      usize t = next_subtree.fetch_add(1, std::memory_order_relaxed);
+      if (t >= nsub) {
+        break;
+      }
+      for (usize p = util::zero_extend(subtree_ptr[t]);
+           p < util::zero_extend(subtree_ptr[t + 1]);
+           ++p) {
+        fact.factorize_supernode(
+          util::zero_extend(order[p]), _map.ptr_mut(), local_stack);
+      }
+    }
+  });
+
+  // the subtrees meet at the top part, which is factorized by the calling
+  // thread once their pending updates are linked
+  fact.subtree_of = nullptr;
+  for (usize s = 0; s < ns; ++s) {
+    if (subtree_of[s] != I(-1)) {
+      fact.link_next(s);
+    }
+  }
+  DynStackMut local_stack = thread_stack(0);
+  auto _map = local_stack.make_new_for_overwrite(tag, n);
+  for (usize s = 0; s < ns; ++s) {
+    if (subtree_of[s] == I(-1)) {
+      fact.factorize_supernode(s, _map.ptr_mut(), local_stack);
+    }
+  }
+}
+} // namespace _detail
+
+/*!
+ * Performs numerical `LDLT` factorization, assuming the symbolic factorization
+ * and column counts have already been computed. The result is identical to
+ * the one of `factorize_numeric`, and is stored in the same format.
+ * Consecutive columns of the factor sharing the same structure are grouped in
+ * supernodes, which are factorized and updated with dense kernels. This is
+ * faster than `factorize_numeric` when the factor has dense subtrees, as is the
+ * case when the constraint matrices have dense rows or columns.
+ * With several threads, the independent subtrees of the elimination tree are
+ * factorized concurrently, then their common ancestors are factorized by the
+ * calling thread.
+ *
+ * @param values pointer to the values of the factorization
+ * @param row_indices pointer to the row indices of the factorization
+ * @param diag_to_add pointer to a vector that is added to the diagonal of the
+ * matrix during factorization, if `diag_to_add` and `perm` are both non null
+ * @param perm pointer to the pre-computed permutation that is applied to
+ * `diag`.
+ * @param col_ptrs pointer to the already computed column pointers
+ * @param nnz_per_col pointer to the already computed number of non zeros of
+ * each column of the factor, including the diagonal
+ * @param etree pointer to the already computed elimination tree
+ * @param perm_inv pointer to the already computed inverse permutation. Must be
+ * the inverse of `perm`
+ * @param a matrix to be factorized
+ * @param stack temporary allocation stack
+ * @param nb_threads number of threads used by the factorization, must be the
+ * same as the one the memory requirements were computed with
+ */
+template<typename T, typename I>
+void
+factorize_numeric_supernodal( //
+  T* values,
+  I* row_indices,
+  proxsuite::linalg::veg::DoNotDeduce<T const*> diag_to_add,
+  proxsuite::linalg::veg::DoNotDeduce<I const*> perm,
+  I const* col_ptrs,
+  I const* nnz_per_col,
+  I const* etree,
+  I const* perm_inv,
+  MatRef<T, I> a,
+  DynStackMut stack,
+  isize nb_threads = 1) noexcept(false)
+{
+  using namespace _detail;
+  isize n = a.nrows();
+
+  bool id_perm = perm_inv == nullptr;
+
+  proxsuite::linalg::veg::Tag<I> tag{};
+  proxsuite::linalg::veg::Tag<T> ttag{};
+
+  auto _permuted_a_values =
+    stack.make_new_for_overwrite(ttag, id_perm ? 0 : a.nnz());
+  auto _permuted_a_col_ptrs =
+    stack.make_new_for_overwrite(tag, id_perm ? 0 : (a.ncols() + 1));
+  auto _permuted_a_row_indices =
+    stack.make_new_for_overwrite(tag, id_perm ? 0 : a.nnz());
+
+  if (!id_perm) {
+    _permuted_a_col_ptrs.as_mut()[0] = 0;
+    _permuted_a_col_ptrs.as_mut()[n] = I(a.nnz());
+    MatMut<T, I> permuted_a{
+      from_raw_parts,
+      n,
+      n,
+      a.nnz(),
+      _permuted_a_col_ptrs.ptr_mut(),
+      nullptr,
+      _permuted_a_row_indices.ptr_mut(),
+      _permuted_a_values.ptr_mut(),
+    };
+    _detail::symmetric_permute(permuted_a, a, perm_inv, stack, nb_threads);
+  }
+
+  MatRef<T, I> permuted_a = id_perm ? a
+                                    : MatRef<T, I>{
+                                        from_raw_parts,
+                                        isize(n),
+                                        isize(n),
+                                        a.nnz(),
+                                        _permuted_a_col_ptrs.ptr(),
+                                        nullptr,
+                                        _permuted_a_row_indices.ptr(),
+                                        _permuted_a_values.ptr(),
+                                      };
+
+  // the columns of a supernode are assembled from the lower triangular part of
+  // the matrix, which is the transpose of the stored upper triangular part
+  auto _lower_values = stack.make_new_for_overwrite(ttag, a.nnz());
+  auto _lower_col_ptrs = stack.make_new_for_overwrite(tag, n + 1);
+  auto _lower_row_indices = stack.make_new_for_overwrite(tag, a.nnz());
+  _lower_col_ptrs.as_mut()[0] = I(0);
+  MatMut<T, I> lower{
+    from_raw_parts,
+    n,
+    n,
+    a.nnz(),
+    _lower_col_ptrs.ptr_mut(),
+    nullptr,
+    _lower_row_indices.ptr_mut(),
+    _lower_values.ptr_mut(),
+  };
+  sparse::transpose(lower, permuted_a, stack, nb_threads);
+
+  _detail::factorize_supernodal_lower(values,
+                                      row_indices,
+                                      diag_to_add,
+                                      perm,
+                                      col_ptrs,
+                                      nnz_per_col,
+                                      etree,
+                                      lower.as_const(),
+                                      stack,
+                                      nb_threads);
+}
+
+/*!
+ * Computes the stack memory requirements of
+ * `factorize_numeric_supernodal_pattern`.
+ *
+ * @param n dimension of the matrix to be factorized.
+ */
+template<typename I>
+auto
+factorize_numeric_supernodal_pattern_req(proxsuite::linalg::veg::Tag<I> tag,
+                                         isize n) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return proxsuite::linalg::veg::dynstack::StackReq::with_len(tag, n);
+}
+
+/*!
+ * Precomputes the data used by `factorize_numeric_supernodal_refactor` to
+ * factorize a matrix with the same sparsity pattern as `a`, whose values may
+ * differ. This stores the lower triangular part of the permuted matrix, which
+ * the supernodes are assembled from, along with the position in `a` of each
+ * of its elements.
+ *
+ * @param lower_col_ptrs storage for the column pointers of the lower
+ * triangular part of the permuted matrix, of size `n + 1`
+ * @param lower_row_indices storage for its row indices, of size `a.nnz()`
+ * @param lower_sources storage for the positions in `a` of its elements, of
+ * size `a.nnz()`
+ * @param perm_inv pointer to the already computed inverse permutation, or
+ * null for the identity permutation
+ * @param a upper triangular part of the matrix to be factorized
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+factorize_numeric_supernodal_pattern(I* lower_col_ptrs,
+                                     I* lower_row_indices,
+                                     I* lower_sources,
+                                     I const* perm_inv,
+                                     SymbolicMatRef<I> a,
+                                     DynStackMut stack) noexcept
+{
+  usize n = usize(a.ncols());
+  auto _pos = stack.make_new(proxsuite::linalg::veg::Tag<I>{}, isize(n));
+  I* pos = _pos.ptr_mut();
+
+  auto new_index = [&](usize old_i) -> usize {
+    return perm_inv == nullptr ? old_i : util::zero_extend(perm_inv[old_i]);
+  };
+
+  // column counts of the lower triangular part of the permuted matrix
+  for (usize old_j = 0; old_j < n; ++old_j) {
+    usize new_j = new_index(old_j);
+    for (usize p = a.col_start(old_j); p < a.col_end(old_j); ++p) {
+      usize old_i = util::zero_extend(a.row_indices()[p]);
+      if (old_i <= old_j) {
+        usize new_i = new_index(old_i);
+        util::wrapping_inc(mut(pos[new_i < new_j ? new_i : new_j]));
+      }
+    }
+  }
+  lower_col_ptrs[0] = I(0);
+  for (usize j = 0; j < n; ++j) {
+    lower_col_ptrs[j + 1] = I(lower_col_ptrs[j] + pos[j]);
+    pos[j] = lower_col_ptrs[j];
+  }
+
+  for (usize old_j = 0; old_j < n; ++old_j) {
+    usize new_j = new_index(old_j);
+    for (usize p = a.col_start(old_j); p < a.col_end(old_j); ++p) {
+      usize old_i = util::zero_extend(a.row_indices()[p]);
+      if (old_i <= old_j) {
+        usize new_i = new_index(old_i);
+        usize col = new_i < new_j ? new_i : new_j;
+        usize q = util::zero_extend(pos[col]);
+        lower_row_indices[q] = I(new_i < new_j ? new_j : new_i);
+        lower_sources[q] = I(p);
+        util::wrapping_inc(mut(pos[col]));
+      }
+    }
+  }
+}
+
+/*!
+ * Computes the stack memory requirements of
+ * `factorize_numeric_supernodal_refactor`.
+ *
+ * @param n dimension of the matrix to be factorized.
+ * @param a_nnz number of non zeros of the matrix to be factorized.
+ * @param max_col_count upper bound on the number of non zeros of each column
+ * of the factor, including the diagonal.
+ * @param nb_threads number of threads used by the factorization.
+ */
+template<typename T, typename I>
+auto
+factorize_numeric_supernodal_refactor_req(proxsuite::linalg::veg::Tag<T> ttag,
+                                          proxsuite::linalg::veg::Tag<I> itag,
+                                          isize n,
+                                          isize a_nnz,
+                                          isize max_col_count,
+                                          isize nb_threads = 1) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  return proxsuite::linalg::veg::dynstack::StackReq::with_len(ttag, a_nnz) &
+         _detail::supernodal_lower_req(
+           ttag, itag, n, max_col_count, nb_threads);
+}
+
+/*!
+ * Performs supernodal numerical `LDLT` factorization of a matrix whose
+ * sparsity pattern is the one `factorize_numeric_supernodal_pattern` was
+ * called with. The permutation and the transposition of the matrix are
+ * replaced by a gather of its values through the precomputed positions. The
+ * result is the same as the one of `factorize_numeric_supernodal`.
+ *
+ * @param values pointer to the values of the factorization
+ * @param row_indices pointer to the row indices of the factorization
+ * @param diag_to_add pointer to a vector that is added to the diagonal of the
+ * matrix during factorization, if `diag_to_add` and `perm` are both non null
+ * @param perm pointer to the pre-computed permutation that is applied to
+ * `diag`.
+ * @param col_ptrs pointer to the already computed column pointers
+ * @param nnz_per_col pointer to the already computed number of non zeros of
+ * each column of the factor, including the diagonal
+ * @param etree pointer to the already computed elimination tree
+ * @param lower_col_ptrs column pointers computed by
+ * `factorize_numeric_supernodal_pattern`
+ * @param lower_row_indices row indices computed by
+ * `factorize_numeric_supernodal_pattern`
+ * @param lower_sources positions computed by
+ * `factorize_numeric_supernodal_pattern`
+ * @param a_values pointer to the values of the matrix to be factorized
+ * @param n dimension of the matrix to be factorized
+ * @param stack temporary allocation stack
+ * @param nb_threads number of threads used by the factorization, must be the
+ * same as the one the memory requirements were computed with
+ */
+template<typename T, typename I>
+void
+factorize_numeric_supernodal_refactor( //
+  T* values,
+  I* row_indices,
+  proxsuite::linalg::veg::DoNotDeduce<T const*> diag_to_add,
+  proxsuite::linalg::veg::DoNotDeduce<I const*> perm,
+  I const* col_ptrs,
+  I const* nnz_per_col,
+  I const* etree,
+  I const* lower_col_ptrs,
+  I const* lower_row_indices,
+  I const* lower_sources,
+  T const* a_values,
+  isize n,
+  DynStackMut stack,
+  isize nb_threads = 1) noexcept(false)
+{
+  isize nnz = isize(util::zero_extend(lower_col_ptrs[n]));
+  auto _lower_values =
+    stack.make_new_for_overwrite(proxsuite::linalg::veg::Tag<T>{}, nnz);
+  T* lower_values = _lower_values.ptr_mut();
+  for (usize p = 0; p < usize(nnz); ++p) {
+    lower_values[p] = a_values[util::zero_extend(lower_sources[p])];
+  }
+
+  _detail::factorize_supernodal_lower(values,
+                                      row_indices,
+                                      diag_to_add,
+                                      perm,
+                                      col_ptrs,
+                                      nnz_per_col,
+                                      etree,
+                                      MatRef<T, I>{
+                                        from_raw_parts,
+                                        n,
+                                        n,
+                                        nnz,
+                                        lower_col_ptrs,
+                                        nullptr,
+                                        lower_row_indices,
+                                        lower_values,
+                                      },
+                                      stack,
+                                      nb_threads);
+}
+} // namespace sparse
+} // namespace linalg
+} // namespace proxsuite
+#endif /* end of include guard PROXSUITE_LINALG_SPARSE_LDLT_SUPERNODAL_HPP */
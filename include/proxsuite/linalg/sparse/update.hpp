@@ -158,6 +158,84 @@ merge_second_col_into_first( //
   };
 }
 
+namespace _detail {
+// merges the pattern of an update vector with sorted permuted row indices
+// into the columns of the factor along its path in the elimination tree, and
+// updates the elimination tree accordingly
+template<typename T, typename I>
+void
+rank1_update_symbolic(MatMut<T, I>& ld,
+                      I* etree,
+                      I const* w_permuted_indices,
+                      isize w_nnz,
+                      I* difference_storage,
+                      I* difference_backup_storage,
+                      DynStackMut stack) noexcept(false)
+{
+  auto sx = util::sign_extend;
+  auto zx = util::zero_extend;
+
+  usize current_col = zx(w_permuted_indices[0]);
+
+  auto merge_col = w_permuted_indices;
+  isize merge_col_len = w_nnz;
+  I* difference = difference_storage;
+
+  while (true) {
+    usize old_parent = sx(etree[isize(current_col)]);
+
+    usize current_ptr_idx = zx(ld.col_ptrs()[isize(current_col)]);
+    usize next_ptr_idx = zx(ld.col_ptrs()[isize(current_col) + 1]);
+
+    VEG_BIND(auto,
+             (_, new_current_col, computed_difference),
+             sparse::merge_second_col_into_first(
+               difference,
+               ld.values_mut() + (current_ptr_idx + 1),
+               ld.row_indices_mut() + (current_ptr_idx + 1),
+               isize(next_ptr_idx - current_ptr_idx),
+               isize(zx(ld.nnz_per_col()[isize(current_col)])) - 1,
+               proxsuite::linalg::veg::Slice<I>{
+                 unsafe, from_raw_parts, merge_col, merge_col_len },
+               I(current_col),
+               true,
+               stack));
+
+    (void)_;
+    ld._set_nnz(ld.nnz() + new_current_col.len() + 1 -
+                isize(ld.nnz_per_col()[isize(current_col)]));
+    ld.nnz_per_col_mut()[isize(current_col)] = I(new_current_col.len() + 1);
+
+    usize new_parent =
+      (new_current_col.len() == 0) ? usize(-1) : sx(new_current_col[0]);
+
+    if (new_parent == usize(-1)) {
+      break;
+    }
+
+    if (new_parent == old_parent) {
+      // the pattern of the rest of the path is left unchanged
+      if (computed_difference.len() == 0) {
+        break;
+      }
+      merge_col = computed_difference.ptr();
+      merge_col_len = computed_difference.len();
+      // the next difference must not overwrite the one being merged
+      difference = (difference == difference_storage)
+                     ? difference_backup_storage
+                     : difference_storage;
+    } else {
+      merge_col = new_current_col.ptr();
+      merge_col_len = new_current_col.len();
+      difference = difference_storage;
+      etree[isize(current_col)] = I(new_parent);
+    }
+
+    current_col = new_parent;
+  }
+}
+} // namespace _detail
+
 /*!
  * Computes the memory requirements for rank one update.
  *
@@ -235,68 +313,26 @@ rank1_update(MatMut<T, I> ld,
     std::sort(pw_permuted_indices, pw_permuted_indices + w.nnz());
   }
 
-  auto sx = util::sign_extend;
-  auto zx = util::zero_extend;
   // symbolic update
   {
-    usize current_col = zx(w_permuted_indices[0]);
+    usize current_col = util::zero_extend(w_permuted_indices[0]);
 
     auto _difference =
       stack.make_new_for_overwrite(tag, isize(n - current_col));
     auto _difference_backup =
       stack.make_new_for_overwrite(tag, isize(n - current_col));
 
-    auto merge_col = w_permuted_indices;
-    isize merge_col_len = w.nnz();
-    I* difference = _difference.ptr_mut();
-
-    while (true) {
-      usize old_parent = sx(etree[isize(current_col)]);
-
-      usize current_ptr_idx = zx(ld.col_ptrs()[isize(current_col)]);
-      usize next_ptr_idx = zx(ld.col_ptrs()[isize(current_col) + 1]);
-
-      VEG_BIND(auto,
-               (_, new_current_col, computed_difference),
-               sparse::merge_second_col_into_first(
-                 difference,
-                 ld.values_mut() + (current_ptr_idx + 1),
-                 ld.row_indices_mut() + (current_ptr_idx + 1),
-                 isize(next_ptr_idx - current_ptr_idx),
-                 isize(zx(ld.nnz_per_col()[isize(current_col)])) - 1,
-                 proxsuite::linalg::veg::Slice<I>{
-                   unsafe, from_raw_parts, merge_col, merge_col_len },
-                 I(current_col),
-                 true,
-                 stack));
-
-      (void)_;
-      ld._set_nnz(ld.nnz() + new_current_col.len() + 1 -
-                  isize(ld.nnz_per_col()[isize(current_col)]));
-      ld.nnz_per_col_mut()[isize(current_col)] = I(new_current_col.len() + 1);
-
-      usize new_parent =
-        (new_current_col.len() == 0) ? usize(-1) : sx(new_current_col[0]);
-
-      if (new_parent == usize(-1)) {
-        break;
-      }
-
-      if (new_parent == old_parent) {
-        merge_col = computed_difference.ptr();
-        merge_col_len = computed_difference.len();
-        difference = _difference_backup.ptr_mut();
-      } else {
-        merge_col = new_current_col.ptr();
-        merge_col_len = new_current_col.len();
-        difference = _difference.ptr_mut();
-        etree[isize(current_col)] = I(new_parent);
-      }
-
-      current_col = new_parent;
-    }
+    _detail::rank1_update_symbolic(ld,
+                                   etree,
+                                   w_permuted_indices,
+                                   w.nnz(),
+                                   _difference.ptr_mut(),
+                                   _difference_backup.ptr_mut(),
+                                   stack);
   }
 
+  auto sx = util::sign_extend;
+  auto zx = util::zero_extend;
   // numerical update
   {
     usize first_col = zx(w_permuted_indices[0]);
@@ -341,6 +377,239 @@ rank1_update(MatMut<T, I> ld,
 
   return ld;
 }
+
+namespace _detail {
+// number of update columns whose numerical updates share a single traversal of
+// the factor
+constexpr isize rank_r_update_block_size = 8;
+} // namespace _detail
+
+/*!
+ * Computes the memory requirements for multiple rank update.
+ *
+ * @param n dimension of matrix
+ * @param id_perm whether the permutation is implicitly the identity or not
+ * @param rank number of columns of the update matrix
+ * @param w_nnz number of nnz elts in the update matrix
+ */
+template<typename T, typename I>
+auto
+rank_r_update_req( //
+  proxsuite::linalg::veg::Tag<T> /*tag*/,
+  proxsuite::linalg::veg::Tag<I> /*tag*/,
+  isize n,
+  bool id_perm,
+  isize rank,
+  isize w_nnz) noexcept -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  isize block_size = rank < _detail::rank_r_update_block_size
+                       ? rank
+                       : _detail::rank_r_update_block_size;
+
+  StackReq permuted_indices = { id_perm ? 0 : (w_nnz * isize{ sizeof(I) }),
+                                isize{ alignof(I) } };
+  StackReq difference = { n * isize{ sizeof(I) }, isize{ alignof(I) } };
+  difference = difference & difference;
+
+  StackReq merge = sparse::merge_second_col_into_first_req(
+    proxsuite::linalg::veg::Tag<I>{}, n);
+
+  StackReq numerical_workspace =
+    StackReq{ n * block_size * isize{ sizeof(T) }, isize{ alignof(T) } } &
+    StackReq{ n * isize{ sizeof(I) }, isize{ alignof(I) } } &
+    StackReq{ n * isize{ sizeof(bool) }, isize{ alignof(bool) } };
+
+  return permuted_indices & ((difference & merge) | numerical_workspace);
+}
+
+/*!
+ * Performs a multiple rank update in place. Given ldlt factor l, and d, of a
+ * matrix a, this computes the ldlt factors of a + w diag(alpha) w.T, where w
+ * has `rank` columns. It returns a view on the updated factors.
+ * The result is the same as that of applying `rank1_update` with each column
+ * of w in turn, but the numerical updates of up to
+ * `_detail::rank_r_update_block_size` columns are applied together, during a
+ * single traversal of the union of their paths in the elimination tree.
+ *
+ * @param ld : ldlt factors of a (lower triangular with d on the diagonal)
+ * @param etree pointer to the elimination tree
+ * @param perm_inv pointer to inverse permutation (for ex AMD). If this is null,
+ * the permutation is assumed to be the identity.
+ * @param w is the update matrix, with sorted row indices if the permutation is
+ * the identity
+ * @param alpha pointer to the update coefficients, one for each column of w
+ * @param stack is the memory stack
+ */
+template<typename T, typename I>
+auto
+rank_r_update(MatMut<T, I> ld,
+              I* etree,
+              I const* perm_inv,
+              MatRef<T, I> w,
+              T const* alpha,
+              DynStackMut stack) noexcept(false) -> MatMut<T, I>
+{
+  VEG_ASSERT(!ld.is_compressed());
+
+  proxsuite::linalg::veg::Tag<I> tag;
+  usize n = usize(ld.ncols());
+  usize rank = usize(w.ncols());
+  bool id_perm = perm_inv == nullptr;
+
+  auto sx = util::sign_extend;
+  auto zx = util::zero_extend;
+
+  // permuted and sorted row indices of the columns of w, stored contiguously
+  VEG_ASSERT(id_perm || w.is_compressed());
+  auto _w_permuted_indices =
+    stack.make_new_for_overwrite(tag, id_perm ? isize(0) : w.nnz());
+  if (!id_perm) {
+    I* pw_permuted_indices = _w_permuted_indices.ptr_mut();
+    usize pos = 0;
+    for (usize k = 0; k < rank; ++k) {
+      usize col_start = pos;
+      for (usize p = w.col_start(k); p < w.col_end(k); ++p) {
+        pw_permuted_indices[pos] = perm_inv[zx(w.row_indices()[p])];
+        ++pos;
+      }
+      std::sort(pw_permuted_indices + col_start, pw_permuted_indices + pos);
+    }
+  }
+  auto w_permuted_indices = [&](usize k) -> I const* {
+    return id_perm ? (w.row_indices() + w.col_start(k))
+                   : (_w_permuted_indices.ptr() +
+                      (w.col_start(k) - w.col_start(0)));
+  };
+
+  // symbolic update, column by column
+  {
+    auto _difference = stack.make_new_for_overwrite(tag, isize(n));
+    auto _difference_backup = stack.make_new_for_overwrite(tag, isize(n));
+    for (usize k = 0; k < rank; ++k) {
+      isize col_nnz = isize(w.col_end(k) - w.col_start(k));
+      if (col_nnz == 0) {
+        continue;
+      }
+      _detail::rank1_update_symbolic(ld,
+                                     etree,
+                                     w_permuted_indices(k),
+                                     col_nnz,
+                                     _difference.ptr_mut(),
+                                     _difference_backup.ptr_mut(),
+                                     stack);
+    }
+  }
+
+  // numerical update, by blocks of columns
+  {
+    usize block_size = usize(_detail::rank_r_update_block_size);
+    if (rank < block_size) {
+      block_size = rank;
+    }
+    auto _work = stack.make_new_for_overwrite(proxsuite::linalg::veg::Tag<T>{},
+                                              isize(n * block_size));
+    auto _path = stack.make_new_for_overwrite(tag, isize(n));
+    auto _visited =
+      stack.make_new(proxsuite::linalg::veg::Tag<bool>{}, isize(n));
+    // the k-th element of the block at row i is stored at i * block_size + k
+    T* pwork = _work.ptr_mut();
+    I* ppath = _path.ptr_mut();
+    bool* visited = _visited.ptr_mut();
+
+    I const* pldi = ld.row_indices();
+    T* pldx = ld.values_mut();
+
+    T block_alpha[_detail::rank_r_update_block_size];
+    T block_w0[_detail::rank_r_update_block_size];
+    T block_beta[_detail::rank_r_update_block_size];
+    usize block_k[_detail::rank_r_update_block_size];
+
+    for (usize k0 = 0; k0 < rank; k0 += block_size) {
+      usize k1 = (rank - k0) < block_size ? rank : k0 + block_size;
+
+      // union of the paths of the columns of the block, from their first
+      // element to the root of the elimination tree
+      usize path_len = 0;
+      for (usize k = k0; k < k1; ++k) {
+        if (w.col_end(k) == w.col_start(k)) {
+          continue;
+        }
+        for (usize col = zx(w_permuted_indices(k)[0]);
+             col != usize(-1) && !visited[col];
+             col = sx(etree[isize(col)])) {
+          visited[col] = true;
+          ppath[path_len] = I(col);
+          ++path_len;
+        }
+      }
+      // the columns of the factor are traversed in increasing order, which is
+      // a topological order of each path
+      std::sort(ppath, ppath + path_len);
+
+      for (usize q = 0; q < path_len; ++q) {
+        usize col = zx(ppath[q]);
+        visited[col] = false;
+        for (usize k = 0; k < block_size; ++k) {
+          pwork[col * block_size + k] = 0;
+        }
+      }
+      for (usize k = k0; k < k1; ++k) {
+        block_alpha[k - k0] = alpha[k];
+        for (usize p = w.col_start(k); p < w.col_end(k); ++p) {
+          usize i = zx(w.row_indices()[p]);
+          pwork[(id_perm ? i : zx(perm_inv[i])) * block_size + (k - k0)] =
+            w.values()[p];
+        }
+      }
+
+      for (usize q = 0; q < path_len; ++q) {
+        usize col = zx(ppath[q]);
+        auto col_start = ld.col_start(col);
+        auto col_end = ld.col_end(col);
+        T* pwork_col = pwork + col * block_size;
+
+        // the updates of the block are applied to the diagonal in order, the
+        // columns whose path does not contain col being left unchanged
+        usize active_count = 0;
+        T d = pldx[col_start];
+        for (usize k = 0; k < k1 - k0; ++k) {
+          T w0 = pwork_col[k];
+          if (w0 == T(0)) {
+            continue;
+          }
+          T new_d = d + block_alpha[k] * w0 * w0;
+          T beta = block_alpha[k] * w0 / new_d;
+          block_alpha[k] = block_alpha[k] - new_d * beta * beta;
+          d = new_d;
+          pwork_col[k] = 0;
+
+          block_w0[active_count] = w0;
+          block_beta[active_count] = beta;
+          block_k[active_count] = k;
+          ++active_count;
+        }
+        pldx[col_start] = d;
+        if (active_count == 0) {
+          continue;
+        }
+
+        for (usize p = col_start + 1; p < col_end; ++p) {
+          T* pwork_row = pwork + zx(pldi[p]) * block_size;
+          T tmp = pldx[p];
+          for (usize a = 0; a < active_count; ++a) {
+            T& wi = pwork_row[block_k[a]];
+            wi = wi - block_w0[a] * tmp;
+            tmp = tmp + block_beta[a] * wi;
+          }
+          pldx[p] = tmp;
+        }
+      }
+    }
+  }
+
+  return ld;
+}
 } // namespace sparse
 } // namespace linalg
 } // namespace proxsuite
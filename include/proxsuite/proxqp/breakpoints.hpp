@@ -0,0 +1,250 @@
+//
+// Copyright (c) 2022 INRIA
+//
+/**
+ * @file breakpoints.hpp
+ */
+#ifndef PROXSUITE_PROXQP_BREAKPOINTS_HPP
+#define PROXSUITE_PROXQP_BREAKPOINTS_HPP
+
+#include <proxsuite/linalg/veg/type_traits/core.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace proxsuite {
+namespace proxqp {
+namespace detail {
+
+/*!
+ * Interval of the exact primal-dual line search that contains the step size
+ * cancelling the derivative of the merit function.
+ *
+ * @param alpha_last_neg largest breakpoint with a negative derivative, or zero.
+ * @param last_neg_grad derivative at alpha_last_neg, or zero.
+ * @param alpha_first_pos smallest breakpoint with a non negative derivative, or
+ * infinity if there is none.
+ * @param first_pos_grad derivative at alpha_first_pos, or zero.
+ */
+template<typename T>
+struct BreakpointBracket
+{
+  T alpha_last_neg;
+  T last_neg_grad;
+  T alpha_first_pos;
+  T first_pos_grad;
+};
+
+/*!
+ * Finds the first breakpoint of the exact primal-dual line search at which the
+ * derivative of the merit function is non negative.
+ *
+ * Between two breakpoints, the derivative is the affine function a * alpha + b,
+ * and the inequality constraint i contributes to a and b according to whether
+ * res_lo[i] + alpha * cdx[i] < 0 and res_up[i] + alpha * cdx[i] > 0. Each of
+ * these tests changes at most once along alpha, at a position of the sorted
+ * breakpoints found by bisection, so that a and b are updated incrementally
+ * instead of being recomputed at each breakpoint. The breakpoints are sorted
+ * lazily, in prefixes of doubling length, since the search usually stops
+ * early.
+ *
+ * The derivative is evaluated at the same breakpoints with the same tests as
+ * when it is recomputed from scratch at each one of them. Since the running
+ * coefficients accumulate rounding errors, the derivative is recomputed from
+ * scratch at the breakpoint where the sweep stops and at the one before it,
+ * and the breakpoints are scanned from scratch in the rare case where this
+ * contradicts the sweep, so that the bracket is the one obtained by
+ * recomputing the derivative at each breakpoint.
+ *
+ * @param alphas breakpoints, reordered by the function.
+ * @param n_alpha number of breakpoints, at least one.
+ * @param res_lo lower residual of the inequality constraints.
+ * @param res_up upper residual of the inequality constraints.
+ * @param cdx product of the constraint matrix and the primal step.
+ * @param n_in number of inequality constraints.
+ * @param derivative computes the coefficients .a and .b of the derivative at a
+ * given step size from scratch.
+ * @param contribution contribution(i, lo_active, up_active, a, b) stores in a
+ * and b the contribution of the constraint i to the coefficients of the
+ * derivative.
+ * @param da storage for the updates of a at each breakpoint, of size n_alpha.
+ * @param db storage for the updates of b at each breakpoint, of size n_alpha.
+ * @param state storage for the tests of each constraint, of size n_in.
+ */
+template<typename T, typename Derivative, typename Contribution>
+auto
+breakpoint_sweep(T* alphas,
+                 proxsuite::linalg::veg::isize n_alpha,
+                 T const* res_lo,
+                 T const* res_up,
+                 T const* cdx,
+                 proxsuite::linalg::veg::isize n_in,
+                 Derivative derivative,
+                 Contribution contribution,
+                 T* da,
+                 T* db,
+                 unsigned char* state) -> BreakpointBracket<T>
+{
+  using proxsuite::linalg::veg::isize;
+
+  constexpr unsigned char lo_bit = 1;
+  constexpr unsigned char up_bit = 2;
+  constexpr isize min_prefix = 16;
+
+  auto tests_at = [&](isize i, T alpha) -> unsigned char {
+    return static_cast<unsigned char>(
+      ((res_lo[i] + alpha * cdx[i] < T(0)) ? lo_bit : 0) |
+      ((res_up[i] + alpha * cdx[i] > T(0)) ? up_bit : 0));
+  };
+  // first position in [begin, end) where the test `bit` differs from `old`
+  auto first_change = [&](isize i,
+                          unsigned char bit,
+                          unsigned char old,
+                          isize begin,
+                          isize end) -> isize {
+    while (begin < end) {
+      isize mid = begin + (end - begin) / 2;
+      if ((tests_at(i, alphas[mid]) & bit) == old) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return begin;
+  };
+  auto transition =
+    [&](isize k, isize i, unsigned char from, unsigned char to) {
+      T a_from(0);
+      T b_from(0);
+      T a_to(0);
+      T b_to(0);
+      contribution(
+        i, (from & lo_bit) != 0, (from & up_bit) != 0, a_from, b_from);
+      contribution(i, (to & lo_bit) != 0, (to & up_bit) != 0, a_to, b_to);
+      da[k] += a_to - a_from;
+      db[k] += b_to - b_from;
+    };
+
+  BreakpointBracket<T> bracket{
+    T(0),
+    T(0),
+    std::numeric_limits<T>::infinity(),
+    T(0),
+  };
+  // position of alpha_last_neg in the sorted breakpoints
+  isize k_last_neg = -1;
+
+  // scans the sorted breakpoints [0, end) recomputing the derivative from
+  // scratch at each one of them
+  auto scan = [&](isize end) -> BreakpointBracket<T> {
+    BreakpointBracket<T> exact{
+      T(0),
+      T(0),
+      std::numeric_limits<T>::infinity(),
+      T(0),
+    };
+    for (isize k = 0; k < end; ++k) {
+      if (k > 0 && alphas[k] == alphas[k - 1]) {
+        continue;
+      }
+      T grad = derivative(alphas[k]).grad;
+      if (grad < T(0)) {
+        exact.alpha_last_neg = alphas[k];
+        exact.last_neg_grad = grad;
+      } else {
+        exact.alpha_first_pos = alphas[k];
+        exact.first_pos_grad = grad;
+        break;
+      }
+    }
+    return exact;
+  };
+  // confirms the sign of the derivative at alpha_last_neg from scratch
+  auto confirm = [&](isize end) -> BreakpointBracket<T> {
+    if (k_last_neg > 0) {
+      T grad = derivative(bracket.alpha_last_neg).grad;
+      if (grad >= T(0)) {
+        return scan(end);
+      }
+      bracket.last_neg_grad = grad;
+    }
+    return bracket;
+  };
+
+  T a(0);
+  T b(0);
+  isize n_sorted = 0;
+  while (n_sorted < n_alpha) {
+    isize n_new = std::min(n_alpha, std::max(2 * n_sorted, min_prefix));
+    std::partial_sort(alphas + n_sorted, alphas + n_new, alphas + n_alpha);
+    std::fill(da + n_sorted, da + n_new, T(0));
+    std::fill(db + n_sorted, db + n_new, T(0));
+
+    isize begin = n_sorted;
+    if (n_sorted == 0) {
+      auto res = derivative(alphas[0]);
+      a = res.a;
+      b = res.b;
+      for (isize i = 0; i < n_in; ++i) {
+        state[i] = tests_at(i, alphas[0]);
+      }
+      begin = 1;
+    }
+
+    // the tests that changed within the new prefix are located by bisection
+    T alpha_end = alphas[n_new - 1];
+    for (isize i = 0; i < n_in; ++i) {
+      unsigned char old = state[i];
+      unsigned char end = tests_at(i, alpha_end);
+      if (end == old) {
+        continue;
+      }
+      unsigned char changed = static_cast<unsigned char>(old ^ end);
+      isize k_lo = (changed & lo_bit) != 0
+                     ? first_change(i, lo_bit, old & lo_bit, begin, n_new)
+                     : n_new;
+      isize k_up = (changed & up_bit) != 0
+                     ? first_change(i, up_bit, old & up_bit, begin, n_new)
+                     : n_new;
+      isize k_first = std::min(k_lo, k_up);
+      unsigned char mid = tests_at(i, alphas[k_first]);
+      transition(k_first, i, old, mid);
+      if (mid != end) {
+        transition(std::max(k_lo, k_up), i, mid, end);
+      }
+      state[i] = end;
+    }
+
+    for (isize k = n_sorted; k < n_new; ++k) {
+      a += da[k];
+      b += db[k];
+      if (k > 0 && alphas[k] == alphas[k - 1]) {
+        continue;
+      }
+      T alpha = alphas[k];
+      T grad = a * alpha + b;
+      if (grad >= T(0) && k > 0) {
+        auto res = derivative(alpha);
+        a = res.a;
+        b = res.b;
+        grad = res.grad;
+      }
+      if (grad < T(0)) {
+        bracket.alpha_last_neg = alpha;
+        bracket.last_neg_grad = grad;
+        k_last_neg = k;
+      } else {
+        bracket.alpha_first_pos = alpha;
+        bracket.first_pos_grad = grad;
+        return confirm(k);
+      }
+    }
+    n_sorted = n_new;
+  }
+  return confirm(n_alpha);
+}
+
+} // namespace detail
+} // namespace proxqp
+} // namespace proxsuite
+
+#endif /* end of include guard PROXSUITE_PROXQP_BREAKPOINTS_HPP */
@@ -55,11 +55,31 @@ compute_equality_constrained_initial_guess(Workspace<T>& qpwork,
   qpwork.rhs.setZero();
 }
 
+/*!
+ * Selects the storage and the precision of the KKT factorization according to
+ * the settings, if they differ from the current ones.
+ *
+ * @param qpwork workspace of the solver.
+ * @param qpsettings settings of the solver.
+ */
+template<typename T>
+void
+select_ldl_storage(Workspace<T>& qpwork, const Settings<T>& qpsettings)
+{
+  bool use_f32 = qpsettings.mixed_precision_factorization &&
+                 sizeof(T) > sizeof(proxsuite::linalg::dense::f32) &&
+                 !qpwork.ldl_f32_stalled;
+  if (use_f32 != qpwork.ldl_use_f32 ||
+      qpsettings.packed_factorization != qpwork.ldl_is_packed()) {
+    qpwork.set_ldl_storage(qpsettings.packed_factorization, use_f32);
+  }
+}
 /*!
  * Setups and performs the first factorization of the regularized KKT matrix of
  * the problem.
  *
  * @param qpwork workspace of the solver.
+ * @param qpsettings settings of the solver.
  * @param qpmodel QP problem model as defined by the user (without any scaling
  * performed).
  * @param qpresults solution results.
@@ -67,9 +87,11 @@ compute_equality_constrained_initial_guess(Workspace<T>& qpwork,
 template<typename T>
 void
 setup_factorization(Workspace<T>& qpwork,
+                    const Settings<T>& qpsettings,
                     const Model<T>& qpmodel,
                     Results<T>& qpresults)
 {
+  select_ldl_storage(qpwork, qpsettings);
 
   proxsuite::linalg::veg::dynstack::DynStackMut stack{
     proxsuite::linalg::veg::from_slice_mut,
@@ -87,7 +109,7 @@ setup_factorization(Workspace<T>& qpwork,
     .segment(qpmodel.dim, qpmodel.n_eq)
     .setConstant(-qpresults.info.mu_eq);
 
-  qpwork.ldl.factorize(qpwork.kkt.transpose(), stack);
+  qpwork.ldl_factorize(qpwork.kkt.transpose(), stack, qpsettings.nb_threads);
 }
 /*!
  * Performs the equilibration of the QP problem for reducing its
@@ -126,6 +148,7 @@ setup_equilibration(Workspace<T>& qpwork,
                          qpsettings.preconditioner_accuracy,
                          stack);
   qpwork.correction_guess_rhs_g = infty_norm(qpwork.g_scaled);
+  qpwork.permute_constraints();
 }
 
 /*!
@@ -10,6 +10,7 @@
 #include "proxsuite/proxqp/results.hpp"
 #include "proxsuite/proxqp/dense/workspace.hpp"
 #include "proxsuite/proxqp/settings.hpp"
+#include "proxsuite/proxqp/breakpoints.hpp"
 #include <cmath>
 
 namespace proxsuite {
@@ -197,7 +198,7 @@ primal_dual_ls(const Model<T>& qpmodel,
    * C(x+alpha dx) - l + ze/mu_in = 0
    * C(x+alpha dx) - u + ze/mu_in = 0
    *
-   * 1.2/ Sort the alpha
+   * 1.2/ Sort the alpha, lazily
    * 2/
    * 2.1
    * For each positive alpha compute the first derivative of
@@ -256,18 +257,9 @@ primal_dual_ls(const Model<T>& qpmodel,
 
   isize n_alpha = qpwork.alphas.len();
 
-  // 1.2 sort the alphas
-
-  std::sort(qpwork.alphas.ptr_mut(), qpwork.alphas.ptr_mut() + n_alpha);
-  isize new_len = std::unique( //
-                    qpwork.alphas.ptr_mut(),
-                    qpwork.alphas.ptr_mut() + n_alpha) -
-                  qpwork.alphas.ptr_mut();
-  qpwork.alphas.resize(new_len);
-
-  n_alpha = qpwork.alphas.len();
-
-  if (n_alpha == 0 || qpwork.alphas[0] > 1) {
+  if (n_alpha == 0 ||
+      *std::min_element(qpwork.alphas.ptr(), qpwork.alphas.ptr() + n_alpha) >
+        1) {
     qpwork.alpha = 1;
     return;
   }
@@ -275,40 +267,67 @@ primal_dual_ls(const Model<T>& qpmodel,
   ////////// STEP 2 ///////////
   auto infty = std::numeric_limits<T>::infinity();
 
+  /*
+   * 2.1
+   * For each positive alpha compute the first derivative of
+   * phi(alpha) = [proximal augmented lagrangian of the
+   *               subproblem evaluated at x_k + alpha dx]
+   *
+   * (By construction for alpha = 0,  phi'(alpha) <= 0 and
+   * phi'(alpha) goes to infinity with alpha hence it cancels
+   * uniquely at one optimal alpha*
+   *
+   * while phi'(alpha)<=0 store the derivative (noted
+   * last_grad_neg) and alpha (last_alpha_neg
+   * the first time phi'(alpha) > 0 store the derivative
+   * (noted first_grad_pos) and alpha (first_alpha_pos), and
+   * break the loop
+   *
+   * phi' is computed from scratch at the first alpha only, and then updated
+   * with the contributions of the constraints whose activity changes at each
+   * alpha, see detail::breakpoint_sweep
+   */
   T last_neg_grad = 0;
   T alpha_last_neg = 0;
   T first_pos_grad = 0;
   T alpha_first_pos = infty;
-  for (isize i = 0; i < n_alpha; ++i) {
-    alpha_ = qpwork.alphas[i];
-
-    /*
-     * 2.1
-     * For each positive alpha compute the first derivative of
-     * phi(alpha) = [proximal augmented lagrangian of the
-     *               subproblem evaluated at x_k + alpha dx]
-     *
-     * (By construction for alpha = 0,  phi'(alpha) <= 0 and
-     * phi'(alpha) goes to infinity with alpha hence it cancels
-     * uniquely at one optimal alpha*
-     *
-     * while phi'(alpha)<=0 store the derivative (noted
-     * last_grad_neg) and alpha (last_alpha_neg
-     * the first time phi'(alpha) > 0 store the derivative
-     * (noted first_grad_pos) and alpha (first_alpha_pos), and
-     * break the loop
-     */
-    T gr =
-      primal_dual_derivative_results(qpmodel, qpresults, qpwork, alpha_).grad;
-
-    if (gr < T(0)) {
-      alpha_last_neg = alpha_;
-      last_neg_grad = gr;
-    } else {
-      first_pos_grad = gr;
-      alpha_first_pos = alpha_;
-      break;
-    }
+  {
+    T mu_in = qpresults.info.mu_in;
+    T mu_in_inv = qpresults.info.mu_in_inv;
+    T nu = qpresults.info.nu;
+    auto dz = qpwork.dw_aug.tail(qpmodel.n_in);
+    auto const& res_up = qpwork.primal_residual_in_scaled_up;
+    auto const& res_low = qpwork.primal_residual_in_scaled_low;
+    auto contribution =
+      [&](isize i, bool lo_active, bool up_active, T& a, T& b) {
+        T cdx_act = (lo_active || up_active) ? qpwork.Cdx(i) : T(0);
+        T res_act = (up_active ? res_up(i) : T(0)) +
+                    (lo_active ? res_low(i) : T(0));
+        T err = cdx_act - dz(i) * mu_in;
+        a = mu_in_inv * cdx_act * cdx_act + nu * mu_in_inv * err * err;
+        b = mu_in_inv * res_act * cdx_act +
+            nu * mu_in_inv * err * (res_act - qpresults.z(i) * mu_in);
+      };
+
+    auto bracket = proxqp::detail::breakpoint_sweep(
+      qpwork.alphas.ptr_mut(),
+      n_alpha,
+      res_low.data(),
+      res_up.data(),
+      qpwork.Cdx.data(),
+      qpmodel.n_in,
+      [&](T alpha) {
+        return primal_dual_derivative_results(
+          qpmodel, qpresults, qpwork, alpha);
+      },
+      contribution,
+      qpwork.alphas_updates.ptr_mut(),
+      qpwork.alphas_updates.ptr_mut() + n_alpha,
+      qpwork.alphas_tests.ptr_mut());
+    alpha_last_neg = bracket.alpha_last_neg;
+    last_neg_grad = bracket.last_neg_grad;
+    alpha_first_pos = bracket.alpha_first_pos;
+    first_pos_grad = bracket.first_pos_grad;
   }
 
   /*
@@ -386,71 +405,91 @@ active_set_change(const Model<T>& qpmodel,
    * factorization all row index i < n_c correspond to current active indexes
    * (all other correspond to inactive rows
    *
-   * To do so,
-   * 1/ for initialization
-   * 1.1/ new_bijection_map = current_bijection_map
-   * 1.2/ n_c_f = n_
+   * The rows of C_current are reordered as follows
+   * 1/ the rows which stay active keep their relative order, and the ones
+   * which are not active anymore are deleted from the factorization
+   * 2/ the rows which become active are appended after them, by increasing
+   * constraint index, and inserted in the factorization
+   * 3/ the rows which stay inactive keep their relative order, and are
+   * followed by the ones which were just deactivated, by increasing
+   * constraint index
    *
-   * 2/ All active indexes of the current bijection map (i.e
-   * current_bijection_map(i) < n_c by assumption) which are not active
-   * anymore in the new active set (new_active_set(i)=false are put at the
-   * end of new_bijection_map, i.
-   *
-   * 2.1/ for all j if new_bijection_map(j) > new_bijection_map(i), then
-   * new_bijection_map(j)-=1
-   * 2.2/ n_c_f -=1
-   * 2.3/ new_bijection_map(i) = n_in-1
-   *
-   * 3/ All active indexe of the new active set (new_active_set(i) == true)
-   * which are not active in the new_bijection_map (new_bijection_map(i) >=
-   * n_c_f) are put at the end of the current version of C, i.e
-   * 3.1/ if new_bijection_map(j) < new_bijection_map(i) &&
-   * new_bijection_map(j) >= n_c_f then new_bijection_map(j)+=1
-   * 3.2/ new_bijection_map(i) = n_c_f
-   * 3.3/ n_c_f +=1
-   *
-   * It returns finally the new_bijection_map, for which
-   * new_bijection_map(n_in) = n_c_f
+   * The inverse of current_bijection_map gives the constraint stored at each
+   * row, so that the new_bijection_map is computed with a few linear passes,
+   * and the deleted rows come out sorted.
    */
 
   qpwork.dw_aug.setZero();
 
-  isize n_c_f = qpwork.n_c;
-  qpwork.new_bijection_map = qpwork.current_bijection_map;
-
-  // suppression pour le nouvel active set, ajout dans le nouvel unactive set
+  isize n_in = qpmodel.n_in;
+  isize n_c = qpwork.n_c;
+  isize n_c_f = 0;
 
   proxsuite::linalg::veg::dynstack::DynStackMut stack{
     proxsuite::linalg::veg::from_slice_mut, qpwork.ldl_stack.as_mut()
   };
 
+  // suppression pour le nouvel active set, ajout dans le nouvel unactive set
+
   {
     auto _planned_to_delete = stack.make_new_for_overwrite(
-      proxsuite::linalg::veg::Tag<isize>{}, isize(qpmodel.n_in));
+      proxsuite::linalg::veg::Tag<isize>{}, isize(n_in));
     isize* planned_to_delete = _planned_to_delete.ptr_mut();
     isize planned_to_delete_count = 0;
 
-    for (isize i = 0; i < qpmodel.n_in; i++) {
-      if (qpwork.current_bijection_map(i) < qpwork.n_c) {
-        if (!qpwork.active_inequalities(i)) {
-          // delete current_bijection_map(i)
+    {
+      auto _constraint_at = stack.make_new_for_overwrite(
+        proxsuite::linalg::veg::Tag<isize>{}, isize(n_in));
+      isize* constraint_at = _constraint_at.ptr_mut();
+      for (isize i = 0; i < n_in; i++) {
+        constraint_at[qpwork.current_bijection_map(i)] = i;
+      }
 
+      isize pos = 0;
+      for (isize k = 0; k < n_c; k++) {
+        isize i = constraint_at[k];
+        if (qpwork.active_inequalities(i)) {
+          qpwork.new_bijection_map(i) = pos;
+          ++pos;
+        } else {
           planned_to_delete[planned_to_delete_count] =
-            qpwork.current_bijection_map(i) + qpmodel.dim + qpmodel.n_eq;
+            k + qpmodel.dim + qpmodel.n_eq;
           ++planned_to_delete_count;
-
-          for (isize j = 0; j < qpmodel.n_in; j++) {
-            if (qpwork.new_bijection_map(j) > qpwork.new_bijection_map(i)) {
-              qpwork.new_bijection_map(j) -= 1;
-            }
-          }
-          n_c_f -= 1;
-          qpwork.new_bijection_map(i) = qpmodel.n_in - 1;
+        }
+      }
+      n_c_f = pos;
+      for (isize i = 0; i < n_in; i++) {
+        if (qpwork.active_inequalities(i) &&
+            qpwork.current_bijection_map(i) >= n_c) {
+          qpwork.new_bijection_map(i) = pos;
+          ++pos;
+        }
+      }
+      for (isize k = n_c; k < n_in; k++) {
+        isize i = constraint_at[k];
+        if (!qpwork.active_inequalities(i)) {
+          qpwork.new_bijection_map(i) = pos;
+          ++pos;
+        }
+      }
+      for (isize i = 0; i < n_in; i++) {
+        if (!qpwork.active_inequalities(i) &&
+            qpwork.current_bijection_map(i) < n_c) {
+          qpwork.new_bijection_map(i) = pos;
+          ++pos;
         }
       }
     }
-    std::sort(planned_to_delete, planned_to_delete + planned_to_delete_count);
-    qpwork.ldl.delete_at(planned_to_delete, planned_to_delete_count, stack);
+
+    // the rows of C_permuted follow the new order of the constraints
+    for (isize i = 0; i < n_in; i++) {
+      isize j = qpwork.new_bijection_map(i);
+      if (j != qpwork.current_bijection_map(i)) {
+        qpwork.C_permuted.row(j) = qpwork.C_scaled.row(i);
+      }
+    }
+
+    qpwork.ldl_delete_at(planned_to_delete, planned_to_delete_count, stack);
     if (planned_to_delete_count > 0) {
       qpwork.constraints_changed = true;
     }
@@ -459,45 +498,30 @@ active_set_change(const Model<T>& qpmodel,
   // ajout au nouvel active set, suppression pour le nouvel unactive set
 
   {
-    auto _planned_to_add = stack.make_new_for_overwrite(
-      proxsuite::linalg::veg::Tag<isize>{}, qpmodel.n_in);
-    auto planned_to_add = _planned_to_add.ptr_mut();
-
     isize planned_to_add_count = 0;
     T mu_in_neg = -qpresults.info.mu_in;
-    isize n_c = n_c_f;
-    for (isize i = 0; i < qpmodel.n_in; i++) {
-      if (qpwork.active_inequalities(i)) {
-        if (qpwork.new_bijection_map(i) >= n_c_f) {
-          // add at the end
-          planned_to_add[planned_to_add_count] = i;
-          ++planned_to_add_count;
-
-          for (isize j = 0; j < qpmodel.n_in; j++) {
-            if (qpwork.new_bijection_map(j) < qpwork.new_bijection_map(i) &&
-                qpwork.new_bijection_map(j) >= n_c_f) {
-              qpwork.new_bijection_map(j) += 1;
-            }
-          }
-          qpwork.new_bijection_map(i) = n_c_f;
-          n_c_f += 1;
-        }
+    for (isize i = 0; i < n_in; i++) {
+      if (qpwork.active_inequalities(i) &&
+          qpwork.current_bijection_map(i) >= n_c) {
+        ++planned_to_add_count;
       }
     }
+    n_c = n_c_f;
+    n_c_f += planned_to_add_count;
     {
       isize n = qpmodel.dim;
       isize n_eq = qpmodel.n_eq;
       LDLT_TEMP_MAT_UNINIT(
         T, new_cols, n + n_eq + n_c_f, planned_to_add_count, stack);
 
+      // the added rows are contiguous in C_permuted, starting at n_c
+      new_cols.topRows(n) =
+        qpwork.C_permuted.middleRows(n_c, planned_to_add_count).transpose();
+      new_cols.bottomRows(n_eq + n_c_f).setZero();
       for (isize k = 0; k < planned_to_add_count; ++k) {
-        isize index = planned_to_add[k];
-        auto col = new_cols.col(k);
-        col.head(n) = (qpwork.C_scaled.row(index));
-        col.tail(n_eq + n_c_f).setZero();
-        col[n + n_eq + n_c + k] = mu_in_neg;
+        new_cols(n + n_eq + n_c + k, k) = mu_in_neg;
       }
-      qpwork.ldl.insert_block_at(n + n_eq + n_c, new_cols, stack);
+      qpwork.ldl_insert_block_at(n + n_eq + n_c, new_cols, stack);
     }
     if (planned_to_add_count > 0) {
       qpwork.constraints_changed = true;
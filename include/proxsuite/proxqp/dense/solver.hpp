@@ -29,6 +29,7 @@ namespace dense {
 /*!
  * Performs a refactorization of the KKT matrix used by the solver.
  *
+ * @param qpsettings solver settings.
  * @param qpwork solver workspace.
  * @param qpmodel QP problem model as defined by the user (without any scaling
  * performed).
@@ -37,7 +38,8 @@ namespace dense {
  */
 template<typename T>
 void
-refactorize(const Model<T>& qpmodel,
+refactorize(const Settings<T>& qpsettings,
+            const Model<T>& qpmodel,
             Results<T>& qpresults,
             Workspace<T>& qpwork,
             T rho_new)
@@ -53,28 +55,22 @@ refactorize(const Model<T>& qpmodel,
   qpwork.kkt.diagonal().segment(qpmodel.dim, qpmodel.n_eq).array() =
     -qpresults.info.mu_eq;
 
+  select_ldl_storage(qpwork, qpsettings);
   proxsuite::linalg::veg::dynstack::DynStackMut stack{
     proxsuite::linalg::veg::from_slice_mut, qpwork.ldl_stack.as_mut()
   };
-  qpwork.ldl.factorize(qpwork.kkt.transpose(), stack);
+  qpwork.ldl_factorize(qpwork.kkt.transpose(), stack, qpsettings.nb_threads);
 
   isize n = qpmodel.dim;
   isize n_eq = qpmodel.n_eq;
-  isize n_in = qpmodel.n_in;
   isize n_c = qpwork.n_c;
 
   LDLT_TEMP_MAT(T, new_cols, n + n_eq + n_c, n_c, stack);
   T mu_in_neg = -qpresults.info.mu_in;
-  for (isize i = 0; i < n_in; ++i) {
-    isize j = qpwork.current_bijection_map[i];
-    if (j < n_c) {
-      auto col = new_cols.col(j);
-      col.head(n) = qpwork.C_scaled.row(i);
-      col.segment(n, n_eq + n_c).setZero();
-      col(n + n_eq + j) = mu_in_neg;
-    }
-  }
-  qpwork.ldl.insert_block_at(n + n_eq, new_cols, stack);
+  new_cols.topRows(n) = qpwork.C_permuted.topRows(n_c).transpose();
+  new_cols.bottomRows(n_eq + n_c).setZero();
+  new_cols.bottomRows(n_c).diagonal().setConstant(mu_in_neg);
+  qpwork.ldl_insert_block_at(n + n_eq, new_cols, stack);
 
   qpwork.constraints_changed = false;
 
@@ -126,7 +122,7 @@ mu_update(const Model<T>& qpmodel,
     for (isize k = 0; k < n_c; ++k) {
       indices[n_eq + k] = n + n_eq + k;
     }
-    qpwork.ldl.diagonal_update_clobber_indices(
+    qpwork.ldl_diagonal_update_clobber_indices(
       indices, n_eq + n_c, rank_update_alpha, stack);
   }
 
@@ -162,15 +158,16 @@ iterative_residual(const Model<T>& qpmodel,
   qpwork.err.head(qpmodel.dim).noalias() -=
     qpwork.A_scaled.transpose() *
     qpwork.dw_aug.segment(qpmodel.dim, qpmodel.n_eq);
-  for (isize i = 0; i < qpmodel.n_in; i++) {
-    isize j = qpwork.current_bijection_map(i);
-    if (j < qpwork.n_c) {
-      qpwork.err.head(qpmodel.dim).noalias() -=
-        qpwork.dw_aug(qpmodel.dim + qpmodel.n_eq + j) * qpwork.C_scaled.row(i);
-      qpwork.err(qpmodel.dim + qpmodel.n_eq + j) -=
-        (qpwork.C_scaled.row(i).dot(qpwork.dw_aug.head(qpmodel.dim)) -
-         qpwork.dw_aug(qpmodel.dim + qpmodel.n_eq + j) * qpresults.info.mu_in);
-    }
+  {
+    // the active rows of C are contiguous in C_permuted
+    auto C_active = qpwork.C_permuted.topRows(qpwork.n_c);
+    auto dz_active = qpwork.dw_aug.segment(qpmodel.dim + qpmodel.n_eq, //
+                                           qpwork.n_c);
+    auto err_active = qpwork.err.segment(qpmodel.dim + qpmodel.n_eq, //
+                                         qpwork.n_c);
+    qpwork.err.head(qpmodel.dim).noalias() -= C_active.transpose() * dz_active;
+    err_active.noalias() -= C_active * qpwork.dw_aug.head(qpmodel.dim);
+    err_active += dz_active * qpresults.info.mu_in;
   }
   qpwork.err.segment(qpmodel.dim, qpmodel.n_eq).noalias() -=
     qpwork.A_scaled * qpwork.dw_aug.head(qpmodel.dim);
@@ -204,11 +201,23 @@ iterative_solve_with_permut_fact( //
   i32 it = 0;
   i32 it_stability = 0;
 
+  if ((qpwork.constraints_changed || qpwork.ldl_use_f32) &&
+      qpwork.ldl_needs_refactorization()) {
+    // the refinement sweeps would be wasted before refactorizing anyway. this
+    // is only worth it when the factorization was updated since it was
+    // computed, or to switch to the working precision
+    if (qpwork.ldl_use_f32) {
+      qpwork.ldl_f32_stalled = true;
+      qpwork.constraints_changed = true;
+    }
+    refactorize(qpsettings, qpmodel, qpresults, qpwork, qpresults.info.rho);
+  }
+
   qpwork.dw_aug.head(inner_pb_dim) = qpwork.rhs.head(inner_pb_dim);
   proxsuite::linalg::veg::dynstack::DynStackMut stack{
     proxsuite::linalg::veg::from_slice_mut, qpwork.ldl_stack.as_mut()
   };
-  qpwork.ldl.solve_in_place(qpwork.dw_aug.head(inner_pb_dim), stack);
+  qpwork.ldl_solve_in_place(qpwork.dw_aug.head(inner_pb_dim), stack);
 
   iterative_residual<T>(qpmodel, qpresults, qpwork, inner_pb_dim);
 
@@ -228,7 +237,7 @@ iterative_solve_with_permut_fact( //
     }
 
     ++it;
-    qpwork.ldl.solve_in_place(qpwork.err.head(inner_pb_dim), stack);
+    qpwork.ldl_solve_in_place(qpwork.err.head(inner_pb_dim), stack);
     qpwork.dw_aug.head(inner_pb_dim) += qpwork.err.head(inner_pb_dim);
 
     qpwork.err.head(inner_pb_dim).setZero();
@@ -255,12 +264,21 @@ iterative_solve_with_permut_fact( //
 
   if (infty_norm(qpwork.err.head(inner_pb_dim)) >=
       std::max(eps, qpsettings.eps_refact)) {
-    refactorize(qpmodel, qpresults, qpwork, qpresults.info.rho);
+    if (qpwork.ldl_use_f32) {
+      // the refinement stalled with the single precision factorization, so the
+      // factorization is recomputed in the working precision
+      qpwork.ldl_f32_stalled = true;
+      qpwork.constraints_changed = true;
+    }
+    refactorize(qpsettings, qpmodel, qpresults, qpwork, qpresults.info.rho);
+    stack = proxsuite::linalg::veg::dynstack::DynStackMut{
+      proxsuite::linalg::veg::from_slice_mut, qpwork.ldl_stack.as_mut()
+    };
     it = 0;
     it_stability = 0;
 
     qpwork.dw_aug.head(inner_pb_dim) = qpwork.rhs.head(inner_pb_dim);
-    qpwork.ldl.solve_in_place(qpwork.dw_aug.head(inner_pb_dim), stack);
+    qpwork.ldl_solve_in_place(qpwork.dw_aug.head(inner_pb_dim), stack);
 
     iterative_residual<T>(qpmodel, qpresults, qpwork, inner_pb_dim);
 
@@ -279,7 +297,7 @@ iterative_solve_with_permut_fact( //
         break;
       }
       ++it;
-      qpwork.ldl.solve_in_place(qpwork.err.head(inner_pb_dim), stack);
+      qpwork.ldl_solve_in_place(qpwork.err.head(inner_pb_dim), stack);
       qpwork.dw_aug.head(inner_pb_dim) += qpwork.err.head(inner_pb_dim);
 
       qpwork.err.head(inner_pb_dim).setZero();
@@ -364,6 +382,8 @@ bcl_update(const Settings<T>& qpsettings,
     */
     qpresults.y = qpwork.y_prev;
     qpresults.z = qpwork.z_prev;
+    qpwork.ATy.noalias() = qpwork.A_scaled.transpose() * qpresults.y;
+    qpwork.CTz.noalias() = qpwork.C_scaled.transpose() * qpresults.z;
 
     new_bcl_mu_in = std::max(qpresults.info.mu_in * qpsettings.mu_update_factor,
                              qpsettings.mu_min_in);
@@ -521,22 +541,31 @@ primal_dual_semi_smooth_newton_step(const Settings<T>& qpsettings,
 
   qpwork.rhs.segment(qpmodel.dim, qpmodel.n_eq) =
     -qpwork.primal_residual_eq_scaled;
-  for (isize i = 0; i < qpmodel.n_in; i++) {
-    isize j = qpwork.current_bijection_map(i);
-    if (j < qpwork.n_c) {
-      if (qpwork.active_set_up(i)) {
-        qpwork.rhs(j + qpmodel.dim + qpmodel.n_eq) =
-          -qpwork.primal_residual_in_scaled_up(i) +
-          qpresults.z(i) * qpresults.info.mu_in;
-      } else if (qpwork.active_set_low(i)) {
-        qpwork.rhs(j + qpmodel.dim + qpmodel.n_eq) =
-          -qpwork.primal_residual_in_scaled_low(i) +
-          qpresults.z(i) * qpresults.info.mu_in;
+  {
+    proxsuite::linalg::veg::dynstack::DynStackMut stack{
+      proxsuite::linalg::veg::from_slice_mut, qpwork.ldl_stack.as_mut()
+    };
+    isize n_inactive = qpmodel.n_in - qpwork.n_c;
+    LDLT_TEMP_VEC_UNINIT(T, z_inactive, n_inactive, stack);
+    for (isize i = 0; i < qpmodel.n_in; i++) {
+      isize j = qpwork.current_bijection_map(i);
+      if (j < qpwork.n_c) {
+        if (qpwork.active_set_up(i)) {
+          qpwork.rhs(j + qpmodel.dim + qpmodel.n_eq) =
+            -qpwork.primal_residual_in_scaled_up(i) +
+            qpresults.z(i) * qpresults.info.mu_in;
+        } else if (qpwork.active_set_low(i)) {
+          qpwork.rhs(j + qpmodel.dim + qpmodel.n_eq) =
+            -qpwork.primal_residual_in_scaled_low(i) +
+            qpresults.z(i) * qpresults.info.mu_in;
+        }
+      } else {
+        z_inactive(j - qpwork.n_c) = qpresults.z(i);
       }
-    } else {
-      qpwork.rhs.head(qpmodel.dim) +=
-        qpresults.z(i) * qpwork.C_scaled.row(i); // unactive unrelevant columns
     }
+    // unactive unrelevant columns
+    qpwork.rhs.head(qpmodel.dim).noalias() +=
+      qpwork.C_permuted.bottomRows(n_inactive).transpose() * z_inactive;
   }
 
   iterative_solve_with_permut_fact( //
@@ -624,11 +653,8 @@ primal_dual_newton_semi_smooth(const Settings<T>& qpsettings,
     Hdx.noalias() +=
       qpwork.H_scaled.template selfadjointView<Eigen::Lower>() * dx;
 
-    Adx.noalias() += qpwork.A_scaled * dx;
-    ATdy.noalias() += qpwork.A_scaled.transpose() * dy;
-
-    Cdx.noalias() += qpwork.C_scaled * dx;
-    CTdz.noalias() += qpwork.C_scaled.transpose() * dz;
+    detail::noalias_gevmmv_add(ATdy, Adx, qpwork.A_scaled, dy, dx);
+    detail::noalias_gevmmv_add(CTdz, Cdx, qpwork.C_scaled, dz, dx);
 
     if (qpmodel.n_in > 0) {
       linesearch::primal_dual_ls(qpmodel, qpresults, qpwork);
@@ -664,6 +690,12 @@ primal_dual_newton_semi_smooth(const Settings<T>& qpsettings,
     qpwork.dual_residual_scaled +=
       alpha * (qpresults.info.rho * dx + Hdx + ATdy + CTdz);
 
+    qpwork.Hx += alpha * Hdx;
+    qpwork.Ax += alpha * Adx;
+    qpwork.Cx += alpha * Cdx;
+    qpwork.ATy += alpha * ATdy;
+    qpwork.CTz += alpha * CTdz;
+
     err_in = dense::compute_inner_loop_saddle_point(qpmodel, qpresults, qpwork);
     /* for debug
     if (qpsettings.verbose) {
@@ -838,7 +870,8 @@ qp_solve( //
       qpwork.l_scaled = qpmodel.l;
       proxsuite::proxqp::dense::setup_equilibration(
         qpwork, qpsettings, ruiz, false); // reuse previous equilibration
-      proxsuite::proxqp::dense::setup_factorization(qpwork, qpmodel, qpresults);
+      proxsuite::proxqp::dense::setup_factorization(
+        qpwork, qpsettings, qpmodel, qpresults);
     }
     switch (qpsettings.initial_guess) {
       case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
@@ -888,7 +921,7 @@ qp_solve( //
     switch (qpsettings.initial_guess) {
       case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
         proxsuite::proxqp::dense::setup_factorization(
-          qpwork, qpmodel, qpresults);
+          qpwork, qpsettings, qpmodel, qpresults);
         compute_equality_constrained_initial_guess(
           qpwork, qpsettings, qpmodel, qpresults);
         break;
@@ -904,7 +937,7 @@ qp_solve( //
           { proxsuite::proxqp::from_eigen, qpresults.y });
         ruiz.scale_dual_in_place_in(
           { proxsuite::proxqp::from_eigen, qpresults.z });
-        setup_factorization(qpwork, qpmodel, qpresults);
+        setup_factorization(qpwork, qpsettings, qpmodel, qpresults);
         qpwork.n_c = 0;
         for (isize i = 0; i < qpmodel.n_in; i++) {
           if (qpresults.z[i] != 0) {
@@ -917,7 +950,7 @@ qp_solve( //
         break;
       }
       case InitialGuessStatus::NO_INITIAL_GUESS: {
-        setup_factorization(qpwork, qpmodel, qpresults);
+        setup_factorization(qpwork, qpsettings, qpmodel, qpresults);
         break;
       }
       case InitialGuessStatus::WARM_START: {
@@ -928,7 +961,7 @@ qp_solve( //
           { proxsuite::proxqp::from_eigen, qpresults.y });
         ruiz.scale_dual_in_place_in(
           { proxsuite::proxqp::from_eigen, qpresults.z });
-        setup_factorization(qpwork, qpmodel, qpresults);
+        setup_factorization(qpwork, qpsettings, qpmodel, qpresults);
         qpwork.n_c = 0;
         for (isize i = 0; i < qpmodel.n_in; i++) {
           if (qpresults.z[i] != 0) {
@@ -954,7 +987,7 @@ qp_solve( //
         if (qpwork.refactorize) { // refactorization only when one of the
                                   // matrices has changed or one proximal
                                   // parameter has changed
-          setup_factorization(qpwork, qpmodel, qpresults);
+          setup_factorization(qpwork, qpsettings, qpmodel, qpresults);
           qpwork.n_c = 0;
           for (isize i = 0; i < qpmodel.n_in; i++) {
             if (qpresults.z[i] != 0) {
@@ -988,13 +1021,16 @@ qp_solve( //
   T duality_gap(0);
   T rhs_duality_gap(0);
 
+  // the products with the iterate are updated along the Newton steps, and
+  // computed again from scratch before the solver stops
+  compute_residual_products(qpresults, qpwork);
+  bool residual_products_exact = true;
+
   for (i64 iter = 0; iter < qpsettings.max_iter; ++iter) {
 
     // compute primal residual
 
-    // PERF: fuse matrix product computations in global_{primal, dual}_residual
     global_primal_residual(qpmodel,
-                           qpresults,
                            qpwork,
                            ruiz,
                            primal_feasibility_lhs,
@@ -1081,7 +1117,7 @@ qp_solve( //
 
         T rho_new(qpsettings.refactor_rho_threshold);
 
-        refactorize(qpmodel, qpresults, qpwork, rho_new);
+        refactorize(qpsettings, qpmodel, qpresults, qpwork, rho_new);
         qpresults.info.rho_updates += 1;
 
         qpresults.info.rho = rho_new;
@@ -1090,8 +1126,49 @@ qp_solve( //
         if (qpresults.info.duality_gap <=
             qpsettings.eps_abs +
               (qpsettings.eps_abs + qpsettings.eps_rel) * rhs_duality_gap) {
-          qpresults.info.status = QPSolverOutput::PROXQP_SOLVED;
-          break;
+          bool solved = true;
+          if (!residual_products_exact) {
+            // the criterion is checked again without the rounding errors
+            // accumulated along the Newton steps
+            compute_residual_products(qpresults, qpwork);
+            residual_products_exact = true;
+            global_primal_residual(qpmodel,
+                                   qpwork,
+                                   ruiz,
+                                   primal_feasibility_lhs,
+                                   primal_feasibility_eq_rhs_0,
+                                   primal_feasibility_in_rhs_0,
+                                   primal_feasibility_eq_lhs,
+                                   primal_feasibility_in_lhs);
+            global_dual_residual(qpresults,
+                                 qpwork,
+                                 qpmodel,
+                                 ruiz,
+                                 dual_feasibility_lhs,
+                                 dual_feasibility_rhs_0,
+                                 dual_feasibility_rhs_1,
+                                 dual_feasibility_rhs_3,
+                                 rhs_duality_gap,
+                                 duality_gap);
+            qpresults.info.pri_res = primal_feasibility_lhs;
+            qpresults.info.dua_res = dual_feasibility_lhs;
+            qpresults.info.duality_gap = duality_gap;
+            solved = global_stopping_criterion(qpsettings,
+                                               qpwork,
+                                               primal_feasibility_lhs,
+                                               primal_feasibility_eq_rhs_0,
+                                               primal_feasibility_in_rhs_0,
+                                               dual_feasibility_lhs,
+                                               dual_feasibility_rhs_0,
+                                               dual_feasibility_rhs_1,
+                                               dual_feasibility_rhs_3,
+                                               rhs_duality_gap,
+                                               duality_gap);
+          }
+          if (solved) {
+            qpresults.info.status = QPSolverOutput::PROXQP_SOLVED;
+            break;
+          }
         }
       }
     }
@@ -1103,9 +1180,7 @@ qp_solve( //
 
     // primal dual version from gill and robinson
 
-    ruiz.scale_primal_residual_in_place_in(VectorViewMut<T>{
-      from_eigen,
-      qpwork.primal_residual_in_scaled_up }); // contains now scaled(Cx)
+    // primal_residual_in_scaled_up contains scaled(Cx)
     qpwork.primal_residual_in_scaled_up +=
       qpwork.z_prev *
       qpresults.info.mu_in; // contains now scaled(Cx+z_prev*mu_in)
@@ -1117,6 +1192,7 @@ qp_solve( //
 
     primal_dual_newton_semi_smooth(
       qpsettings, qpmodel, qpresults, qpwork, ruiz, bcl_eta_in);
+    residual_products_exact = false;
 
     if (qpresults.info.status == QPSolverOutput::PROXQP_PRIMAL_INFEASIBLE ||
         qpresults.info.status == QPSolverOutput::PROXQP_DUAL_INFEASIBLE) {
@@ -1130,7 +1206,6 @@ qp_solve( //
     T primal_feasibility_lhs_new(primal_feasibility_lhs);
 
     global_primal_residual(qpmodel,
-                           qpresults,
                            qpwork,
                            ruiz,
                            primal_feasibility_lhs_new,
@@ -1173,8 +1248,49 @@ qp_solve( //
         if (qpresults.info.duality_gap <=
             qpsettings.eps_abs +
               (qpsettings.eps_abs + qpsettings.eps_rel) * rhs_duality_gap) {
-          qpresults.info.status = QPSolverOutput::PROXQP_SOLVED;
-          break;
+          bool solved = true;
+          if (!residual_products_exact) {
+            // the criterion is checked again without the rounding errors
+            // accumulated along the Newton steps
+            compute_residual_products(qpresults, qpwork);
+            residual_products_exact = true;
+            global_primal_residual(qpmodel,
+                                   qpwork,
+                                   ruiz,
+                                   primal_feasibility_lhs_new,
+                                   primal_feasibility_eq_rhs_0,
+                                   primal_feasibility_in_rhs_0,
+                                   primal_feasibility_eq_lhs,
+                                   primal_feasibility_in_lhs);
+            global_dual_residual(qpresults,
+                                 qpwork,
+                                 qpmodel,
+                                 ruiz,
+                                 dual_feasibility_lhs_new,
+                                 dual_feasibility_rhs_0,
+                                 dual_feasibility_rhs_1,
+                                 dual_feasibility_rhs_3,
+                                 rhs_duality_gap,
+                                 duality_gap);
+            qpresults.info.pri_res = primal_feasibility_lhs_new;
+            qpresults.info.dua_res = dual_feasibility_lhs_new;
+            qpresults.info.duality_gap = duality_gap;
+            solved = global_stopping_criterion(qpsettings,
+                                               qpwork,
+                                               primal_feasibility_lhs_new,
+                                               primal_feasibility_eq_rhs_0,
+                                               primal_feasibility_in_rhs_0,
+                                               dual_feasibility_lhs_new,
+                                               dual_feasibility_rhs_0,
+                                               dual_feasibility_rhs_1,
+                                               dual_feasibility_rhs_3,
+                                               rhs_duality_gap,
+                                               duality_gap);
+          }
+          if (solved) {
+            qpresults.info.status = QPSolverOutput::PROXQP_SOLVED;
+            break;
+          }
         }
       }
     }
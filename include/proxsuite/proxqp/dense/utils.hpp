@@ -10,6 +10,7 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 #include <type_traits>
 
 #include "proxsuite/helpers/common.hpp"
@@ -113,13 +114,86 @@ save_data(const std::string& filename, const ::Eigen::MatrixBase<Derived>& mat)
   }
 }
 
+namespace detail {
+
+/*!
+ * Computes out_r += a * in_r and out_l += a.transpose() * in_l with a single
+ * pass over a. The matrix is traversed by blocks of rows (of columns if it is
+ * column major) of about tile_bytes, and both products are applied to each
+ * block while it is still in cache.
+ *
+ * @param out_l output of the transposed product, of size a.cols().
+ * @param out_r output of the product, of size a.rows().
+ * @param a dense matrix.
+ * @param in_l input of the transposed product, of size a.rows().
+ * @param in_r input of the product, of size a.cols().
+ */
+template<typename OutL, typename OutR, typename A, typename InL, typename InR>
+void
+noalias_gevmmv_add(OutL&& out_l,
+                   OutR&& out_r,
+                   A const& a,
+                   InL const& in_l,
+                   InR const& in_r)
+{
+  // noalias general vector matrix matrix vector add
+  using Scalar = typename A::Scalar;
+  constexpr isize tile_bytes = 16384;
+
+  isize m = a.rows();
+  isize n = a.cols();
+  if (bool(A::IsRowMajor)) {
+    isize row_bytes = std::max(isize(1), n * isize(sizeof(Scalar)));
+    isize block = std::max(isize(1), tile_bytes / row_bytes);
+    for (isize i = 0; i < m; i += block) {
+      isize bs = std::min(block, m - i);
+      auto a_block = a.middleRows(i, bs);
+      out_r.segment(i, bs).noalias() += a_block * in_r;
+      out_l.noalias() += a_block.transpose() * in_l.segment(i, bs);
+    }
+  } else {
+    isize col_bytes = std::max(isize(1), m * isize(sizeof(Scalar)));
+    isize block = std::max(isize(1), tile_bytes / col_bytes);
+    for (isize j = 0; j < n; j += block) {
+      isize bs = std::min(block, n - j);
+      auto a_block = a.middleCols(j, bs);
+      out_r.noalias() += a_block * in_r.segment(j, bs);
+      out_l.segment(j, bs).noalias() += a_block.transpose() * in_l;
+    }
+  }
+}
+
+} // namespace detail
+
+/*!
+ * Computes from scratch the scaled products H*x, A*x, C*x, A.T*y and C.T*z of
+ * the workspace, which are then kept up to date along the Newton steps.
+ *
+ * @param qpresults solver results.
+ * @param qpwork solver workspace.
+ */
+template<typename T>
+void
+compute_residual_products(const Results<T>& qpresults, Workspace<T>& qpwork)
+{
+  qpwork.Hx.noalias() =
+    qpwork.H_scaled.template selfadjointView<Eigen::Lower>() * qpresults.x;
+  qpwork.Ax.setZero();
+  qpwork.ATy.setZero();
+  detail::noalias_gevmmv_add(
+    qpwork.ATy, qpwork.Ax, qpwork.A_scaled, qpresults.y, qpresults.x);
+  qpwork.Cx.setZero();
+  qpwork.CTz.setZero();
+  detail::noalias_gevmmv_add(
+    qpwork.CTz, qpwork.Cx, qpwork.C_scaled, qpresults.z, qpresults.x);
+}
+
 /*!
  * Derives the global primal residual of the QP problem.
  *
  * @param qpwork solver workspace.
  * @param qpmodel QP problem model as defined by the user (without any scaling
  * performed).
- * @param qpresults solver results.
  * @param ruiz ruiz preconditioner.
  * @param primal_feasibility_lhs primal infeasibility.
  * @param primal_feasibility_eq_rhs_0 scalar variable used when using a relative
@@ -134,7 +208,6 @@ save_data(const std::string& filename, const ::Eigen::MatrixBase<Derived>& mat)
 template<typename T>
 void
 global_primal_residual(const Model<T>& qpmodel,
-                       const Results<T>& qpresults,
                        Workspace<T>& qpwork,
                        const preconditioner::RuizEquilibration<T>& ruiz,
                        T& primal_feasibility_lhs,
@@ -151,24 +224,23 @@ global_primal_residual(const Model<T>& qpmodel,
   // primal_feasibility_eq_rhs_0 = norm(unscaled(Ax))
   // primal_feasibility_in_rhs_0 = norm(unscaled(Cx))
   //
-  // MAY_ALIAS[primal_residual_in_scaled_u, primal_residual_in_scaled_l]
+  // primal_residual_in_scaled_up = scaled(Cx)
   //
   // INDETERMINATE:
-  // primal_residual_in_scaled_u = unscaled(Cx)
-  // primal_residual_in_scaled_l = unscaled([Cx - u]+ + [Cx - l]-)
-  qpwork.primal_residual_eq_scaled.noalias() = qpwork.A_scaled * qpresults.x;
-  qpwork.primal_residual_in_scaled_up.noalias() = qpwork.C_scaled * qpresults.x;
+  // primal_residual_in_scaled_low = unscaled([Cx - u]+ + [Cx - l]-)
+  // the products are unscaled on the fly, see compute_residual_products
+  auto delta_eq = ruiz.delta.segment(qpmodel.dim, qpmodel.n_eq).array();
+  auto delta_in = ruiz.delta.tail(qpmodel.n_in).array();
+  auto Cx = (qpwork.Cx.array() / delta_in).matrix();
 
-  ruiz.unscale_primal_residual_in_place_eq(
-    VectorViewMut<T>{ from_eigen, qpwork.primal_residual_eq_scaled });
+  qpwork.primal_residual_eq_scaled = (qpwork.Ax.array() / delta_eq).matrix();
   primal_feasibility_eq_rhs_0 = infty_norm(qpwork.primal_residual_eq_scaled);
-  ruiz.unscale_primal_residual_in_place_in(
-    VectorViewMut<T>{ from_eigen, qpwork.primal_residual_in_scaled_up });
-  primal_feasibility_in_rhs_0 = infty_norm(qpwork.primal_residual_in_scaled_up);
+  primal_feasibility_in_rhs_0 = infty_norm(Cx);
 
+  qpwork.primal_residual_in_scaled_up = qpwork.Cx;
   qpwork.primal_residual_in_scaled_low =
-    helpers::positive_part(qpwork.primal_residual_in_scaled_up - qpmodel.u) +
-    helpers::negative_part(qpwork.primal_residual_in_scaled_up - qpmodel.l);
+    helpers::positive_part(Cx - qpmodel.u) +
+    helpers::negative_part(Cx - qpmodel.l);
   qpwork.primal_residual_eq_scaled -= qpmodel.b;
 
   primal_feasibility_in_lhs = infty_norm(qpwork.primal_residual_in_scaled_low);
@@ -330,7 +402,7 @@ global_dual_residual_infeasibility(
  */
 template<typename T>
 void
-global_dual_residual(Results<T>& qpresults,
+global_dual_residual(const Results<T>& qpresults,
                      Workspace<T>& qpwork,
                      const Model<T>& qpmodel,
                      const preconditioner::RuizEquilibration<T>& ruiz,
@@ -351,69 +423,105 @@ global_dual_residual(Results<T>& qpresults,
     std::max(qpmodel.dim, std::max(qpmodel.n_eq, qpmodel.n_in));
   const T sqrt_max_dim(std::sqrt(max_dim)); // for normalizing scalar products
 
-  qpwork.dual_residual_scaled = qpwork.g_scaled;
-  qpwork.CTz.noalias() =
-    qpwork.H_scaled.template selfadjointView<Eigen::Lower>() * qpresults.x;
-  qpwork.dual_residual_scaled += qpwork.CTz;
-  ruiz.unscale_dual_residual_in_place(
-    VectorViewMut<T>{ from_eigen, qpwork.CTz }); // contains unscaled Hx
-  dual_feasibility_rhs_0 = infty_norm(qpwork.CTz);
-
-  ruiz.unscale_primal_in_place(VectorViewMut<T>{ from_eigen, qpresults.x });
-  duality_gap = (qpmodel.g).dot(qpresults.x);
+  // the products and the iterate are unscaled on the fly, see
+  // compute_residual_products
+  auto delta_x = ruiz.delta.head(qpmodel.dim).array();
+  auto delta_eq = ruiz.delta.segment(qpmodel.dim, qpmodel.n_eq).array();
+  auto delta_in = ruiz.delta.tail(qpmodel.n_in).array();
+  auto x = (qpresults.x.array() * delta_x).matrix();
+  auto y = (qpresults.y.array() * delta_eq / ruiz.c).matrix();
+  auto z = (qpresults.z.array() * delta_in / ruiz.c).matrix();
+  auto Hx = (qpwork.Hx.array() / (delta_x * ruiz.c)).matrix();
+  auto ATy = (qpwork.ATy.array() / (delta_x * ruiz.c)).matrix();
+  auto CTz = (qpwork.CTz.array() / (delta_x * ruiz.c)).matrix();
+
+  qpwork.dual_residual_scaled =
+    qpwork.g_scaled + qpwork.Hx + qpwork.ATy + qpwork.CTz;
+  dual_feasibility_lhs = infty_norm(
+    (qpwork.dual_residual_scaled.array() / (delta_x * ruiz.c)).matrix());
+  dual_feasibility_rhs_0 = infty_norm(Hx);
+  dual_feasibility_rhs_1 = infty_norm(ATy);
+  dual_feasibility_rhs_3 = infty_norm(CTz);
+
+  duality_gap = (qpmodel.g).dot(x);
   rhs_duality_gap = std::abs(duality_gap);
-  const T xHx = (qpwork.CTz).dot(qpresults.x);
+  const T xHx = Hx.dot(x);
   duality_gap += xHx; // contains now xHx+g.Tx
   rhs_duality_gap = std::max(rhs_duality_gap, std::abs(xHx));
 
-  ruiz.scale_primal_in_place(VectorViewMut<T>{ from_eigen, qpresults.x });
-
-  qpwork.CTz.noalias() = qpwork.A_scaled.transpose() * qpresults.y;
-  qpwork.dual_residual_scaled += qpwork.CTz;
-  ruiz.unscale_dual_residual_in_place(
-    VectorViewMut<T>{ from_eigen, qpwork.CTz });
-  dual_feasibility_rhs_1 = infty_norm(qpwork.CTz);
-
-  qpwork.CTz.noalias() = qpwork.C_scaled.transpose() * qpresults.z;
-  qpwork.dual_residual_scaled += qpwork.CTz;
-  ruiz.unscale_dual_residual_in_place(
-    VectorViewMut<T>{ from_eigen, qpwork.CTz });
-  dual_feasibility_rhs_3 = infty_norm(qpwork.CTz);
-
-  ruiz.unscale_dual_residual_in_place(
-    VectorViewMut<T>{ from_eigen, qpwork.dual_residual_scaled });
-
-  dual_feasibility_lhs = infty_norm(qpwork.dual_residual_scaled);
-
-  ruiz.scale_dual_residual_in_place(
-    VectorViewMut<T>{ from_eigen, qpwork.dual_residual_scaled });
-
-  ruiz.unscale_dual_in_place_eq(VectorViewMut<T>{ from_eigen, qpresults.y });
-  const T by = (qpmodel.b).dot(qpresults.y);
+  const T by = (qpmodel.b).dot(y);
   rhs_duality_gap = std::max(rhs_duality_gap, std::abs(by));
   duality_gap += by;
-  ruiz.scale_dual_in_place_eq(VectorViewMut<T>{ from_eigen, qpresults.y });
-
-  ruiz.unscale_dual_in_place_in(VectorViewMut<T>{ from_eigen, qpresults.z });
 
   const T zu =
-    helpers::positive_part(qpresults.z)
-      .dot(helpers::at_most(qpmodel.u, helpers::infinite_bound<T>::value()));
+    helpers::positive_part(z).dot(
+      helpers::at_most(qpmodel.u, helpers::infinite_bound<T>::value()));
   rhs_duality_gap = std::max(rhs_duality_gap, std::abs(zu));
   duality_gap += zu;
 
   const T zl =
-    helpers::negative_part(qpresults.z)
-      .dot(helpers::at_least(qpmodel.l, -helpers::infinite_bound<T>::value()));
+    helpers::negative_part(z).dot(
+      helpers::at_least(qpmodel.l, -helpers::infinite_bound<T>::value()));
   rhs_duality_gap = std::max(rhs_duality_gap, std::abs(zl));
   duality_gap += zl;
 
-  ruiz.scale_dual_in_place_in(VectorViewMut<T>{ from_eigen, qpresults.z });
-
   duality_gap /= sqrt_max_dim; // in order to get an a-dimensional duality gap
   rhs_duality_gap /= sqrt_max_dim;
 }
 
+/*!
+ * Checks whether the stopping criterion of the solver holds for the global
+ * residuals of the QP problem.
+ *
+ * @param qpsettings solver settings.
+ * @param qpwork solver workspace.
+ * @param primal_feasibility_lhs primal infeasibility.
+ * @param primal_feasibility_eq_rhs_0 scalar variable used when using a relative
+ * stopping criterion.
+ * @param primal_feasibility_in_rhs_0 scalar variable used when using a relative
+ * stopping criterion.
+ * @param dual_feasibility_lhs dual infeasibility.
+ * @param dual_feasibility_rhs_0 scalar variable used when using a relative
+ * stopping criterion.
+ * @param dual_feasibility_rhs_1 scalar variable used when using a relative
+ * stopping criterion.
+ * @param dual_feasibility_rhs_3 scalar variable used when using a relative
+ * stopping criterion.
+ * @param rhs_duality_gap scalar variable used when using a relative stopping
+ * criterion.
+ * @param duality_gap duality gap.
+ */
+template<typename T>
+bool
+global_stopping_criterion(const Settings<T>& qpsettings,
+                          const Workspace<T>& qpwork,
+                          T primal_feasibility_lhs,
+                          T primal_feasibility_eq_rhs_0,
+                          T primal_feasibility_in_rhs_0,
+                          T dual_feasibility_lhs,
+                          T dual_feasibility_rhs_0,
+                          T dual_feasibility_rhs_1,
+                          T dual_feasibility_rhs_3,
+                          T rhs_duality_gap,
+                          T duality_gap)
+{
+  T rhs_pri(qpsettings.eps_abs);
+  T rhs_dua(qpsettings.eps_abs);
+  if (qpsettings.eps_rel != 0) {
+    rhs_pri += qpsettings.eps_rel * std::max(primal_feasibility_eq_rhs_0,
+                                             primal_feasibility_in_rhs_0);
+    rhs_dua +=
+      qpsettings.eps_rel *
+      std::max(std::max(dual_feasibility_rhs_3, dual_feasibility_rhs_0),
+               std::max(dual_feasibility_rhs_1, qpwork.dual_feasibility_rhs_2));
+  }
+  return primal_feasibility_lhs <= rhs_pri &&
+         dual_feasibility_lhs <= rhs_dua &&
+         duality_gap <= qpsettings.eps_abs +
+                          (qpsettings.eps_abs + qpsettings.eps_rel) *
+                            rhs_duality_gap;
+}
+
 } // namespace dense
 } // namespace proxqp
 } // namespace proxsuite
@@ -28,7 +28,17 @@ struct Workspace
 
   ///// Cholesky Factorization
   proxsuite::linalg::dense::Ldlt<T> ldl{};
+  // single precision factorization, used in place of ldl with the mixed
+  // precision factorization
+  proxsuite::linalg::dense::Ldlt<proxsuite::linalg::dense::f32> ldl_f32{};
   proxsuite::linalg::veg::Vec<unsigned char> ldl_stack;
+  // whether ldl_f32 holds the factorization
+  bool ldl_use_f32{};
+  // whether the iterative refinement stalled with ldl_f32
+  bool ldl_f32_stalled{};
+  // estimated condition number of ldl_f32, negative until it is estimated
+  // for the current factorization
+  proxsuite::linalg::dense::f32 ldl_f32_condition{ -1 };
   Timer<T> timer;
 
   ///// QP STORAGE
@@ -36,6 +46,9 @@ struct Workspace
   Vec<T> g_scaled;
   Mat<T> A_scaled;
   Mat<T> C_scaled;
+  // rows of C_scaled ordered as in the factorization, following
+  // current_bijection_map: the n_c active rows come first
+  Mat<T> C_permuted;
   Vec<T> b_scaled;
   Vec<T> u_scaled;
   Vec<T> l_scaled;
@@ -65,6 +78,10 @@ struct Workspace
 
   Vec<T> active_part_z;
   proxsuite::linalg::veg::Vec<T> alphas;
+  // updates of the derivative coefficients at each alpha, and activity tests
+  // of each constraint, used by the line search
+  proxsuite::linalg::veg::Vec<T> alphas_updates;
+  proxsuite::linalg::veg::Vec<unsigned char> alphas_tests;
 
   ///// Newton variables
   Vec<T> dw_aug;
@@ -85,6 +102,13 @@ struct Workspace
 
   Vec<T> primal_residual_in_scaled_up_plus_alphaCdx;
   Vec<T> primal_residual_in_scaled_low_plus_alphaCdx;
+
+  //// Scaled products with the current iterate, updated along the Newton steps
+
+  Vec<T> Hx;
+  Vec<T> Ax;
+  Vec<T> Cx;
+  Vec<T> ATy;
   Vec<T> CTz;
 
   bool constraints_changed;
@@ -109,6 +133,7 @@ struct Workspace
     , g_scaled(dim)
     , A_scaled(n_eq, dim)
     , C_scaled(n_in, dim)
+    , C_permuted(n_in, dim)
     , b_scaled(n_eq)
     , u_scaled(n_in)
     , l_scaled(n_in)
@@ -138,6 +163,10 @@ struct Workspace
 
     primal_residual_in_scaled_up_plus_alphaCdx(n_in)
     , primal_residual_in_scaled_low_plus_alphaCdx(n_in)
+    , Hx(dim)
+    , Ax(n_eq)
+    , Cx(n_in)
+    , ATy(dim)
     , CTz(dim)
     , constraints_changed(false)
     , dirty(false)
@@ -146,34 +175,16 @@ struct Workspace
     , is_initialized(false)
 
   {
-    ldl.reserve_uninit(dim + n_eq + n_in);
-    ldl_stack.resize_for_overwrite(
-      proxsuite::linalg::veg::dynstack::StackReq(
-
-        proxsuite::linalg::dense::Ldlt<T>::factorize_req(dim + n_eq + n_in) |
-
-        (proxsuite::linalg::dense::temp_vec_req(
-           proxsuite::linalg::veg::Tag<T>{}, n_eq + n_in) &
-         proxsuite::linalg::veg::dynstack::StackReq{
-           isize{ sizeof(isize) } * (n_eq + n_in), alignof(isize) } &
-         proxsuite::linalg::dense::Ldlt<T>::diagonal_update_req(
-           dim + n_eq + n_in, n_eq + n_in)) |
-
-        (proxsuite::linalg::dense::temp_mat_req(
-           proxsuite::linalg::veg::Tag<T>{}, dim + n_eq + n_in, n_in) &
-         proxsuite::linalg::dense::Ldlt<T>::insert_block_at_req(
-           dim + n_eq + n_in, n_in)) |
-
-        proxsuite::linalg::dense::Ldlt<T>::solve_in_place_req(dim + n_eq +
-                                                              n_in))
-
-        .alloc_req());
+    set_ldl_storage(false, false);
 
     alphas.reserve(2 * n_in);
+    alphas_updates.resize_for_overwrite(4 * n_in);
+    alphas_tests.resize_for_overwrite(n_in);
     H_scaled.setZero();
     g_scaled.setZero();
     A_scaled.setZero();
     C_scaled.setZero();
+    C_permuted.setZero();
     b_scaled.setZero();
     u_scaled.setZero();
     l_scaled.setZero();
@@ -205,9 +216,242 @@ struct Workspace
 
     primal_residual_in_scaled_up_plus_alphaCdx.setZero();
     primal_residual_in_scaled_low_plus_alphaCdx.setZero();
+    Hx.setZero();
+    Ax.setZero();
+    Cx.setZero();
+    ATy.setZero();
     CTz.setZero();
     n_c = 0;
   }
+  /*!
+   * Selects the storage of the KKT factorization, and reserves the memory it
+   * needs. This invalidates the current factorization.
+   * @param packed whether the factorization only stores its lower triangular
+   * part.
+   * @param use_f32 whether the factorization is stored and computed in single
+   * precision.
+   */
+  void set_ldl_storage(bool packed, bool use_f32 = false)
+  {
+    using proxsuite::linalg::dense::f32;
+    using proxsuite::linalg::veg::Tag;
+    using proxsuite::linalg::veg::dynstack::StackReq;
+
+    isize dim = H_scaled.rows();
+    isize n_eq = A_scaled.rows();
+    isize n_in = C_scaled.rows();
+    isize n_tot = dim + n_eq + n_in;
+
+    auto req_f64 = StackReq(
+      proxsuite::linalg::dense::temp_vec_req(Tag<T>{}, n_eq + n_in) &
+      StackReq{ isize{ sizeof(isize) } * (n_eq + n_in), alignof(isize) });
+    auto req_mat_f64 =
+      proxsuite::linalg::dense::temp_mat_req(Tag<T>{}, n_tot, n_in);
+    // rows to delete and inverse of the bijection map in active_set_change
+    auto req_bijection =
+      StackReq{ isize{ sizeof(isize) } * 2 * n_in, alignof(isize) };
+
+    ldl_use_f32 = use_f32;
+    ldl_f32_condition = -1;
+    if (use_f32) {
+      // the double precision factorization is released, so that only the
+      // single precision one is kept in memory
+      ldl = proxsuite::linalg::dense::Ldlt<T>{};
+      ldl_f32.set_packed_storage(packed);
+      ldl_f32.reserve_uninit(n_tot);
+      ldl_stack.resize_for_overwrite(
+        StackReq(
+          proxsuite::linalg::dense::Ldlt<f32>::factorize_cast_req(n_tot,
+                                                                  packed) |
+
+          (req_f64 & proxsuite::linalg::dense::temp_vec_req(Tag<f32>{},
+                                                             n_eq + n_in) &
+           proxsuite::linalg::dense::Ldlt<f32>::diagonal_update_req(
+             n_tot, n_eq + n_in)) |
+
+          (req_mat_f64 &
+           proxsuite::linalg::dense::temp_mat_req(Tag<f32>{}, n_tot, n_in) &
+           proxsuite::linalg::dense::Ldlt<f32>::insert_block_at_req(n_tot,
+                                                                    n_in)) |
+
+          (proxsuite::linalg::dense::temp_vec_req(Tag<f32>{}, n_tot) &
+           proxsuite::linalg::dense::Ldlt<f32>::solve_in_place_req(n_tot)) |
+
+          proxsuite::linalg::dense::Ldlt<f32>::condition_estimate_req(n_tot) |
+
+          req_bijection)
+
+          .alloc_req());
+      return;
+    }
+
+    ldl_f32 = proxsuite::linalg::dense::Ldlt<f32>{};
+    ldl.set_packed_storage(packed);
+    ldl.reserve_uninit(n_tot);
+    ldl_stack.resize_for_overwrite(
+      StackReq(
+
+        proxsuite::linalg::dense::Ldlt<T>::factorize_req(n_tot, packed) |
+
+        (req_f64 &
+         proxsuite::linalg::dense::Ldlt<T>::diagonal_update_req(n_tot,
+                                                                n_eq + n_in)) |
+
+        (req_mat_f64 &
+         proxsuite::linalg::dense::Ldlt<T>::insert_block_at_req(n_tot, n_in)) |
+
+        proxsuite::linalg::dense::Ldlt<T>::solve_in_place_req(n_tot) |
+
+        req_bijection)
+
+        .alloc_req());
+  }
+  /*!
+   * Returns whether the current factorization uses the packed storage.
+   */
+  auto ldl_is_packed() const noexcept -> bool
+  {
+    return ldl_use_f32 ? ldl_f32.is_packed() : ldl.is_packed();
+  }
+  /*!
+   * Returns whether the iterative refinement is not expected to converge with
+   * the current factorization, so that it should be recomputed first. With
+   * eps the unit roundoff of the precision of the factorization, this is the
+   * case when
+   * - a pivot is not finite, or is below eps relative to the largest one,
+   * - the updates since the factorization grew the largest pivot by more than
+   *   1/sqrt(eps), amplifying the rounding errors of the decomposition,
+   * - with the single precision factorization, the estimated condition number
+   *   exceeds 0.1/eps, as each refinement sweep contracts the error by about
+   *   the condition number times eps.
+   * The condition number is only estimated, in O(n²) operations, when the
+   * pivots spread over more than 1/sqrt(eps), and at most once per
+   * modification of the factorization.
+   */
+  auto ldl_needs_refactorization() -> bool
+  {
+    using proxsuite::linalg::dense::f32;
+    if (!ldl_use_f32) {
+      T eps = std::numeric_limits<T>::epsilon();
+      return ldl.is_degraded(eps) || ldl.pivot_growth() * std::sqrt(eps) > 1;
+    }
+    f32 eps = std::numeric_limits<f32>::epsilon();
+    if (ldl_f32.is_degraded(eps) ||
+        ldl_f32.pivot_growth() * std::sqrt(eps) > 1) {
+      return true;
+    }
+    if (ldl_f32.min_abs_pivot() > std::sqrt(eps) * ldl_f32.max_abs_pivot()) {
+      return false;
+    }
+    if (ldl_f32_condition < 0) {
+      proxsuite::linalg::veg::dynstack::DynStackMut stack{
+        proxsuite::linalg::veg::from_slice_mut, ldl_stack.as_mut()
+      };
+      ldl_f32_condition = ldl_f32.condition_estimate(stack);
+    }
+    return !(ldl_f32_condition * eps < f32(0.1));
+  }
+  /*!
+   * Computes the factorization of the lower triangular part of mat, in the
+   * precision selected by set_ldl_storage. In single precision, mat is rounded
+   * directly into the storage of the factor. A non positive nb_threads, the
+   * default of the settings, factorizes sequentially: the dense solver only
+   * uses several threads when they are requested explicitly.
+   */
+  void ldl_factorize(Eigen::Ref<Mat<T, Eigen::ColMajor> const> mat,
+                     proxsuite::linalg::veg::dynstack::DynStackMut stack,
+                     isize nb_threads)
+  {
+    if (nb_threads <= 0) {
+      nb_threads = 1;
+    }
+    if (!ldl_use_f32) {
+      ldl.factorize(mat, stack, nb_threads);
+      return;
+    }
+    ldl_f32_condition = -1;
+    ldl_f32.factorize_cast(mat, stack, nb_threads);
+  }
+  /*!
+   * Solves the factorized system in place. With the single precision
+   * factorization, the right hand side is rounded to single precision, so
+   * that the result is only a first approximation for the iterative
+   * refinement.
+   */
+  void ldl_solve_in_place(Eigen::Ref<Vec<T>> rhs,
+                          proxsuite::linalg::veg::dynstack::DynStackMut stack)
+  {
+    if (!ldl_use_f32) {
+      ldl.solve_in_place(rhs, stack);
+      return;
+    }
+    LDLT_TEMP_VEC_UNINIT(
+      proxsuite::linalg::dense::f32, rhs_f32, rhs.rows(), stack);
+    rhs_f32 = rhs.template cast<proxsuite::linalg::dense::f32>();
+    ldl_f32.solve_in_place(rhs_f32, stack);
+    rhs = rhs_f32.template cast<T>();
+  }
+  /*!
+   * Inserts the columns a at the index i of the factorized matrix.
+   */
+  void ldl_insert_block_at(isize i,
+                           Eigen::Ref<Mat<T, Eigen::ColMajor> const> a,
+                           proxsuite::linalg::veg::dynstack::DynStackMut stack)
+  {
+    if (!ldl_use_f32) {
+      ldl.insert_block_at(i, a, stack);
+      return;
+    }
+    ldl_f32_condition = -1;
+    LDLT_TEMP_MAT_UNINIT(
+      proxsuite::linalg::dense::f32, a_f32, a.rows(), a.cols(), stack);
+    a_f32 = a.template cast<proxsuite::linalg::dense::f32>();
+    ldl_f32.insert_block_at(i, a_f32, stack);
+  }
+  /*!
+   * Deletes the r rows and columns of the factorized matrix given by the
+   * sorted indices.
+   */
+  void ldl_delete_at(isize const* indices,
+                     isize r,
+                     proxsuite::linalg::veg::dynstack::DynStackMut stack)
+  {
+    if (!ldl_use_f32) {
+      ldl.delete_at(indices, r, stack);
+    } else {
+      ldl_f32_condition = -1;
+      ldl_f32.delete_at(indices, r, stack);
+    }
+  }
+  /*!
+   * Adds alpha to the diagonal elements of the factorized matrix given by the
+   * indices, which are clobbered.
+   */
+  void ldl_diagonal_update_clobber_indices(
+    isize* indices,
+    isize r,
+    Eigen::Ref<Vec<T> const> alpha,
+    proxsuite::linalg::veg::dynstack::DynStackMut stack)
+  {
+    if (!ldl_use_f32) {
+      ldl.diagonal_update_clobber_indices(indices, r, alpha, stack);
+      return;
+    }
+    ldl_f32_condition = -1;
+    LDLT_TEMP_VEC_UNINIT(proxsuite::linalg::dense::f32, alpha_f32, r, stack);
+    alpha_f32 = alpha.template cast<proxsuite::linalg::dense::f32>();
+    ldl_f32.diagonal_update_clobber_indices(indices, r, alpha_f32, stack);
+  }
+  /*!
+   * Copies the rows of C_scaled to C_permuted, in the order of
+   * current_bijection_map.
+   */
+  void permute_constraints()
+  {
+    for (isize i = 0; i < C_scaled.rows(); ++i) {
+      C_permuted.row(current_bijection_map(i)) = C_scaled.row(i);
+    }
+  }
   /*!
    * Clean-ups solver's workspace.
    */
@@ -218,6 +462,7 @@ struct Workspace
     g_scaled.setZero();
     A_scaled.setZero();
     C_scaled.setZero();
+    C_permuted.setZero();
     b_scaled.setZero();
     u_scaled.setZero();
     l_scaled.setZero();
@@ -238,6 +483,10 @@ struct Workspace
 
     primal_residual_in_scaled_up_plus_alphaCdx.setZero();
     primal_residual_in_scaled_low_plus_alphaCdx.setZero();
+    Hx.setZero();
+    Ax.setZero();
+    Cx.setZero();
+    ATy.setZero();
     CTz.setZero();
 
     x_prev.setZero();
@@ -254,6 +503,7 @@ struct Workspace
     refactorize = false;
     proximal_parameter_update = false;
     is_initialized = false;
+    ldl_f32_stalled = false;
     n_c = 0;
   }
 };
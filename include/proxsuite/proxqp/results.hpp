@@ -52,6 +52,11 @@ struct Info
   T duality_gap;
   //// sparse backend used by solver, either CholeskySparse or MatrixFree
   SparseBackend sparse_backend;
+  //// fill reducing ordering of the sparse KKT factorization, with the
+  //// predicted number of non zeros and flops of its factor
+  SparseOrdering sparse_ordering;
+  sparse::isize factor_nnz;
+  T factor_flops;
 };
 ///
 /// @brief This class stores all the results of PROXQP solvers with sparse and
@@ -109,6 +114,9 @@ struct Results
     info.duality_gap = 0.;
     info.status = QPSolverOutput::PROXQP_NOT_RUN;
     info.sparse_backend = SparseBackend::Automatic;
+    info.sparse_ordering = SparseOrdering::Automatic;
+    info.factor_nnz = 0;
+    info.factor_flops = 0;
   }
   /*!
    * cleanups the Result variables and set the info variables to their initial
@@ -36,6 +36,34 @@ operator<<(std::ostream& os, const SparseBackend& sparse_backend)
   return os;
 }
 
+// Fill reducing orderings of the sparse KKT factorization
+enum struct SparseOrdering
+{
+  Automatic,        // the ordering with the cheapest predicted factorization.
+  Natural,          // no permutation.
+  AMD,              // approximate minimum degree.
+  ConstrainedAMD,   // approximate minimum degree, with the constraint rows
+                    // ordered after the primal variables.
+  NestedDissection, // nested dissection, suited to grid-like problems.
+};
+
+inline std::ostream&
+operator<<(std::ostream& os, const SparseOrdering& sparse_ordering)
+{
+  if (sparse_ordering == SparseOrdering::Automatic)
+    os << "Automatic";
+  else if (sparse_ordering == SparseOrdering::Natural) {
+    os << "Natural";
+  } else if (sparse_ordering == SparseOrdering::AMD) {
+    os << "AMD";
+  } else if (sparse_ordering == SparseOrdering::ConstrainedAMD) {
+    os << "ConstrainedAMD";
+  } else {
+    os << "NestedDissection";
+  }
+  return os;
+}
+
 ///
 /// @brief This class defines the settings of PROXQP solvers with sparse and
 /// dense backends.
@@ -92,6 +120,18 @@ struct Settings
   bool bcl_update;
 
   SparseBackend sparse_backend;
+
+  isize nb_threads;
+
+  bool packed_factorization;
+
+  bool mixed_precision_factorization;
+
+  bool supernodal_factorization;
+
+  SparseOrdering sparse_ordering;
+
+  isize sparse_factorization_memory_budget;
   /*!
    * Default constructor.
    * @param default_rho default rho parameter of result class
@@ -147,6 +187,40 @@ struct Settings
    * used.
    * @param sparse_backend Default automatic. User can choose between sparse
    * cholesky or iterative matrix free sparse backend.
+   * @param nb_threads number of threads used by the multithreaded linear
+   * algebra kernels (1 for sequential execution). The default, 0, uses all
+   * the available hardware threads in the sparse solver, and is sequential in
+   * the dense solver. The threads are only used for large enough systems:
+   * sparse KKT systems whose factor holds at least 1e5 non zeros are
+   * factorized by the supernodal factorization, with the independent subtrees
+   * of the elimination tree spread over the threads, and dense KKT matrices
+   * with at least twice as many rows as the block size of the factorization
+   * are factorized by tiles when more than one thread is requested.
+   * @param packed_factorization if set to true, the dense KKT factorization
+   * only stores its lower triangular part, which roughly halves its memory
+   * footprint.
+   * @param mixed_precision_factorization if set to true, the dense KKT
+   * factorization is stored and computed in single precision, while the
+   * iterates and residuals are kept in the working precision. The accuracy is
+   * recovered by the iterative refinement, and the solver falls back to a
+   * factorization in the working precision if the refinement stalls.
+   * @param supernodal_factorization if set to true, the sparse KKT
+   * factorization groups the columns of the factor sharing the same structure
+   * and processes them with dense kernels, which is faster when the factor has
+   * dense parts. It is taken into account when the solver is initialized.
+   * @param sparse_ordering fill reducing ordering of the sparse KKT
+   * factorization. By default, the orderings are all evaluated from the
+   * symbolic factorization, and the one with the fewest predicted flops is
+   * kept. The constrained minimum degree ordering places the
+   * constraint rows after the primal variables, which shortens the paths of
+   * the elimination tree followed when the active set changes. Nested
+   * dissection gives sparser factors on grid-like problems. It is taken into
+   * account when the solver is initialized.
+   * @param sparse_factorization_memory_budget maximal size in bytes of the
+   * sparse KKT factor, above which the automatic sparse backend switches to
+   * the matrix free one (0 for half of the physical memory). Factors whose
+   * number of non zeros overflows the index type of the model are stored with
+   * 64 bits indices, whose size is taken into account.
    */
 
   Settings(
@@ -188,7 +262,13 @@ struct Settings
     T eps_primal_inf = 1.E-4,
     T eps_dual_inf = 1.E-4,
     bool bcl_update = true,
-    SparseBackend sparse_backend = SparseBackend::Automatic)
+    SparseBackend sparse_backend = SparseBackend::Automatic,
+    isize nb_threads = 0,
+    bool packed_factorization = false,
+    bool mixed_precision_factorization = false,
+    bool supernodal_factorization = false,
+    SparseOrdering sparse_ordering = SparseOrdering::Automatic,
+    isize sparse_factorization_memory_budget = 0)
     : default_rho(default_rho)
     , default_mu_eq(default_mu_eq)
     , default_mu_in(default_mu_in)
@@ -224,6 +304,12 @@ struct Settings
     , eps_dual_inf(eps_dual_inf)
     , bcl_update(bcl_update)
     , sparse_backend(sparse_backend)
+    , nb_threads(nb_threads)
+    , packed_factorization(packed_factorization)
+    , mixed_precision_factorization(mixed_precision_factorization)
+    , supernodal_factorization(supernodal_factorization)
+    , sparse_ordering(sparse_ordering)
+    , sparse_factorization_memory_budget(sparse_factorization_memory_budget)
   {
   }
 };
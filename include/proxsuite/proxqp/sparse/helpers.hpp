@@ -235,6 +235,10 @@ qp_setup(QpView<T, I> qp,
   else {
     results.info.sparse_backend = settings.sparse_backend;
   }
+  // ordering of the KKT matrix and predicted cost of its factorization
+  results.info.sparse_ordering = work.internal.selected_ordering;
+  results.info.factor_nnz = work.lnnz;
+  results.info.factor_flops = T(work.internal.factor_flops);
 }
 /*!
  * Checks whether matrix b has the same sparsity structure as matrix a.
@@ -14,10 +14,12 @@
 #include <proxsuite/linalg/sparse/factorize.hpp>
 #include <proxsuite/linalg/sparse/update.hpp>
 #include <proxsuite/linalg/sparse/rowmod.hpp>
+#include <proxsuite/linalg/sparse/solve.hpp>
 #include <proxsuite/proxqp/dense/views.hpp>
 #include <proxsuite/proxqp/settings.hpp>
 #include <proxsuite/linalg/veg/vec.hpp>
 #include "proxsuite/proxqp/results.hpp"
+#include "proxsuite/proxqp/breakpoints.hpp"
 #include "proxsuite/proxqp/sparse/fwd.hpp"
 #include "proxsuite/proxqp/sparse/views.hpp"
 #include "proxsuite/proxqp/sparse/model.hpp"
@@ -35,21 +37,20 @@ namespace proxsuite {
 namespace proxqp {
 namespace sparse {
 
-template<typename T, typename I>
+template<typename T, typename I, typename J>
 void
 ldl_solve(VectorViewMut<T> sol,
           VectorView<T> rhs,
           isize n_tot,
-          proxsuite::linalg::sparse::MatMut<T, I> ldl,
+          proxsuite::linalg::sparse::MatMut<T, J> ldl,
           Eigen::MINRES<detail::AugmentedKkt<T, I>,
                         Eigen::Upper | Eigen::Lower,
                         Eigen::IdentityPreconditioner>& iterative_solver,
           bool do_ldlt,
           proxsuite::linalg::veg::dynstack::DynStackMut stack,
-          T* ldl_values,
-          I* perm,
-          I* ldl_col_ptrs,
-          I const* perm_inv)
+          proxsuite::linalg::sparse::LdltSolveSchedule<J> const& schedule,
+          J* perm,
+          J const* perm_inv)
 {
   LDLT_TEMP_VEC_UNINIT(T, work_, n_tot, stack);
   auto rhs_e = rhs.to_eigen();
@@ -62,17 +63,11 @@ ldl_solve(VectorViewMut<T> sol,
       work_[i] = rhs_e[isize(zx(perm[i]))];
     }
 
-    proxsuite::linalg::sparse::dense_lsolve<T, I>( //
-      { proxsuite::linalg::sparse::from_eigen, work_ },
-      ldl.as_const());
-
-    for (isize i = 0; i < n_tot; ++i) {
-      work_[i] /= ldl_values[isize(zx(ldl_col_ptrs[i]))];
-    }
-
-    proxsuite::linalg::sparse::dense_ltsolve<T, I>( //
+    proxsuite::linalg::sparse::ldlt_solve_in_place<T, J>(
       { proxsuite::linalg::sparse::from_eigen, work_ },
-      ldl.as_const());
+      ldl.as_const(),
+      schedule,
+      stack);
 
     for (isize i = 0; i < n_tot; ++i) {
       sol_e[i] = work_[isize(zx(perm_inv[i]))];
@@ -83,7 +78,7 @@ ldl_solve(VectorViewMut<T> sol,
   }
 }
 
-template<typename T, typename I>
+template<typename T, typename I, typename J>
 void
 ldl_iter_solve_noalias(
   VectorViewMut<T> sol,
@@ -92,16 +87,15 @@ ldl_iter_solve_noalias(
   Results<T> const& results,
   Model<T, I> const& data,
   isize n_tot,
-  proxsuite::linalg::sparse::MatMut<T, I> ldl,
+  proxsuite::linalg::sparse::MatMut<T, J> ldl,
   Eigen::MINRES<detail::AugmentedKkt<T, I>,
                 Eigen::Upper | Eigen::Lower,
                 Eigen::IdentityPreconditioner>& iterative_solver,
   bool do_ldlt,
   proxsuite::linalg::veg::dynstack::DynStackMut stack,
-  T* ldl_values,
-  I* perm,
-  I* ldl_col_ptrs,
-  I const* perm_inv,
+  proxsuite::linalg::sparse::LdltSolveSchedule<J> const& schedule,
+  J* perm,
+  J const* perm_inv,
   Settings<T> const& settings,
   proxsuite::linalg::sparse::MatMut<T, I> kkt_active,
   proxsuite::linalg::veg::SliceMut<bool> active_constraints)
@@ -156,9 +150,8 @@ ldl_iter_solve_noalias(
               iterative_solver,
               do_ldlt,
               stack,
-              ldl_values,
+              schedule,
               perm,
-              ldl_col_ptrs,
               perm_inv);
 
     sol_e -= err;
@@ -181,14 +174,13 @@ ldl_iter_solve_noalias(
  * are active or not.
  * @param iterative_solver iterative solver matrix free.
  * @param stack memory stack.
- * @param ldl_values pointor to ldl values.
+ * @param schedule schedule of the triangular solves with the ldl.
  * @param perm pointor to the ldl permutation.
- * @param ldl_col_ptrs pointor to the column of the ldl.
  * @param perm_inv pointor the inverse permutation.
  * @param settings solver's settings.
  * @param kkt_active active part of the kkt.
  */
-template<typename T, typename I>
+template<typename T, typename I, typename J>
 void
 ldl_solve_in_place(
   VectorViewMut<T> rhs,
@@ -196,16 +188,15 @@ ldl_solve_in_place(
   Results<T> const& results,
   Model<T, I> const& data,
   isize n_tot,
-  proxsuite::linalg::sparse::MatMut<T, I> ldl,
+  proxsuite::linalg::sparse::MatMut<T, J> ldl,
   Eigen::MINRES<detail::AugmentedKkt<T, I>,
                 Eigen::Upper | Eigen::Lower,
                 Eigen::IdentityPreconditioner>& iterative_solver,
   bool do_ldlt,
   proxsuite::linalg::veg::dynstack::DynStackMut stack,
-  T* ldl_values,
-  I* perm,
-  I* ldl_col_ptrs,
-  I const* perm_inv,
+  proxsuite::linalg::sparse::LdltSolveSchedule<J> const& schedule,
+  J* perm,
+  J const* perm_inv,
   Settings<T> const& settings,
   proxsuite::linalg::sparse::MatMut<T, I> kkt_active,
   proxsuite::linalg::veg::SliceMut<bool> active_constraints)
@@ -221,9 +212,8 @@ ldl_solve_in_place(
                          iterative_solver,
                          do_ldlt,
                          stack,
-                         ldl_values,
+                         schedule,
                          perm,
-                         ldl_col_ptrs,
                          perm_inv,
                          settings,
                          kkt_active,
@@ -321,159 +311,38 @@ struct PrimalDualGradResult
   VEG_REFLECT(PrimalDualGradResult, a, b, grad);
 };
 
-/*!
- * Executes the PROXQP algorithm.
- *
- * @param work solver workspace.
- * @param model QP problem model as defined by the user (without any scaling
- * performed).
- * @param settings solver settings.
- * @param results solver results.
- * @param precond preconditioner.
- */
-template<typename T, typename I, typename P>
-void
-qp_solve(Results<T>& results,
-         Model<T, I>& data,
-         const Settings<T>& settings,
-         Workspace<T, I>& work,
-         P& precond)
+namespace detail {
+/// row indices of the columns of the KKT matrix with the type of the indices
+/// of the factor, which are the ones of the model if it has the same type
+template<typename I>
+auto
+factor_row_indices(I const* row_indices, I* /*buf*/, isize /*nnz*/)
+  -> I const*
 {
-  if (settings.compute_timings) {
-    work.timer.stop();
-    work.timer.start();
-  }
-
-  if (work.internal
-        .dirty) // the following is used when a solve has already been executed
-                // (and without any intermediary model update)
-  {
-    proxsuite::linalg::sparse::MatMut<T, I> kkt_unscaled =
-      data.kkt_mut_unscaled();
-
-    auto kkt_top_n_rows = detail::top_rows_mut_unchecked(
-      proxsuite::linalg::veg::unsafe, kkt_unscaled, data.dim);
-
-    proxsuite::linalg::sparse::MatMut<T, I> H_unscaled =
-      detail::middle_cols_mut(kkt_top_n_rows, 0, data.dim, data.H_nnz);
-
-    proxsuite::linalg::sparse::MatMut<T, I> AT_unscaled =
-      detail::middle_cols_mut(kkt_top_n_rows, data.dim, data.n_eq, data.A_nnz);
-
-    proxsuite::linalg::sparse::MatMut<T, I> CT_unscaled =
-      detail::middle_cols_mut(
-        kkt_top_n_rows, data.dim + data.n_eq, data.n_in, data.C_nnz);
-
-    SparseMat<T, I> H_triu =
-      H_unscaled.to_eigen().template triangularView<Eigen::Upper>();
-    sparse::QpView<T, I> qp = {
-      { proxsuite::linalg::sparse::from_eigen, H_triu },
-      { proxsuite::linalg::sparse::from_eigen, data.g },
-      { proxsuite::linalg::sparse::from_eigen, AT_unscaled.to_eigen() },
-      { proxsuite::linalg::sparse::from_eigen, data.b },
-      { proxsuite::linalg::sparse::from_eigen, CT_unscaled.to_eigen() },
-      { proxsuite::linalg::sparse::from_eigen, data.l },
-      { proxsuite::linalg::sparse::from_eigen, data.u }
-    };
-
-    switch (settings.initial_guess) { // the following is used when one solve
-                                      // has already been executed
-      case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
-        results.cleanup(settings);
-        break;
-      }
-      case InitialGuessStatus::COLD_START_WITH_PREVIOUS_RESULT: {
-        // keep solutions but restart workspace and results
-        results.cold_start(settings);
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen, results.x });
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-      case InitialGuessStatus::NO_INITIAL_GUESS: {
-        results.cleanup(settings);
-        break;
-      }
-      case InitialGuessStatus::WARM_START: {
-        results.cold_start(settings); // because there was already a solve,
-                                      // precond was already computed if set so
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen,
-            results.x }); // it contains the value given in entry for warm start
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-      case InitialGuessStatus::WARM_START_WITH_PREVIOUS_RESULT: {
-        // keep workspace and results solutions except statistics
-        results.cleanup_statistics();
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen, results.x });
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-    }
-    work.setup_impl(
-      qp,
-      data,
-      settings,
-      false,
-      precond,
-      P::scale_qp_in_place_req(
-        proxsuite::linalg::veg::Tag<T>{}, data.dim, data.n_eq, data.n_in));
-
-  } else {
-    // the following is used for a first solve after initializing or updating
-    // the Qp object
-    switch (settings.initial_guess) {
-      case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
-        break;
-      }
-      case InitialGuessStatus::COLD_START_WITH_PREVIOUS_RESULT: {
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen,
-            results.x }); // meaningful for when there is an upate of the model
-                          // and one wants to warm start with previous result
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-      case InitialGuessStatus::NO_INITIAL_GUESS: {
-        break;
-      }
-      case InitialGuessStatus::WARM_START: {
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen, results.x });
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-      case InitialGuessStatus::WARM_START_WITH_PREVIOUS_RESULT: {
-        precond.scale_primal_in_place(
-          { proxsuite::proxqp::from_eigen,
-            results.x }); // meaningful for when there is an upate of the model
-                          // and one wants to warm start with previous result
-        precond.scale_dual_in_place_eq(
-          { proxsuite::proxqp::from_eigen, results.y });
-        precond.scale_dual_in_place_in(
-          { proxsuite::proxqp::from_eigen, results.z });
-        break;
-      }
-    }
+  return row_indices;
+}
+/// otherwise, they are copied to buf
+template<typename I, typename J>
+auto
+factor_row_indices(I const* row_indices, J* buf, isize nnz) -> J const*
+{
+  for (isize p = 0; p < nnz; ++p) {
+    buf[p] = J(proxsuite::linalg::sparse::util::zero_extend(row_indices[p]));
   }
+  return buf;
+}
 
+/// executes the PROXQP algorithm once the workspace is set up, the factor of
+/// the KKT matrix being stored in ldl_storage, whose indices have the type J
+template<typename T, typename I, typename J, typename P>
+void
+qp_solve_impl(Results<T>& results,
+              Model<T, I>& data,
+              const Settings<T>& settings,
+              Workspace<T, I>& work,
+              P& precond,
+              Ldlt<T, J>& ldl_storage)
+{
   if (settings.verbose) {
     sparse::print_setup_header(settings, results, data);
   }
@@ -523,27 +392,35 @@ qp_solve(Results<T>& results,
 
   T const dual_feasibility_rhs_2 = infty_norm(data.g);
 
-  // auto ldl_col_ptrs = work.ldl_col_ptrs_mut();
-  auto ldl_col_ptrs = work.internal.ldl.col_ptrs.ptr_mut();
-  proxsuite::linalg::veg::Tag<I> itag;
+  J* ldl_col_ptrs = ldl_storage.col_ptrs.ptr_mut();
+  proxsuite::linalg::veg::Tag<J> jtag;
   proxsuite::linalg::veg::Tag<T> xtag;
 
   bool do_ldlt = work.internal.do_ldlt;
 
   isize ldlt_ntot = do_ldlt ? n_tot : 0;
 
-  auto _perm = stack.make_new_for_overwrite(itag, ldlt_ntot);
+  auto _perm = stack.make_new_for_overwrite(jtag, ldlt_ntot);
 
-  I* perm_inv = work.internal.ldl.perm_inv.ptr_mut();
-  I* perm = _perm.ptr_mut();
+  J* perm_inv = ldl_storage.perm_inv.ptr_mut();
+  J* perm = _perm.ptr_mut();
 
   if (do_ldlt) {
     // compute perm from perm_inv
     for (isize i = 0; i < n_tot; ++i) {
-      perm[isize(zx(perm_inv[i]))] = I(i);
+      perm[isize(zx(perm_inv[i]))] = J(i);
     }
   }
 
+  // the rows of the inequality constraints added to the factor are read from
+  // the columns of CT, whose row indices have the type of the indices of the
+  // factor
+  isize ct_start = isize(zx(kkt.col_ptrs()[n + n_eq]));
+  auto _ct_row_indices = stack.make_new_for_overwrite(
+    jtag, (do_ldlt && work.internal.wide_ldl) ? data.C_nnz : 0);
+  J const* ct_row_indices = detail::factor_row_indices(
+    kkt.row_indices() + ct_start, _ct_row_indices.ptr_mut(), data.C_nnz);
+
   I* kkt_nnz_counts = work.internal.kkt_nnz_counts.ptr_mut();
 
   auto& iterative_solver = *work.internal.matrix_free_solver.get();
@@ -651,14 +528,14 @@ qp_solve(Results<T>& results,
     kkt.values_mut(),
   };
 
-  I* etree = work.internal.ldl.etree.ptr_mut();
-  I* ldl_nnz_counts = work.internal.ldl.nnz_counts.ptr_mut();
-  I* ldl_row_indices = work.internal.ldl.row_indices.ptr_mut();
-  T* ldl_values = work.internal.ldl.values.ptr_mut();
+  J* etree = ldl_storage.etree.ptr_mut();
+  J* ldl_nnz_counts = ldl_storage.nnz_counts.ptr_mut();
+  J* ldl_row_indices = ldl_storage.row_indices.ptr_mut();
+  T* ldl_values = ldl_storage.values.ptr_mut();
   proxsuite::linalg::veg::SliceMut<bool> active_constraints =
     results.active_constraints.as_mut();
 
-  proxsuite::linalg::sparse::MatMut<T, I> ldl = {
+  proxsuite::linalg::sparse::MatMut<T, J> ldl = {
     proxsuite::linalg::sparse::from_raw_parts,
     n_tot,
     n_tot,
@@ -697,9 +574,8 @@ qp_solve(Results<T>& results,
                          iterative_solver,
                          do_ldlt,
                          stack,
-                         ldl_values,
+                         ldl_storage.solve_schedule,
                          perm,
-                         ldl_col_ptrs,
                          perm_inv,
                          settings,
                          kkt_active,
@@ -897,6 +773,19 @@ qp_solve(Results<T>& results,
               bool removed = false;
               bool added = false;
 
+              // the rows of the factorization are deleted and added in two
+              // batches, which share the traversals of the elimination tree
+              auto _removed_positions =
+                stack.make_new_for_overwrite(jtag, n_in);
+              auto _added_positions = stack.make_new_for_overwrite(jtag, n_in);
+              auto _added_col_starts =
+                stack.make_new_for_overwrite(jtag, n_in);
+              auto _added_col_nnz = stack.make_new_for_overwrite(jtag, n_in);
+              auto _added_diag = stack.make_new_for_overwrite(xtag, n_in);
+              isize n_removed = 0;
+              isize n_added = 0;
+              isize added_nnz = 0;
+
               for (isize i = 0; i < n_in; ++i) {
                 bool was_active = active_constraints[i];
                 bool is_active = new_active_constraints[i];
@@ -912,38 +801,59 @@ qp_solve(Results<T>& results,
                   kkt_active.nnz_per_col_mut()[idx] = I(col_nnz);
                   kkt_active._set_nnz(kkt_active.nnz() + isize(col_nnz));
 
-                  if (do_ldlt) {
-                    proxsuite::linalg::sparse::VecRef<T, I> new_col{
-                      proxsuite::linalg::sparse::from_raw_parts,
-                      n_tot,
-                      isize(col_nnz),
-                      kkt.row_indices() + zx(kkt.col_start(usize(idx))),
-                      kkt.values() + zx(kkt.col_start(usize(idx))),
-                    };
-
-                    ldl =
-                      proxsuite::linalg::sparse::add_row(ldl,
-                                                         etree,
-                                                         perm_inv,
-                                                         idx,
-                                                         new_col,
-                                                         -results.info.mu_in,
-                                                         stack);
-                  }
+                  _added_positions.ptr_mut()[n_added] = J(idx);
+                  _added_col_starts.ptr_mut()[n_added] =
+                    J(isize(zx(kkt.col_start(usize(idx)))) - ct_start);
+                  _added_col_nnz.ptr_mut()[n_added] = J(col_nnz);
+                  _added_diag.ptr_mut()[n_added] = -results.info.mu_in;
+                  added_nnz += isize(col_nnz);
+                  ++n_added;
                   active_constraints[i] = new_active_constraints[i];
 
                 } else if (!is_active && was_active) {
                   removed = true;
                   kkt_active.nnz_per_col_mut()[idx] = 0;
                   kkt_active._set_nnz(kkt_active.nnz() - isize(col_nnz));
-                  if (do_ldlt) {
-                    ldl = proxsuite::linalg::sparse::delete_row(
-                      ldl, etree, perm_inv, idx, stack);
-                  }
+                  _removed_positions.ptr_mut()[n_removed] = J(idx);
+                  ++n_removed;
                   active_constraints[i] = new_active_constraints[i];
                 }
               }
 
+              if (do_ldlt) {
+                ldl = proxsuite::linalg::sparse::delete_rows(
+                  ldl,
+                  etree,
+                  perm_inv,
+                  { proxsuite::linalg::veg::unsafe,
+                    proxsuite::linalg::veg::from_raw_parts,
+                    _removed_positions.ptr(),
+                    n_removed },
+                  stack);
+                ldl = proxsuite::linalg::sparse::add_rows(
+                  ldl,
+                  etree,
+                  perm_inv,
+                  { proxsuite::linalg::veg::unsafe,
+                    proxsuite::linalg::veg::from_raw_parts,
+                    _added_positions.ptr(),
+                    n_added },
+                  proxsuite::linalg::sparse::MatRef<T, J>{
+                    proxsuite::linalg::sparse::from_raw_parts,
+                    n_tot,
+                    n_added,
+                    added_nnz,
+                    _added_col_starts.ptr(),
+                    _added_col_nnz.ptr(),
+                    ct_row_indices,
+                    kkt.values() + ct_start,
+                  },
+                  _added_diag.ptr(),
+                  stack);
+                detail::update_ldl_solve_schedule(
+                  ldl_storage, n_tot, work.internal.nb_threads_solve, stack);
+              }
+
               if (!do_ldlt) {
                 if (removed || added) {
                   refactorize(work,
@@ -985,9 +895,8 @@ qp_solve(Results<T>& results,
               iterative_solver,
               do_ldlt,
               stack,
-              ldl_values,
+              ldl_storage.solve_schedule,
               perm,
-              ldl_col_ptrs,
               perm_inv,
               settings,
               kkt_active,
@@ -1075,12 +984,9 @@ qp_solve(Results<T>& results,
                 }
               }
             }
-            std::sort(alphas.data(), alphas.data() + alphas_count);
-            alphas_count =
-              std::unique(alphas.data(), alphas.data() + alphas_count) -
-              alphas.data();
 
-            if (alphas_count > 0 && alphas[0] <= 1) {
+            if (alphas_count > 0 &&
+                alphas.head(alphas_count).minCoeff() <= 1) {
               auto infty = std::numeric_limits<T>::infinity();
 
               T last_neg_grad = 0;
@@ -1089,19 +995,40 @@ qp_solve(Results<T>& results,
               T alpha_first_pos = infty;
 
               {
-                for (isize i = 0; i < alphas_count; ++i) {
-                  T alpha_cur = alphas[i];
-                  T gr = primal_dual_gradient_norm(alpha_cur).grad;
-
-                  if (gr < 0) {
-                    alpha_last_neg = alpha_cur;
-                    last_neg_grad = gr;
-                  } else {
-                    first_pos_grad = gr;
-                    alpha_first_pos = alpha_cur;
-                    break;
-                  }
-                }
+                // the derivative is updated from one alpha to the next with
+                // the contributions of the constraints whose activity changes
+                LDLT_TEMP_VEC_UNINIT(T, grad_updates, 2 * alphas_count, stack);
+                auto _tests = stack.make_new_for_overwrite(
+                  proxsuite::linalg::veg::Tag<unsigned char>{}, n_in);
+                auto contribution =
+                  [&](isize i, bool lo_active, bool up_active, T& a, T& b) {
+                    T Cdx_act = (lo_active || up_active) ? Cdx(i) : T(0);
+                    T res_act =
+                      (lo_active ? primal_residual_in_scaled_lo(i) : T(0)) +
+                      (up_active ? primal_residual_in_scaled_up(i) : T(0));
+                    T err = results.info.mu_in_inv * Cdx_act - dz(i);
+                    a = results.info.mu_in_inv * Cdx_act * Cdx_act +
+                        results.info.nu * results.info.mu_in * err * err;
+                    b = results.info.mu_in_inv * Cdx_act * res_act +
+                        results.info.nu *
+                          (res_act - results.info.mu_in * z_e(i)) * err;
+                  };
+                auto bracket = proxqp::detail::breakpoint_sweep(
+                  alphas.data(),
+                  alphas_count,
+                  primal_residual_in_scaled_lo.data(),
+                  primal_residual_in_scaled_up.data(),
+                  Cdx.data(),
+                  n_in,
+                  primal_dual_gradient_norm,
+                  contribution,
+                  grad_updates.data(),
+                  grad_updates.data() + alphas_count,
+                  _tests.ptr_mut());
+                alpha_last_neg = bracket.alpha_last_neg;
+                last_neg_grad = bracket.last_neg_grad;
+                alpha_first_pos = bracket.alpha_first_pos;
+                first_pos_grad = bracket.first_pos_grad;
 
                 if (alpha_last_neg == 0) {
                   last_neg_grad =
@@ -1321,29 +1248,53 @@ qp_solve(Results<T>& results,
                       xtag);
       */
       if (work.internal.do_ldlt) {
-        isize w_values = 1; // un seul elt non nul
-        T alpha = 0;
+        // the regularization of the equality and active inequality
+        // constraints is updated with a single multiple rank update, whose
+        // columns are the corresponding columns of the identity
+        isize n_active_in = 0;
+        for (isize j = 0; j < n_in; ++j) {
+          n_active_in += results.active_constraints[j] ? 1 : 0;
+        }
+        isize rank = n_eq + n_active_in;
+        auto _w_col_ptrs = stack.make_new_for_overwrite(jtag, rank + 1);
+        auto _w_row_indices = stack.make_new_for_overwrite(jtag, rank);
+        auto _w_values = stack.make_new_for_overwrite(xtag, rank);
+        auto _alpha = stack.make_new_for_overwrite(xtag, rank);
+        J* w_col_ptrs = _w_col_ptrs.ptr_mut();
+        J* w_row_indices = _w_row_indices.ptr_mut();
+        T* w_values = _w_values.ptr_mut();
+        T* alpha = _alpha.ptr_mut();
+
+        isize k = 0;
+        w_col_ptrs[0] = 0;
         for (isize j = 0; j < n_eq + n_in; ++j) {
-          I row_index = I(j + n);
           if (j < n_eq) {
-            alpha = results.info.mu_eq - new_bcl_mu_eq;
-
+            alpha[k] = results.info.mu_eq - new_bcl_mu_eq;
           } else {
             if (!results.active_constraints[j - n_eq]) {
               continue;
             }
-            alpha = results.info.mu_in - new_bcl_mu_in;
+            alpha[k] = results.info.mu_in - new_bcl_mu_in;
           }
-          T value = 1;
-          proxsuite::linalg::sparse::VecRef<T, I> w{
-            proxsuite::linalg::veg::from_raw_parts,
-            n + n_eq + n_in,
-            w_values,
-            &row_index, // &: adresse de row index
-            &value,
-          };
-          ldl = rank1_update(ldl, etree, perm_inv, w, alpha, stack);
+          w_row_indices[k] = J(j + n);
+          w_values[k] = 1;
+          w_col_ptrs[k + 1] = J(k + 1);
+          ++k;
         }
+        proxsuite::linalg::sparse::MatRef<T, J> w{
+          proxsuite::linalg::sparse::from_raw_parts,
+          n + n_eq + n_in,
+          rank,
+          rank,
+          w_col_ptrs,
+          nullptr,
+          w_row_indices,
+          w_values,
+        };
+        ldl = proxsuite::linalg::sparse::rank_r_update(
+          ldl, etree, perm_inv, w, alpha, stack);
+        detail::update_ldl_solve_schedule(
+          ldl_storage, n_tot, work.internal.nb_threads_solve, stack);
       } else {
         refactorize(
           work, results, kkt_active, active_constraints, data, stack, xtag);
@@ -1417,6 +1368,171 @@ qp_solve(Results<T>& results,
 
   work.set_dirty();
 }
+} // namespace detail
+
+/*!
+ * Executes the PROXQP algorithm.
+ *
+ * @param work solver workspace.
+ * @param model QP problem model as defined by the user (without any scaling
+ * performed).
+ * @param settings solver settings.
+ * @param results solver results.
+ * @param precond preconditioner.
+ */
+template<typename T, typename I, typename P>
+void
+qp_solve(Results<T>& results,
+         Model<T, I>& data,
+         const Settings<T>& settings,
+         Workspace<T, I>& work,
+         P& precond)
+{
+  if (settings.compute_timings) {
+    work.timer.stop();
+    work.timer.start();
+  }
+
+  if (work.internal
+        .dirty) // the following is used when a solve has already been executed
+                // (and without any intermediary model update)
+  {
+    proxsuite::linalg::sparse::MatMut<T, I> kkt_unscaled =
+      data.kkt_mut_unscaled();
+
+    auto kkt_top_n_rows = detail::top_rows_mut_unchecked(
+      proxsuite::linalg::veg::unsafe, kkt_unscaled, data.dim);
+
+    proxsuite::linalg::sparse::MatMut<T, I> H_unscaled =
+      detail::middle_cols_mut(kkt_top_n_rows, 0, data.dim, data.H_nnz);
+
+    proxsuite::linalg::sparse::MatMut<T, I> AT_unscaled =
+      detail::middle_cols_mut(kkt_top_n_rows, data.dim, data.n_eq, data.A_nnz);
+
+    proxsuite::linalg::sparse::MatMut<T, I> CT_unscaled =
+      detail::middle_cols_mut(
+        kkt_top_n_rows, data.dim + data.n_eq, data.n_in, data.C_nnz);
+
+    SparseMat<T, I> H_triu =
+      H_unscaled.to_eigen().template triangularView<Eigen::Upper>();
+    sparse::QpView<T, I> qp = {
+      { proxsuite::linalg::sparse::from_eigen, H_triu },
+      { proxsuite::linalg::sparse::from_eigen, data.g },
+      { proxsuite::linalg::sparse::from_eigen, AT_unscaled.to_eigen() },
+      { proxsuite::linalg::sparse::from_eigen, data.b },
+      { proxsuite::linalg::sparse::from_eigen, CT_unscaled.to_eigen() },
+      { proxsuite::linalg::sparse::from_eigen, data.l },
+      { proxsuite::linalg::sparse::from_eigen, data.u }
+    };
+
+    switch (settings.initial_guess) { // the following is used when one solve
+                                      // has already been executed
+      case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
+        results.cleanup(settings);
+        break;
+      }
+      case InitialGuessStatus::COLD_START_WITH_PREVIOUS_RESULT: {
+        // keep solutions but restart workspace and results
+        results.cold_start(settings);
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen, results.x });
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+      case InitialGuessStatus::NO_INITIAL_GUESS: {
+        results.cleanup(settings);
+        break;
+      }
+      case InitialGuessStatus::WARM_START: {
+        results.cold_start(settings); // because there was already a solve,
+                                      // precond was already computed if set so
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen,
+            results.x }); // it contains the value given in entry for warm start
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+      case InitialGuessStatus::WARM_START_WITH_PREVIOUS_RESULT: {
+        // keep workspace and results solutions except statistics
+        results.cleanup_statistics();
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen, results.x });
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+    }
+    work.setup_impl(
+      qp,
+      data,
+      settings,
+      false,
+      precond,
+      P::scale_qp_in_place_req(
+        proxsuite::linalg::veg::Tag<T>{}, data.dim, data.n_eq, data.n_in));
+
+  } else {
+    // the following is used for a first solve after initializing or updating
+    // the Qp object
+    switch (settings.initial_guess) {
+      case InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS: {
+        break;
+      }
+      case InitialGuessStatus::COLD_START_WITH_PREVIOUS_RESULT: {
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen,
+            results.x }); // meaningful for when there is an upate of the model
+                          // and one wants to warm start with previous result
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+      case InitialGuessStatus::NO_INITIAL_GUESS: {
+        break;
+      }
+      case InitialGuessStatus::WARM_START: {
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen, results.x });
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+      case InitialGuessStatus::WARM_START_WITH_PREVIOUS_RESULT: {
+        precond.scale_primal_in_place(
+          { proxsuite::proxqp::from_eigen,
+            results.x }); // meaningful for when there is an upate of the model
+                          // and one wants to warm start with previous result
+        precond.scale_dual_in_place_eq(
+          { proxsuite::proxqp::from_eigen, results.y });
+        precond.scale_dual_in_place_in(
+          { proxsuite::proxqp::from_eigen, results.z });
+        break;
+      }
+    }
+  }
+
+  // the factor is stored with 64 bits indices if its number of non zeros
+  // overflows I
+  if (work.internal.wide_ldl) {
+    detail::qp_solve_impl(
+      results, data, settings, work, precond, work.internal.ldl_wide);
+  } else {
+    detail::qp_solve_impl(
+      results, data, settings, work, precond, work.internal.ldl);
+  }
+}
 } // namespace sparse
 } // namespace proxqp
 } // namespace proxsuite
@@ -55,6 +55,13 @@ print_setup_header(const Settings<T>& settings,
     std::cout << " -> " << results.info.sparse_backend;
   }
   std::cout << "," << std::endl;
+  std::cout << "          sparse_ordering = " << settings.sparse_ordering;
+  if (settings.sparse_ordering == SparseOrdering::Automatic) {
+    std::cout << " -> " << results.info.sparse_ordering;
+  }
+  std::cout << ", factor nnz = " << results.info.factor_nnz
+            << ", factor flops = " << results.info.factor_flops << ","
+            << std::endl;
   std::cout << "          eps_abs = " << settings.eps_abs
             << ", eps_rel = " << settings.eps_rel << std::endl;
   std::cout << "          eps_prim_inf = " << settings.eps_primal_inf
@@ -9,17 +9,21 @@
 #include <proxsuite/linalg/dense/core.hpp>
 #include <proxsuite/linalg/sparse/core.hpp>
 #include <proxsuite/linalg/sparse/factorize.hpp>
+#include <proxsuite/linalg/sparse/supernodal.hpp>
+#include <proxsuite/linalg/sparse/solve.hpp>
 #include <proxsuite/linalg/sparse/update.hpp>
 #include <proxsuite/linalg/sparse/rowmod.hpp>
 #include <proxsuite/proxqp/timings.hpp>
 #include <proxsuite/proxqp/settings.hpp>
 #include <proxsuite/proxqp/dense/views.hpp>
 #include <proxsuite/linalg/veg/vec.hpp>
+#include <proxsuite/helpers/memory.hpp>
 #include "proxsuite/proxqp/sparse/views.hpp"
 #include "proxsuite/proxqp/sparse/model.hpp"
 #include "proxsuite/proxqp/results.hpp"
 #include "proxsuite/proxqp/sparse/utils.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <Eigen/IterativeLinearSolvers>
 #include <unsupported/Eigen/IterativeSolvers>
@@ -36,59 +40,542 @@ namespace sparse {
 template<typename T, typename I>
 struct Workspace;
 
+/*!
+ * Computes the stack memory requirements of the fill reducing ordering of the
+ * KKT matrix.
+ *
+ * @param n_tot dimension of the KKT matrix.
+ * @param nnz_tot number of non zeros of the KKT matrix.
+ * @param ordering fill reducing ordering, `Automatic` standing for any of the
+ * other ones.
+ */
+template<typename I>
+auto
+kkt_ordering_req(proxsuite::linalg::veg::Tag<I> itag,
+                 isize n_tot,
+                 isize nnz_tot,
+                 SparseOrdering ordering) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  StackReq amd_req = proxsuite::linalg::sparse::amd_req(itag, n_tot, nnz_tot);
+  StackReq camd_req =
+    StackReq::with_len(itag, n_tot) &
+    proxsuite::linalg::sparse::camd_req(itag, n_tot, nnz_tot);
+  StackReq nd_req =
+    proxsuite::linalg::sparse::nested_dissection_req(itag, n_tot, nnz_tot);
+  switch (ordering) {
+    case SparseOrdering::Natural:
+      return StackReq{ 0, 1 };
+    case SparseOrdering::AMD:
+      return amd_req;
+    case SparseOrdering::ConstrainedAMD:
+      return camd_req;
+    case SparseOrdering::NestedDissection:
+      return nd_req;
+    default:
+      return amd_req | camd_req | nd_req;
+  }
+}
+
+/*!
+ * Computes the fill reducing ordering `ordering` of the KKT matrix, which must
+ * not be `Automatic`.
+ *
+ * @param perm storage for the permutation, of size `n_tot`
+ * @param kkt symbolic structure of the KKT matrix
+ * @param dim primal dimension.
+ * @param ordering fill reducing ordering.
+ * @param stack temporary allocation stack
+ */
+template<typename I>
+void
+kkt_ordering(I* perm,
+             proxsuite::linalg::sparse::SymbolicMatRef<I> kkt,
+             isize dim,
+             SparseOrdering ordering,
+             proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  proxsuite::linalg::veg::Tag<I> itag;
+  isize n_tot = kkt.nrows();
+  switch (ordering) {
+    case SparseOrdering::Natural: {
+      for (isize i = 0; i < n_tot; ++i) {
+        perm[i] = I(i);
+      }
+      break;
+    }
+    case SparseOrdering::AMD: {
+      proxsuite::linalg::sparse::amd(perm, kkt, stack);
+      break;
+    }
+    case SparseOrdering::ConstrainedAMD: {
+      // the primal variables come first, then the constraint rows
+      auto _cons = stack.make_new_for_overwrite(itag, n_tot);
+      I* cons = _cons.ptr_mut();
+      for (isize i = 0; i < n_tot; ++i) {
+        cons[i] = I(i < dim ? 0 : 1);
+      }
+      proxsuite::linalg::sparse::camd(perm, kkt, cons, stack);
+      break;
+    }
+    default: {
+      VEG_ASSERT(ordering == SparseOrdering::NestedDissection);
+      proxsuite::linalg::sparse::nested_dissection(perm, kkt, stack);
+      break;
+    }
+  }
+}
+
+/*!
+ * Predicted number of floating point operations of the LDLT factorization,
+ * from the number of non zeros in each column of its factor.
+ *
+ * @param nnz_per_col non-zeros per column of the factor, of size `n`
+ * @param n dimension of the factor.
+ */
+template<typename I>
+auto
+factorization_flops(I const* nnz_per_col, isize n) noexcept -> double
+{
+  double flops = 0;
+  for (isize j = 0; j < n; ++j) {
+    double count = double(proxsuite::linalg::sparse::util::zero_extend(
+      nnz_per_col[j]));
+    flops += count * count;
+  }
+  return flops;
+}
+
+/*!
+ * Computes the stack memory requirements of the symbolic factorization of the
+ * KKT matrix, with the fill reducing ordering `ordering`.
+ *
+ * @param n_tot dimension of the KKT matrix.
+ * @param nnz_tot number of non zeros of the KKT matrix.
+ * @param ordering fill reducing ordering.
+ * @param nb_threads number of threads of the permutation and transposition
+ * passes.
+ */
+template<typename I>
+auto
+kkt_symbolic_req(proxsuite::linalg::veg::Tag<I> itag,
+                 isize n_tot,
+                 isize nnz_tot,
+                 SparseOrdering ordering,
+                 isize nb_threads = 1) noexcept
+  -> proxsuite::linalg::veg::dynstack::StackReq
+{
+  using proxsuite::linalg::veg::dynstack::StackReq;
+  isize n_work = ordering == SparseOrdering::Automatic ? 4 * n_tot : n_tot;
+  return StackReq::with_len(itag, n_work) &
+         (kkt_ordering_req(itag, n_tot, nnz_tot, ordering) |
+          proxsuite::linalg::sparse::factorize_symbolic_req(
+            itag,
+            n_tot,
+            nnz_tot,
+            proxsuite::linalg::sparse::Ordering::user_provided,
+            nb_threads));
+}
+
+/*!
+ * Performs the symbolic factorization of the KKT matrix, with the fill
+ * reducing ordering `ordering`. The `Automatic` ordering evaluates each of
+ * the other ones, and keeps the one with the smallest predicted number of
+ * floating point operations of the factorization.
+ *
+ * @param nnz_per_col storage for non-zeros per column, of size `n_tot`
+ * @param etree storage for elimination tree, of size `n_tot`
+ * @param perm_inv storage for the inverse of the ordering, of size `n_tot`
+ * @param kkt symbolic structure of the KKT matrix
+ * @param dim primal dimension.
+ * @param ordering fill reducing ordering.
+ * @param stack temporary allocation stack
+ * @param nb_threads number of threads of the permutation and transposition
+ * passes.
+ * @return the ordering that was applied.
+ */
+template<typename I>
+auto
+kkt_symbolic_non_zeros(I* nnz_per_col,
+                       I* etree,
+                       I* perm_inv,
+                       proxsuite::linalg::sparse::SymbolicMatRef<I> kkt,
+                       isize dim,
+                       SparseOrdering ordering,
+                       proxsuite::linalg::veg::dynstack::DynStackMut stack,
+                       isize nb_threads = 1) -> SparseOrdering
+{
+  proxsuite::linalg::veg::Tag<I> itag;
+  isize n_tot = kkt.nrows();
+  auto _perm = stack.make_new_for_overwrite(itag, n_tot);
+
+  if (ordering != SparseOrdering::Automatic) {
+    kkt_ordering(_perm.ptr_mut(), kkt, dim, ordering, stack);
+    proxsuite::linalg::sparse::factorize_symbolic_non_zeros(
+      nnz_per_col, etree, perm_inv, _perm.ptr(), kkt, stack, nb_threads);
+    return ordering;
+  }
+
+  // the outputs hold the symbolic factorization of the best candidate so far
+  auto _nnz_per_col = stack.make_new_for_overwrite(itag, n_tot);
+  auto _etree = stack.make_new_for_overwrite(itag, n_tot);
+  auto _perm_inv = stack.make_new_for_overwrite(itag, n_tot);
+
+  SparseOrdering best = SparseOrdering::Automatic;
+  double best_flops = 0;
+  for (SparseOrdering candidate : { SparseOrdering::AMD,
+                                    SparseOrdering::ConstrainedAMD,
+                                    SparseOrdering::NestedDissection,
+                                    SparseOrdering::Natural }) {
+    kkt_ordering(_perm.ptr_mut(), kkt, dim, candidate, stack);
+    proxsuite::linalg::sparse::factorize_symbolic_non_zeros(
+      _nnz_per_col.ptr_mut(),
+      _etree.ptr_mut(),
+      _perm_inv.ptr_mut(),
+      _perm.ptr(),
+      kkt,
+      stack,
+      nb_threads);
+    double flops = factorization_flops(_nnz_per_col.ptr(), n_tot);
+    if (best == SparseOrdering::Automatic || flops < best_flops) {
+      best = candidate;
+      best_flops = flops;
+      for (isize i = 0; i < n_tot; ++i) {
+        nnz_per_col[i] = _nnz_per_col.ptr()[i];
+        etree[i] = _etree.ptr()[i];
+        perm_inv[i] = _perm_inv.ptr()[i];
+      }
+    }
+  }
+  return best;
+}
+
+/*!
+ * Decides from its predicted cost whether the sparse LDLT factorization of
+ * the KKT matrix is preferable to the matrix free backend. The factor must
+ * fit in the memory budget, and one factorization must cost at most as much
+ * as the matrix-vector products of the number of MINRES iterations it
+ * typically saves.
+ *
+ * @param lnnz predicted number of non zeros of the factor.
+ * @param flops predicted number of floating point operations of the
+ * factorization.
+ * @param nnz_tot number of non zeros of the KKT matrix.
+ * @param memory_budget maximal size in bytes of the factor, whose indices
+ * have the type I (0 for half of the physical memory).
+ */
 template<typename T, typename I>
+auto
+ldlt_is_affordable(isize lnnz,
+                   double flops,
+                   isize nnz_tot,
+                   isize memory_budget) noexcept -> bool
+{
+  constexpr double saved_minres_iterations = 100000;
+  double factor_bytes = double(lnnz) * double(sizeof(T) + sizeof(I));
+  double budget = double(memory_budget);
+  if (memory_budget <= 0) {
+    // half of the physical memory, no limit if it cannot be queried
+    budget = 0.5 * double(proxsuite::helpers::physical_memory());
+  }
+  if (budget > 0 && factor_bytes > budget) {
+    return false;
+  }
+  // a product with the symmetric KKT matrix, stored as its upper triangular
+  // part, costs about 4 flops per stored non zero
+  return flops <= saved_minres_iterations * 4 * double(nnz_tot);
+}
+
+/*!
+ * Number of threads of the triangular solves with the sparse factor, which
+ * only pay off the cost of spawning the threads for large factors.
+ *
+ * @param nb_threads number of threads requested in the settings.
+ * @param lnnz number of non zeros the storage of the factor can hold.
+ */
+inline auto
+ldl_solve_nb_threads(isize nb_threads, isize lnnz) noexcept -> isize
+{
+  constexpr isize min_parallel_lnnz = 1000000;
+  nb_threads = proxsuite::helpers::resolve_nb_threads(nb_threads);
+  return (nb_threads > 1 && lnnz >= min_parallel_lnnz) ? nb_threads : 1;
+}
+
+/*!
+ * Number of threads of the permutation and transposition passes over the KKT
+ * matrix during the symbolic factorization, which are only worth splitting
+ * for large matrices.
+ *
+ * @param nb_threads number of threads requested in the settings.
+ * @param nnz_tot number of non zeros of the KKT matrix.
+ */
+inline auto
+kkt_symbolic_nb_threads(isize nb_threads, isize nnz_tot) noexcept -> isize
+{
+  constexpr isize min_parallel_nnz = 1000000;
+  nb_threads = proxsuite::helpers::resolve_nb_threads(nb_threads);
+  return (nb_threads > 1 && nnz_tot >= min_parallel_nnz) ? nb_threads : 1;
+}
+
+template<typename T, typename I>
+struct Ldlt
+{
+  proxsuite::linalg::veg::Vec<I> etree;
+  proxsuite::linalg::veg::Vec<I> perm;
+  proxsuite::linalg::veg::Vec<I> perm_inv;
+  proxsuite::linalg::veg::Vec<I> col_ptrs;
+  proxsuite::linalg::veg::Vec<I> nnz_counts;
+  proxsuite::linalg::veg::Vec<I> row_indices;
+  proxsuite::linalg::veg::Vec<T> values;
+  // schedule of the triangular solves with the factor, which is computed
+  // again whenever the structure of the factor changes
+  proxsuite::linalg::veg::Vec<I> solve_sn_start;
+  proxsuite::linalg::veg::Vec<I> solve_order;
+  proxsuite::linalg::veg::Vec<I> solve_subtree_ptr;
+  proxsuite::linalg::sparse::LdltSolveSchedule<I> solve_schedule{};
+};
+/// symbolic data of the last factorization computed from scratch, which lets
+/// the following factorizations with the same active set only compute the
+/// values of the factor
+template<typename I>
+struct LdltPattern
+{
+  bool valid = false;
+  bool supernodal = false; // whether the data is the one of the supernodal
+                           // factorization
+  proxsuite::linalg::veg::Vec<I> kkt_nnz_counts;
+  proxsuite::linalg::veg::Vec<I> etree;
+  proxsuite::linalg::veg::Vec<I> nnz_counts;
+  proxsuite::linalg::veg::Vec<I> permuted_col_ptrs;
+  proxsuite::linalg::veg::Vec<I> permuted_row_indices;
+  proxsuite::linalg::veg::Vec<I> permuted_sources;
+  proxsuite::linalg::veg::Vec<I> l_row_ptrs;
+  proxsuite::linalg::veg::Vec<I> l_col_indices;
+  // lower triangular part of the permuted KKT matrix, which the supernodal
+  // factorization is assembled from
+  proxsuite::linalg::veg::Vec<I> lower_col_ptrs;
+  proxsuite::linalg::veg::Vec<I> lower_row_indices;
+  proxsuite::linalg::veg::Vec<I> lower_sources;
+};
+
+namespace detail {
+/// computes the schedule of the triangular solves with the factor stored in
+/// ldl, after a factorization or a modification of its structure
+template<typename T, typename J>
 void
-refactorize(Workspace<T, I>& work,
-            Results<T> const& results,
-            proxsuite::linalg::sparse::MatMut<T, I> kkt_active,
-            proxsuite::linalg::veg::SliceMut<bool> active_constraints,
-            Model<T, I> const& data,
-            proxsuite::linalg::veg::dynstack::DynStackMut stack,
-            proxsuite::linalg::veg::Tag<T>& xtag)
+update_ldl_solve_schedule(Ldlt<T, J>& ldl,
+                          isize n_tot,
+                          isize nb_threads,
+                          proxsuite::linalg::veg::dynstack::DynStackMut stack)
+{
+  ldl.solve_schedule = proxsuite::linalg::sparse::ldlt_solve_schedule(
+    ldl.solve_sn_start.ptr_mut(),
+    ldl.solve_order.ptr_mut(),
+    ldl.solve_subtree_ptr.ptr_mut(),
+    proxsuite::linalg::sparse::MatRef<T, J>{
+      proxsuite::linalg::sparse::from_raw_parts,
+      n_tot,
+      n_tot,
+      0,
+      ldl.col_ptrs.ptr(),
+      ldl.nnz_counts.ptr(),
+      ldl.row_indices.ptr(),
+      ldl.values.ptr(),
+    },
+    nb_threads,
+    stack);
+}
+
+/// factorizes the active part of the KKT matrix in the factor storage ldl,
+/// whose indices have the type J
+template<typename T, typename I, typename J>
+void
+refactorize_ldlt(Workspace<T, I>& work,
+                 Ldlt<T, J>& ldl,
+                 LdltPattern<J>& ldl_pattern,
+                 Results<T> const& results,
+                 proxsuite::linalg::sparse::MatMut<T, J> kkt_active,
+                 proxsuite::linalg::veg::SliceMut<bool> active_constraints,
+                 Model<T, I> const& data,
+                 proxsuite::linalg::veg::dynstack::DynStackMut stack,
+                 proxsuite::linalg::veg::Tag<T>& xtag)
 {
   isize n_tot = kkt_active.nrows();
   T mu_eq_neg = -results.info.mu_eq;
   T mu_in_neg = -results.info.mu_in;
-
-  if (work.internal.do_ldlt) {
+  usize n_tot_ = usize(n_tot);
+
+  // the cached symbolic data can be reused if the active set, and thus the
+  // sparsity pattern of kkt_active, is the one it was computed with
+  bool reuse_pattern =
+    ldl_pattern.valid &&
+    std::equal(kkt_active.nnz_per_col(),
+               kkt_active.nnz_per_col() + n_tot_,
+               ldl_pattern.kkt_nnz_counts.ptr());
+
+  if (reuse_pattern) {
+    // the elimination tree and the column counts may have been modified by
+    // the row additions and deletions since then
+    std::copy(ldl_pattern.etree.ptr(),
+              ldl_pattern.etree.ptr() + n_tot_,
+              ldl.etree.ptr_mut());
+    std::copy(ldl_pattern.nnz_counts.ptr(),
+              ldl_pattern.nnz_counts.ptr() + n_tot_,
+              ldl.nnz_counts.ptr_mut());
+  } else {
     proxsuite::linalg::sparse::factorize_symbolic_non_zeros(
-      work.internal.ldl.nnz_counts.ptr_mut(),
-      work.internal.ldl.etree.ptr_mut(),
-      work.internal.ldl.perm_inv.ptr_mut(),
-      work.internal.ldl.perm.ptr_mut(),
+      ldl.nnz_counts.ptr_mut(),
+      ldl.etree.ptr_mut(),
+      ldl.perm_inv.ptr_mut(),
+      ldl.perm.ptr_mut(),
       kkt_active.symbolic(),
-      stack);
-
-    isize nnz = 0;
-    VEG_ONLY_USED_FOR_DEBUG(nnz);
-    for (usize j = 0; j < usize(kkt_active.ncols()); ++j) {
-      nnz += usize(kkt_active.col_end(j) - kkt_active.col_start(j));
+      stack,
+      work.internal.nb_threads_fact);
+    std::copy(kkt_active.nnz_per_col(),
+              kkt_active.nnz_per_col() + n_tot_,
+              ldl_pattern.kkt_nnz_counts.ptr_mut());
+    std::copy(
+      ldl.etree.ptr(), ldl.etree.ptr() + n_tot_, ldl_pattern.etree.ptr_mut());
+    std::copy(ldl.nnz_counts.ptr(),
+              ldl.nnz_counts.ptr() + n_tot_,
+              ldl_pattern.nnz_counts.ptr_mut());
+    if (work.internal.do_supernodal_fact) {
+      proxsuite::linalg::sparse::factorize_numeric_supernodal_pattern(
+        ldl_pattern.lower_col_ptrs.ptr_mut(),
+        ldl_pattern.lower_row_indices.ptr_mut(),
+        ldl_pattern.lower_sources.ptr_mut(),
+        ldl.perm_inv.ptr(),
+        kkt_active.symbolic(),
+        stack);
+    } else {
+      proxsuite::linalg::sparse::factorize_numeric_pattern(
+        ldl_pattern.permuted_col_ptrs.ptr_mut(),
+        ldl_pattern.permuted_row_indices.ptr_mut(),
+        ldl_pattern.permuted_sources.ptr_mut(),
+        ldl_pattern.l_row_ptrs.ptr_mut(),
+        ldl_pattern.l_col_indices.ptr_mut(),
+        ldl.etree.ptr(),
+        ldl.perm_inv.ptr(),
+        kkt_active.symbolic(),
+        stack);
     }
-    VEG_ASSERT(kkt_active.nnz() == nnz);
-    auto _diag = stack.make_new_for_overwrite(xtag, n_tot);
-    T* diag = _diag.ptr_mut();
+    ldl_pattern.valid = true;
+  }
 
-    for (isize i = 0; i < data.dim; ++i) {
-      diag[i] = results.info.rho;
-    }
-    for (isize i = 0; i < data.n_eq; ++i) {
-      diag[data.dim + i] = mu_eq_neg;
-    }
-    for (isize i = 0; i < data.n_in; ++i) {
-      diag[(data.dim + data.n_eq) + i] =
-        active_constraints[i] ? mu_in_neg : T(1);
-    }
+  isize nnz = 0;
+  VEG_ONLY_USED_FOR_DEBUG(nnz);
+  for (usize j = 0; j < usize(kkt_active.ncols()); ++j) {
+    nnz += usize(kkt_active.col_end(j) - kkt_active.col_start(j));
+  }
+  VEG_ASSERT(kkt_active.nnz() == nnz);
+  auto _diag = stack.make_new_for_overwrite(xtag, n_tot);
+  T* diag = _diag.ptr_mut();
 
-    proxsuite::linalg::sparse::factorize_numeric(
-      work.internal.ldl.values.ptr_mut(),
-      work.internal.ldl.row_indices.ptr_mut(),
+  for (isize i = 0; i < data.dim; ++i) {
+    diag[i] = results.info.rho;
+  }
+  for (isize i = 0; i < data.n_eq; ++i) {
+    diag[data.dim + i] = mu_eq_neg;
+  }
+  for (isize i = 0; i < data.n_in; ++i) {
+    diag[(data.dim + data.n_eq) + i] =
+      active_constraints[i] ? mu_in_neg : T(1);
+  }
+
+  if (work.internal.do_supernodal_fact) {
+    proxsuite::linalg::sparse::factorize_numeric_supernodal_refactor(
+      ldl.values.ptr_mut(),
+      ldl.row_indices.ptr_mut(),
       diag,
-      work.internal.ldl.perm.ptr_mut(),
-      work.internal.ldl.col_ptrs.ptr(),
-      work.internal.ldl.etree.ptr_mut(),
-      work.internal.ldl.perm_inv.ptr_mut(),
-      kkt_active.as_const(),
+      ldl.perm.ptr(),
+      ldl.col_ptrs.ptr(),
+      ldl.nnz_counts.ptr(),
+      ldl.etree.ptr(),
+      ldl_pattern.lower_col_ptrs.ptr(),
+      ldl_pattern.lower_row_indices.ptr(),
+      ldl_pattern.lower_sources.ptr(),
+      kkt_active.values(),
+      n_tot,
+      stack,
+      work.internal.nb_threads_fact);
+  } else {
+    proxsuite::linalg::sparse::factorize_numeric_refactor(
+      ldl.values.ptr_mut(),
+      ldl.row_indices.ptr_mut(),
+      diag,
+      ldl.perm.ptr(),
+      ldl.col_ptrs.ptr(),
+      ldl_pattern.permuted_col_ptrs.ptr(),
+      ldl_pattern.permuted_row_indices.ptr(),
+      ldl_pattern.permuted_sources.ptr(),
+      ldl_pattern.l_row_ptrs.ptr(),
+      ldl_pattern.l_col_indices.ptr(),
+      kkt_active.values(),
+      n_tot,
       stack);
+  }
+  update_ldl_solve_schedule(ldl, n_tot, work.internal.nb_threads_solve, stack);
+}
+} // namespace detail
+
+template<typename T, typename I>
+void
+refactorize(Workspace<T, I>& work,
+            Results<T> const& results,
+            proxsuite::linalg::sparse::MatMut<T, I> kkt_active,
+            proxsuite::linalg::veg::SliceMut<bool> active_constraints,
+            Model<T, I> const& data,
+            proxsuite::linalg::veg::dynstack::DynStackMut stack,
+            proxsuite::linalg::veg::Tag<T>& xtag)
+{
+  if (work.internal.do_ldlt && work.internal.wide_ldl) {
+    // the factor is stored with 64 bits indices, which the structure of the
+    // KKT matrix is converted to
+    auto zx = proxsuite::linalg::sparse::util::zero_extend;
+    isize n_tot = kkt_active.nrows();
+    isize kkt_nnz = isize(zx(kkt_active.col_ptrs()[n_tot]));
+    proxsuite::linalg::veg::Tag<i64> ltag;
+    auto _col_ptrs = stack.make_new_for_overwrite(ltag, n_tot + 1);
+    auto _nnz_counts = stack.make_new_for_overwrite(ltag, n_tot);
+    auto _row_indices = stack.make_new_for_overwrite(ltag, kkt_nnz);
+    for (isize j = 0; j < n_tot; ++j) {
+      _col_ptrs.ptr_mut()[j] = i64(zx(kkt_active.col_ptrs()[j]));
+      _nnz_counts.ptr_mut()[j] = i64(zx(kkt_active.nnz_per_col()[j]));
+    }
+    _col_ptrs.ptr_mut()[n_tot] = i64(kkt_nnz);
+    for (isize p = 0; p < kkt_nnz; ++p) {
+      _row_indices.ptr_mut()[p] = i64(zx(kkt_active.row_indices()[p]));
+    }
+    detail::refactorize_ldlt(
+      work,
+      work.internal.ldl_wide,
+      work.internal.ldl_pattern_wide,
+      results,
+      proxsuite::linalg::sparse::MatMut<T, i64>{
+        proxsuite::linalg::sparse::from_raw_parts,
+        n_tot,
+        n_tot,
+        kkt_active.nnz(),
+        _col_ptrs.ptr_mut(),
+        _nnz_counts.ptr_mut(),
+        _row_indices.ptr_mut(),
+        kkt_active.values_mut(),
+      },
+      active_constraints,
+      data,
+      stack,
+      xtag);
+  } else if (work.internal.do_ldlt) {
+    detail::refactorize_ldlt(work,
+                             work.internal.ldl,
+                             work.internal.ldl_pattern,
+                             results,
+                             kkt_active,
+                             active_constraints,
+                             data,
+                             stack,
+                             xtag);
   } else {
     *work.internal.matrix_free_kkt = { { kkt_active.as_const(),
                                          active_constraints.as_const(),
@@ -102,17 +589,6 @@ refactorize(Workspace<T, I>& work,
   }
 }
 
-template<typename T, typename I>
-struct Ldlt
-{
-  proxsuite::linalg::veg::Vec<I> etree;
-  proxsuite::linalg::veg::Vec<I> perm;
-  proxsuite::linalg::veg::Vec<I> perm_inv;
-  proxsuite::linalg::veg::Vec<I> col_ptrs;
-  proxsuite::linalg::veg::Vec<I> nnz_counts;
-  proxsuite::linalg::veg::Vec<I> row_indices;
-  proxsuite::linalg::veg::Vec<T> values;
-};
 template<typename T, typename I>
 struct Workspace
 {
@@ -124,8 +600,26 @@ struct Workspace
       storage; // memory of the stack with the requirements req which determines
                // its size.
     Ldlt<T, I> ldl;
+    LdltPattern<I> ldl_pattern;
+    Ldlt<T, i64> ldl_wide; // storage of the factors whose number of non zeros
+                           // overflows I
+    LdltPattern<i64> ldl_pattern_wide;
+    bool wide_ldl; // whether the factor is stored in ldl_wide
     bool do_ldlt;
+    bool ldl_overflow;   // whether the number of non zeros of the factor
+                         // overflows the indices of both storages
+    isize memory_budget; // memory budget do_ldlt was decided with
     bool do_symbolic_fact;
+    bool do_supernodal_fact; // whether the numeric factorization groups the
+                             // columns of the factor in dense supernodes
+    isize nb_threads_fact;   // number of threads of the supernodal
+                             // factorization
+    isize nb_threads_solve;  // number of threads of the triangular solves
+    SparseOrdering ordering; // fill reducing ordering requested for the
+                             // symbolic factorization
+    SparseOrdering selected_ordering; // fill reducing ordering applied to the
+                                      // KKT matrix
+    double factor_flops; // predicted flops of the factorization
     // persistent allocations
 
     Eigen::Matrix<T, Eigen::Dynamic, 1> g_scaled;
@@ -160,6 +654,93 @@ struct Workspace
   } internal;
 
   isize lnnz;
+  /*!
+   * Decides whether the KKT matrix is factorized, or solved by the matrix free
+   * backend, from the symbolic factorization and the settings.
+   *
+   * @param backend sparse backend requested in the settings.
+   * @param memory_budget maximal size in bytes of the factor (0 for half of
+   * the physical memory).
+   * @param nnz_tot number of non zeros of the KKT matrix.
+   */
+  void select_ldlt(SparseBackend backend, isize memory_budget, isize nnz_tot)
+  {
+    bool overflow = internal.ldl_overflow;
+    if (backend == SparseBackend::Automatic) {
+      internal.do_ldlt =
+        !overflow &&
+        (internal.wide_ldl
+           ? ldlt_is_affordable<T, i64>(
+               lnnz, internal.factor_flops, nnz_tot, memory_budget)
+           : ldlt_is_affordable<T, I>(
+               lnnz, internal.factor_flops, nnz_tot, memory_budget));
+    } else if (backend == SparseBackend::SparseCholesky) {
+      internal.do_ldlt = !overflow;
+    } else {
+      internal.do_ldlt = false;
+    }
+    internal.memory_budget = memory_budget;
+  }
+  /*!
+   * Computes the column pointers of the factor from its column counts, which
+   * are stored after the first column pointer. If the number of non zeros of
+   * the factor overflows I, the symbolic data is moved to the storage with 64
+   * bits indices.
+   *
+   * @param n_tot dimension of the KKT matrix.
+   * @return false if the number of non zeros of the factor overflows 64 bits
+   * indices as well.
+   */
+  auto ldl_col_ptrs_from_counts(isize n_tot) -> bool
+  {
+    using proxsuite::linalg::veg::u64;
+    auto zx = proxsuite::linalg::sparse::util::zero_extend;
+    auto& ldl = internal.ldl;
+    I* pcol_ptrs = ldl.col_ptrs.ptr_mut();
+    pcol_ptrs[0] = I(0);
+
+    u64 acc = 0;
+    bool overflow = false;
+    for (usize i = 0; i < usize(n_tot); ++i) {
+      acc += u64(zx(pcol_ptrs[i + 1]));
+      if (acc != u64(I(acc))) {
+        overflow = true;
+      }
+    }
+    internal.wide_ldl = overflow && sizeof(I) < sizeof(i64) &&
+                        acc <= u64(std::numeric_limits<i64>::max());
+    if (!internal.wide_ldl) {
+      // releases the storage of a previous factor with 64 bits indices
+      internal.ldl_wide = {};
+      internal.ldl_pattern_wide = {};
+    }
+    if (overflow && !internal.wide_ldl) {
+      return false;
+    }
+
+    if (internal.wide_ldl) {
+      auto& ldl_wide = internal.ldl_wide;
+      ldl_wide.col_ptrs.resize_for_overwrite(n_tot + 1);
+      ldl_wide.etree.resize_for_overwrite(n_tot);
+      ldl_wide.perm_inv.resize_for_overwrite(n_tot);
+      ldl_wide.col_ptrs[0] = 0;
+      for (isize i = 0; i < n_tot; ++i) {
+        ldl_wide.col_ptrs[i + 1] =
+          ldl_wide.col_ptrs[i] + i64(zx(pcol_ptrs[i + 1]));
+        ldl_wide.etree[i] =
+          ldl.etree[i] == I(-1) ? i64(-1) : i64(zx(ldl.etree[i]));
+        ldl_wide.perm_inv[i] = i64(zx(ldl.perm_inv[i]));
+      }
+    } else {
+      acc = 0;
+      for (usize i = 0; i < usize(n_tot); ++i) {
+        acc += u64(zx(pcol_ptrs[i + 1]));
+        pcol_ptrs[i + 1] = I(acc);
+      }
+    }
+    lnnz = isize(acc);
+    return true;
+  }
   /*!
    * Constructor using the symbolic factorization.
    * @param results solver's results.
@@ -172,17 +753,21 @@ struct Workspace
    * defining the QP model.
    * @param C symbolic structure of the inequality constraint matrix input
    * defining the QP model.
+   * @param ordering fill reducing ordering of the KKT matrix.
+   * @param memory_budget maximal size in bytes of the factor (0 for half of
+   * the physical memory).
    */
   void setup_symbolic_factorizaton(
     Model<T, I>& data,
     proxsuite::linalg::sparse::SymbolicMatRef<I> H,
     proxsuite::linalg::sparse::SymbolicMatRef<I> AT,
-    proxsuite::linalg::sparse::SymbolicMatRef<I> CT)
+    proxsuite::linalg::sparse::SymbolicMatRef<I> CT,
+    SparseOrdering ordering = SparseOrdering::Automatic,
+    isize memory_budget = 0)
   {
     auto& ldl = internal.ldl;
 
     auto& storage = internal.storage;
-    auto& do_ldlt = internal.do_ldlt;
     // persistent allocations
 
     data.dim = H.nrows();
@@ -255,12 +840,8 @@ struct Workspace
 
     storage.resize_for_overwrite( //
       (StackReq::with_len(itag, n_tot) &
-       proxsuite::linalg::sparse::factorize_symbolic_req( //
-         itag,                                            //
-         n_tot,                                           //
-         nnz_tot,                                         //
-         proxsuite::linalg::sparse::Ordering::amd))       //
-        .alloc_req()                                      //
+       kkt_symbolic_req(itag, n_tot, nnz_tot, ordering))
+        .alloc_req() //
     );
 
     ldl.col_ptrs.resize_for_overwrite(n_tot + 1);
@@ -283,37 +864,27 @@ struct Workspace
         nullptr,
         data.kkt_row_indices.ptr(),
       };
-      proxsuite::linalg::sparse::factorize_symbolic_non_zeros( //
+      internal.selected_ordering = kkt_symbolic_non_zeros( //
         ldl.col_ptrs.ptr_mut() +
           1, // reimplements col counts to get the matrix free version as well
         etree_ptr,
         ldl.perm_inv.ptr_mut(),
-        static_cast<I const*>(nullptr),
         kkt_sym,
+        data.dim,
+        ordering,
         stack);
+      internal.factor_flops =
+        factorization_flops(ldl.col_ptrs.ptr() + 1, n_tot);
 
-      auto pcol_ptrs = ldl.col_ptrs.ptr_mut();
-      pcol_ptrs[0] = I(0);
-
-      using proxsuite::linalg::veg::u64;
-      u64 acc = 0;
-
-      for (usize i = 0; i < usize(n_tot); ++i) {
-        acc += u64(zero_extend(pcol_ptrs[i + 1]));
-        if (acc != u64(I(acc))) {
-          overflow = true;
-        }
-        pcol_ptrs[(i + 1)] = I(acc);
-      }
+      overflow = !ldl_col_ptrs_from_counts(n_tot);
     }
 
-    lnnz = isize(zero_extend(ldl.col_ptrs[n_tot]));
-
-    // if ldlt is too sparse
-    // do_ldlt = !overflow && lnnz < (10000000);
-    do_ldlt = !overflow && lnnz < 10000000;
+    internal.ldl_overflow = overflow;
+    select_ldlt(SparseBackend::Automatic, memory_budget, nnz_tot);
 
+    internal.ordering = ordering;
     internal.do_symbolic_fact = false;
+    internal.ldl_pattern.valid = false;
   }
   /*!
    * Constructor.
@@ -365,9 +936,7 @@ struct Workspace
     using namespace proxsuite::linalg::veg::dynstack;
     using namespace proxsuite::linalg::sparse::util;
 
-    using SR = StackReq;
     proxsuite::linalg::veg::Tag<I> itag;
-    proxsuite::linalg::veg::Tag<T> xtag;
 
     isize n = qp.H.nrows();
     isize n_eq = qp.AT.ncols();
@@ -376,7 +945,14 @@ struct Workspace
 
     isize nnz_tot = qp.H.nnz() + qp.AT.nnz() + qp.CT.nnz();
 
+    // the symbolic factorization computed from the sparsity structure of
+    // the model is redone if the ordering of the settings has changed
+    if (!internal.do_symbolic_fact &&
+        internal.ordering != settings.sparse_ordering) {
+      internal.do_symbolic_fact = true;
+    }
     if (internal.do_symbolic_fact) {
+      internal.ldl_pattern.valid = false;
 
       // form the full kkt matrix
       // assuming H, AT, CT are sorted
@@ -431,14 +1007,16 @@ struct Workspace
       data.kkt_row_indices_unscaled = data.kkt_row_indices;
       data.kkt_values_unscaled = data.kkt_values;
 
+      isize nb_threads_symbolic =
+        kkt_symbolic_nb_threads(settings.nb_threads, nnz_tot);
       storage.resize_for_overwrite( //
         (StackReq::with_len(itag, n_tot) &
-         proxsuite::linalg::sparse::factorize_symbolic_req( //
-           itag,                                            //
-           n_tot,                                           //
-           nnz_tot,                                         //
-           proxsuite::linalg::sparse::Ordering::amd))       //
-          .alloc_req()                                      //
+         kkt_symbolic_req(itag,
+                          n_tot,
+                          nnz_tot,
+                          settings.sparse_ordering,
+                          nb_threads_symbolic))
+          .alloc_req() //
       );
 
       ldl.col_ptrs.resize_for_overwrite(n_tot + 1);
@@ -461,45 +1039,38 @@ struct Workspace
           nullptr,
           data.kkt_row_indices.ptr(),
         };
-        proxsuite::linalg::sparse::factorize_symbolic_non_zeros( //
+        internal.selected_ordering = kkt_symbolic_non_zeros( //
           ldl.col_ptrs.ptr_mut() + 1,
           etree_ptr,
           ldl.perm_inv.ptr_mut(),
-          static_cast<I const*>(nullptr),
           kkt_sym,
-          stack);
-
-        auto pcol_ptrs = ldl.col_ptrs.ptr_mut();
-        pcol_ptrs[0] = I(0); // pcol_ptrs +1: pointor towards the nbr of non
-                             // zero elts per column of the ldlt
-        // we need to compute its cumulative sum below to determine if there
-        // could be an overflow
-
-        using proxsuite::linalg::veg::u64;
-        u64 acc = 0;
-
-        for (usize i = 0; i < usize(n_tot); ++i) {
-          acc += u64(zero_extend(pcol_ptrs[i + 1]));
-          if (acc != u64(I(acc))) {
-            overflow = true;
-          }
-          pcol_ptrs[(i + 1)] = I(acc);
-        }
+          data.dim,
+          settings.sparse_ordering,
+          stack,
+          nb_threads_symbolic);
+        internal.ordering = settings.sparse_ordering;
+        internal.factor_flops =
+          factorization_flops(ldl.col_ptrs.ptr() + 1, n_tot);
+
+        // the cumulative sum of the column counts may overflow I, in which
+        // case the factor is stored with 64 bits indices
+        overflow = !ldl_col_ptrs_from_counts(n_tot);
       }
 
-      auto lnnz = isize(zero_extend(ldl.col_ptrs[n_tot]));
-
-      // if ldlt is too sparse
-      // do_ldlt = !overflow && lnnz < (10000000);
-      if (settings.sparse_backend == SparseBackend::Automatic) {
-        do_ldlt = !overflow && lnnz < 10000000;
-      } else if (settings.sparse_backend == SparseBackend::SparseCholesky) {
-        do_ldlt = true;
-      } else {
-        do_ldlt = false;
-      }
+      internal.ldl_overflow = overflow;
+      select_ldlt(settings.sparse_backend,
+                  settings.sparse_factorization_memory_budget,
+                  nnz_tot);
 
     } else {
+      // the symbolic factorization is kept, but the choice of the backend
+      // follows the memory budget of the settings
+      if (internal.memory_budget !=
+          settings.sparse_factorization_memory_budget) {
+        select_ldlt(settings.sparse_backend,
+                    settings.sparse_factorization_memory_budget,
+                    nnz_tot);
+      }
       T* kktx = data.kkt_values.ptr_mut();
       usize pos = 0;
       auto insert_submatrix =
@@ -530,129 +1101,41 @@ struct Workspace
 #define PROX_QP_ANY_OF(...)                                                    \
   ::proxsuite::linalg::veg::dynstack::StackReq::or_(                           \
     ::proxsuite::linalg::veg::init_list(__VA_ARGS__))
-    //  ? --> if
-    auto refactorize_req =
-      do_ldlt
-        ? PROX_QP_ANY_OF({
-            proxsuite::linalg::sparse::factorize_symbolic_req( // symbolic ldl
-              itag,
-              n_tot,
-              nnz_tot,
-              proxsuite::linalg::sparse::Ordering::user_provided),
-            PROX_QP_ALL_OF({
-              SR::with_len(xtag, n_tot),                        // diag
-              proxsuite::linalg::sparse::factorize_numeric_req( // numeric ldl
-                xtag,
-                itag,
-                n_tot,
-                nnz_tot,
-                proxsuite::linalg::sparse::Ordering::user_provided),
-            }),
-          })
-        : PROX_QP_ALL_OF({
-            SR::with_len(itag, 0), // compute necessary space for storing n elts
-                                   // of type I (n = 0 here)
-            SR::with_len(xtag, 0), // compute necessary space for storing n elts
-                                   // of type T (n = 0 here)
-          });
-
-    auto x_vec = [&](isize n) noexcept -> StackReq {
-      return proxsuite::linalg::dense::temp_vec_req(xtag, n);
-    };
-
-    auto ldl_solve_in_place_req = PROX_QP_ALL_OF({
-      x_vec(n_tot), // tmp
-      x_vec(n_tot), // err
-      x_vec(n_tot), // work
-    });
-
-    auto unscaled_primal_dual_residual_req = x_vec(n); // Hx
-    auto line_search_req = PROX_QP_ALL_OF({
-      x_vec(2 * n_in), // alphas
-      x_vec(n),        // Cdx_active
-      x_vec(n_in),     // active_part_z
-      x_vec(n_in),     // tmp_lo
-      x_vec(n_in),     // tmp_up
-    });
-    // define memory needed for primal_dual_newton_semi_smooth
-    // PROX_QP_ALL_OF --> need to store all argument inside
-    // PROX_QP_ANY_OF --> au moins un de  ceux en entrée
-    auto primal_dual_newton_semi_smooth_req = PROX_QP_ALL_OF({
-      x_vec(n_tot), // dw
-      PROX_QP_ANY_OF({
-        ldl_solve_in_place_req,
-        PROX_QP_ALL_OF({
-          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
-                       n_in), // active_set_lo
-          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
-                       n_in), // active_set_up
-          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
-                       n_in), // new_active_constraints
-          (do_ldlt && n_in > 0) ? PROX_QP_ANY_OF({
-                                    proxsuite::linalg::sparse::add_row_req(
-                                      xtag, itag, n_tot, false, n, n_tot),
-                                    proxsuite::linalg::sparse::delete_row_req(
-                                      xtag, itag, n_tot, n_tot),
-                                  })
-                                : refactorize_req,
-        }),
-        PROX_QP_ALL_OF({
-          x_vec(n),    // Hdx
-          x_vec(n_eq), // Adx
-          x_vec(n_in), // Cdx
-          x_vec(n),    // ATdy
-          x_vec(n),    // CTdz
-        }),
-      }),
-      line_search_req,
-    });
-
-    auto iter_req = PROX_QP_ANY_OF({
-      PROX_QP_ALL_OF({ x_vec(n_eq), // primal_residual_eq_scaled
-                       x_vec(n_in), // primal_residual_in_scaled_lo
-                       x_vec(n_in), // primal_residual_in_scaled_up
-                       x_vec(n_in), // primal_residual_in_scaled_up
-                       x_vec(n),    // dual_residual_scaled
-                       PROX_QP_ANY_OF({
-                         unscaled_primal_dual_residual_req,
-                         PROX_QP_ALL_OF({
-                           x_vec(n),    // x_prev
-                           x_vec(n_eq), // y_prev
-                           x_vec(n_in), // z_prev
-                           primal_dual_newton_semi_smooth_req,
-                         }),
-                       }) }),
-      refactorize_req, // mu_update
-    });
+    // with several threads, large factors are always computed by the
+    // supernodal factorization, which spreads the independent subtrees of the
+    // elimination tree over the threads
+    isize nb_threads =
+      proxsuite::helpers::resolve_nb_threads(settings.nb_threads);
+    bool parallel_fact = do_ldlt && nb_threads > 1 && lnnz >= 100000;
+    internal.do_supernodal_fact =
+      do_ldlt && (settings.supernodal_factorization || parallel_fact);
+    internal.nb_threads_fact = parallel_fact ? nb_threads : 1;
+    internal.nb_threads_solve =
+      do_ldlt ? ldl_solve_nb_threads(settings.nb_threads, lnnz) : 1;
+    // the columns of the factor never hold more elements than with all the
+    // constraints active, which is the structure the col_ptrs were computed
+    // with
+    isize max_col_count = 0;
+    if (internal.do_supernodal_fact) {
+      auto const& ldl_wide = internal.ldl_wide;
+      for (usize j = 0; j < usize(n_tot); ++j) {
+        isize count =
+          internal.wide_ldl
+            ? isize(ldl_wide.col_ptrs[j + 1] - ldl_wide.col_ptrs[j])
+            : isize(zero_extend(ldl.col_ptrs[j + 1])) -
+                isize(zero_extend(ldl.col_ptrs[j]));
+        max_col_count = count > max_col_count ? count : max_col_count;
+      }
+    }
 
-    auto req = //
-      PROX_QP_ALL_OF({
-        x_vec(n),    // g_scaled
-        x_vec(n_eq), // b_scaled
-        x_vec(n_in), // l_scaled
-        x_vec(n_in), // u_scaled
-        SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
-                     n_in),        // active constr
-        SR::with_len(itag, n_tot), // kkt nnz counts
-        refactorize_req,
-        PROX_QP_ANY_OF({
-          precond_req,
-          PROX_QP_ALL_OF({
-            do_ldlt ? PROX_QP_ALL_OF({
-                        SR::with_len(itag, n_tot), // perm
-                        SR::with_len(itag, n_tot), // etree
-                        SR::with_len(itag, n_tot), // ldl nnz counts
-                        SR::with_len(itag, lnnz),  // ldl row indices
-                        SR::with_len(xtag, lnnz),  // ldl values
-                      })
-                    : PROX_QP_ALL_OF({
-                        SR::with_len(itag, 0),
-                        SR::with_len(xtag, 0),
-                      }),
-            iter_req,
-          }),
-        }),
-      });
+    auto req =
+      internal.wide_ldl
+        ? solve_req(proxsuite::linalg::veg::Tag<i64>{},
+                    data,
+                    nnz_tot,
+                    max_col_count,
+                    precond_req)
+        : solve_req(itag, data, nnz_tot, max_col_count, precond_req);
 
     storage.resize_for_overwrite(
       req.alloc_req()); // defines the maximal storage size
@@ -756,25 +1239,285 @@ struct Workspace
       }
     };
 
-    auto zx = proxsuite::linalg::sparse::util::zero_extend; // ?
-    auto max_lnnz = isize(zx(ldl.col_ptrs[n_tot]));
-    isize ldlt_ntot = do_ldlt ? n_tot : 0;
-    isize ldlt_lnnz = do_ldlt ? max_lnnz : 0;
+    // the factor is stored in the storage whose indices have the type it
+    // was computed with by the symbolic factorization, the other one being
+    // left empty
+    bool wide_ldl = internal.wide_ldl;
+    setup_ldl_storage(internal.ldl,
+                      internal.ldl_pattern,
+                      do_ldlt && !wide_ldl,
+                      n_tot,
+                      nnz_tot);
+    setup_ldl_storage(internal.ldl_wide,
+                      internal.ldl_pattern_wide,
+                      do_ldlt && wide_ldl,
+                      n_tot,
+                      nnz_tot);
+
+    internal.dirty = false;
+  }
+  /*!
+   * Allocates the numeric storage of the factor and of its cached symbolic
+   * data.
+   * @param ldl storage of the factor, whose indices have the type J.
+   * @param ldl_pattern cached symbolic data of the factor.
+   * @param active whether the factor is stored in ldl.
+   * @param n_tot dimension of the KKT matrix.
+   * @param nnz_tot number of non zeros of the KKT matrix.
+   */
+  template<typename J>
+  void setup_ldl_storage(Ldlt<T, J>& ldl,
+                         LdltPattern<J>& ldl_pattern,
+                         bool active,
+                         isize n_tot,
+                         isize nnz_tot)
+  {
+    auto zx = proxsuite::linalg::sparse::util::zero_extend;
+    isize max_lnnz = lnnz;
+    isize ldlt_ntot = active ? n_tot : 0;
+    isize ldlt_lnnz = active ? max_lnnz : 0;
 
     ldl.nnz_counts.resize_for_overwrite(ldlt_ntot);
     ldl.row_indices.resize_for_overwrite(ldlt_lnnz);
     ldl.values.resize_for_overwrite(ldlt_lnnz);
+    ldl.solve_sn_start.resize_for_overwrite(active ? (n_tot + 1) : 0);
+    ldl.solve_order.resize_for_overwrite(ldlt_ntot);
+    ldl.solve_subtree_ptr.resize_for_overwrite(active ? (n_tot + 1) : 0);
+    ldl.solve_schedule = {};
 
     ldl.perm.resize_for_overwrite(ldlt_ntot);
-    if (do_ldlt) {
+    if (active) {
       // compute perm from perm_inv
       for (isize i = 0; i < n_tot; ++i) {
-        ldl.perm[isize(zx(ldl.perm_inv[i]))] = I(i);
+        ldl.perm[isize(zx(ldl.perm_inv[i]))] = J(i);
       }
     }
 
-    internal.dirty = false;
+    // the symbolic data of the factorization is kept as long as the
+    // structure of the KKT matrix is unchanged. the supernodal factorization
+    // only needs the lower triangular part of the permuted matrix
+    bool supernodal = internal.do_supernodal_fact;
+    bool simplicial_pattern = active && !supernodal;
+    bool supernodal_pattern = active && supernodal;
+    if (!active || ldl_pattern.supernodal != supernodal) {
+      ldl_pattern.valid = false;
+    }
+    ldl_pattern.supernodal = supernodal;
+    isize pattern_ntot = active ? n_tot : 0;
+    isize pattern_nnz = simplicial_pattern ? nnz_tot : 0;
+    isize lower_nnz = supernodal_pattern ? nnz_tot : 0;
+    ldl_pattern.kkt_nnz_counts.resize_for_overwrite(pattern_ntot);
+    ldl_pattern.etree.resize_for_overwrite(pattern_ntot);
+    ldl_pattern.nnz_counts.resize_for_overwrite(pattern_ntot);
+    ldl_pattern.permuted_col_ptrs.resize_for_overwrite(
+      simplicial_pattern ? (n_tot + 1) : 0);
+    ldl_pattern.permuted_row_indices.resize_for_overwrite(pattern_nnz);
+    ldl_pattern.permuted_sources.resize_for_overwrite(pattern_nnz);
+    ldl_pattern.l_row_ptrs.resize_for_overwrite(
+      simplicial_pattern ? (n_tot + 1) : 0);
+    ldl_pattern.l_col_indices.resize_for_overwrite(
+      simplicial_pattern ? (max_lnnz - n_tot) : 0);
+    ldl_pattern.lower_col_ptrs.resize_for_overwrite(
+      supernodal_pattern ? (n_tot + 1) : 0);
+    ldl_pattern.lower_row_indices.resize_for_overwrite(lower_nnz);
+    ldl_pattern.lower_sources.resize_for_overwrite(lower_nnz);
   }
+  /*!
+   * Computes the stack memory requirements of the solver.
+   * @param jtag type of the indices of the factor.
+   * @param data solver's model.
+   * @param nnz_tot number of non zeros of the KKT matrix.
+   * @param max_col_count maximal number of non zeros of a column of the
+   * factor.
+   * @param precond_req storage requirements for the solver's preconditioner.
+   */
+  template<typename J>
+  auto solve_req(proxsuite::linalg::veg::Tag<J> jtag,
+                 Model<T, I> const& data,
+                 isize nnz_tot,
+                 isize max_col_count,
+                 proxsuite::linalg::veg::dynstack::StackReq precond_req) const
+    -> proxsuite::linalg::veg::dynstack::StackReq
+  {
+    using proxsuite::linalg::veg::dynstack::StackReq;
+    using SR = StackReq;
+    proxsuite::linalg::veg::Tag<I> itag;
+    proxsuite::linalg::veg::Tag<T> xtag;
+
+    isize n = data.dim;
+    isize n_eq = data.n_eq;
+    isize n_in = data.n_in;
+    isize n_tot = n + n_eq + n_in;
+    bool do_ldlt = internal.do_ldlt;
+    bool wide_ldl = internal.wide_ldl;
+
+    //  ? --> if
+    auto refactorize_req =
+      do_ldlt
+        ? PROX_QP_ALL_OF({
+            // structure of the KKT matrix with the indices of the factor
+            SR::with_len(jtag, wide_ldl ? (2 * n_tot + 1) : 0),
+            SR::with_len(jtag, wide_ldl ? nnz_tot : 0),
+            PROX_QP_ANY_OF({
+              // symbolic ldl
+              proxsuite::linalg::sparse::factorize_symbolic_req(
+                jtag,
+                n_tot,
+                nnz_tot,
+                proxsuite::linalg::sparse::Ordering::user_provided,
+                internal.nb_threads_fact),
+              proxsuite::linalg::sparse::factorize_numeric_pattern_req(jtag,
+                                                                       n_tot),
+              proxsuite::linalg::sparse::
+                factorize_numeric_supernodal_pattern_req(jtag, n_tot),
+              proxsuite::linalg::sparse::ldlt_solve_schedule_req(jtag, n_tot),
+              PROX_QP_ALL_OF({
+                SR::with_len(xtag, n_tot), // diag
+                internal.do_supernodal_fact
+                  ? proxsuite::linalg::sparse::
+                      factorize_numeric_supernodal_refactor_req( // numeric ldl
+                        xtag,
+                        jtag,
+                        n_tot,
+                        nnz_tot,
+                        max_col_count,
+                        internal.nb_threads_fact)
+                  : proxsuite::linalg::sparse::factorize_numeric_req( // numeric
+                                                                      // ldl
+                      xtag,
+                      jtag,
+                      n_tot,
+                      nnz_tot,
+                      proxsuite::linalg::sparse::Ordering::user_provided),
+              }),
+            }),
+          })
+        : PROX_QP_ALL_OF({
+            SR::with_len(jtag, 0), // compute necessary space for storing n elts
+                                   // of type I (n = 0 here)
+            SR::with_len(xtag, 0), // compute necessary space for storing n elts
+                                   // of type T (n = 0 here)
+          });
+
+    auto x_vec = [&](isize n) noexcept -> StackReq {
+      return proxsuite::linalg::dense::temp_vec_req(xtag, n);
+    };
+
+    isize ldl_solve_n = do_ldlt ? n_tot : 0;
+    auto ldl_solve_in_place_req = PROX_QP_ALL_OF({
+      x_vec(n_tot), // tmp
+      x_vec(n_tot), // err
+      x_vec(n_tot), // work
+      proxsuite::linalg::sparse::ldlt_solve_in_place_req(
+        xtag, jtag, ldl_solve_n, internal.nb_threads_solve),
+    });
+
+    auto unscaled_primal_dual_residual_req = x_vec(n); // Hx
+    auto line_search_req = PROX_QP_ALL_OF({
+      x_vec(2 * n_in), // alphas
+      x_vec(n),        // Cdx_active
+      x_vec(n_in),     // active_part_z
+      x_vec(n_in),     // tmp_lo
+      x_vec(n_in),     // tmp_up
+      x_vec(4 * n_in), // updates of the derivative at each alpha
+      SR::with_len(proxsuite::linalg::veg::Tag<unsigned char>{}, n_in),
+    });
+    // define memory needed for primal_dual_newton_semi_smooth
+    // PROX_QP_ALL_OF --> need to store all argument inside
+    // PROX_QP_ANY_OF --> au moins un de  ceux en entrée
+    auto primal_dual_newton_semi_smooth_req = PROX_QP_ALL_OF({
+      x_vec(n_tot), // dw
+      PROX_QP_ANY_OF({
+        ldl_solve_in_place_req,
+        PROX_QP_ALL_OF({
+          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
+                       n_in), // active_set_lo
+          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
+                       n_in), // active_set_up
+          SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
+                       n_in), // new_active_constraints
+          SR::with_len(jtag, n_in), // removed_positions
+          SR::with_len(jtag, n_in), // added_positions
+          SR::with_len(jtag, n_in), // added_col_starts
+          SR::with_len(jtag, n_in), // added_col_nnz
+          x_vec(n_in),              // added_diag
+          (do_ldlt && n_in > 0)
+            ? PROX_QP_ANY_OF({
+                proxsuite::linalg::sparse::add_rows_req(
+                  xtag, jtag, n_tot, false, n_in, n),
+                proxsuite::linalg::sparse::delete_rows_req(
+                  xtag, jtag, n_tot, n_in),
+                proxsuite::linalg::sparse::ldlt_solve_schedule_req(jtag,
+                                                                   n_tot),
+              })
+            : refactorize_req,
+        }),
+        PROX_QP_ALL_OF({
+          x_vec(n),    // Hdx
+          x_vec(n_eq), // Adx
+          x_vec(n_in), // Cdx
+          x_vec(n),    // ATdy
+          x_vec(n),    // CTdz
+        }),
+      }),
+      line_search_req,
+    });
+
+    auto iter_req = PROX_QP_ANY_OF({
+      PROX_QP_ALL_OF({ x_vec(n_eq), // primal_residual_eq_scaled
+                       x_vec(n_in), // primal_residual_in_scaled_lo
+                       x_vec(n_in), // primal_residual_in_scaled_up
+                       x_vec(n_in), // primal_residual_in_scaled_up
+                       x_vec(n),    // dual_residual_scaled
+                       PROX_QP_ANY_OF({
+                         unscaled_primal_dual_residual_req,
+                         PROX_QP_ALL_OF({
+                           x_vec(n),    // x_prev
+                           x_vec(n_eq), // y_prev
+                           x_vec(n_in), // z_prev
+                           primal_dual_newton_semi_smooth_req,
+                         }),
+                       }) }),
+      refactorize_req, // mu_update
+      do_ldlt ? PROX_QP_ALL_OF({
+                  SR::with_len(jtag, n_eq + n_in + 1), // w col ptrs
+                  SR::with_len(jtag, n_eq + n_in),     // w row indices
+                  SR::with_len(xtag, n_eq + n_in),     // w values
+                  SR::with_len(xtag, n_eq + n_in),     // alpha
+                  PROX_QP_ANY_OF({
+                    proxsuite::linalg::sparse::rank_r_update_req(
+                      xtag, jtag, n_tot, false, n_eq + n_in, n_eq + n_in),
+                    proxsuite::linalg::sparse::ldlt_solve_schedule_req(jtag,
+                                                                       n_tot),
+                  }),
+                })
+              : SR::with_len(jtag, 0), // mu_update
+    });
+
+    return PROX_QP_ALL_OF({
+      x_vec(n),    // g_scaled
+      x_vec(n_eq), // b_scaled
+      x_vec(n_in), // l_scaled
+      x_vec(n_in), // u_scaled
+      SR::with_len(proxsuite::linalg::veg::Tag<bool>{},
+                   n_in),        // active constr
+      SR::with_len(itag, n_tot), // kkt nnz counts
+      refactorize_req,
+      PROX_QP_ANY_OF({
+        precond_req,
+        PROX_QP_ALL_OF({
+          do_ldlt ? PROX_QP_ALL_OF({
+                      SR::with_len(jtag, n_tot), // perm
+                      // row indices of the inequality constraints
+                      SR::with_len(jtag, wide_ldl ? data.C_nnz : 0),
+                    })
+                  : SR::with_len(jtag, 0),
+          iter_req,
+        }),
+      }),
+    });
+  }
+
   Timer<T> timer;
   Workspace() = default;
 
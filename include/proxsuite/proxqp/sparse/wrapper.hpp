@@ -141,7 +141,12 @@ struct QP
       proxsuite::linalg::sparse::from_eigen, CT
     };
     work.setup_symbolic_factorizaton(
-      model, Href.symbolic(), ATref.symbolic(), CTref.symbolic());
+      model,
+      Href.symbolic(),
+      ATref.symbolic(),
+      CTref.symbolic(),
+      settings.sparse_ordering,
+      settings.sparse_factorization_memory_budget);
     if (settings.compute_timings) {
       results.info.setup_time = work.timer.elapsed().user; // in microseconds
     }
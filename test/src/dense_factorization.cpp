@@ -0,0 +1,427 @@
+//
+// Copyright (c) 2022 INRIA
+//
+#include <proxsuite/linalg/dense/ldlt.hpp>
+#include <proxsuite/linalg/dense/tuning.hpp>
+#include <proxsuite/linalg/veg/vec.hpp>
+#include <proxsuite/proxqp/utils/random_qp_problems.hpp>
+#include <doctest.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+using namespace proxsuite;
+using T = double;
+using proxsuite::linalg::veg::isize;
+
+namespace {
+using Mat = Eigen::Matrix<T, -1, -1, Eigen::ColMajor>;
+using Vec = Eigen::Matrix<T, -1, 1>;
+
+auto
+random_kkt(isize n, isize n_eq) -> Mat
+{
+  ::proxsuite::proxqp::utils::rand::set_seed(1);
+  Mat h = ::proxsuite::proxqp::utils::rand::
+    sparse_positive_definite_rand_not_compressed<T>(n, T(1e-1), T(0.5));
+  Mat a = ::proxsuite::proxqp::utils::rand::
+    sparse_matrix_rand_not_compressed<T>(n_eq, n, T(0.5));
+
+  Mat kkt(n + n_eq, n + n_eq);
+  kkt.setZero();
+  kkt.topLeftCorner(n, n) = h;
+  kkt.topLeftCorner(n, n).diagonal().array() += T(1e-2);
+  kkt.bottomLeftCorner(n_eq, n) = a;
+  kkt.topRightCorner(n, n_eq) = a.transpose();
+  kkt.bottomRightCorner(n_eq, n_eq).diagonal().setConstant(T(-1e-3));
+  return kkt;
+}
+} // namespace
+
+DOCTEST_TEST_CASE("dense ldlt: multithreaded factorization")
+{
+  isize n = 400;
+  isize n_eq = 200;
+  isize n_tot = n + n_eq;
+  Mat kkt = random_kkt(n, n_eq);
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+     linalg::dense::Ldlt<T>::solve_in_place_req(n_tot))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  linalg::dense::Ldlt<T> ldl_serial;
+  linalg::dense::Ldlt<T> ldl_parallel;
+  ldl_serial.factorize(kkt, stack);
+  ldl_parallel.factorize(kkt, stack, 4);
+
+  Mat l_serial = ldl_serial.l();
+  Mat l_parallel = ldl_parallel.l();
+  DOCTEST_CHECK((l_serial - l_parallel).norm() <= T(1e-9) * l_serial.norm());
+  DOCTEST_CHECK((ldl_serial.d() - ldl_parallel.d()).norm() <=
+                T(1e-9) * ldl_serial.d().norm());
+
+  Vec rhs = Vec::Random(n_tot);
+  Vec sol = rhs;
+  ldl_parallel.solve_in_place(sol, stack);
+  DOCTEST_CHECK((kkt * sol - rhs).lpNorm<Eigen::Infinity>() <= T(1e-8));
+}
+
+DOCTEST_TEST_CASE("dense ldlt: rank r update")
+{
+  // exercises the rank update kernels selected for the running host
+  isize n = 203;
+  isize r = 7;
+  Mat a = Mat::Random(n, n);
+  a = a * a.transpose() + T(n) * Mat::Identity(n, n);
+  Mat w = Mat::Random(n, r);
+  Vec alpha = Vec::Ones(r);
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n) |
+     linalg::dense::Ldlt<T>::rank_r_update_req(n, r))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  linalg::dense::Ldlt<T> ldl;
+  ldl.factorize(a, stack);
+  ldl.rank_r_update(w, alpha, stack);
+
+  Mat b = a + w * alpha.asDiagonal() * w.transpose();
+  DOCTEST_CHECK((ldl.dbg_reconstructed_matrix() - b).norm() <=
+                T(1e-12) * b.norm());
+}
+
+DOCTEST_TEST_CASE("dense ldlt: packed storage")
+{
+  isize n = 150;
+  isize n_eq = 40;
+  isize n_tot = n + n_eq;
+  isize r = 5;
+  Mat kkt = random_kkt(n, n_eq);
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+     linalg::dense::Ldlt<T>::factorize_req(n_tot, true) |
+     linalg::dense::Ldlt<T>::insert_block_at_req(n_tot, r) |
+     linalg::dense::Ldlt<T>::delete_at_req(n_tot + r, r) |
+     linalg::dense::Ldlt<T>::diagonal_update_req(n_tot + r, r) |
+     linalg::dense::Ldlt<T>::rank_r_update_req(n_tot + r, r) |
+     linalg::dense::Ldlt<T>::solve_in_place_req(n_tot + r))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  linalg::dense::Ldlt<T> ldl_square;
+  linalg::dense::Ldlt<T> ldl_packed;
+  ldl_packed.set_packed_storage(true);
+  DOCTEST_CHECK(ldl_packed.is_packed());
+
+  ldl_square.factorize(kkt, stack);
+  ldl_packed.factorize(kkt, stack, 2);
+
+  auto check_same = [&](Mat const& a) {
+    Mat a_square = ldl_square.dbg_reconstructed_matrix();
+    Mat a_packed = ldl_packed.dbg_reconstructed_matrix();
+    DOCTEST_CHECK((a_square - a).norm() <= T(1e-9) * a.norm());
+    DOCTEST_CHECK((a_packed - a).norm() <= T(1e-9) * a.norm());
+  };
+  check_same(kkt);
+
+  // insertion in the middle of the matrix, which grows the capacity
+  Mat new_cols = Mat::Random(n_tot + r, r);
+  isize pos = 70;
+  new_cols.middleRows(pos, r) =
+    new_cols.middleRows(pos, r).transpose().eval() +
+    new_cols.middleRows(pos, r) + T(20) * Mat::Identity(r, r);
+  Mat kkt_ins(n_tot + r, n_tot + r);
+  kkt_ins.topLeftCorner(pos, pos) = kkt.topLeftCorner(pos, pos);
+  kkt_ins.bottomRightCorner(n_tot - pos, n_tot - pos) =
+    kkt.bottomRightCorner(n_tot - pos, n_tot - pos);
+  kkt_ins.bottomLeftCorner(n_tot - pos, pos) =
+    kkt.bottomLeftCorner(n_tot - pos, pos);
+  kkt_ins.topRightCorner(pos, n_tot - pos) =
+    kkt.topRightCorner(pos, n_tot - pos);
+  kkt_ins.middleCols(pos, r) = new_cols;
+  kkt_ins.middleRows(pos, r) = new_cols.transpose();
+
+  ldl_square.insert_block_at(pos, new_cols, stack);
+  ldl_packed.insert_block_at(pos, new_cols, stack);
+  check_same(kkt_ins);
+
+  // diagonal update
+  isize indices[] = { 3, 64, 65, 120, 180 };
+  isize indices_copy[] = { 3, 64, 65, 120, 180 };
+  Vec alpha = Vec::Constant(r, T(0.5));
+  ldl_square.diagonal_update_clobber_indices(indices, r, alpha, stack);
+  ldl_packed.diagonal_update_clobber_indices(indices_copy, r, alpha, stack);
+  isize const updated[] = { 3, 64, 65, 120, 180 };
+  for (isize k = 0; k < r; ++k) {
+    kkt_ins(updated[k], updated[k]) += alpha[k];
+  }
+  check_same(kkt_ins);
+
+  // rank r update
+  Mat w = Mat::Random(n_tot + r, r);
+  ldl_square.rank_r_update(w, alpha, stack);
+  ldl_packed.rank_r_update(w, alpha, stack);
+  kkt_ins += w * alpha.asDiagonal() * w.transpose();
+  check_same(kkt_ins);
+
+  // deletion
+  isize const deleted[] = { 0, 63, 64, 128, 190 };
+  ldl_square.delete_at(deleted, r, stack);
+  ldl_packed.delete_at(deleted, r, stack);
+  Mat kkt_del(n_tot, n_tot);
+  {
+    std::vector<isize> kept;
+    for (isize i = 0; i < n_tot + r; ++i) {
+      if (std::find(deleted, deleted + r, i) == deleted + r) {
+        kept.push_back(i);
+      }
+    }
+    for (isize j = 0; j < n_tot; ++j) {
+      for (isize i = 0; i < n_tot; ++i) {
+        kkt_del(i, j) = kkt_ins(kept[i], kept[j]);
+      }
+    }
+  }
+  check_same(kkt_del);
+
+  Vec rhs = Vec::Random(n_tot);
+  Vec sol = rhs;
+  ldl_packed.solve_in_place(sol, stack);
+  DOCTEST_CHECK((kkt_del * sol - rhs).lpNorm<Eigen::Infinity>() <= T(1e-8));
+}
+
+DOCTEST_TEST_CASE("dense ldlt: multiple right hand sides")
+{
+  isize n = 120;
+  isize n_eq = 30;
+  isize n_tot = n + n_eq;
+  isize k = 70;
+  Mat kkt = random_kkt(n, n_eq);
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+     linalg::dense::Ldlt<T>::solve_in_place_req(n_tot) |
+     linalg::dense::Ldlt<T>::solve_in_place_req(n_tot, k))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  Mat rhs = Mat::Random(n_tot, k);
+
+  for (bool packed : { false, true }) {
+    linalg::dense::Ldlt<T> ldl;
+    ldl.set_packed_storage(packed);
+    ldl.factorize(kkt, stack);
+
+    Mat sol = rhs;
+    ldl.solve_in_place_multiple(sol, stack);
+    DOCTEST_CHECK((kkt * sol - rhs).lpNorm<Eigen::Infinity>() <= T(1e-8));
+
+    for (isize j = 0; j < k; ++j) {
+      Vec sol_j = rhs.col(j);
+      ldl.solve_in_place(sol_j, stack);
+      DOCTEST_CHECK((sol_j - sol.col(j)).lpNorm<Eigen::Infinity>() <=
+                    T(1e-10));
+    }
+  }
+}
+
+DOCTEST_TEST_CASE("dense ldlt: blocked rank r update")
+{
+  isize n = 300;
+  isize n_eq = 60;
+  isize n_tot = n + n_eq;
+  isize r = 40;
+  Mat kkt = random_kkt(n, n_eq);
+  DOCTEST_CHECK(
+    linalg::dense::_detail::rank_r_update_prefer_blocked(n_tot, r));
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+     linalg::dense::Ldlt<T>::rank_r_update_req(n_tot, r) |
+     linalg::dense::Ldlt<T>::insert_block_at_req(n_tot, r))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  Mat w = Mat::Random(n_tot, r);
+  Vec alpha = Vec::Ones(r);
+  Mat kkt_upd = kkt + w * w.transpose();
+
+  // large block inserted at the beginning, so that the whole factor is
+  // updated
+  Mat new_cols = Mat::Random(n_tot + r, r);
+  new_cols.topRows(r) =
+    new_cols.topRows(r).transpose().eval() + new_cols.topRows(r);
+  new_cols.topRows(r).diagonal().array() += T(2 * r);
+  Mat kkt_ins(n_tot + r, n_tot + r);
+  kkt_ins.bottomRightCorner(n_tot, n_tot) = kkt_upd;
+  kkt_ins.leftCols(r) = new_cols;
+  kkt_ins.topRows(r) = new_cols.transpose();
+
+  for (bool packed : { false, true }) {
+    linalg::dense::Ldlt<T> ldl;
+    ldl.set_packed_storage(packed);
+    ldl.factorize(kkt, stack);
+
+    ldl.rank_r_update(w, alpha, stack);
+    DOCTEST_CHECK((ldl.dbg_reconstructed_matrix() - kkt_upd).norm() <=
+                  T(1e-9) * kkt_upd.norm());
+
+    ldl.insert_block_at(0, new_cols, stack);
+    DOCTEST_CHECK((ldl.dbg_reconstructed_matrix() - kkt_ins).norm() <=
+                  T(1e-9) * kkt_ins.norm());
+  }
+}
+
+DOCTEST_TEST_CASE("dense ldlt: tuned factorization parameters")
+{
+  linalg::dense::FactorizeParams tuned =
+    linalg::dense::tune_factorize_params<T>(256, 1);
+  DOCTEST_CHECK(tuned.block_size > 0);
+  DOCTEST_CHECK(tuned.recursive_threshold > 0);
+  DOCTEST_CHECK(tuned.blocked_threshold > 0);
+
+  // the parameters are frozen by their first use, and cannot change after
+  linalg::dense::FactorizeParams params =
+    linalg::dense::factorize_params<T>();
+  DOCTEST_CHECK(linalg::dense::factorize_params_frozen<T>());
+  DOCTEST_CHECK(!linalg::dense::set_factorize_params<T>(
+    { params.block_size + 16, 24, 100 }));
+  DOCTEST_CHECK(linalg::dense::set_factorize_params<T>(params));
+  DOCTEST_CHECK(linalg::dense::factorize_params<T>().block_size ==
+                params.block_size);
+
+  // round trip through the cache file, which agrees with the frozen values
+  char const* path = "dense_factorization_params.txt";
+  DOCTEST_CHECK(linalg::dense::save_factorize_params(path));
+  DOCTEST_CHECK(linalg::dense::load_factorize_params(path));
+  DOCTEST_CHECK(linalg::dense::autotune_factorize_params(path));
+  DOCTEST_CHECK(linalg::dense::factorize_params<T>().recursive_threshold ==
+                params.recursive_threshold);
+  DOCTEST_CHECK(linalg::dense::factorize_params<T>().blocked_threshold ==
+                params.blocked_threshold);
+  std::remove(path);
+
+  isize n = 300;
+  isize n_eq = 60;
+  isize n_tot = n + n_eq;
+  Mat kkt = random_kkt(n, n_eq);
+
+  proxsuite::linalg::veg::Vec<unsigned char> storage;
+  storage.resize_for_overwrite(
+    (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+     linalg::dense::Ldlt<T>::solve_in_place_req(n_tot))
+      .alloc_req());
+  proxsuite::linalg::veg::dynstack::DynStackMut stack{
+    proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+  };
+
+  linalg::dense::Ldlt<T> ldl;
+  ldl.factorize(kkt, stack);
+
+  DOCTEST_CHECK((ldl.dbg_reconstructed_matrix() - kkt).norm() <=
+                T(1e-10) * kkt.norm());
+  Vec rhs = Vec::Random(n_tot);
+  Vec sol = rhs;
+  ldl.solve_in_place(sol, stack);
+  DOCTEST_CHECK((kkt * sol - rhs).lpNorm<Eigen::Infinity>() <= T(1e-8));
+}
+
+DOCTEST_TEST_CASE("dense ldlt: fused permuted solve")
+{
+  // sizes around the width of the column groups of the fused kernel
+  for (isize n : { 1, 2, 3, 4, 5, 7, 9, 17, 64, 131 }) {
+    isize n_eq = n / 3;
+    isize n_tot = n + n_eq;
+    Mat kkt = random_kkt(n, n_eq);
+
+    proxsuite::linalg::veg::Vec<unsigned char> storage;
+    storage.resize_for_overwrite(
+      (linalg::dense::Ldlt<T>::factorize_req(n_tot) |
+       linalg::dense::Ldlt<T>::solve_in_place_req(n_tot))
+        .alloc_req());
+    proxsuite::linalg::veg::dynstack::DynStackMut stack{
+      proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+    };
+
+    linalg::dense::Ldlt<T> ldl;
+    ldl.factorize(kkt, stack);
+
+    Vec rhs = Vec::Random(n_tot);
+    Vec sol = rhs;
+    ldl.solve_in_place(sol, stack);
+    DOCTEST_CHECK((kkt * sol - rhs).lpNorm<Eigen::Infinity>() <= T(1e-8));
+  }
+}
+
+DOCTEST_TEST_CASE("dense ldlt: pivot monitor and condition estimate")
+{
+  isize n = 60;
+  isize n_eq = 20;
+  isize n_tot = n + n_eq;
+  Mat kkt = random_kkt(n, n_eq);
+
+  for (bool packed : { false, true }) {
+    proxsuite::linalg::veg::Vec<unsigned char> storage;
+    storage.resize_for_overwrite(
+      (linalg::dense::Ldlt<T>::factorize_req(n_tot, packed) |
+       linalg::dense::Ldlt<T>::delete_at_req(n_tot, 1) |
+       linalg::dense::Ldlt<T>::insert_block_at_req(n_tot, 1) |
+       linalg::dense::Ldlt<T>::condition_estimate_req(n_tot))
+        .alloc_req());
+    proxsuite::linalg::veg::dynstack::DynStackMut stack{
+      proxsuite::linalg::veg::from_slice_mut, storage.as_mut()
+    };
+
+    linalg::dense::Ldlt<T> ldl;
+    ldl.set_packed_storage(packed);
+    ldl.factorize(kkt, stack);
+
+    DOCTEST_CHECK(ldl.pivot_growth() == T(1));
+    DOCTEST_CHECK(ldl.min_abs_pivot() > T(0));
+    DOCTEST_CHECK(ldl.min_abs_pivot() <= ldl.max_abs_pivot());
+    DOCTEST_CHECK(!ldl.is_degraded(std::numeric_limits<T>::epsilon()));
+
+    // the estimate is a lower bound, that is usually within a small factor of
+    // the exact condition number
+    Mat kkt_full = kkt.selfadjointView<Eigen::Lower>();
+    T cond = kkt_full.cwiseAbs().colwise().sum().maxCoeff() *
+             kkt_full.inverse().cwiseAbs().colwise().sum().maxCoeff();
+    T estimate = ldl.condition_estimate(stack);
+    DOCTEST_CHECK(estimate <= cond * T(1 + 1e-8));
+    DOCTEST_CHECK(estimate >= cond / T(10));
+
+    // replacing the last row and column of the matrix by a linear combination
+    // of the others makes it numerically singular
+    // the diagonal entry is chosen so that the schur complement vanishes
+    isize index = n_tot - 1;
+    ldl.delete_at(&index, 1, stack);
+    Mat kkt_reduced = kkt_full.topLeftCorner(n_tot - 1, n_tot - 1);
+    Vec a = kkt_full.col(index).head(n_tot - 1);
+    Mat col(n_tot, 1);
+    col.col(0).head(n_tot - 1) = a;
+    col(index, 0) = a.dot(kkt_reduced.lu().solve(a));
+    ldl.insert_block_at(index, col, stack);
+    DOCTEST_CHECK(ldl.pivot_growth() >= T(0));
+    DOCTEST_CHECK(ldl.is_degraded(T(1e-10)));
+  }
+}
@@ -383,3 +383,32 @@ DOCTEST_TEST_CASE("sparse random strongly convex qp with equality and "
   std::cout << "setup timing " << results.info.setup_time << " solve time "
             << results.info.solve_time << std::endl;
 }
+
+DOCTEST_TEST_CASE("proxqp::dense: fused matrix vector and transposed products")
+{
+  utils::rand::set_seed(1);
+  // the second size spans several row blocks of the kernel
+  for (dense::isize n : { 7, 300 }) {
+    dense::isize m = 3 * n + 1;
+    Eigen::Matrix<T, -1, -1, Eigen::RowMajor> a_row =
+      Eigen::Matrix<T, -1, -1, Eigen::RowMajor>::Random(m, n);
+    Eigen::Matrix<T, -1, -1, Eigen::ColMajor> a_col = a_row;
+    Eigen::Matrix<T, -1, 1> in_l = Eigen::Matrix<T, -1, 1>::Random(m);
+    Eigen::Matrix<T, -1, 1> in_r = Eigen::Matrix<T, -1, 1>::Random(n);
+
+    Eigen::Matrix<T, -1, 1> out_l = Eigen::Matrix<T, -1, 1>::Ones(n);
+    Eigen::Matrix<T, -1, 1> out_r = Eigen::Matrix<T, -1, 1>::Ones(m);
+    Eigen::Matrix<T, -1, 1> ref_l = out_l + a_row.transpose() * in_l;
+    Eigen::Matrix<T, -1, 1> ref_r = out_r + a_row * in_r;
+
+    dense::detail::noalias_gevmmv_add(out_l, out_r, a_row, in_l, in_r);
+    DOCTEST_CHECK((out_l - ref_l).lpNorm<Eigen::Infinity>() <= 1e-10);
+    DOCTEST_CHECK((out_r - ref_r).lpNorm<Eigen::Infinity>() <= 1e-10);
+
+    out_l.setOnes();
+    out_r.setOnes();
+    dense::detail::noalias_gevmmv_add(out_l, out_r, a_col, in_l, in_r);
+    DOCTEST_CHECK((out_l - ref_l).lpNorm<Eigen::Infinity>() <= 1e-10);
+    DOCTEST_CHECK((out_r - ref_r).lpNorm<Eigen::Infinity>() <= 1e-10);
+  }
+}
@@ -6798,4 +6798,103 @@ TEST_CASE("ProxQP::dense: init must be called before update")
               .lpNorm<Eigen::Infinity>();
   CHECK(dua_res <= eps_abs);
   CHECK(pri_res <= eps_abs);
-}
\ No newline at end of file
+}
+
+TEST_CASE(
+  "ProxQP::dense: sparse random strongly convex qp with equality and "
+  "inequality constraints, using the mixed precision factorization")
+{
+  std::cout << "---testing sparse random strongly convex qp with equality and "
+               "inequality constraints, using the mixed precision "
+               "factorization---"
+            << std::endl;
+  double sparsity_factor = 0.15;
+  T eps_abs = T(1e-9);
+  utils::rand::set_seed(1);
+  dense::isize dim = 100;
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  T strong_convexity_factor(1.e-2);
+  proxqp::dense::Model<T> qp_random = proxqp::utils::dense_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  for (bool packed_factorization : { false, true }) {
+    dense::QP<T> qp{ dim, n_eq, n_in };
+    qp.settings.eps_abs = eps_abs;
+    qp.settings.eps_rel = 0;
+    qp.settings.mixed_precision_factorization = true;
+    qp.settings.packed_factorization = packed_factorization;
+    qp.init(qp_random.H,
+            qp_random.g,
+            qp_random.A,
+            qp_random.b,
+            qp_random.C,
+            qp_random.l,
+            qp_random.u);
+    qp.solve();
+
+    T pri_res = std::max(
+      (qp_random.A * qp.results.x - qp_random.b).lpNorm<Eigen::Infinity>(),
+      (helpers::positive_part(qp_random.C * qp.results.x - qp_random.u) +
+       helpers::negative_part(qp_random.C * qp.results.x - qp_random.l))
+        .lpNorm<Eigen::Infinity>());
+    T dua_res = (qp_random.H * qp.results.x + qp_random.g +
+                 qp_random.A.transpose() * qp.results.y +
+                 qp_random.C.transpose() * qp.results.z)
+                  .lpNorm<Eigen::Infinity>();
+    CHECK(pri_res <= eps_abs);
+    CHECK(dua_res <= eps_abs);
+    // the problem is well conditioned enough for the refinement to converge
+    // with the single precision factorization
+    CHECK(qp.work.ldl_use_f32);
+    CHECK(!qp.work.ldl_f32_stalled);
+    CHECK(qp.work.ldl_is_packed() == packed_factorization);
+
+    std::cout << "------using API solving qp with dim: " << dim
+              << " neq: " << n_eq << " nin: " << n_in << std::endl;
+    std::cout << "primal residual: " << pri_res << std::endl;
+    std::cout << "dual residual: " << dua_res << std::endl;
+    std::cout << "total number of iteration: " << qp.results.info.iter
+              << std::endl;
+  }
+}
+
+TEST_CASE("ProxQP::dense: the packed factorization only allocates the lower "
+          "triangular part of the factor")
+{
+  std::cout << "---testing the memory allocated by the packed "
+               "factorization---"
+            << std::endl;
+  double sparsity_factor = 0.15;
+  utils::rand::set_seed(1);
+  dense::isize dim = 200;
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  dense::isize n_tot = dim + n_eq + n_in;
+  T strong_convexity_factor(1.e-2);
+  proxqp::dense::Model<T> qp_random = proxqp::utils::dense_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  for (bool packed_factorization : { false, true }) {
+    dense::QP<T> qp{ dim, n_eq, n_in };
+    qp.settings.packed_factorization = packed_factorization;
+    qp.init(qp_random.H,
+            qp_random.g,
+            qp_random.A,
+            qp_random.b,
+            qp_random.C,
+            qp_random.l,
+            qp_random.u);
+    qp.solve();
+
+    CHECK(qp.results.info.status == QPSolverOutput::PROXQP_SOLVED);
+    CHECK(qp.work.ldl_is_packed() == packed_factorization);
+    // the square buffer reserved by the workspace constructor is released
+    // when switching to the packed storage
+    if (packed_factorization) {
+      CHECK(qp.work.ldl.storage_capacity() < n_tot * n_tot * 3 / 4);
+    } else {
+      CHECK(qp.work.ldl.storage_capacity() >= n_tot * n_tot);
+    }
+  }
+}
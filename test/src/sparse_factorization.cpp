@@ -2,8 +2,10 @@
 // Copyright (c) 2022 INRIA
 //
 #include <proxsuite/linalg/sparse/factorize.hpp>
+#include <proxsuite/linalg/sparse/supernodal.hpp>
 #include <proxsuite/linalg/sparse/update.hpp>
 #include <proxsuite/linalg/sparse/rowmod.hpp>
+#include <proxsuite/linalg/sparse/solve.hpp>
 #include <proxsuite/linalg/veg/vec.hpp>
 #include <doctest.hpp>
 #include <iostream>
@@ -469,6 +471,166 @@ TEST_CASE("ldlt: factorize uncompressed, rank update")
           .norm() < T(1e-10));
 }
 
+TEST_CASE("ldlt: multiple rank update")
+{
+  using I = isize;
+  using T = double;
+  using Mat = Eigen::Matrix<T, -1, -1, Eigen::ColMajor>;
+
+  isize n = 60;
+  isize rank = 11;
+  std::srand(3);
+
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i < j; ++i) {
+      if (std::rand() % 15 == 0) {
+        row_ind.push(i);
+        vals.push(T(std::rand() % 100) / T(100) - T(0.5));
+      }
+    }
+    row_ind.push(j);
+    vals.push(T(n));
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  // columns of the update, with a mix of updates and downdates
+  Vec<I> w_col_ptrs;
+  Vec<I> w_row_indices;
+  Vec<T> w_values;
+  Vec<T> alpha;
+  w_col_ptrs.push(0);
+  for (isize k = 0; k < rank; ++k) {
+    for (isize i = 0; i < n; ++i) {
+      if (std::rand() % 12 == 0) {
+        w_row_indices.push(i);
+        w_values.push(T(std::rand() % 100) / T(100) + T(0.5));
+      }
+    }
+    w_col_ptrs.push(w_row_indices.len());
+    alpha.push(k % 3 == 2 ? T(-0.5) : T(1));
+  }
+  MatRef<T, I> w{
+    from_raw_parts,   n,       rank, w_row_indices.len(), w_col_ptrs.ptr(),
+    nullptr,          w_row_indices.ptr(), w_values.ptr(),
+  };
+
+  Vec<I> etree;
+  Vec<I> perm_inv;
+  Vec<I> l_nnz_per_col;
+  Vec<I> l_col_ptrs;
+  Vec<I> l_row_indices;
+  Vec<T> l_values;
+  etree.resize_for_overwrite(n);
+  perm_inv.resize_for_overwrite(n);
+  l_nnz_per_col.resize_for_overwrite(n);
+  l_row_indices.resize_for_overwrite(n * n);
+  l_values.resize_for_overwrite(n * n);
+  for (isize k = 0; k < n + 1; ++k) {
+    l_col_ptrs.push(k * n);
+  }
+
+  Vec<unsigned char> _stack;
+  _stack.resize_for_overwrite(
+    (factorize_symbolic_req(Tag<I>{}, n, nnz, Ordering::amd) |
+     factorize_numeric_req(Tag<T>{}, Tag<I>{}, n, nnz, Ordering::amd) |
+     rank1_update_req(Tag<T>{}, Tag<I>{}, n, false, n) |
+     rank_r_update_req(
+       Tag<T>{}, Tag<I>{}, n, false, rank, w_row_indices.len()))
+      .alloc_req());
+  dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+  factorize_symbolic_non_zeros(l_nnz_per_col.ptr_mut(),
+                               etree.ptr_mut(),
+                               perm_inv.ptr_mut(),
+                               static_cast<I const*>(nullptr),
+                               a.symbolic(),
+                               stack);
+  factorize_numeric(l_values.ptr_mut(),
+                    l_row_indices.ptr_mut(),
+                    nullptr,
+                    nullptr,
+                    l_col_ptrs.ptr(),
+                    etree.ptr(),
+                    perm_inv.ptr(),
+                    a,
+                    stack);
+  isize lnnz = 0;
+  for (isize k = 0; k < n; ++k) {
+    lnnz += l_nnz_per_col[k];
+  }
+
+  // reference: one rank one update per column
+  Vec<I> etree_ref;
+  Vec<I> l_nnz_per_col_ref;
+  Vec<I> l_row_indices_ref;
+  Vec<T> l_values_ref;
+  etree_ref = etree;
+  l_nnz_per_col_ref = l_nnz_per_col;
+  l_row_indices_ref = l_row_indices;
+  l_values_ref = l_values;
+  MatMut<T, I> ld_ref{
+    from_raw_parts,
+    n,
+    n,
+    lnnz,
+    l_col_ptrs.ptr_mut(),
+    l_nnz_per_col_ref.ptr_mut(),
+    l_row_indices_ref.ptr_mut(),
+    l_values_ref.ptr_mut(),
+  };
+  for (isize k = 0; k < rank; ++k) {
+    VecRef<T, I> wk{
+      from_raw_parts,
+      n,
+      w_col_ptrs[k + 1] - w_col_ptrs[k],
+      w_row_indices.ptr() + w_col_ptrs[k],
+      w_values.ptr() + w_col_ptrs[k],
+    };
+    ld_ref = rank1_update(
+      ld_ref, etree_ref.ptr_mut(), perm_inv.ptr(), wk, alpha[k], stack);
+  }
+
+  MatMut<T, I> ld{
+    from_raw_parts,
+    n,
+    n,
+    lnnz,
+    l_col_ptrs.ptr_mut(),
+    l_nnz_per_col.ptr_mut(),
+    l_row_indices.ptr_mut(),
+    l_values.ptr_mut(),
+  };
+  ld = rank_r_update(
+    ld, etree.ptr_mut(), perm_inv.ptr(), w, alpha.ptr(), stack);
+
+  CHECK(ld.nnz() == ld_ref.nnz());
+  for (isize j = 0; j < n; ++j) {
+    CHECK(etree[j] == etree_ref[j]);
+    CHECK(l_nnz_per_col[j] == l_nnz_per_col_ref[j]);
+    for (isize p = l_col_ptrs[j]; p < l_col_ptrs[j] + l_nnz_per_col[j]; ++p) {
+      CHECK(l_row_indices[p] == l_row_indices_ref[p]);
+      CHECK(std::fabs(l_values[p] - l_values_ref[p]) < T(1e-12));
+    }
+  }
+
+  Mat w_eigen = to_eigen(w);
+  Mat alpha_eigen = Eigen::Map<Eigen::Matrix<T, -1, 1>>(alpha.ptr_mut(), rank)
+                      .asDiagonal();
+  Mat a_updated = Mat(to_eigen(a).selfadjointView<Eigen::Upper>()) +
+                  w_eigen * alpha_eigen * w_eigen.transpose();
+  CHECK((reconstruct_with_perm(perm_inv.as_ref(), ld.as_const()) - a_updated)
+          .norm() < T(1e-10) * a_updated.norm());
+}
+
 TEST_CASE("ldlt: row mod")
 {
   using I = isize;
@@ -629,3 +791,756 @@ TEST_CASE("ldlt: row mod")
   std::cout << to_eigen(ld.as_const()) << '\n' << '\n';
   dump_reconstructed();
 }
+
+TEST_CASE("ldlt: batched row mod")
+{
+  using I = isize;
+  using T = double;
+  using Mat = Eigen::Matrix<T, -1, -1, Eigen::ColMajor>;
+
+  isize n = 50;
+  std::srand(5);
+
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i < j; ++i) {
+      if (std::rand() % 10 == 0) {
+        row_ind.push(i);
+        vals.push(T(std::rand() % 100) / T(100) - T(0.5));
+      }
+    }
+    row_ind.push(j);
+    vals.push(T(n));
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  Vec<I> etree;
+  Vec<I> perm_inv;
+  Vec<I> l_nnz_per_col;
+  Vec<I> l_col_ptrs;
+  Vec<I> l_row_indices;
+  Vec<T> l_values;
+  etree.resize_for_overwrite(n);
+  perm_inv.resize_for_overwrite(n);
+  l_nnz_per_col.resize_for_overwrite(n);
+  l_row_indices.resize_for_overwrite(n * n);
+  l_values.resize_for_overwrite(n * n);
+  for (isize k = 0; k < n + 1; ++k) {
+    l_col_ptrs.push(k * n);
+  }
+
+  Vec<I> deleted;
+  for (auto i : { 30, 4, 12, 45, 11, 0 }) {
+    deleted.push(I(i));
+  }
+  Vec<I> added;
+  for (auto i : { 11, 45, 0, 4 }) {
+    added.push(I(i));
+  }
+  isize count = deleted.len();
+
+  Vec<unsigned char> _stack;
+  _stack.resize_for_overwrite(
+    (factorize_symbolic_req(Tag<I>{}, n, nnz, Ordering::amd) |
+     factorize_numeric_req(Tag<T>{}, Tag<I>{}, n, nnz, Ordering::amd) |
+     delete_rows_req(Tag<T>{}, Tag<I>{}, n, count) |
+     add_rows_req(Tag<T>{}, Tag<I>{}, n, false, count, n))
+      .alloc_req());
+  dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+  factorize_symbolic_non_zeros(l_nnz_per_col.ptr_mut(),
+                               etree.ptr_mut(),
+                               perm_inv.ptr_mut(),
+                               static_cast<I const*>(nullptr),
+                               a.symbolic(),
+                               stack);
+  factorize_numeric(l_values.ptr_mut(),
+                    l_row_indices.ptr_mut(),
+                    nullptr,
+                    nullptr,
+                    l_col_ptrs.ptr(),
+                    etree.ptr(),
+                    perm_inv.ptr(),
+                    a,
+                    stack);
+  isize lnnz = 0;
+  for (isize k = 0; k < n; ++k) {
+    lnnz += l_nnz_per_col[k];
+  }
+  MatMut<T, I> ld{
+    from_raw_parts,
+    n,
+    n,
+    lnnz,
+    l_col_ptrs.ptr_mut(),
+    l_nnz_per_col.ptr_mut(),
+    l_row_indices.ptr_mut(),
+    l_values.ptr_mut(),
+  };
+
+  // the parent of each column must be its first off diagonal row
+  auto check_etree = [&] {
+    for (isize j = 0; j < n; ++j) {
+      isize start = l_col_ptrs[j];
+      CHECK(etree[j] == (l_nnz_per_col[j] > 1 ? l_row_indices[start + 1]
+                                               : I(-1)));
+    }
+  };
+
+  Mat a_full = Mat(to_eigen(a).selfadjointView<Eigen::Upper>());
+  for (isize k = 0; k < count; ++k) {
+    a_full.row(deleted[k]).setZero();
+    a_full.col(deleted[k]).setZero();
+    a_full(deleted[k], deleted[k]) = T(1);
+  }
+
+  ld = delete_rows(
+    ld, etree.ptr_mut(), perm_inv.ptr(), deleted.as_ref(), stack);
+  check_etree();
+  CHECK((reconstruct_with_perm(perm_inv.as_ref(), ld.as_const()) - a_full)
+          .norm() < T(1e-10) * a_full.norm());
+
+  // the added columns have no element in the rows of the deleted ones
+  Vec<I> new_col_ptrs;
+  Vec<I> new_row_indices;
+  Vec<T> new_values;
+  Vec<T> new_diag;
+  new_col_ptrs.push(0);
+  for (isize k = 0; k < added.len(); ++k) {
+    for (isize i = 0; i < n; ++i) {
+      bool is_deleted = false;
+      for (isize q = 0; q < count; ++q) {
+        is_deleted = is_deleted || deleted[q] == i;
+      }
+      if (!is_deleted && std::rand() % 6 == 0) {
+        new_row_indices.push(i);
+        new_values.push(T(std::rand() % 100) / T(100) - T(0.5));
+        a_full(i, added[k]) = new_values[new_values.len() - 1];
+        a_full(added[k], i) = new_values[new_values.len() - 1];
+      }
+    }
+    new_col_ptrs.push(new_row_indices.len());
+    new_diag.push(T(-1) - T(k));
+    a_full(added[k], added[k]) = new_diag[k];
+  }
+  MatRef<T, I> new_cols{
+    from_raw_parts,   n,       added.len(), new_row_indices.len(),
+    new_col_ptrs.ptr(), nullptr, new_row_indices.ptr(), new_values.ptr(),
+  };
+
+  ld = add_rows(ld,
+                etree.ptr_mut(),
+                perm_inv.ptr(),
+                added.as_ref(),
+                new_cols,
+                new_diag.ptr(),
+                stack);
+  check_etree();
+  CHECK((reconstruct_with_perm(perm_inv.as_ref(), ld.as_const()) - a_full)
+          .norm() < T(1e-10) * a_full.norm());
+}
+
+TEST_CASE("ldlt: supernodal factorization")
+{
+  using I = isize;
+  using T = double;
+  using Mat = Eigen::Matrix<T, -1, -1, Eigen::ColMajor>;
+
+  isize n = 150;
+  std::srand(1);
+
+  // banded matrix with a few dense rows, so that the factor has supernodes of
+  // various widths
+  Mat a_dense = Mat::Zero(n, n);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i < j; ++i) {
+      if (j - i <= 2 || i % 37 == 0 || std::rand() % 50 == 0) {
+        a_dense(i, j) = T(std::rand() % 100) / T(100) - T(0.5);
+      }
+    }
+    a_dense(j, j) = T(n);
+  }
+
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i <= j; ++i) {
+      if (a_dense(i, j) != T(0)) {
+        row_ind.push(i);
+        vals.push(a_dense(i, j));
+      }
+    }
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  Vec<T> diag;
+  for (isize i = 0; i < n; ++i) {
+    diag.push(i % 2 == 0 ? T(1) : T(-2 * n));
+  }
+  Mat a_full = Mat(a_dense.selfadjointView<Eigen::Upper>());
+  a_full.diagonal() += Eigen::Map<Eigen::Matrix<T, -1, 1>>(diag.ptr_mut(), n);
+
+  for (Ordering o : { Ordering::amd, Ordering::user_provided }) {
+    Vec<I> perm;
+    Vec<I> perm_inv;
+    Vec<I> etree;
+    Vec<I> l_nnz_per_col;
+    perm.resize_for_overwrite(n);
+    perm_inv.resize_for_overwrite(n);
+    etree.resize_for_overwrite(n);
+    l_nnz_per_col.resize_for_overwrite(n);
+    for (isize i = 0; i < n; ++i) {
+      perm[i] = (i * 7) % n;
+    }
+
+    Vec<unsigned char> _stack;
+    _stack.resize_for_overwrite(
+      (factorize_symbolic_req(Tag<I>{}, n, nnz, o) |
+       factorize_numeric_req(Tag<T>{}, Tag<I>{}, n, nnz, o) |
+       factorize_numeric_supernodal_req(Tag<T>{}, Tag<I>{}, n, nnz, n, o, 4) |
+       factorize_numeric_supernodal_pattern_req(Tag<I>{}, n) |
+       factorize_numeric_supernodal_refactor_req(
+         Tag<T>{}, Tag<I>{}, n, nnz, n, 4) |
+       ldlt_solve_schedule_req(Tag<I>{}, n) |
+       ldlt_solve_in_place_req(Tag<T>{}, Tag<I>{}, n, 4))
+        .alloc_req());
+    dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+    factorize_symbolic_non_zeros(l_nnz_per_col.ptr_mut(),
+                                 etree.ptr_mut(),
+                                 perm_inv.ptr_mut(),
+                                 o == Ordering::amd ? nullptr : perm.ptr(),
+                                 a.symbolic(),
+                                 stack);
+    if (o == Ordering::amd) {
+      for (isize i = 0; i < n; ++i) {
+        perm[perm_inv[i]] = i;
+      }
+    }
+
+    Vec<I> l_col_ptrs;
+    l_col_ptrs.push(0);
+    for (isize j = 0; j < n; ++j) {
+      l_col_ptrs.push(l_col_ptrs[j] + l_nnz_per_col[j]);
+    }
+    isize lnnz = l_col_ptrs[n];
+
+    Vec<I> row_indices_ref;
+    Vec<T> values_ref;
+    Vec<I> row_indices;
+    Vec<T> values;
+    row_indices_ref.resize_for_overwrite(lnnz);
+    values_ref.resize_for_overwrite(lnnz);
+    row_indices.resize_for_overwrite(lnnz);
+    values.resize_for_overwrite(lnnz);
+
+    factorize_numeric(values_ref.ptr_mut(),
+                      row_indices_ref.ptr_mut(),
+                      diag.ptr(),
+                      perm.ptr(),
+                      l_col_ptrs.ptr(),
+                      etree.ptr(),
+                      perm_inv.ptr(),
+                      a,
+                      stack);
+    // sequential, then with the subtrees of the elimination tree spread over
+    // several threads
+    for (isize nb_threads : { 1, 4 }) {
+      factorize_numeric_supernodal(values.ptr_mut(),
+                                   row_indices.ptr_mut(),
+                                   diag.ptr(),
+                                   perm.ptr(),
+                                   l_col_ptrs.ptr(),
+                                   l_nnz_per_col.ptr(),
+                                   etree.ptr(),
+                                   perm_inv.ptr(),
+                                   a,
+                                   stack,
+                                   nb_threads);
+
+      for (isize p = 0; p < lnnz; ++p) {
+        CHECK(row_indices[p] == row_indices_ref[p]);
+        CHECK(std::fabs(values[p] - values_ref[p]) < T(1e-10));
+      }
+
+      MatRef<T, I> ld{
+        from_raw_parts, n,      n, lnnz, l_col_ptrs.ptr(), nullptr,
+        row_indices.ptr(), values.ptr(),
+      };
+      CHECK((reconstruct_with_perm(perm_inv.as_ref(), ld) - a_full).norm() <
+            T(1e-8) * a_full.norm());
+
+      // same factorization from the precomputed lower triangular part of the
+      // permuted matrix
+      Vec<I> lower_col_ptrs;
+      Vec<I> lower_row_indices;
+      Vec<I> lower_sources;
+      lower_col_ptrs.resize_for_overwrite(n + 1);
+      lower_row_indices.resize_for_overwrite(nnz);
+      lower_sources.resize_for_overwrite(nnz);
+      factorize_numeric_supernodal_pattern(lower_col_ptrs.ptr_mut(),
+                                           lower_row_indices.ptr_mut(),
+                                           lower_sources.ptr_mut(),
+                                           perm_inv.ptr(),
+                                           a.symbolic(),
+                                           stack);
+      Vec<I> row_indices_refactor;
+      Vec<T> values_refactor;
+      row_indices_refactor.resize_for_overwrite(lnnz);
+      values_refactor.resize_for_overwrite(lnnz);
+      factorize_numeric_supernodal_refactor(values_refactor.ptr_mut(),
+                                            row_indices_refactor.ptr_mut(),
+                                            diag.ptr(),
+                                            perm.ptr(),
+                                            l_col_ptrs.ptr(),
+                                            l_nnz_per_col.ptr(),
+                                            etree.ptr(),
+                                            lower_col_ptrs.ptr(),
+                                            lower_row_indices.ptr(),
+                                            lower_sources.ptr(),
+                                            a.values(),
+                                            n,
+                                            stack,
+                                            nb_threads);
+      for (isize p = 0; p < lnnz; ++p) {
+        CHECK(row_indices_refactor[p] == row_indices[p]);
+        CHECK(values_refactor[p] == values[p]);
+      }
+
+      // triangular solves following a supernodal schedule
+      Vec<I> sn_start;
+      Vec<I> sn_order;
+      Vec<I> subtree_ptr;
+      sn_start.resize_for_overwrite(n + 1);
+      sn_order.resize_for_overwrite(n);
+      subtree_ptr.resize_for_overwrite(n + 1);
+      auto schedule = ldlt_solve_schedule(sn_start.ptr_mut(),
+                                          sn_order.ptr_mut(),
+                                          subtree_ptr.ptr_mut(),
+                                          ld,
+                                          nb_threads,
+                                          stack);
+      CHECK(schedule.ns < usize(n));
+
+      Mat l = to_eigen(ld).triangularView<Eigen::UnitLower>();
+      Eigen::Matrix<T, -1, 1> b = Eigen::Matrix<T, -1, 1>::Random(n);
+      Eigen::Matrix<T, -1, 1> x = b;
+      ldlt_solve_in_place<T, I>({ from_eigen, x }, ld, schedule, stack);
+      Mat ldlt = l * to_eigen(ld).diagonal().asDiagonal() * l.transpose();
+      CHECK((ldlt * x - b).norm() < T(1e-8) * b.norm());
+    }
+  }
+}
+
+TEST_CASE("ldlt: value only refactorization")
+{
+  using I = isize;
+  using T = double;
+
+  isize n = 120;
+  std::srand(2);
+
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i < j; ++i) {
+      if (j - i <= 1 || std::rand() % 20 == 0) {
+        row_ind.push(i);
+        vals.push(T(std::rand() % 100) / T(100) - T(0.5));
+      }
+    }
+    row_ind.push(j);
+    vals.push(T(n));
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  Vec<T> diag;
+  for (isize i = 0; i < n; ++i) {
+    diag.push(i % 3 == 0 ? T(-2 * n) : T(1));
+  }
+
+  Vec<I> perm;
+  Vec<I> perm_inv;
+  Vec<I> etree;
+  Vec<I> l_nnz_per_col;
+  perm.resize_for_overwrite(n);
+  perm_inv.resize_for_overwrite(n);
+  etree.resize_for_overwrite(n);
+  l_nnz_per_col.resize_for_overwrite(n);
+
+  Vec<unsigned char> _stack;
+  _stack.resize_for_overwrite(
+    (factorize_symbolic_req(Tag<I>{}, n, nnz, Ordering::amd) |
+     factorize_numeric_req(Tag<T>{}, Tag<I>{}, n, nnz, Ordering::amd) |
+     factorize_numeric_pattern_req(Tag<I>{}, n) |
+     factorize_numeric_refactor_req(Tag<T>{}, Tag<I>{}, n))
+      .alloc_req());
+  dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+  factorize_symbolic_non_zeros(l_nnz_per_col.ptr_mut(),
+                               etree.ptr_mut(),
+                               perm_inv.ptr_mut(),
+                               static_cast<I const*>(nullptr),
+                               a.symbolic(),
+                               stack);
+  for (isize i = 0; i < n; ++i) {
+    perm[perm_inv[i]] = i;
+  }
+
+  Vec<I> l_col_ptrs;
+  l_col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    l_col_ptrs.push(l_col_ptrs[j] + l_nnz_per_col[j]);
+  }
+  isize lnnz = l_col_ptrs[n];
+
+  Vec<I> permuted_col_ptrs;
+  Vec<I> permuted_row_indices;
+  Vec<I> permuted_sources;
+  Vec<I> l_row_ptrs;
+  Vec<I> l_col_indices;
+  permuted_col_ptrs.resize_for_overwrite(n + 1);
+  permuted_row_indices.resize_for_overwrite(nnz);
+  permuted_sources.resize_for_overwrite(nnz);
+  l_row_ptrs.resize_for_overwrite(n + 1);
+  l_col_indices.resize_for_overwrite(lnnz - n);
+  factorize_numeric_pattern(permuted_col_ptrs.ptr_mut(),
+                            permuted_row_indices.ptr_mut(),
+                            permuted_sources.ptr_mut(),
+                            l_row_ptrs.ptr_mut(),
+                            l_col_indices.ptr_mut(),
+                            etree.ptr(),
+                            perm_inv.ptr(),
+                            a.symbolic(),
+                            stack);
+  CHECK(l_row_ptrs[n] == lnnz - n);
+
+  Vec<I> row_indices_ref;
+  Vec<T> values_ref;
+  Vec<I> row_indices;
+  Vec<T> values;
+  row_indices_ref.resize_for_overwrite(lnnz);
+  values_ref.resize_for_overwrite(lnnz);
+  row_indices.resize_for_overwrite(lnnz);
+  values.resize_for_overwrite(lnnz);
+
+  // the pattern is computed once, and reused for new values
+  for (isize k = 0; k < 3; ++k) {
+    if (k > 0) {
+      for (isize p = 0; p < nnz; ++p) {
+        vals[p] *= T(std::rand() % 100 + 50) / T(100);
+      }
+    }
+    factorize_numeric(values_ref.ptr_mut(),
+                      row_indices_ref.ptr_mut(),
+                      diag.ptr(),
+                      perm.ptr(),
+                      l_col_ptrs.ptr(),
+                      etree.ptr(),
+                      perm_inv.ptr(),
+                      a,
+                      stack);
+    factorize_numeric_refactor(values.ptr_mut(),
+                               row_indices.ptr_mut(),
+                               diag.ptr(),
+                               perm.ptr(),
+                               l_col_ptrs.ptr(),
+                               permuted_col_ptrs.ptr(),
+                               permuted_row_indices.ptr(),
+                               permuted_sources.ptr(),
+                               l_row_ptrs.ptr(),
+                               l_col_indices.ptr(),
+                               vals.ptr(),
+                               n,
+                               stack);
+    for (isize p = 0; p < lnnz; ++p) {
+      CHECK(row_indices[p] == row_indices_ref[p]);
+      CHECK(values[p] == values_ref[p]);
+    }
+  }
+}
+
+TEST_CASE("ldlt: fill reducing orderings")
+{
+  using I = isize;
+  using T = double;
+  using Mat = Eigen::Matrix<T, -1, -1, Eigen::ColMajor>;
+
+  // 5-point laplacian on a 30 x 30 grid, with the vertices numbered in a
+  // scrambled order
+  isize m = 30;
+  isize n = m * m;
+  Vec<I> label;
+  for (isize i = 0; i < n; ++i) {
+    label.push((i * 7) % n);
+  }
+  Mat a_full = Mat::Zero(n, n);
+  for (isize x = 0; x < m; ++x) {
+    for (isize y = 0; y < m; ++y) {
+      isize i = label[x * m + y];
+      a_full(i, i) = T(4);
+      if (x + 1 < m) {
+        isize j = label[(x + 1) * m + y];
+        a_full(i, j) = a_full(j, i) = T(-1);
+      }
+      if (y + 1 < m) {
+        isize j = label[x * m + y + 1];
+        a_full(i, j) = a_full(j, i) = T(-1);
+      }
+    }
+  }
+
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i <= j; ++i) {
+      if (a_full(i, j) != T(0)) {
+        row_ind.push(i);
+        vals.push(a_full(i, j));
+      }
+    }
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  Vec<I> cons;
+  for (isize i = 0; i < n; ++i) {
+    cons.push(i % 3);
+  }
+  Vec<T> diag;
+  for (isize i = 0; i < n; ++i) {
+    diag.push(T(0));
+  }
+
+  Vec<unsigned char> _stack;
+  _stack.resize_for_overwrite(
+    (amd_req(Tag<I>{}, n, nnz) | camd_req(Tag<I>{}, n, nnz) |
+     nested_dissection_req(Tag<I>{}, n, nnz) |
+     factorize_symbolic_req(Tag<I>{}, n, nnz, Ordering::user_provided) |
+     factorize_numeric_req(
+       Tag<T>{}, Tag<I>{}, n, nnz, Ordering::user_provided))
+      .alloc_req());
+  dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+  // number of non zeros of the factor with the natural ordering
+  isize natural_lnnz = 0;
+  for (isize k = 0; k < 4; ++k) {
+    Vec<I> perm;
+    perm.resize_for_overwrite(n);
+    if (k == 0) {
+      for (isize i = 0; i < n; ++i) {
+        perm[i] = i;
+      }
+    } else if (k == 1) {
+      amd(perm.ptr_mut(), a.symbolic(), stack);
+    } else if (k == 2) {
+      camd(perm.ptr_mut(), a.symbolic(), cons.ptr(), stack);
+    } else {
+      nested_dissection(perm.ptr_mut(), a.symbolic(), stack);
+    }
+
+    Vec<bool> seen;
+    for (isize i = 0; i < n; ++i) {
+      seen.push(false);
+    }
+    for (isize i = 0; i < n; ++i) {
+      CHECK(perm[i] >= 0);
+      CHECK(perm[i] < n);
+      CHECK(!seen[perm[i]]);
+      seen[perm[i]] = true;
+    }
+    if (k == 2) {
+      for (isize i = 0; i + 1 < n; ++i) {
+        CHECK(cons[perm[i]] <= cons[perm[i + 1]]);
+      }
+    }
+
+    Vec<I> perm_inv;
+    Vec<I> etree;
+    Vec<I> l_nnz_per_col;
+    perm_inv.resize_for_overwrite(n);
+    etree.resize_for_overwrite(n);
+    l_nnz_per_col.resize_for_overwrite(n);
+    factorize_symbolic_non_zeros(l_nnz_per_col.ptr_mut(),
+                                 etree.ptr_mut(),
+                                 perm_inv.ptr_mut(),
+                                 perm.ptr(),
+                                 a.symbolic(),
+                                 stack);
+
+    Vec<I> l_col_ptrs;
+    l_col_ptrs.push(0);
+    for (isize j = 0; j < n; ++j) {
+      l_col_ptrs.push(l_col_ptrs[j] + l_nnz_per_col[j]);
+    }
+    isize lnnz = l_col_ptrs[n];
+    if (k == 0) {
+      natural_lnnz = lnnz;
+    } else if (k != 2) {
+      CHECK(4 * lnnz < natural_lnnz);
+    }
+
+    Vec<I> row_indices;
+    Vec<T> values;
+    row_indices.resize_for_overwrite(lnnz);
+    values.resize_for_overwrite(lnnz);
+    factorize_numeric(values.ptr_mut(),
+                      row_indices.ptr_mut(),
+                      diag.ptr(),
+                      perm.ptr(),
+                      l_col_ptrs.ptr(),
+                      etree.ptr(),
+                      perm_inv.ptr(),
+                      a,
+                      stack);
+
+    MatRef<T, I> ld{
+      from_raw_parts, n,      n, lnnz, l_col_ptrs.ptr(), nullptr,
+      row_indices.ptr(), values.ptr(),
+    };
+    CHECK((reconstruct_with_perm(perm_inv.as_ref(), ld) - a_full).norm() <
+          T(1e-8) * a_full.norm());
+  }
+}
+
+TEST_CASE("ldlt: parallel transpose and symmetric permutation")
+{
+  namespace sparse = proxsuite::linalg::sparse;
+  using I = isize;
+  using T = double;
+
+  // upper triangular part of a symmetric matrix with an irregular pattern,
+  // and a few empty columns
+  isize n = 300;
+  Vec<I> col_ptrs;
+  Vec<I> row_ind;
+  Vec<T> vals;
+  col_ptrs.push(0);
+  for (isize j = 0; j < n; ++j) {
+    for (isize i = 0; i <= j; ++i) {
+      bool empty = j % 37 == 5;
+      if (!empty && (i == j || (i * 31 + j * 17) % 11 == 0 || i < 3)) {
+        row_ind.push(i);
+        vals.push(T(i + 1) / T(j + 2));
+      }
+    }
+    col_ptrs.push(row_ind.len());
+  }
+  isize nnz = row_ind.len();
+  auto a = MatRef<T, I>{
+    from_raw_parts, n,          n, nnz, col_ptrs.ptr(), nullptr,
+    row_ind.ptr(),  vals.ptr(),
+  };
+
+  Vec<I> perm_inv;
+  for (isize i = 0; i < n; ++i) {
+    perm_inv.push((i * 7 + 3) % n);
+  }
+
+  isize max_threads = 4;
+  Vec<unsigned char> _stack;
+  _stack.resize_for_overwrite(
+    (transpose_req(Tag<I>{}, n, max_threads) |
+     sparse::_detail::symmetric_permute_req(Tag<I>{}, n, max_threads))
+      .alloc_req());
+  dynstack::DynStackMut stack{ from_slice_mut, _stack.as_mut() };
+
+  Vec<I> ref_col_ptrs;
+  Vec<I> ref_row_ind;
+  Vec<T> ref_vals;
+  ref_col_ptrs.resize_for_overwrite(n + 1);
+  ref_row_ind.resize_for_overwrite(nnz);
+  ref_vals.resize_for_overwrite(nnz);
+  Vec<I> out_col_ptrs;
+  Vec<I> out_row_ind;
+  Vec<T> out_vals;
+  out_col_ptrs.resize_for_overwrite(n + 1);
+  out_row_ind.resize_for_overwrite(nnz);
+  out_vals.resize_for_overwrite(nnz);
+
+  auto mat = [&](Vec<I>& cp, Vec<I>& ri, Vec<T>& v) {
+    cp[0] = 0;
+    cp[n] = I(nnz);
+    return MatMut<T, I>{
+      from_raw_parts, n,         n, nnz, cp.ptr_mut(), nullptr,
+      ri.ptr_mut(),   v.ptr_mut(),
+    };
+  };
+  auto symbolic_mat = [&](Vec<I>& cp, Vec<I>& ri) {
+    cp[0] = 0;
+    cp[n] = I(nnz);
+    return SymbolicMatMut<I>{
+      from_raw_parts, n, n, nnz, cp.ptr_mut(), nullptr, ri.ptr_mut(),
+    };
+  };
+  auto check_same = [&] {
+    for (isize j = 0; j <= n; ++j) {
+      CHECK(out_col_ptrs[j] == ref_col_ptrs[j]);
+    }
+    for (isize p = 0; p < nnz; ++p) {
+      CHECK(out_row_ind[p] == ref_row_ind[p]);
+      CHECK(out_vals[p] == ref_vals[p]);
+    }
+  };
+
+  for (isize nb_threads = 2; nb_threads <= max_threads; ++nb_threads) {
+    transpose(mat(ref_col_ptrs, ref_row_ind, ref_vals), a, stack);
+    transpose(mat(out_col_ptrs, out_row_ind, out_vals), a, stack, nb_threads);
+    check_same();
+
+    transpose_symbolic(symbolic_mat(out_col_ptrs, out_row_ind),
+                       a.symbolic(),
+                       stack,
+                       nb_threads);
+    for (isize p = 0; p < nnz; ++p) {
+      CHECK(out_row_ind[p] == ref_row_ind[p]);
+    }
+
+    sparse::_detail::symmetric_permute(
+      mat(ref_col_ptrs, ref_row_ind, ref_vals), a, perm_inv.ptr(), stack);
+    sparse::_detail::symmetric_permute(mat(out_col_ptrs, out_row_ind, out_vals),
+                                       a,
+                                       perm_inv.ptr(),
+                                       stack,
+                                       nb_threads);
+    check_same();
+
+    sparse::_detail::symmetric_permute_symbolic(
+      symbolic_mat(out_col_ptrs, out_row_ind),
+      a.symbolic(),
+      perm_inv.ptr(),
+      stack,
+      nb_threads);
+    for (isize p = 0; p < nnz; ++p) {
+      CHECK(out_row_ind[p] == ref_row_ind[p]);
+    }
+  }
+}
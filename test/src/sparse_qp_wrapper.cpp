@@ -6065,4 +6065,224 @@ TEST_CASE("ProxQP::sparse: init must be called before update")
               .lpNorm<Eigen::Infinity>();
   DOCTEST_CHECK(pri_res <= eps_abs);
   DOCTEST_CHECK(dua_res <= eps_abs);
-}
\ No newline at end of file
+}
+TEST_CASE("ProxQP::sparse: supernodal factorization")
+{
+  double sparsity_factor = 0.3;
+  T eps_abs = T(1e-9);
+  dense::isize dim = 60;
+
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  T strong_convexity_factor(1.e-2);
+  ::proxsuite::proxqp::utils::rand::set_seed(1);
+  proxqp::sparse::SparseModel<T> qp_random = utils::sparse_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  for (bool supernodal_factorization : { false, true }) {
+    proxqp::sparse::QP<T, I> qp(qp_random.H.cast<bool>(),
+                                qp_random.A.cast<bool>(),
+                                qp_random.C.cast<bool>());
+    qp.settings.eps_abs = eps_abs;
+    qp.settings.eps_rel = 0;
+    qp.settings.sparse_backend = SparseBackend::SparseCholesky;
+    qp.settings.supernodal_factorization = supernodal_factorization;
+    qp.init(qp_random.H,
+            qp_random.g,
+            qp_random.A,
+            qp_random.b,
+            qp_random.C,
+            qp_random.l,
+            qp_random.u);
+    qp.solve();
+
+    T pri_res = std::max(
+      (qp_random.A * qp.results.x - qp_random.b).lpNorm<Eigen::Infinity>(),
+      (helpers::positive_part(qp_random.C * qp.results.x - qp_random.u) +
+       helpers::negative_part(qp_random.C * qp.results.x - qp_random.l))
+        .lpNorm<Eigen::Infinity>());
+    T dua_res = (qp_random.H.selfadjointView<Eigen::Upper>() * qp.results.x +
+                 qp_random.g + qp_random.A.transpose() * qp.results.y +
+                 qp_random.C.transpose() * qp.results.z)
+                  .lpNorm<Eigen::Infinity>();
+    DOCTEST_CHECK(pri_res <= eps_abs);
+    DOCTEST_CHECK(dua_res <= eps_abs);
+    DOCTEST_CHECK(qp.work.internal.do_supernodal_fact ==
+                  supernodal_factorization);
+  }
+}
+
+TEST_CASE("ProxQP::sparse: fill reducing orderings")
+{
+  double sparsity_factor = 0.05;
+  T eps_abs = T(1e-9);
+  dense::isize dim = 200;
+
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  T strong_convexity_factor(1.e-2);
+  ::proxsuite::proxqp::utils::rand::set_seed(1);
+  proxqp::sparse::SparseModel<T> qp_random = utils::sparse_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  for (SparseOrdering sparse_ordering : { SparseOrdering::Automatic,
+                                          SparseOrdering::Natural,
+                                          SparseOrdering::AMD,
+                                          SparseOrdering::ConstrainedAMD,
+                                          SparseOrdering::NestedDissection }) {
+    // the symbolic factorization computed at construction uses the default
+    // ordering, and is redone by init when another one is selected
+    proxqp::sparse::QP<T, I> qp(qp_random.H.cast<bool>(),
+                                qp_random.A.cast<bool>(),
+                                qp_random.C.cast<bool>());
+    qp.settings.eps_abs = eps_abs;
+    qp.settings.eps_rel = 0;
+    qp.settings.sparse_backend = SparseBackend::SparseCholesky;
+    qp.settings.sparse_ordering = sparse_ordering;
+    qp.init(qp_random.H,
+            qp_random.g,
+            qp_random.A,
+            qp_random.b,
+            qp_random.C,
+            qp_random.l,
+            qp_random.u);
+    qp.solve();
+
+    T pri_res = std::max(
+      (qp_random.A * qp.results.x - qp_random.b).lpNorm<Eigen::Infinity>(),
+      (helpers::positive_part(qp_random.C * qp.results.x - qp_random.u) +
+       helpers::negative_part(qp_random.C * qp.results.x - qp_random.l))
+        .lpNorm<Eigen::Infinity>());
+    T dua_res = (qp_random.H.selfadjointView<Eigen::Upper>() * qp.results.x +
+                 qp_random.g + qp_random.A.transpose() * qp.results.y +
+                 qp_random.C.transpose() * qp.results.z)
+                  .lpNorm<Eigen::Infinity>();
+    DOCTEST_CHECK(pri_res <= eps_abs);
+    DOCTEST_CHECK(dua_res <= eps_abs);
+    DOCTEST_CHECK(qp.work.internal.ordering == sparse_ordering);
+    // the automatic ordering reports the one it selected
+    if (sparse_ordering == SparseOrdering::Automatic) {
+      DOCTEST_CHECK(qp.results.info.sparse_ordering !=
+                    SparseOrdering::Automatic);
+    } else {
+      DOCTEST_CHECK(qp.results.info.sparse_ordering == sparse_ordering);
+    }
+    DOCTEST_CHECK(qp.results.info.factor_nnz >= dim + n_eq + n_in);
+    DOCTEST_CHECK(qp.results.info.factor_flops > 0);
+  }
+}
+
+TEST_CASE("ProxQP::sparse: factor with 64 bits indices")
+{
+  // the number of non zeros of the factor overflows 16 bits indices, while
+  // the one of the KKT matrix does not
+  using I16 = short;
+  double sparsity_factor = 0.03;
+  T eps_abs = T(1e-9);
+  dense::isize dim = 400;
+
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  T strong_convexity_factor(1.e-2);
+  ::proxsuite::proxqp::utils::rand::set_seed(1);
+  proxqp::sparse::SparseModel<T> qp_random = utils::sparse_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  for (bool supernodal_factorization : { false, true }) {
+    proxqp::sparse::QP<T, I16> qp(dim, n_eq, n_in);
+    qp.settings.eps_abs = eps_abs;
+    qp.settings.eps_rel = 0;
+    qp.settings.supernodal_factorization = supernodal_factorization;
+    qp.init(qp_random.H,
+            qp_random.g,
+            qp_random.A,
+            qp_random.b,
+            qp_random.C,
+            qp_random.l,
+            qp_random.u);
+    qp.solve();
+
+    T pri_res = std::max(
+      (qp_random.A * qp.results.x - qp_random.b).lpNorm<Eigen::Infinity>(),
+      (helpers::positive_part(qp_random.C * qp.results.x - qp_random.u) +
+       helpers::negative_part(qp_random.C * qp.results.x - qp_random.l))
+        .lpNorm<Eigen::Infinity>());
+    T dua_res = (qp_random.H.selfadjointView<Eigen::Upper>() * qp.results.x +
+                 qp_random.g + qp_random.A.transpose() * qp.results.y +
+                 qp_random.C.transpose() * qp.results.z)
+                  .lpNorm<Eigen::Infinity>();
+    DOCTEST_CHECK(pri_res <= eps_abs);
+    DOCTEST_CHECK(dua_res <= eps_abs);
+    DOCTEST_CHECK(qp.results.info.factor_nnz > 32767);
+    DOCTEST_CHECK(qp.work.internal.wide_ldl);
+    DOCTEST_CHECK(qp.results.info.sparse_backend ==
+                  SparseBackend::SparseCholesky);
+  }
+
+  // a factor exceeding the memory budget switches to the matrix free backend
+  proxqp::sparse::QP<T, I16> qp(dim, n_eq, n_in);
+  qp.settings.eps_abs = eps_abs;
+  qp.settings.eps_rel = 0;
+  qp.settings.sparse_factorization_memory_budget = 1000;
+  qp.init(qp_random.H,
+          qp_random.g,
+          qp_random.A,
+          qp_random.b,
+          qp_random.C,
+          qp_random.l,
+          qp_random.u);
+  DOCTEST_CHECK(!qp.work.internal.do_ldlt);
+}
+
+TEST_CASE("ProxQP::sparse: update follows the memory budget of the factor")
+{
+  double sparsity_factor = 0.15;
+  T eps_abs = T(1e-9);
+  dense::isize dim = 100;
+
+  dense::isize n_eq(dim / 4);
+  dense::isize n_in(dim / 2);
+  T strong_convexity_factor(1.e-2);
+  ::proxsuite::proxqp::utils::rand::set_seed(1);
+  proxqp::sparse::SparseModel<T> qp_random = utils::sparse_strongly_convex_qp(
+    dim, n_eq, n_in, sparsity_factor, strong_convexity_factor);
+
+  proxqp::sparse::QP<T, I> qp(dim, n_eq, n_in);
+  qp.settings.eps_abs = eps_abs;
+  qp.settings.eps_rel = 0;
+  qp.init(qp_random.H,
+          qp_random.g,
+          qp_random.A,
+          qp_random.b,
+          qp_random.C,
+          qp_random.l,
+          qp_random.u);
+  DOCTEST_CHECK(qp.work.internal.do_ldlt);
+
+  // the symbolic factorization is kept by the update, while the choice of
+  // the backend is redone with the new budget
+  for (dense::isize memory_budget : { 1000, 0 }) {
+    qp.settings.sparse_factorization_memory_budget = memory_budget;
+    qp.update(qp_random.H,
+              qp_random.g,
+              qp_random.A,
+              qp_random.b,
+              qp_random.C,
+              qp_random.l,
+              qp_random.u);
+    DOCTEST_CHECK(qp.work.internal.do_ldlt == (memory_budget == 0));
+    qp.solve();
+
+    T pri_res = std::max(
+      (qp_random.A * qp.results.x - qp_random.b).lpNorm<Eigen::Infinity>(),
+      (helpers::positive_part(qp_random.C * qp.results.x - qp_random.u) +
+       helpers::negative_part(qp_random.C * qp.results.x - qp_random.l))
+        .lpNorm<Eigen::Infinity>());
+    T dua_res = (qp_random.H.selfadjointView<Eigen::Upper>() * qp.results.x +
+                 qp_random.g + qp_random.A.transpose() * qp.results.y +
+                 qp_random.C.transpose() * qp.results.z)
+                  .lpNorm<Eigen::Infinity>();
+    DOCTEST_CHECK(pri_res <= eps_abs);
+    DOCTEST_CHECK(dua_res <= eps_abs);
+  }
+}